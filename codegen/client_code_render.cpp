@@ -71,6 +71,19 @@ void ClientCodeRender::GenerateStubHpp(SyntaxTree *stree, FILE *write) {
     fprintf(write, "class BaseMessageHandlerFactory;\n");
     fprintf(write, "class BaseTcpStream;\n");
     fprintf(write, "class ClientMonitor;\n");
+    fprintf(write, "class EndpointStat;\n");
+    fprintf(write, "class HshaServer;\n");
+    fprintf(write, "class UThreadEpollScheduler;\n");
+    fprintf(write, "class UThreadPipelinedConnection;\n");
+    if (stree->HasBatch()) {
+        fprintf(write, "class BatchRequest;\n");
+        fprintf(write, "class BatchResponse;\n");
+    }
+    if (stree->HasServerStreaming()) {
+        fprintf(write, "\n");
+        fprintf(write, "template <typename Message>\n");
+        fprintf(write, "class StreamReader;\n");
+    }
     fprintf(write, "\n");
     fprintf(write, "\n");
     fprintf(write, "}\n");
@@ -90,6 +103,12 @@ void ClientCodeRender::GenerateStubHpp(SyntaxTree *stree, FILE *write) {
         fprintf(write, "\n");
 
         fprintf(write, "    void set_keep_alive(const bool keep_alive);\n\n");
+        fprintf(write, "    void set_endpoint_stat(phxrpc::EndpointStat *endpoint_stat);\n\n");
+        fprintf(write, "    // for the calls other than server-streaming ones to share a connection\n");
+        fprintf(write, "    void set_pipeline(phxrpc::UThreadPipelinedConnection *pipeline);\n\n");
+        fprintf(write, "    // for the calls to go to local_server of this process in place of socket\n");
+        fprintf(write, "    void set_local(phxrpc::HshaServer *local_server, "
+                "phxrpc::UThreadEpollScheduler *scheduler);\n\n");
 
         auto flist(stree->func_list());
         auto fit(flist->cbegin());
@@ -98,12 +117,20 @@ void ClientCodeRender::GenerateStubHpp(SyntaxTree *stree, FILE *write) {
             GetStubFuncDeclaration(stree, &(*fit), 1, &buffer);
             fprintf(write, "    %s;\n", buffer.c_str());
         }
+        if (stree->HasBatch()) {
+            fprintf(write, "    // calls to a method marked option (phxrpc.Batch) sent together\n");
+            fprintf(write, "    int PHXBatch(const phxrpc::BatchRequest &req, phxrpc::BatchResponse *resp);\n");
+        }
         fprintf(write, "\n");
 
         fprintf(write, "  private:\n");
         fprintf(write, "    phxrpc::BaseTcpStream &socket_;\n");
         fprintf(write, "    phxrpc::ClientMonitor &client_monitor_;\n");
         fprintf(write, "    bool keep_alive_{false};\n");
+        fprintf(write, "    phxrpc::EndpointStat *endpoint_stat_{nullptr};\n");
+        fprintf(write, "    phxrpc::UThreadPipelinedConnection *pipeline_{nullptr};\n");
+        fprintf(write, "    phxrpc::HshaServer *local_server_{nullptr};\n");
+        fprintf(write, "    phxrpc::UThreadEpollScheduler *local_scheduler_{nullptr};\n");
         fprintf(write, "    phxrpc::BaseMessageHandlerFactory &msg_handler_factory_;\n");
 
         fprintf(write, "};\n");
@@ -128,7 +155,11 @@ void ClientCodeRender::GetStubFuncDeclaration(const SyntaxTree *const stree, con
     phxrpc::StrAppendFormat(result, "const %s &req, ", type_name);
 
     name_render_.GetMessageClassName(func->GetResp()->GetType(), type_name, sizeof(type_name));
-    phxrpc::StrAppendFormat(result, "%s *resp", type_name);
+    if (func->IsServerStreaming()) {
+        phxrpc::StrAppendFormat(result, "phxrpc::StreamReader<%s> *reader", type_name);
+    } else {
+        phxrpc::StrAppendFormat(result, "%s *resp", type_name);
+    }
 
     phxrpc::StrAppendFormat(result, ")");
 }
@@ -176,12 +207,44 @@ void ClientCodeRender::GenerateStubCpp(SyntaxTree *stree, FILE *write) {
         fprintf(write, "}\n");
         fprintf(write, "\n");
 
+        fprintf(write, "void %s::set_endpoint_stat(phxrpc::EndpointStat *endpoint_stat) {\n", class_name);
+        fprintf(write, "    endpoint_stat_ = endpoint_stat;\n");
+        fprintf(write, "}\n");
+        fprintf(write, "\n");
+
+        fprintf(write, "void %s::set_pipeline(phxrpc::UThreadPipelinedConnection *pipeline) {\n", class_name);
+        fprintf(write, "    pipeline_ = pipeline;\n");
+        fprintf(write, "}\n");
+        fprintf(write, "\n");
+
+        fprintf(write, "void %s::set_local(phxrpc::HshaServer *local_server, "
+                "phxrpc::UThreadEpollScheduler *scheduler) {\n", class_name);
+        fprintf(write, "    local_server_ = local_server;\n");
+        fprintf(write, "    local_scheduler_ = scheduler;\n");
+        fprintf(write, "}\n");
+        fprintf(write, "\n");
+
         auto flist(stree->func_list());
         auto fit(flist->cbegin());
         for (; flist->cend() != fit; ++fit) {
             GenerateStubFunc(stree, &(*fit), write);
         }
 
+        if (stree->HasBatch()) {
+            fprintf(write, "int %s::PHXBatch(const phxrpc::BatchRequest &req, "
+                    "phxrpc::BatchResponse *resp) {\n", class_name);
+            fprintf(write, "    phxrpc::Caller caller(socket_, client_monitor_, msg_handler_factory_);\n");
+            fprintf(write, "    caller.set_uri(\"/%s/PHXBatch\", -1);\n",
+                    SyntaxTree::Pb2UriPackageName(stree->package_name()).c_str());
+            fprintf(write, "    caller.set_keep_alive(keep_alive_);\n");
+            fprintf(write, "    caller.set_endpoint_stat(endpoint_stat_);\n");
+            fprintf(write, "    caller.set_pipeline(pipeline_);\n");
+            fprintf(write, "    caller.set_local(local_server_, local_scheduler_);\n");
+            fprintf(write, "    return caller.Call(req, resp);\n");
+            fprintf(write, "}\n");
+            fprintf(write, "\n");
+        }
+
     }
 }
 
@@ -194,12 +257,35 @@ void ClientCodeRender::GenerateStubFunc(const SyntaxTree *const stree,
 
     fprintf(write, "%s {\n", buffer.c_str());
 
+    // nothing comes back to revalidate or decompress for a one-way one
+    const bool etag{func->IsETag() && !func->IsServerStreaming() && !func->IsOneWay()};
+    if (etag) {
+        fprintf(write, "    // the last response to each req, sent again by the server only if changed\n");
+        fprintf(write, "    static phxrpc::ETagCache etag_cache;\n");
+        fprintf(write, "\n");
+    }
+
     fprintf(write, "    phxrpc::Caller caller(socket_, client_monitor_, msg_handler_factory_);\n");
     fprintf(write, "    caller.set_uri(\"/%s/%s\", %d);\n",
             SyntaxTree::Pb2UriPackageName(stree->package_name()).c_str(),
             func->GetName(), func->GetCmdID());
     fprintf(write, "    caller.set_keep_alive(keep_alive_);\n");
-    fprintf(write, "    return caller.Call(req, resp);\n");
+    fprintf(write, "    caller.set_endpoint_stat(endpoint_stat_);\n");
+    fprintf(write, "    caller.set_local(local_server_, local_scheduler_);\n");
+    if (func->IsServerStreaming()) {
+        fprintf(write, "    return caller.CallStream(req, reader);\n");
+    } else {
+        fprintf(write, "    caller.set_pipeline(pipeline_);\n");
+        if (etag) {
+            fprintf(write, "    caller.set_etag_cache(&etag_cache);\n");
+        }
+        if (func->IsOneWay()) {
+            fprintf(write, "    caller.set_one_way(true);\n");
+        } else if (0 < func->GetCompressMinBytes()) {
+            fprintf(write, "    caller.set_accept_encoding(true);\n");
+        }
+        fprintf(write, "    return caller.Call(req, resp);\n");
+    }
 
     fprintf(write, "}\n");
     fprintf(write, "\n");
@@ -242,6 +328,16 @@ void ClientCodeRender::GenerateClientHpp(SyntaxTree *stree,
                 GetClienfuncDeclaration(stree, &echo_func, 1, &buffer, is_uthread_mode);
                 declarations.append("    ").append(buffer).append(";\n");
             }
+
+            // for threads outside any scheduler, run by phxrpc::ClientRuntime::Default
+            if (!is_uthread_mode && !fit->IsServerStreaming()) {
+                string buffer;
+                GetAsyncClientFuncDeclaration(stree, &(*fit), 1, false, &buffer);
+                declarations.append("    ").append(buffer).append(";\n");
+                buffer.clear();
+                GetAsyncClientFuncDeclaration(stree, &(*fit), 1, true, &buffer);
+                declarations.append("    ").append(buffer).append(";\n");
+            }
         }
     }
 
@@ -320,22 +416,80 @@ void ClientCodeRender::GenerateClientCpp(SyntaxTree *stree,
             functions.append(buffer).append("\n");
 
             string content;
-            if (!is_uthread_mode) {
-                content = PHXRPC_CLIENT_FUNC_TEMPLATE;
+            if (fit->IsServerStreaming()) {
+                if (!is_uthread_mode) {
+                    content = PHXRPC_CLIENT_STREAM_FUNC_TEMPLATE;
+                } else {
+                    content = PHXRPC_UTHREAD_CLIENT_STREAM_FUNC_TEMPLATE;
+                }
             } else {
-                content = PHXRPC_UTHREAD_CLIENT_FUNC_TEMPLATE;
+                // a one-way call is over once sent, nothing to wait for together or twice
+                if (!is_uthread_mode && fit->IsBatch() && !fit->IsOneWay()) {
+                    content = PHXRPC_CLIENT_BATCHED_FUNC_TEMPLATE;
+                } else if (!is_uthread_mode) {
+                    content = PHXRPC_CLIENT_FUNC_TEMPLATE;
+                } else if (fit->IsHedge() && !fit->IsOneWay()) {
+                    content = PHXRPC_UTHREAD_CLIENT_HEDGE_FUNC_TEMPLATE;
+                } else {
+                    content = PHXRPC_UTHREAD_CLIENT_FUNC_TEMPLATE;
+                }
             }
 
             StrTrim(&content);
+            if (0 < fit->GetCacheTTLMS() && !fit->IsServerStreaming() && !fit->IsOneWay()) {
+                // what a miss does is the body of the function without a cache
+                StrReplaceAll(&content, "\n", "\n            ");
+                StrReplaceAll(&content, "\n            \n", "\n\n");
+
+                string cached_content(PHXRPC_CLIENT_CACHED_FUNC_TEMPLATE);
+                StrTrim(&cached_content);
+                StrReplaceAll(&cached_content, "$CacheTTLMS$", to_string(fit->GetCacheTTLMS()));
+                StrReplaceAll(&cached_content, "$UThreadScheduler$",
+                              is_uthread_mode ? "uthread_scheduler_" : "nullptr");
+                StrReplaceAll(&cached_content, "$FuncBody$", content);
+                content = cached_content;
+            }
             StrReplaceAll(&content, "$ClientClass$", client_class_str.c_str());
             StrReplaceAll(&content, "$ClientClassLower$", client_class_lower_str.c_str());
             StrReplaceAll(&content, "$StubClass$", stub_class);
             string func_string(fit->GetName());
-            func_string += "(req, resp)";
+            func_string += fit->IsServerStreaming() ? "(req, reader)" : "(req, resp)";
             StrReplaceAll(&content, "$Func$", func_string);
+            StrReplaceAll(&content, "$FuncName$", fit->GetName());
+            string uri("/" + SyntaxTree::Pb2UriPackageName(stree->package_name()) + "/" +
+                       fit->GetName());
+            StrReplaceAll(&content, "$URI$", uri);
+
+            char req_type_name[128]{'\0'}, resp_type_name[128]{'\0'};
+            name_render_.GetMessageClassName(fit->GetReq()->GetType(), req_type_name,
+                                             sizeof(req_type_name));
+            StrReplaceAll(&content, "$ReqClass$", req_type_name);
+            name_render_.GetMessageClassName(fit->GetResp()->GetType(), resp_type_name,
+                                             sizeof(resp_type_name));
+            StrReplaceAll(&content, "$RespClass$", resp_type_name);
 
             functions.append(content).append("\n\n");
 
+            if (!is_uthread_mode && !fit->IsServerStreaming()) {
+                const char *templates[]{PHXRPC_CLIENT_ASYNC_FUNC_TEMPLATE,
+                                        PHXRPC_CLIENT_ASYNC_CALLBACK_FUNC_TEMPLATE};
+                for (int i{0}; 2 > i; ++i) {
+                    string buffer;
+                    GetAsyncClientFuncDeclaration(stree, &(*fit), 0, 1 == i, &buffer);
+                    functions.append(buffer).append("\n");
+
+                    string content(templates[i]);
+                    StrTrim(&content);
+                    StrReplaceAll(&content, "$ClientClassLower$", client_class_lower_str.c_str());
+                    StrReplaceAll(&content, "$StubClass$", stub_class);
+                    StrReplaceAll(&content, "$FuncName$", fit->GetName());
+                    StrReplaceAll(&content, "$ReqClass$", req_type_name);
+                    StrReplaceAll(&content, "$RespClass$", resp_type_name);
+
+                    functions.append(content).append("\n\n");
+                }
+            }
+
             if (0 == strcmp(fit->GetName(), "PHXEcho")) {
                 SyntaxFunc echo_func = *fit;
                 echo_func.SetName("PHXBatchEcho");
@@ -371,6 +525,7 @@ void ClientCodeRender::GenerateClientCpp(SyntaxTree *stree,
     StrReplaceAll(&content, "$PbPackageName$", stree->package_name());
     StrReplaceAll(&content, "$ClientFile$", client_file);
     StrReplaceAll(&content, "$StubFile$", stub_file);
+    StrReplaceAll(&content, "$StubClass$", stub_class);
     StrReplaceAll(&content, "$ClientClass$", client_class_str);
     StrReplaceAll(&content, "$ClientClassLower$", client_class_lower_str.c_str());
     StrReplaceAll(&content, "$ClientClassFuncs$", functions);
@@ -400,7 +555,40 @@ void ClientCodeRender::GetClienfuncDeclaration(const SyntaxTree *const stree,
     phxrpc::StrAppendFormat(result, "const %s &req", type_name);
 
     name_render_.GetMessageClassName(func->GetResp()->GetType(), type_name, sizeof(type_name));
-    phxrpc::StrAppendFormat(result, ", %s *resp", type_name);
+    if (func->IsServerStreaming()) {
+        phxrpc::StrAppendFormat(result, ", phxrpc::StreamReader<%s> *reader", type_name);
+    } else {
+        phxrpc::StrAppendFormat(result, ", %s *resp", type_name);
+    }
+
+    phxrpc::StrAppendFormat(result, ")");
+}
+
+void ClientCodeRender::GetAsyncClientFuncDeclaration(const SyntaxTree *const stree,
+                                                     const SyntaxFunc *const func,
+                                                     const int is_header, const bool is_callback,
+                                                     string *result) {
+    char class_name[128]{'\0'}, type_name[128]{'\0'};
+
+    name_render_.GetClientClassName(stree->GetName(), class_name, sizeof(class_name));
+
+    const char *ret_type{is_callback ? "void" : "std::future<int>"};
+    if (is_header) {
+        phxrpc::StrAppendFormat(result, "%s Async%s(", ret_type, func->GetName());
+    } else {
+        phxrpc::StrAppendFormat(result, "%s %s::Async%s(", ret_type, class_name, func->GetName());
+    }
+
+    name_render_.GetMessageClassName(func->GetReq()->GetType(), type_name, sizeof(type_name));
+    phxrpc::StrAppendFormat(result, "const %s &req", type_name);
+
+    name_render_.GetMessageClassName(func->GetResp()->GetType(), type_name, sizeof(type_name));
+    if (is_callback) {
+        phxrpc::StrAppendFormat(result, ", std::function<void(int ret, %s *resp)> callback",
+                                type_name);
+    } else {
+        phxrpc::StrAppendFormat(result, ", %s *resp", type_name);
+    }
 
     phxrpc::StrAppendFormat(result, ")");
 }
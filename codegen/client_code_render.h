@@ -56,6 +56,11 @@ class ClientCodeRender {
     void GetClienfuncDeclaration(const SyntaxTree *const stree, const SyntaxFunc *const func,
                                  const int is_header, std::string *result, const bool is_uthread_mode);
 
+    // AsyncFunc of the blocking client, returning a future, or taking a callback
+    void GetAsyncClientFuncDeclaration(const SyntaxTree *const stree, const SyntaxFunc *const func,
+                                       const int is_header, const bool is_callback,
+                                       std::string *result);
+
     NameRender &name_render_;
 };
 
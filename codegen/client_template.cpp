@@ -22,6 +22,9 @@ See the AUTHORS file for names of contributors.
 const char *PHXRPC_CLIENT_HPP_TEMPLATE =
         R"(
 
+#include <functional>
+#include <future>
+
 #include "$MessageFile$.h"
 #include "phxrpc/rpc.h"
 
@@ -73,6 +76,7 @@ const char *PHXRPC_CLIENT_CPP_TEMPLATE =
 #include "$ClientFile$.h"
 
 #include <cstdlib>
+#include <cstring>
 #include <memory>
 #include <mutex>
 
@@ -87,10 +91,41 @@ using namespace std;
 
 static phxrpc::ClientConfig global_$ClientClassLower$_config_;
 static phxrpc::ClientMonitorPtr global_$ClientClassLower$_monitor_;
+static phxrpc::BlockConnectionPool global_$ClientClassLower$_pool_(global_$ClientClassLower$_config_);
+// for the Async calls, run in the threads of phxrpc::ClientRuntime::Default
+static phxrpc::UThreadConnectionPool global_$ClientClassLower$_async_pool_(global_$ClientClassLower$_config_);
+static phxrpc::ResponseCache global_$ClientClassLower$_cache_(global_$ClientClassLower$_config_);
+
+
+// func is called on a stub handing its requests to the HshaServer of this process
+// named by ep of local:<PackageName>, there is no connection to it
+template <typename Func>
+static int CallLocalServer(const phxrpc::Endpoint_t &ep,
+                           phxrpc::UThreadEpollScheduler *uthread_scheduler, Func func) {
+    // kept up till the stub is done with it
+    std::shared_ptr<phxrpc::HshaServer> local_server{
+            phxrpc::HshaServer::FindLocal(strchr(ep.ip, ':') + 1)};
+    if (!local_server) {
+        return -1;
+    }
+
+    phxrpc::BlockTcpStream socket;
+    phxrpc::HttpMessageHandlerFactory http_msg_factory;
+    $StubClass$ stub(socket, *(global_$ClientClassLower$_monitor_.get()), http_msg_factory);
+    stub.set_endpoint_stat(ep.stat);
+    stub.set_local(local_server.get(), uthread_scheduler);
+
+    return func(stub);
+}
 
 
 bool $ClientClass$::Init(const char *config_file) {
-    return global_$ClientClassLower$_config_.Read(config_file);
+    if (!global_$ClientClassLower$_config_.Read(config_file)) {
+        return false;
+    }
+    global_$ClientClassLower$_pool_.WarmUp();
+
+    return true;
 }
 
 const char *$ClientClass$::GetPackageName() {
@@ -128,6 +163,7 @@ const char *PHXRPC_UTHREAD_CLIENT_CPP_TEMPLATE =
 #include "$ClientFile$_uthread.h"
 
 #include <cstdlib>
+#include <cstring>
 #include <memory>
 #include <mutex>
 
@@ -142,6 +178,31 @@ using namespace std;
 
 static phxrpc::ClientConfig global_$ClientClassLower$_config_;
 static phxrpc::ClientMonitorPtr global_$ClientClassLower$_monitor_;
+static phxrpc::UThreadConnectionPool global_$ClientClassLower$_pool_(global_$ClientClassLower$_config_);
+static phxrpc::UThreadPipelinePool global_$ClientClassLower$_pipelines_(global_$ClientClassLower$_config_);
+static phxrpc::ResponseCache global_$ClientClassLower$_cache_(global_$ClientClassLower$_config_);
+
+
+// func is called on a stub handing its requests to the HshaServer of this process
+// named by ep of local:<PackageName>, there is no connection to it
+template <typename Func>
+static int CallLocalServer(const phxrpc::Endpoint_t &ep,
+                           phxrpc::UThreadEpollScheduler *uthread_scheduler, Func func) {
+    // kept up till the stub is done with it
+    std::shared_ptr<phxrpc::HshaServer> local_server{
+            phxrpc::HshaServer::FindLocal(strchr(ep.ip, ':') + 1)};
+    if (!local_server) {
+        return -1;
+    }
+
+    phxrpc::BlockTcpStream socket;
+    phxrpc::HttpMessageHandlerFactory http_msg_factory;
+    $StubClass$ stub(socket, *(global_$ClientClassLower$_monitor_.get()), http_msg_factory);
+    stub.set_endpoint_stat(ep.stat);
+    stub.set_local(local_server.get(), uthread_scheduler);
+
+    return func(stub);
+}
 
 
 bool $ClientClass$::Init(const char *config_file) {
@@ -181,17 +242,20 @@ $ClientClassFuncs$
 const char *PHXRPC_CLIENT_FUNC_TEMPLATE =
         R"(
 {
-    const phxrpc::Endpoint_t *ep{global_$ClientClassLower$_config_.GetRandom()};
+    const phxrpc::Endpoint_t *ep{global_$ClientClassLower$_config_.Select()};
+
+    if (ep && ep->local) {
+        return CallLocalServer(*ep, nullptr, [&]($StubClass$ &stub) { return stub.$Func$; });
+    }
 
     if (ep) {
-        phxrpc::BlockTcpStream socket;
-        bool open_ret{phxrpc::PhxrpcTcpUtils::Open(&socket, ep->ip, ep->port,
-                global_$ClientClassLower$_config_.GetConnectTimeoutMS(), nullptr, 0,
-                *(global_$ClientClassLower$_monitor_.get()))};
-        if (open_ret) {
-            socket.SetTimeout(global_$ClientClassLower$_config_.GetSocketTimeoutMS());
+        auto socket(global_$ClientClassLower$_pool_.Get(*ep,
+                *(global_$ClientClassLower$_monitor_.get())));
+        if (socket) {
             phxrpc::HttpMessageHandlerFactory http_msg_factory;
-            $StubClass$ stub(socket, *(global_$ClientClassLower$_monitor_.get()), http_msg_factory);
+            $StubClass$ stub(*socket, *(global_$ClientClassLower$_monitor_.get()), http_msg_factory);
+            stub.set_keep_alive(global_$ClientClassLower$_pool_.keep_alive());
+            stub.set_endpoint_stat(ep->stat);
             return stub.$Func$;
         }
 
@@ -206,17 +270,36 @@ const char *PHXRPC_CLIENT_FUNC_TEMPLATE =
 const char *PHXRPC_UTHREAD_CLIENT_FUNC_TEMPLATE =
         R"(
 {
-    const phxrpc::Endpoint_t *ep{global_$ClientClassLower$_config_.GetRandom()};
+    const phxrpc::Endpoint_t *ep{global_$ClientClassLower$_config_.Select()};
+
+    if (ep && ep->local) {
+        return CallLocalServer(*ep, uthread_scheduler_,
+                [&]($StubClass$ &stub) { return stub.$Func$; });
+    }
+
+    if (uthread_scheduler_ && ep && !ep->shm && global_$ClientClassLower$_pipelines_.enabled()) {
+        // calls of the scheduler to ep share [ConnectionPool] PipelinesPerEndpoint connections,
+        // but for shm ones, whose reads and writes wait on the same eventfd
+        auto pipeline(global_$ClientClassLower$_pipelines_.Get(uthread_scheduler_, *ep));
+        if (pipeline) {
+            phxrpc::HttpMessageHandlerFactory http_msg_factory;
+            $StubClass$ stub(pipeline->stream(), *(global_$ClientClassLower$_monitor_.get()), http_msg_factory);
+            stub.set_pipeline(pipeline);
+            stub.set_endpoint_stat(ep->stat);
+            return stub.$Func$;
+        }
+
+        return -1;
+    }
 
     if (uthread_scheduler_ && ep) {
-        phxrpc::UThreadTcpStream socket;
-        bool open_ret{phxrpc::PhxrpcTcpUtils::Open(uthread_scheduler_, &socket, ep->ip, ep->port,
-                global_$ClientClassLower$_config_.GetConnectTimeoutMS(),
-                *(global_$ClientClassLower$_monitor_.get()))};
-        if (open_ret) {
-            socket.SetTimeout(global_$ClientClassLower$_config_.GetSocketTimeoutMS());
+        auto socket(global_$ClientClassLower$_pool_.Get(uthread_scheduler_, *ep,
+                *(global_$ClientClassLower$_monitor_.get())));
+        if (socket) {
             phxrpc::HttpMessageHandlerFactory http_msg_factory;
-            $StubClass$ stub(socket, *(global_$ClientClassLower$_monitor_.get()), http_msg_factory);
+            $StubClass$ stub(*socket, *(global_$ClientClassLower$_monitor_.get()), http_msg_factory);
+            stub.set_keep_alive(global_$ClientClassLower$_pool_.keep_alive());
+            stub.set_endpoint_stat(ep->stat);
             return stub.$Func$;
         }
     }
@@ -227,6 +310,211 @@ const char *PHXRPC_UTHREAD_CLIENT_FUNC_TEMPLATE =
 
 //////////////////////////////////////////////////////////////////////
 
+const char *PHXRPC_CLIENT_STREAM_FUNC_TEMPLATE =
+        R"(
+{
+    const phxrpc::Endpoint_t *ep{global_$ClientClassLower$_config_.Select()};
+
+    if (ep && ep->local) {
+        // refused there, a stream is read from a connection
+        return CallLocalServer(*ep, nullptr, [&]($StubClass$ &stub) { return stub.$Func$; });
+    }
+
+    if (ep) {
+        auto socket(global_$ClientClassLower$_pool_.Get(*ep,
+                *(global_$ClientClassLower$_monitor_.get())));
+        if (socket) {
+            phxrpc::HttpMessageHandlerFactory http_msg_factory;
+            $StubClass$ stub(*socket, *(global_$ClientClassLower$_monitor_.get()), http_msg_factory);
+            stub.set_endpoint_stat(ep->stat);
+            int ret{stub.$Func$};
+            if (0 == ret) {
+                // messages are read from the connection as reader is asked for them,
+                // it is closed with the reader
+                reader->HoldSocket(socket.Release());
+            }
+            return ret;
+        }
+
+    }
+
+    return -1;
+}
+)";
+
+//////////////////////////////////////////////////////////////////////
+
+const char *PHXRPC_UTHREAD_CLIENT_STREAM_FUNC_TEMPLATE =
+        R"(
+{
+    const phxrpc::Endpoint_t *ep{global_$ClientClassLower$_config_.Select()};
+
+    if (ep && ep->local) {
+        // refused there, a stream is read from a connection
+        return CallLocalServer(*ep, uthread_scheduler_,
+                [&]($StubClass$ &stub) { return stub.$Func$; });
+    }
+
+    if (uthread_scheduler_ && ep) {
+        auto socket(global_$ClientClassLower$_pool_.Get(uthread_scheduler_, *ep,
+                *(global_$ClientClassLower$_monitor_.get())));
+        if (socket) {
+            phxrpc::HttpMessageHandlerFactory http_msg_factory;
+            $StubClass$ stub(*socket, *(global_$ClientClassLower$_monitor_.get()), http_msg_factory);
+            stub.set_endpoint_stat(ep->stat);
+            int ret{stub.$Func$};
+            if (0 == ret) {
+                // messages are read from the connection as reader is asked for them,
+                // it is closed with the reader
+                reader->HoldSocket(socket.Release());
+            }
+            return ret;
+        }
+    }
+
+    return -1;
+}
+)";
+
+//////////////////////////////////////////////////////////////////////
+
+const char *PHXRPC_UTHREAD_CLIENT_HEDGE_FUNC_TEMPLATE =
+        R"(
+{
+    // what slow is for this method, backup calls go out past [Hedge] Percentile of it
+    static phxrpc::LatencyHistogram latency;
+
+    const phxrpc::Endpoint_t *ep{global_$ClientClassLower$_config_.Select()};
+
+    if (ep && ep->local) {
+        // as fast as it gets, no backup for it
+        return CallLocalServer(*ep, uthread_scheduler_,
+                [&]($StubClass$ &stub) { return stub.$Func$; });
+    }
+
+    if (!uthread_scheduler_ || !ep) {
+        return -1;
+    }
+
+    phxrpc::UThreadHedgedCaller caller(uthread_scheduler_, global_$ClientClassLower$_config_,
+            &global_$ClientClassLower$_pool_, *(global_$ClientClassLower$_monitor_.get()), latency,
+            [](phxrpc::BaseTcpStream &socket, phxrpc::EndpointStat *endpoint_stat,
+               const google::protobuf::Message &req, google::protobuf::Message *resp) {
+                phxrpc::HttpMessageHandlerFactory http_msg_factory;
+                $StubClass$ stub(socket, *(global_$ClientClassLower$_monitor_.get()), http_msg_factory);
+                stub.set_keep_alive(global_$ClientClassLower$_pool_.keep_alive());
+                stub.set_endpoint_stat(endpoint_stat);
+                return stub.$FuncName$(static_cast<const $ReqClass$ &>(req),
+                        static_cast<$RespClass$ *>(resp));
+            });
+
+    return caller.Call(*ep, req, resp);
+}
+)";
+
+//////////////////////////////////////////////////////////////////////
+
+const char *PHXRPC_CLIENT_BATCHED_FUNC_TEMPLATE =
+        R"(
+{
+    // calls within [Batch] WindowMS of each other go out together in one PHXBatch call
+    static phxrpc::CallBatcher batcher("$URI$", global_$ClientClassLower$_config_.GetBatchPolicy(),
+            [](const phxrpc::BatchRequest &batch_req, phxrpc::BatchResponse *batch_resp) {
+        const phxrpc::Endpoint_t *ep{global_$ClientClassLower$_config_.Select()};
+
+        if (ep && ep->local) {
+            return CallLocalServer(*ep, nullptr,
+                    [&]($StubClass$ &stub) { return stub.PHXBatch(batch_req, batch_resp); });
+        }
+
+        if (ep) {
+            auto socket(global_$ClientClassLower$_pool_.Get(*ep,
+                    *(global_$ClientClassLower$_monitor_.get())));
+            if (socket) {
+                phxrpc::HttpMessageHandlerFactory http_msg_factory;
+                $StubClass$ stub(*socket, *(global_$ClientClassLower$_monitor_.get()), http_msg_factory);
+                stub.set_keep_alive(global_$ClientClassLower$_pool_.keep_alive());
+                stub.set_endpoint_stat(ep->stat);
+                return stub.PHXBatch(batch_req, batch_resp);
+            }
+        }
+
+        return -1;
+    });
+
+    return batcher.Call(req, resp);
+}
+)";
+
+//////////////////////////////////////////////////////////////////////
+
+const char *PHXRPC_CLIENT_CACHED_FUNC_TEMPLATE =
+        R"(
+{
+    // an equal req within $CacheTTLMS$ ms is answered from the cache
+    return global_$ClientClassLower$_cache_.Call("$URI$", req, resp, $CacheTTLMS$,
+            *(global_$ClientClassLower$_monitor_.get()), $UThreadScheduler$,
+            [&]() $FuncBody$);
+}
+)";
+
+//////////////////////////////////////////////////////////////////////
+
+const char *PHXRPC_CLIENT_ASYNC_FUNC_TEMPLATE =
+        R"(
+{
+    // resp is to stay until the future is ready
+    std::shared_ptr<std::promise<int>> promise(new std::promise<int>);
+    std::future<int> future(promise->get_future());
+
+    Async$FuncName$(req, [promise, resp](int ret, $RespClass$ *async_resp) {
+        resp->Swap(async_resp);
+        promise->set_value(ret);
+    });
+
+    return future;
+}
+)";
+
+const char *PHXRPC_CLIENT_ASYNC_CALLBACK_FUNC_TEMPLATE =
+        R"(
+{
+    // callback runs in a thread of the runtime, it is not to block
+    std::shared_ptr<$ReqClass$> async_req(new $ReqClass$(req));
+
+    bool submitted{phxrpc::ClientRuntime::Default()->Submit(
+            [async_req, callback](phxrpc::UThreadEpollScheduler *uthread_scheduler) {
+        $RespClass$ resp;
+        int ret{-1};
+
+        const phxrpc::Endpoint_t *ep{global_$ClientClassLower$_config_.Select()};
+        if (ep && ep->local) {
+            ret = CallLocalServer(*ep, uthread_scheduler,
+                    [&]($StubClass$ &stub) { return stub.$FuncName$(*async_req, &resp); });
+        } else if (ep) {
+            auto socket(global_$ClientClassLower$_async_pool_.Get(uthread_scheduler, *ep,
+                    *(global_$ClientClassLower$_monitor_.get())));
+            if (socket) {
+                phxrpc::HttpMessageHandlerFactory http_msg_factory;
+                $StubClass$ stub(*socket, *(global_$ClientClassLower$_monitor_.get()), http_msg_factory);
+                stub.set_keep_alive(global_$ClientClassLower$_async_pool_.keep_alive());
+                stub.set_endpoint_stat(ep->stat);
+                ret = stub.$FuncName$(*async_req, &resp);
+            }
+        }
+
+        callback(ret, &resp);
+    })};
+
+    if (!submitted) {
+        $RespClass$ resp;
+        callback(-1, &resp);
+    }
+}
+)";
+
+//////////////////////////////////////////////////////////////////////
+
 const char *PHXRPC_BATCH_CLIENT_FUNC_TEMPLATE =
         R"(
 {
@@ -236,13 +524,20 @@ const char *PHXRPC_BATCH_CLIENT_FUNC_TEMPLATE =
     for (size_t i{0}; echo_server_count > i; ++i) {
         uthread_t [=, &uthread_s, &ret](void *) {
             const phxrpc::Endpoint_t *ep = global_$ClientClassLower$_config_.GetByIndex(i);
-            if (ep != nullptr) {
+            if (ep != nullptr && ep->local) {
+                if (0 == CallLocalServer(*ep, &uthread_s,
+                        [&]($StubClass$ &stub) { return stub.PHXEcho(req, resp); })) {
+                    ret = 0;
+                    uthread_s.Close();
+                }
+            } else if (ep != nullptr) {
                 phxrpc::UThreadTcpStream socket;
-                if (phxrpc::PhxrpcTcpUtils::Open(&uthread_s, &socket, ep->ip, ep->port,
+                if (phxrpc::PhxrpcTcpUtils::Open(&uthread_s, &socket, *ep,
                     global_$ClientClassLower$_config_.GetConnectTimeoutMS(), *(global_$ClientClassLower$_monitor_.get()))) {
                     socket.SetTimeout(global_$ClientClassLower$_config_.GetSocketTimeoutMS());
                     phxrpc::HttpMessageHandlerFactory http_msg_factory;
                     $StubClass$ stub(socket, *(global_$ClientClassLower$_monitor_.get()), http_msg_factory);
+                    stub.set_endpoint_stat(ep->stat);
                     int this_ret{stub.PHXEcho(req, resp)};
                     if (this_ret == 0) {
                         ret = this_ret;
@@ -266,17 +561,51 @@ const char *PHXRPC_CLIENT_ETC_TEMPLATE =
 ConnectTimeoutMS = 100
 SocketTimeoutMS = 30000
 
+[ConnectionPool]
+MaxIdlePerEndpoint = 8
+MaxActivePerEndpoint = 0
+IdleTimeoutMS = 3000
+WarmUpPerEndpoint = 0
+PipelinesPerEndpoint = 0
+
+[OutlierDetection]
+ConsecutiveFailures = 5
+BaseEjectionMS = 5000
+MaxEjectionMS = 60000
+MaxEjectionPercent = 50
+ProbeIntervalMS = 1000
+SlowCallMS = 0
+
+[Hedge]
+DelayMS = 0
+Percentile = 95
+BudgetPercent = 5
+
+[Batch]
+WindowMS = 1
+MaxSize = 64
+
+[Cache]
+MaxEntries = 10000
+
 [Server]
 ServerCount = 2
 PackageName = $PbPackageName$
+# Random, RoundRobin, LeastOutstanding or P2C
+LoadBalancer = Random
 
 [Server0]
+# or unix:<path> of the UnixSocketPath of a server on this host, with no Port,
+# or shm:<path> to go on over shared memory rings if it has ShmRingSize,
+# or local:<PackageName> of a server in this process, handed its requests directly
 IP = 127.0.0.1
 Port = 16161
+Weight = 1
 
 [Server1]
 IP = 127.0.0.1
 Port = 16161
+Weight = 1
 
 )";
 
@@ -30,6 +30,18 @@ extern const char * PHXRPC_UTHREAD_CLIENT_CPP_TEMPLATE;
 extern const char * PHXRPC_CLIENT_FUNC_TEMPLATE;
 extern const char * PHXRPC_UTHREAD_CLIENT_FUNC_TEMPLATE;
 
+extern const char * PHXRPC_CLIENT_STREAM_FUNC_TEMPLATE;
+extern const char * PHXRPC_UTHREAD_CLIENT_STREAM_FUNC_TEMPLATE;
+
+extern const char * PHXRPC_UTHREAD_CLIENT_HEDGE_FUNC_TEMPLATE;
+
+extern const char * PHXRPC_CLIENT_BATCHED_FUNC_TEMPLATE;
+
+extern const char * PHXRPC_CLIENT_CACHED_FUNC_TEMPLATE;
+
+extern const char * PHXRPC_CLIENT_ASYNC_FUNC_TEMPLATE;
+extern const char * PHXRPC_CLIENT_ASYNC_CALLBACK_FUNC_TEMPLATE;
+
 extern const char * PHXRPC_BATCH_CLIENT_FUNC_TEMPLATE;
 extern const char * PHXRPC_CLIENT_ETC_TEMPLATE;
 
@@ -108,6 +108,13 @@ int ProtoUtils::LoadNormal(const char *file_name, SyntaxTree *stree, map<string,
             func.GetResp()->SetName("Resp");
             func.GetResp()->SetType(output_type->full_name().c_str());
 
+            if (method->client_streaming()) {
+                fprintf(stderr, "%s: client streaming is not supported\n", method->name().c_str());
+
+                return -1;
+            }
+            func.SetServerStreaming(method->server_streaming());
+
             stree->mutable_func_list()->push_back(func);
         }
     }
@@ -152,6 +159,34 @@ int ProtoUtils::LoadExtension(const char *file_name, SyntaxTree *stree, DiskSour
                     if (nullptr != strstr(opt.name(0).name_part().c_str(), "Usage")) {
                         func->SetUsage(opt.string_value().c_str());
                     }
+
+                    // a bool comes as an identifier
+                    if (nullptr != strstr(opt.name(0).name_part().c_str(), "Hedge")) {
+                        func->SetHedge("true" == opt.identifier_value());
+                    }
+
+                    if (nullptr != strstr(opt.name(0).name_part().c_str(), "Batch")) {
+                        func->SetBatch("true" == opt.identifier_value());
+                    }
+
+                    // CacheTTLMS is part of its name
+                    if (nullptr != strstr(opt.name(0).name_part().c_str(), "ServerCacheTTLMS")) {
+                        func->SetServerCacheTTLMS(opt.positive_int_value());
+                    } else if (nullptr != strstr(opt.name(0).name_part().c_str(), "CacheTTLMS")) {
+                        func->SetCacheTTLMS(opt.positive_int_value());
+                    }
+
+                    if (nullptr != strstr(opt.name(0).name_part().c_str(), "ETag")) {
+                        func->SetETag("true" == opt.identifier_value());
+                    }
+
+                    if (nullptr != strstr(opt.name(0).name_part().c_str(), "CompressMinBytes")) {
+                        func->SetCompressMinBytes(opt.positive_int_value());
+                    }
+
+                    if (nullptr != strstr(opt.name(0).name_part().c_str(), "OneWay")) {
+                        func->SetOneWay("true" == opt.identifier_value());
+                    }
                 }
             }
         }
@@ -45,11 +45,13 @@ void Dispatch(const phxrpc::BaseRequest &req,
               phxrpc::DispatcherArgs_t *const args) {
     ServiceArgs_t *service_args{(ServiceArgs_t *)(args->service_args)};
 
-    $ServiceImplClass$ service(*service_args);
-    $DispatcherClass$ dispatcher(service, args);
+    // built once per worker thread, which runs one request at a time
+    thread_local $ServiceImplClass$ service(*service_args);
+    thread_local $DispatcherClass$ dispatcher(service, args);
+    thread_local phxrpc::BaseDispatcher<$DispatcherClass$> base_dispatcher(
+            dispatcher, $DispatcherClass$::GetURIFuncMap(), $DispatcherClass$::GetCmdIDFunc);
+    dispatcher.set_dispatcher_args(args);
 
-    phxrpc::BaseDispatcher<$DispatcherClass$> base_dispatcher(
-            dispatcher, $DispatcherClass$::GetURIFuncMap());
     if (!base_dispatcher.Dispatch(req, resp)) {
         resp->SetFake(phxrpc::BaseResponse::FakeReason::DISPATCH_ERROR);
     }
@@ -139,11 +141,13 @@ void Dispatch(const phxrpc::BaseRequest &req,
               phxrpc::DispatcherArgs_t *const args) {
     ServiceArgs_t *service_args{(ServiceArgs_t *)(args->service_args)};
 
-    $ServiceImplClass$ service(*service_args, args->server_worker_uthread_scheduler);
+    // the service is built once per worker thread and shared by its uthreads,
+    // the dispatcher holds the args of one request so it stays per call
+    thread_local $ServiceImplClass$ service(*service_args, args->server_worker_uthread_scheduler);
     $DispatcherClass$ dispatcher(service, args);
 
     phxrpc::BaseDispatcher<$DispatcherClass$> base_dispatcher(
-            dispatcher, $DispatcherClass$::GetURIFuncMap());
+            dispatcher, $DispatcherClass$::GetURIFuncMap(), $DispatcherClass$::GetCmdIDFunc);
     if (!base_dispatcher.Dispatch(req, resp)) {
         resp->SetFake(phxrpc::BaseResponse::FakeReason::DISPATCH_ERROR);
     }
@@ -276,6 +280,15 @@ MaxConnections = 800000
 MaxQueueLength = 20480
 FastRejectThresholdMS = 20
 FastRejectAdjustRate = 5
+RequestArenaSize = 0
+# to listen on for callers on the same host as well, only on it with Port = 0
+# UnixSocketPath = /tmp/$PbPackageName$.sock
+# bytes each way of shared memory rings for callers there with IP = shm:<path>
+# ShmRingSize = 1048576
+# responses this large or larger go out with no copy into the kernel, over TCP
+# ZeroCopyMinBytes = 262144
+# requests with a larger body are refused
+# MaxBodyBytes = 67108864
 
 [Log]
 LogDir = ~/log
@@ -284,6 +297,10 @@ LogLevel = 3
 [ServerTimeout]
 SocketTimeoutMS = 5000
 
+[ServerCache]
+MaxEntries = 10000
+MaxStaleMS = 0
+
 )";
 
 //////////////////////////////////////////////////////////////////////
@@ -303,6 +320,15 @@ MaxConnections = 800000
 MaxQueueLength = 20480
 FastRejectThresholdMS = 20
 FastRejectAdjustRate = 5
+RequestArenaSize = 0
+# to listen on for callers on the same host as well, only on it with Port = 0
+# UnixSocketPath = /tmp/$PbPackageName$.sock
+# bytes each way of shared memory rings for callers there with IP = shm:<path>
+# ShmRingSize = 1048576
+# responses this large or larger go out with no copy into the kernel, over TCP
+# ZeroCopyMinBytes = 262144
+# requests with a larger body are refused
+# MaxBodyBytes = 67108864
 
 [Log]
 LogDir = ~/log
@@ -311,6 +337,10 @@ LogLevel = 3
 [ServerTimeout]
 SocketTimeoutMS = 5000
 
+[ServerCache]
+MaxEntries = 10000
+MaxStaleMS = 0
+
 )";
 
 //////////////////////////////////////////////////////////////////////
@@ -20,6 +20,8 @@ See the AUTHORS file for names of contributors.
 */
 
 #include <cstring>
+#include <map>
+#include <set>
 
 #include "service_code_render.h"
 
@@ -58,6 +60,11 @@ void ServiceCodeRender::GenerateServiceHpp(SyntaxTree *stree, FILE *write) {
     name_render_.GetMessageFileName(stree->proto_file(), file_name, sizeof(file_name));
     fprintf(write, "#include \"%s.h\"\n", file_name);
 
+    if (stree->HasServerStreaming()) {
+        fprintf(write, "\n");
+        fprintf(write, "#include \"phxrpc/msg.h\"\n");
+    }
+
     fprintf(write, "\n");
     fprintf(write, "\n");
 
@@ -291,7 +298,12 @@ void ServiceCodeRender::GetServiceFuncDeclaration(SyntaxTree *stree,
     StrAppendFormat(result, "const %s &%s, ", type_name, need_param_name ? "req" : "/* req */");
 
     name_render_.GetMessageClassName(func->GetResp()->GetType(), type_name, sizeof(type_name));
-    StrAppendFormat(result, "%s *%s", type_name, need_param_name ? "resp" : "/* resp */");
+    if (func->IsServerStreaming()) {
+        StrAppendFormat(result, "phxrpc::StreamWriter<%s> *%s", type_name,
+                        need_param_name ? "writer" : "/* writer */");
+    } else {
+        StrAppendFormat(result, "%s *%s", type_name, need_param_name ? "resp" : "/* resp */");
+    }
 
     result->append(")");
 }
@@ -327,6 +339,9 @@ void ServiceCodeRender::GenerateDispatcherHpp(SyntaxTree *stree, FILE *write) {
 
     fprintf(write, "  public:\n");
     fprintf(write, "    static const phxrpc::BaseDispatcher<%s>::URIFuncMap &GetURIFuncMap();\n", dispatcher_name);
+    fprintf(write, "    static phxrpc::BaseDispatcher<%s>::URIFunc_t GetCmdIDFunc(const int cmd_id, "
+            "const char **uri);\n",
+            dispatcher_name);
     fprintf(write, "\n");
 
     fprintf(write, "    %s(%s &service, phxrpc::DispatcherArgs_t *dispatcher_args);\n", dispatcher_name, service_name);
@@ -335,6 +350,9 @@ void ServiceCodeRender::GenerateDispatcherHpp(SyntaxTree *stree, FILE *write) {
     fprintf(write, "    virtual ~%s();\n", dispatcher_name);
     fprintf(write, "\n");
 
+    fprintf(write, "    void set_dispatcher_args(phxrpc::DispatcherArgs_t *dispatcher_args);\n");
+    fprintf(write, "\n");
+
     auto flist(stree->func_list());
     auto fit(flist->cbegin());
     for (; flist->cend() != fit; ++fit) {
@@ -342,6 +360,10 @@ void ServiceCodeRender::GenerateDispatcherHpp(SyntaxTree *stree, FILE *write) {
                 "phxrpc::BaseResponse *const resp);\n",
                 fit->GetName());
     }
+    if (stree->HasBatch()) {
+        fprintf(write, "    int PHXBatch(const phxrpc::BaseRequest &req, "
+                "phxrpc::BaseResponse *const resp);\n");
+    }
     fprintf(write, "\n");
 
     fprintf(write, "  private:\n");
@@ -398,15 +420,29 @@ void ServiceCodeRender::GenerateDispatcherCpp(SyntaxTree *stree, FILE *write) {
     fprintf(write, "}\n");
     fprintf(write, "\n");
 
+    fprintf(write, "void %s::set_dispatcher_args(phxrpc::DispatcherArgs_t *dispatcher_args) {\n",
+            dispatcher_name);
+    fprintf(write, "    dispatcher_args_ = dispatcher_args;\n");
+    fprintf(write, "}\n");
+    fprintf(write, "\n");
+
     GenerateURIFuncMap(stree, write);
 
     fprintf(write, "\n");
 
+    GenerateCmdIDFunc(stree, write);
+
+    fprintf(write, "\n");
+
     auto flist(stree->func_list());
     auto fit(flist->cbegin());
     for (; flist->cend() != fit; ++fit) {
         GenerateDispatcherFunc(stree, &(*fit), write);
     }
+
+    if (stree->HasBatch()) {
+        GenerateBatchDispatcherFunc(stree, write);
+    }
 }
 
 void ServiceCodeRender::GenerateURIFuncMap(SyntaxTree *stree, FILE *write) {
@@ -429,6 +465,11 @@ void ServiceCodeRender::GenerateURIFuncMap(SyntaxTree *stree, FILE *write) {
                 SyntaxTree::Pb2UriPackageName(stree->package_name()).c_str(),
                 fit->GetName(), dispatcher_name, fit->GetName());
     }
+    if (stree->HasBatch()) {
+        fprintf(write, ",\n");
+        fprintf(write, "        {\"/%s/PHXBatch\", &%s::PHXBatch}",
+                SyntaxTree::Pb2UriPackageName(stree->package_name()).c_str(), dispatcher_name);
+    }
     fprintf(write, "};\n");
 
     fprintf(write, "    return uri_func_map;\n");
@@ -436,6 +477,51 @@ void ServiceCodeRender::GenerateURIFuncMap(SyntaxTree *stree, FILE *write) {
     fprintf(write, "}\n");
 }
 
+void ServiceCodeRender::GenerateCmdIDFunc(SyntaxTree *stree, FILE *write) {
+    char dispatcher_name[128]{'\0'};
+    name_render_.GetDispatcherClassName(stree->GetName(), dispatcher_name, sizeof(dispatcher_name));
+
+    fprintf(write, "phxrpc::BaseDispatcher<%s>::URIFunc_t %s::GetCmdIDFunc(const int cmd_id, "
+            "const char **uri) {\n",
+            dispatcher_name, dispatcher_name);
+
+    fprintf(write, "    switch (cmd_id) {\n");
+
+    map<int, int> cmd_id_counts;
+    auto flist(stree->func_list());
+    for (const auto &func : *flist) {
+        if (0 <= func.GetCmdID())
+            ++cmd_id_counts[func.GetCmdID()];
+    }
+
+    set<int> cmd_ids;
+    auto fit(flist->cbegin());
+    for (; flist->cend() != fit; ++fit) {
+        // methods without a CmdID are only found by uri
+        if (0 > fit->GetCmdID() || !cmd_ids.insert(fit->GetCmdID()).second)
+            continue;
+
+        // shared by several, the CmdID a client sends can't tell which one it calls,
+        // so all of them are found by uri
+        if (1 < cmd_id_counts[fit->GetCmdID()]) {
+            fprintf(stderr, "%s: CmdID %d is used by another method too, dispatch them by uri\n",
+                    fit->GetName(), fit->GetCmdID());
+            fprintf(write, "        case %d: return nullptr;\n", fit->GetCmdID());
+            continue;
+        }
+
+        fprintf(write, "        case %d:\n", fit->GetCmdID());
+        fprintf(write, "            *uri = \"/%s/%s\";\n",
+                SyntaxTree::Pb2UriPackageName(stree->package_name()).c_str(), fit->GetName());
+        fprintf(write, "            return &%s::%s;\n", dispatcher_name, fit->GetName());
+    }
+
+    fprintf(write, "        default: return nullptr;\n");
+    fprintf(write, "    }\n");
+
+    fprintf(write, "}\n");
+}
+
 void ServiceCodeRender::GenerateDispatcherFunc(const SyntaxTree *const stree,
                                                const SyntaxFunc *const func,
                                                FILE *write) {
@@ -451,21 +537,64 @@ void ServiceCodeRender::GenerateDispatcherFunc(const SyntaxTree *const stree,
             func->GetCmdID(), func->GetName());
     fprintf(write, "\n");
 
+    const bool server_cached{0 < func->GetServerCacheTTLMS() && !func->IsServerStreaming()};
+    // what the response goes through after it is made, a result of it to return
+    auto respond([func](string result) -> string {
+        // a one-way response is not sent at all
+        if (func->IsServerStreaming() || func->IsOneWay())
+            return result;
+        // a 304 in place of a response the client has already
+        if (func->IsETag())
+            result = "phxrpc::ETagUtils::Respond(req, resp, " + result + ")";
+        // compressed by the io thread
+        if (0 < func->GetCompressMinBytes()) {
+            result = "phxrpc::ContentCodingUtils::Negotiate(req, resp, " +
+                     to_string(func->GetCompressMinBytes()) + ",\n            " + result + ")";
+        }
+        return result;
+    });
+    if (server_cached) {
+        fprintf(write, "    // an equal request within %d ms is answered with the response to it\n",
+                func->GetServerCacheTTLMS());
+        fprintf(write, "    phxrpc::ServerCacheCall cache_call(dispatcher_args_, \"%s\", req, resp, %d);\n",
+                func->GetName(), func->GetServerCacheTTLMS());
+        fprintf(write, "    if (cache_call.hit()) {\n");
+        fprintf(write, "        return %s;\n", respond("cache_call.result()").c_str());
+        fprintf(write, "    }\n");
+        fprintf(write, "\n");
+    }
+
+    if (func->IsServerStreaming()) {
+        // nothing would read the frames, the handler is not to run
+        fprintf(write, "    if (req.one_way()) {\n");
+        fprintf(write, "        phxrpc::log(LOG_ERR, \"%s one-way req refused, it has a stream\");\n",
+                func->GetName());
+        fprintf(write, "\n");
+        fprintf(write, "        return -EINVAL;\n");
+        fprintf(write, "    }\n");
+        fprintf(write, "\n");
+    }
+
     fprintf(write, "    int ret{-1};\n");
     fprintf(write, "\n");
 
+    // on the request arena if the server runs with one, see RequestArenaSize
+    fprintf(write, "    google::protobuf::Arena *pb_arena{req.pb_arena()};\n");
+
     name_render_.GetMessageClassName(func->GetReq()->GetType(), type_name, sizeof(type_name));
-    fprintf(write, "    %s req_pb;\n", type_name);
+    fprintf(write, "    phxrpc::ArenaMessage<%s> req_pb(pb_arena);\n", type_name);
 
     name_render_.GetMessageClassName(func->GetResp()->GetType(), type_name, sizeof(type_name));
-    fprintf(write, "    %s resp_pb;\n", type_name);
+    if (!func->IsServerStreaming()) {
+        fprintf(write, "    phxrpc::ArenaMessage<%s> resp_pb(pb_arena);\n", type_name);
+    }
 
     fprintf(write, "\n");
 
     fprintf(write, "    // unpack request\n");
     fprintf(write, "    {\n");
 
-    fprintf(write, "        ret = req.ToPb(&req_pb);\n");
+    fprintf(write, "        ret = req.ToPb(req_pb.get());\n");
     fprintf(write, "        if (0 != ret) {\n");
     fprintf(write, "            phxrpc::log(LOG_ERR, \"ToPb err %%d\", ret);\n");
 
@@ -476,20 +605,34 @@ void ServiceCodeRender::GenerateDispatcherFunc(const SyntaxTree *const stree,
 
     fprintf(write, "\n");
 
-    fprintf(write, "    // logic process\n");
-    fprintf(write, "    {\n");
+    if (func->IsServerStreaming()) {
+        fprintf(write, "    // logic process, messages go to the client as they are written\n");
+        fprintf(write, "    {\n");
 
-    fprintf(write, "        if (0 == ret) {\n");
-    fprintf(write, "            ret = service_.%s(req_pb, &resp_pb);\n", func->GetName());
-    fprintf(write, "        }\n");
+        fprintf(write, "        if (0 == ret) {\n");
+        fprintf(write, "            phxrpc::StreamWriter<%s> writer(resp->EnableStream(\n", type_name);
+        fprintf(write, "                    dispatcher_args_->stream_notify_func));\n");
+        fprintf(write, "            ret = service_.%s(*req_pb, &writer);\n", func->GetName());
+        fprintf(write, "        }\n");
 
-    fprintf(write, "    }\n");
-    fprintf(write, "\n");
+        fprintf(write, "    }\n");
+        fprintf(write, "\n");
+    } else {
+        fprintf(write, "    // logic process\n");
+        fprintf(write, "    {\n");
+
+        fprintf(write, "        if (0 == ret) {\n");
+        fprintf(write, "            ret = service_.%s(*req_pb, resp_pb.get());\n", func->GetName());
+        fprintf(write, "        }\n");
 
-    if (0 != strcmp(type_name, "google::protobuf::Empty")) {
+        fprintf(write, "    }\n");
+        fprintf(write, "\n");
+    }
+
+    if (!func->IsServerStreaming() && 0 != strcmp(type_name, "google::protobuf::Empty")) {
         fprintf(write, "    // pack response\n");
         fprintf(write, "    {\n");
-        fprintf(write, "        if (0 != resp->FromPb(resp_pb)) {\n");
+        fprintf(write, "        if (0 != resp->FromPb(*resp_pb)) {\n");
         fprintf(write, "            phxrpc::log(LOG_ERR, \"FromPb err %%d\", ret);\n");
         fprintf(write, "\n");
         fprintf(write, "            return -ENOMEM;\n");
@@ -501,7 +644,86 @@ void ServiceCodeRender::GenerateDispatcherFunc(const SyntaxTree *const stree,
     fprintf(write, "    phxrpc::log(LOG_DEBUG, \"RETN: %s = %%d\", ret);\n", func->GetName());
 
     fprintf(write, "\n");
-    fprintf(write, "    return ret;\n");
+    fprintf(write, "    return %s;\n", respond(server_cached ? "cache_call.Done(ret)" : "ret").c_str());
+    fprintf(write, "}\n");
+    fprintf(write, "\n");
+}
+
+void ServiceCodeRender::GenerateBatchDispatcherFunc(const SyntaxTree *const stree, FILE *write) {
+    char dispatcher_name[128]{'\0'};
+
+    name_render_.GetDispatcherClassName(stree->GetName(), dispatcher_name, sizeof(dispatcher_name));
+
+    fprintf(write, "int %s::PHXBatch(const phxrpc::BaseRequest &req, "
+            "phxrpc::BaseResponse *const resp) {\n", dispatcher_name);
+
+    fprintf(write, "    dispatcher_args_->server_monitor->SvrCall(-1, \"PHXBatch\", 1);\n");
+    fprintf(write, "\n");
+
+    fprintf(write, "    int ret{-1};\n");
+    fprintf(write, "\n");
+
+    fprintf(write, "    phxrpc::BatchRequest req_pb;\n");
+    fprintf(write, "    phxrpc::BatchResponse resp_pb;\n");
+    fprintf(write, "\n");
+
+    fprintf(write, "    // unpack request\n");
+    fprintf(write, "    {\n");
+    fprintf(write, "        ret = req.ToPb(&req_pb);\n");
+    fprintf(write, "        if (0 != ret) {\n");
+    fprintf(write, "            phxrpc::log(LOG_ERR, \"ToPb err %%d\", ret);\n");
+    fprintf(write, "\n");
+    fprintf(write, "            return -EINVAL;\n");
+    fprintf(write, "        }\n");
+    fprintf(write, "    }\n");
+    fprintf(write, "\n");
+
+    // only methods marked Batch, the others may not expect to run this way
+    fprintf(write, "    phxrpc::BaseDispatcher<%s>::URIFunc_t func{nullptr};\n", dispatcher_name);
+    auto flist(stree->func_list());
+    auto fit(flist->cbegin());
+    for (; flist->cend() != fit; ++fit) {
+        if (!fit->IsBatch() || fit->IsServerStreaming())
+            continue;
+
+        fprintf(write, "    if (\"/%s/%s\" == req_pb.uri()) {\n",
+                SyntaxTree::Pb2UriPackageName(stree->package_name()).c_str(), fit->GetName());
+        fprintf(write, "        func = &%s::%s;\n", dispatcher_name, fit->GetName());
+        fprintf(write, "    }\n");
+    }
+    fprintf(write, "    if (nullptr == func) {\n");
+    fprintf(write, "        phxrpc::log(LOG_ERR, \"%%s not to be batched\", req_pb.uri().c_str());\n");
+    fprintf(write, "\n");
+    fprintf(write, "        return -EINVAL;\n");
+    fprintf(write, "    }\n");
+    fprintf(write, "\n");
+
+    fprintf(write, "    // logic process, each call as if it came on its own\n");
+    fprintf(write, "    {\n");
+    fprintf(write, "        for (const auto &request : req_pb.requests()) {\n");
+    fprintf(write, "            phxrpc::HttpRequest item_req;\n");
+    fprintf(write, "            item_req.set_uri(req_pb.uri().c_str());\n");
+    fprintf(write, "            item_req.set_content(request.data(), request.size());\n");
+    fprintf(write, "            phxrpc::HttpResponse item_resp;\n");
+    fprintf(write, "            resp_pb.add_results((this->*func)(item_req, &item_resp));\n");
+    fprintf(write, "            resp_pb.add_responses(item_resp.content());\n");
+    fprintf(write, "        }\n");
+    fprintf(write, "    }\n");
+    fprintf(write, "\n");
+
+    fprintf(write, "    // pack response\n");
+    fprintf(write, "    {\n");
+    fprintf(write, "        if (0 != resp->FromPb(resp_pb)) {\n");
+    fprintf(write, "            phxrpc::log(LOG_ERR, \"FromPb err %%d\", ret);\n");
+    fprintf(write, "\n");
+    fprintf(write, "            return -ENOMEM;\n");
+    fprintf(write, "        }\n");
+    fprintf(write, "    }\n");
+    fprintf(write, "\n");
+
+    fprintf(write, "    phxrpc::log(LOG_DEBUG, \"RETN: PHXBatch of %%d\", req_pb.requests_size());\n");
+    fprintf(write, "\n");
+    fprintf(write, "    return 0;\n");
     fprintf(write, "}\n");
     fprintf(write, "\n");
 }
@@ -61,7 +61,11 @@ class ServiceCodeRender {
                                         const SyntaxFunc *const func,
                                         FILE *write);
 
+    // PHXBatch, running each of the calls in a batch with the function of their method
+    virtual void GenerateBatchDispatcherFunc(const SyntaxTree *const stree, FILE *write);
+
     virtual void GenerateURIFuncMap(SyntaxTree *stree, FILE *write);
+    virtual void GenerateCmdIDFunc(SyntaxTree *stree, FILE *write);
 
     NameRender &name_render_;
 };
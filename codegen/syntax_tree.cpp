@@ -68,6 +68,14 @@ const char *SyntaxParam::GetType() const {
 
 SyntaxFunc::SyntaxFunc() {
     cmdid_ = -1;
+    server_streaming_ = false;
+    hedge_ = false;
+    batch_ = false;
+    cache_ttl_ms_ = 0;
+    server_cache_ttl_ms_ = 0;
+    etag_ = false;
+    compress_min_bytes_ = 0;
+    one_way_ = false;
     memset(opt_string_, 0, sizeof(opt_string_));
     memset(usage_, 0, sizeof(usage_));
 }
@@ -115,6 +123,70 @@ const char *SyntaxFunc::GetUsage() const {
     return usage_;
 }
 
+void SyntaxFunc::SetServerStreaming(const bool server_streaming) {
+    server_streaming_ = server_streaming;
+}
+
+bool SyntaxFunc::IsServerStreaming() const {
+    return server_streaming_;
+}
+
+void SyntaxFunc::SetHedge(const bool hedge) {
+    hedge_ = hedge;
+}
+
+bool SyntaxFunc::IsHedge() const {
+    return hedge_;
+}
+
+void SyntaxFunc::SetBatch(const bool batch) {
+    batch_ = batch;
+}
+
+bool SyntaxFunc::IsBatch() const {
+    return batch_;
+}
+
+void SyntaxFunc::SetCacheTTLMS(const int cache_ttl_ms) {
+    cache_ttl_ms_ = cache_ttl_ms;
+}
+
+int SyntaxFunc::GetCacheTTLMS() const {
+    return cache_ttl_ms_;
+}
+
+void SyntaxFunc::SetServerCacheTTLMS(const int server_cache_ttl_ms) {
+    server_cache_ttl_ms_ = server_cache_ttl_ms;
+}
+
+int SyntaxFunc::GetServerCacheTTLMS() const {
+    return server_cache_ttl_ms_;
+}
+
+void SyntaxFunc::SetETag(const bool etag) {
+    etag_ = etag;
+}
+
+bool SyntaxFunc::IsETag() const {
+    return etag_;
+}
+
+void SyntaxFunc::SetCompressMinBytes(const int compress_min_bytes) {
+    compress_min_bytes_ = compress_min_bytes;
+}
+
+int SyntaxFunc::GetCompressMinBytes() const {
+    return compress_min_bytes_;
+}
+
+void SyntaxFunc::SetOneWay(const bool one_way) {
+    one_way_ = one_way;
+}
+
+bool SyntaxFunc::IsOneWay() const {
+    return one_way_ && !server_streaming_;
+}
+
 //====================================================================
 
 char *SyntaxTree::ToLower(char *s) {
@@ -217,3 +289,21 @@ SyntaxFuncVector *SyntaxTree::mutable_func_list() {
     return &func_list_;
 }
 
+bool SyntaxTree::HasServerStreaming() const {
+    for (const auto &func : func_list_) {
+        if (func.IsServerStreaming())
+            return true;
+    }
+
+    return false;
+}
+
+bool SyntaxTree::HasBatch() const {
+    for (const auto &func : func_list_) {
+        if (func.IsBatch())
+            return true;
+    }
+
+    return false;
+}
+
@@ -81,10 +81,50 @@ class SyntaxFunc : public SyntaxNode {
     void SetUsage(const char *usage);
     const char *GetUsage() const;
 
+    // returns (stream Resp), the handler writes and the client reads messages one by one
+    void SetServerStreaming(const bool server_streaming);
+    bool IsServerStreaming() const;
+
+    // option (phxrpc.Hedge), safe to send twice
+    void SetHedge(const bool hedge);
+    bool IsHedge() const;
+
+    // option (phxrpc.Batch), concurrent calls may go out together in one PHXBatch call
+    void SetBatch(const bool batch);
+    bool IsBatch() const;
+
+    // option (phxrpc.CacheTTLMS), 0 if its responses are not to be cached
+    void SetCacheTTLMS(const int cache_ttl_ms);
+    int GetCacheTTLMS() const;
+
+    // option (phxrpc.ServerCacheTTLMS), 0 if the server is not to cache its responses
+    void SetServerCacheTTLMS(const int server_cache_ttl_ms);
+    int GetServerCacheTTLMS() const;
+
+    // option (phxrpc.ETag), unchanged responses are revalidated rather than sent again
+    void SetETag(const bool etag);
+    bool IsETag() const;
+
+    // option (phxrpc.CompressMinBytes), 0 if its responses are not to be compressed
+    void SetCompressMinBytes(const int compress_min_bytes);
+    int GetCompressMinBytes() const;
+
+    // option (phxrpc.OneWay), no response is sent, not for a server-streaming one
+    void SetOneWay(const bool one_way);
+    bool IsOneWay() const;
+
   private:
     SyntaxParam req_;
     SyntaxParam resp_;
     int cmdid_;
+    bool server_streaming_;
+    bool hedge_;
+    bool batch_;
+    int cache_ttl_ms_;
+    int server_cache_ttl_ms_;
+    bool etag_;
+    int compress_min_bytes_;
+    bool one_way_;
     char opt_string_[_SYNTAX_DESC_LEN];
     char usage_[_SYNTAX_DESC_LEN];
 };
@@ -127,6 +167,10 @@ class SyntaxTree : public SyntaxNode {
     const SyntaxFuncVector *func_list() const;
     SyntaxFuncVector *mutable_func_list();
 
+    bool HasServerStreaming() const;
+
+    bool HasBatch() const;
+
   private:
     char proto_file_[128];
     char prefix_[32];
@@ -285,9 +285,22 @@ void ToolCodeRender::GenerateToolImplCpp(SyntaxTree *stree, FILE *write) {
 
         fprintf(write, "\n");
         fprintf(write, "    %s client;\n", client_class);
-        fprintf(write, "    int ret{client.%s(req, &resp)};\n", fit->GetName());
-        fprintf(write, "    printf(\"%%s return %%d\\n\", __func__, ret);\n");
-        fprintf(write, "    printf(\"resp: {\\n%%s}\\n\", resp.DebugString().c_str());\n");
+        if (fit->IsServerStreaming()) {
+            fprintf(write, "    phxrpc::StreamReader<%s> reader;\n", resp_class);
+            fprintf(write, "    int ret{client.%s(req, &reader)};\n", fit->GetName());
+            fprintf(write, "    printf(\"%%s return %%d\\n\", __func__, ret);\n");
+            fprintf(write, "    while (0 == ret && 0 < reader.Read(&resp)) {\n");
+            fprintf(write, "        printf(\"resp: {\\n%%s}\\n\", resp.DebugString().c_str());\n");
+            fprintf(write, "    }\n");
+            fprintf(write, "    if (0 == ret) {\n");
+            fprintf(write, "        ret = reader.result();\n");
+            fprintf(write, "        printf(\"%%s result %%d\\n\", __func__, ret);\n");
+            fprintf(write, "    }\n");
+        } else {
+            fprintf(write, "    int ret{client.%s(req, &resp)};\n", fit->GetName());
+            fprintf(write, "    printf(\"%%s return %%d\\n\", __func__, ret);\n");
+            fprintf(write, "    printf(\"resp: {\\n%%s}\\n\", resp.DebugString().c_str());\n");
+        }
         fprintf(write, "\n");
         fprintf(write, "    return ret;\n");
         fprintf(write, "}\n");
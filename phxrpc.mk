@@ -39,7 +39,7 @@ CFLAGS = -std=c++11 -Wall -D_REENTRANT -D_GNU_SOURCE -D_XOPEN_SOURCE -fPIC -m64
 		-I$(PHXRPC_ROOT)
 
 LDFLAGS = -L$(PROTOBUF_ROOT)/lib/ $(PROTOBUF_ROOT)/lib/libprotobuf.a \
-		-lstdc++ -lpthread -lm
+		-lstdc++ -lpthread -lm -lz
 
 PBFLAGS = -I $(PROTOBUF_ROOT)/include -I $(PHXRPC_ROOT)
 
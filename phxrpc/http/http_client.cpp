@@ -41,9 +41,7 @@ int HttpClient::Get(BaseTcpStream &socket, const HttpRequest &req, HttpResponse
     int ret{HttpProtocol::SendReqHeader(socket, "GET", req)};
 
     if (0 == ret) {
-        ret = HttpProtocol::RecvRespStartLine(socket, resp);
-        if (0 == ret)
-            ret = HttpProtocol::RecvHeaders(socket, resp);
+        ret = HttpProtocol::RecvRespHead(socket, resp);
         if (0 == ret && SC_NOT_MODIFIED != resp->status_code()) {
             ret = HttpProtocol::RecvBody(socket, resp);
         }
@@ -75,9 +73,7 @@ int HttpClient::Post(BaseTcpStream &socket, const HttpRequest &req, HttpResponse
     }
 
     if (0 == ret) {
-        ret = HttpProtocol::RecvRespStartLine(socket, resp);
-        if (0 == ret)
-            ret = HttpProtocol::RecvHeaders(socket, resp);
+        ret = HttpProtocol::RecvRespHead(socket, resp);
 
         if (0 == ret && SC_NOT_MODIFIED != resp->status_code()) {
             ret = HttpProtocol::RecvBody(socket, resp);
@@ -100,10 +96,7 @@ int HttpClient::Head(BaseTcpStream & socket, const HttpRequest &req, HttpRespons
     int ret{HttpProtocol::SendReqHeader(socket, "HEAD", req)};
 
     if (0 == ret)
-        ret = HttpProtocol::RecvRespStartLine(socket, resp);
-
-    if (0 == ret)
-        ret = HttpProtocol::RecvHeaders(socket, resp);
+        ret = HttpProtocol::RecvRespHead(socket, resp);
 
     return static_cast<int>(ret);
 }
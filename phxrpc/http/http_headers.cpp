@@ -0,0 +1,243 @@
+/*
+Tencent is pleased to support the open source community by making
+PhxRPC available.
+Copyright (C) 2016 THL A29 Limited, a Tencent company.
+All rights reserved.
+
+Licensed under the BSD 3-Clause License (the "License"); you may
+not use this file except in compliance with the License. You may
+obtain a copy of the License at
+
+https://opensource.org/licenses/BSD-3-Clause
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" basis,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+implied. See the License for the specific language governing
+permissions and limitations under the License.
+
+See the AUTHORS file for names of contributors.
+*/
+
+
+#include "phxrpc/http/http_headers.h"
+
+#include <cstring>
+
+#include "phxrpc/msg/arena.h"
+
+
+namespace {
+
+
+using namespace phxrpc;
+
+
+struct WellKnownHeader {
+    const char *name;
+    size_t len;
+};
+
+#define WELL_KNOWN_HEADER(name) {name, sizeof(name) - 1}
+
+// indexed by HttpHeaderId
+const WellKnownHeader WELL_KNOWN_HEADERS[] = {
+    {"", 0},
+    WELL_KNOWN_HEADER("Content-Length"),
+    WELL_KNOWN_HEADER("Content-Type"),
+    WELL_KNOWN_HEADER("Connection"),
+    WELL_KNOWN_HEADER("Proxy-Connection"),
+    WELL_KNOWN_HEADER("Transfer-Encoding"),
+    WELL_KNOWN_HEADER("Date"),
+    WELL_KNOWN_HEADER("Server"),
+    WELL_KNOWN_HEADER("X-PHXRPC-Result"),
+    WELL_KNOWN_HEADER("X-PHXRPC-CmdID"),
+    WELL_KNOWN_HEADER("X-PHXRPC-OneWay"),
+};
+
+#undef WELL_KNOWN_HEADER
+
+static_assert(sizeof(WELL_KNOWN_HEADERS) / sizeof(WELL_KNOWN_HEADERS[0]) ==
+              static_cast<size_t>(HttpHeaderId::MAX), "WELL_KNOWN_HEADERS out of date");
+
+
+}  // namespace
+
+
+namespace phxrpc {
+
+
+HttpHeaders::HttpHeaders() {
+    entries_.reserve(8);
+    memset(slots_, -1, sizeof(slots_));
+}
+
+HttpHeaders::HttpHeaders(const HttpHeaders &other) : HttpHeaders() {
+    *this = other;
+}
+
+HttpHeaders::~HttpHeaders() {
+}
+
+HttpHeaders &HttpHeaders::operator=(const HttpHeaders &other) {
+    if (this != &other) {
+        Clear();
+        for (auto &entry : other.entries_) {
+            if (HttpHeaderId::UNKNOWN == entry.id) {
+                Add(entry.name, entry.value);
+            } else {
+                Append(Name(entry.id), Copy(entry.value, strlen(entry.value)), entry.id);
+            }
+        }
+    }
+
+    return *this;
+}
+
+HttpHeaderId HttpHeaders::Intern(const char *name, const size_t name_len) {
+    for (int i{1}; static_cast<int>(HttpHeaderId::MAX) > i; ++i) {
+        if (WELL_KNOWN_HEADERS[i].len == name_len &&
+            0 == strncasecmp(WELL_KNOWN_HEADERS[i].name, name, name_len)) {
+            return static_cast<HttpHeaderId>(i);
+        }
+    }
+
+    return HttpHeaderId::UNKNOWN;
+}
+
+const char *HttpHeaders::Name(const HttpHeaderId id) {
+    return WELL_KNOWN_HEADERS[static_cast<int>(id)].name;
+}
+
+void HttpHeaders::Add(const char *name, const char *value) {
+    const size_t name_len{strlen(name)};
+    const HttpHeaderId id{Intern(name, name_len)};
+
+    Append(HttpHeaderId::UNKNOWN == id ? Copy(name, name_len) : Name(id),
+           Copy(value, strlen(value)), id);
+}
+
+void HttpHeaders::Add(const HttpHeaderId id, const char *value) {
+    Append(Name(id), Copy(value, strlen(value)), id);
+}
+
+void HttpHeaders::AddView(const char *name, const size_t name_len, const char *value) {
+    Append(name, value, Intern(name, name_len));
+}
+
+void HttpHeaders::Set(const HttpHeaderId id, const char *value) {
+    const int16_t slot{slots_[static_cast<int>(id)]};
+    if (0 <= slot) {
+        entries_[slot].value = Copy(value, strlen(value));
+    } else {
+        Add(id, value);
+    }
+}
+
+bool HttpHeaders::Remove(const char *name) {
+    const HttpHeaderId id{Intern(name, strlen(name))};
+    if (HttpHeaderId::UNKNOWN != id)
+        return Remove(id);
+
+    for (size_t i{0}; entries_.size() > i; ++i) {
+        if (HttpHeaderId::UNKNOWN == entries_[i].id && 0 == strcasecmp(name, entries_[i].name)) {
+            Erase(i);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool HttpHeaders::Remove(const HttpHeaderId id) {
+    const int16_t slot{slots_[static_cast<int>(id)]};
+    if (0 > slot)
+        return false;
+
+    Erase(slot);
+
+    return true;
+}
+
+void HttpHeaders::Clear() {
+    entries_.clear();
+    memset(slots_, -1, sizeof(slots_));
+    arena_blocks_.clear();
+    arena_block_used_ = ARENA_BLOCK_SIZE;
+}
+
+const char *HttpHeaders::name(const size_t index) const {
+    return index < entries_.size() ? entries_[index].name : nullptr;
+}
+
+const char *HttpHeaders::value(const size_t index) const {
+    return index < entries_.size() ? entries_[index].value : nullptr;
+}
+
+const char *HttpHeaders::Get(const char *name) const {
+    const HttpHeaderId id{Intern(name, strlen(name))};
+    if (HttpHeaderId::UNKNOWN != id)
+        return Get(id);
+
+    for (auto &entry : entries_) {
+        if (HttpHeaderId::UNKNOWN == entry.id && 0 == strcasecmp(name, entry.name))
+            return entry.value;
+    }
+
+    return nullptr;
+}
+
+const char *HttpHeaders::Get(const HttpHeaderId id) const {
+    const int16_t slot{slots_[static_cast<int>(id)]};
+
+    return 0 <= slot ? entries_[slot].value : nullptr;
+}
+
+void HttpHeaders::Append(const char *name, const char *value, const HttpHeaderId id) {
+    if (HttpHeaderId::UNKNOWN != id && 0 > slots_[static_cast<int>(id)])
+        slots_[static_cast<int>(id)] = static_cast<int16_t>(entries_.size());
+
+    entries_.push_back(Entry{name, value, id});
+}
+
+void HttpHeaders::Erase(const size_t index) {
+    // entries are pods, so erasing is a memmove, then re-point the slots behind it
+    entries_.erase(entries_.begin() + index);
+
+    memset(slots_, -1, sizeof(slots_));
+    for (size_t i{0}; entries_.size() > i; ++i) {
+        int16_t &slot = slots_[static_cast<int>(entries_[i].id)];
+        if (HttpHeaderId::UNKNOWN != entries_[i].id && 0 > slot)
+            slot = static_cast<int16_t>(i);
+    }
+}
+
+const char *HttpHeaders::Copy(const char *data, const size_t len) {
+    char *dest{nullptr};
+
+    if (nullptr != arena_) {
+        dest = static_cast<char *>(arena_->Allocate(len + 1, 1));
+    } else if (ARENA_BLOCK_SIZE < len + 1) {
+        // too big to share a block
+        arena_blocks_.emplace_back(new char[len + 1]);
+        dest = arena_blocks_.back().get();
+        if (1 < arena_blocks_.size())
+            std::swap(arena_blocks_.back(), arena_blocks_[arena_blocks_.size() - 2]);
+    } else {
+        if (ARENA_BLOCK_SIZE < arena_block_used_ + len + 1) {
+            arena_blocks_.emplace_back(new char[ARENA_BLOCK_SIZE]);
+            arena_block_used_ = 0;
+        }
+        dest = arena_blocks_.back().get() + arena_block_used_;
+        arena_block_used_ += len + 1;
+    }
+
+    memcpy(dest, data, len);
+    dest[len] = '\0';
+
+    return dest;
+}
+
+
+}  // namespace phxrpc
+
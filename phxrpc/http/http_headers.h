@@ -0,0 +1,118 @@
+/*
+Tencent is pleased to support the open source community by making
+PhxRPC available.
+Copyright (C) 2016 THL A29 Limited, a Tencent company.
+All rights reserved.
+
+Licensed under the BSD 3-Clause License (the "License"); you may
+not use this file except in compliance with the License. You may
+obtain a copy of the License at
+
+https://opensource.org/licenses/BSD-3-Clause
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" basis,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+implied. See the License for the specific language governing
+permissions and limitations under the License.
+
+See the AUTHORS file for names of contributors.
+*/
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+
+namespace phxrpc {
+
+
+class Arena;
+
+// headers the framework itself looks at, they own a fixed slot in every
+// table so finding them never compares names
+enum class HttpHeaderId : uint8_t {
+    UNKNOWN = 0,
+    CONTENT_LENGTH,
+    CONTENT_TYPE,
+    CONNECTION,
+    PROXY_CONNECTION,
+    TRANSFER_ENCODING,
+    DATE,
+    SERVER,
+    X_PHXRPC_RESULT,
+    X_PHXRPC_CMDID,
+    X_PHXRPC_ONEWAY,
+    MAX,
+};
+
+
+// Flat header table.
+//
+// Names and values are c strings that either point into a buffer owned by
+// the message (e.g. the received head, see AddView) or into a small arena
+// owned by the table, or the request arena if set, so no header costs a
+// std::string of its own.
+class HttpHeaders {
+  public:
+    HttpHeaders();
+    HttpHeaders(const HttpHeaders &other);
+    ~HttpHeaders();
+
+    HttpHeaders &operator=(const HttpHeaders &other);
+
+    static HttpHeaderId Intern(const char *name, const size_t name_len);
+    static const char *Name(const HttpHeaderId id);
+
+    // copies name and value into the arena
+    void Add(const char *name, const char *value);
+    void Add(const HttpHeaderId id, const char *value);
+    // name and value must outlive the table
+    void AddView(const char *name, const size_t name_len, const char *value);
+    // replaces the value of the first header with this id, or adds one
+    void Set(const HttpHeaderId id, const char *value);
+    bool Remove(const char *name);
+    bool Remove(const HttpHeaderId id);
+    void Clear();
+
+    // copies made from now on go to arena, which must outlive the table
+    void set_arena(Arena *arena) { arena_ = arena; }
+
+    size_t count() const { return entries_.size(); }
+    const char *name(const size_t index) const;
+    const char *value(const size_t index) const;
+    HttpHeaderId id(const size_t index) const { return entries_[index].id; }
+    const char *Get(const char *name) const;
+    const char *Get(const HttpHeaderId id) const;
+
+  private:
+    enum {
+        ARENA_BLOCK_SIZE = 512,
+    };
+
+    struct Entry {
+        const char *name;
+        const char *value;
+        HttpHeaderId id;
+    };
+
+    void Append(const char *name, const char *value, const HttpHeaderId id);
+    void Erase(const size_t index);
+    const char *Copy(const char *data, const size_t len);
+
+    std::vector<Entry> entries_;
+    // index of the first entry of each well-known header, -1 if absent
+    int16_t slots_[static_cast<int>(HttpHeaderId::MAX)];
+
+    std::vector<std::unique_ptr<char[]>> arena_blocks_;
+    size_t arena_block_used_{ARENA_BLOCK_SIZE};
+    Arena *arena_{nullptr};
+};
+
+
+}  // namespace phxrpc
+
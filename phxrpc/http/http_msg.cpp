@@ -26,6 +26,7 @@ See the AUTHORS file for names of contributors.
 #include <cstring>
 
 #include "phxrpc/http/http_protocol.h"
+#include "phxrpc/msg/zero_copy_stream.h"
 #include "phxrpc/rpc/phxrpc.pb.h"
 
 
@@ -44,16 +45,40 @@ const char *HttpMessage::HEADER_DATE = "Date";
 const char *HttpMessage::HEADER_SERVER = "Server";
 
 const char *HttpMessage::HEADER_X_PHXRPC_RESULT = "X-PHXRPC-Result";
+const char *HttpMessage::HEADER_X_PHXRPC_CMDID = "X-PHXRPC-CmdID";
+const char *HttpMessage::HEADER_X_PHXRPC_ONEWAY = "X-PHXRPC-OneWay";
 
 
 int HttpMessage::ToPb(google::protobuf::Message *const message) const {
-    if (!message->ParseFromString(content()))
+    if (nullptr != body_pb_)
+        JoinContentPieces();
+
+    if (!content_pieces_.empty()) {
+        BufferChainInputStream stream(content_pieces_);
+        if (!message->ParseFromZeroCopyStream(&stream))
+            return -1;
+
+        return 0;
+    }
+
+    if (!message->ParseFromArray(content_.data(), static_cast<int>(content_.size())))
         return -1;
 
     return 0;
 }
 
 int HttpMessage::FromPb(const google::protobuf::Message &message) {
+    // it outlives this message then, so the worker only sizes it up
+    if (nullptr != arena() && nullptr != message.GetArena() &&
+        arena()->pb_arena() == message.GetArena()) {
+        set_content("", 0);
+        body_pb_ = &message;
+        body_pb_size_ = message.ByteSizeLong();
+
+        return 0;
+    }
+
+    body_pb_ = nullptr;
     if (!message.SerializeToString(mutable_content()))
         return -1;
 
@@ -61,12 +86,19 @@ int HttpMessage::FromPb(const google::protobuf::Message &message) {
 }
 
 size_t HttpMessage::size() const {
-    return content().size();
+    if (nullptr != body_pb_)
+        return body_pb_size_;
+
+    return content_.size() + content_pieces_size_;
+}
+
+void HttpMessage::set_arena(Arena *arena) {
+    BaseMessage::set_arena(arena);
+    headers_.set_arena(arena);
 }
 
 void HttpMessage::AddHeader(const char *name, const char *value) {
-    header_name_list_.push_back(name);
-    header_value_list_.push_back(value);
+    headers_.Add(name, value);
 }
 
 void HttpMessage::AddHeader(const char *name, int value) {
@@ -76,42 +108,47 @@ void HttpMessage::AddHeader(const char *name, int value) {
     AddHeader(name, tmp);
 }
 
-bool HttpMessage::RemoveHeader(const char *name) {
-    bool ret{false};
+void HttpMessage::AddHeader(const HttpHeaderId id, const char *value) {
+    headers_.Add(id, value);
+}
 
-    for (size_t i{0}; header_name_list_.size() > i && false == ret; ++i) {
-        if (0 == strcasecmp(name, header_name_list_[i].c_str())) {
-            header_name_list_.erase(header_name_list_.begin() + i);
-            header_value_list_.erase(header_value_list_.begin() + i);
-            ret = true;
-        }
-    }
+void HttpMessage::AddHeader(const HttpHeaderId id, int value) {
+    char tmp[32]{0};
+    snprintf(tmp, sizeof(tmp), "%d", value);
 
-    return ret;
+    AddHeader(id, tmp);
+}
+
+void HttpMessage::SetHeader(const HttpHeaderId id, const char *value) {
+    headers_.Set(id, value);
+}
+
+bool HttpMessage::RemoveHeader(const char *name) {
+    return headers_.Remove(name);
+}
+
+bool HttpMessage::RemoveHeader(const HttpHeaderId id) {
+    return headers_.Remove(id);
 }
 
 size_t HttpMessage::GetHeaderCount() const {
-    return header_name_list_.size();
+    return headers_.count();
 }
 
 const char *HttpMessage::GetHeaderName(size_t index) const {
-    return index < header_name_list_.size() ? header_name_list_[index].c_str() : nullptr;
+    return headers_.name(index);
 }
 
 const char *HttpMessage::GetHeaderValue(size_t index) const {
-    return index < header_value_list_.size() ? header_value_list_[index].c_str() : nullptr;
+    return headers_.value(index);
 }
 
 const char *HttpMessage::GetHeaderValue(const char *name) const {
-    const char *value{nullptr};
-
-    for (size_t i{0}; header_name_list_.size() > i && nullptr == value; ++i) {
-        if (0 == strcasecmp(name, header_name_list_[i].c_str())) {
-            value = header_value_list_[i].c_str();
-        }
-    }
+    return headers_.Get(name);
+}
 
-    return value;
+const char *HttpMessage::GetHeaderValue(const HttpHeaderId id) const {
+    return headers_.Get(id);
 }
 
 void HttpMessage::AppendContent(const void *content, const int length, const int max_length) {
@@ -119,27 +156,69 @@ void HttpMessage::AppendContent(const void *content, const int length, const int
     if (valid_length <= 0)
         valid_length = strlen((char *)content);
 
-    int total = content_.size() + valid_length;
-    total = total > max_length ? total : max_length;
+    JoinContentPieces();
 
-    //content_.reserve(total);
+    if (static_cast<size_t>(max_length) > content_.capacity())
+        content_.reserve(max_length);
 
     content_.append((char *) content, valid_length);
 }
 
 const string &HttpMessage::content() const {
+    JoinContentPieces();
+
     return content_;
 }
 
 void HttpMessage::set_content(const char *const content, const int length) {
+    content_pieces_.clear();
+    content_pieces_size_ = 0;
+    body_pb_ = nullptr;
     content_.clear();
     content_.append(content, length);
 }
 
 string *HttpMessage::mutable_content() {
+    JoinContentPieces();
+
     return &content_;
 }
 
+string *HttpMessage::AddContentPiece(const size_t size) {
+    if (content_pieces_.empty() && !content_.empty()) {
+        content_pieces_size_ += content_.size();
+        content_pieces_.emplace_back(move(content_));
+        content_.clear();
+    }
+
+    content_pieces_.emplace_back(size, '\0');
+    content_pieces_size_ += size;
+
+    return &content_pieces_.back();
+}
+
+void HttpMessage::JoinContentPieces() const {
+    if (nullptr != body_pb_) {
+        // asked for the bytes before sending, sizes are cached by FromPb
+        content_.resize(body_pb_size_);
+        body_pb_->SerializeWithCachedSizesToArray(
+                reinterpret_cast<uint8_t *>(&content_[0]));
+        body_pb_ = nullptr;
+
+        return;
+    }
+
+    if (content_pieces_.empty())
+        return;
+
+    content_.reserve(content_pieces_size_);
+    for (auto &piece : content_pieces_)
+        content_.append(piece);
+
+    content_pieces_.clear();
+    content_pieces_size_ = 0;
+}
+
 const char *HttpMessage::version() const {
     return version_;
 }
@@ -164,9 +243,12 @@ HttpRequest::~HttpRequest() {
 int HttpRequest::Send(BaseTcpStream &socket) const {
     int ret{HttpProtocol::SendReqHeader(socket, "POST", *this)};
 
-    if (0 == ret) {
-        socket << content();
-        if (!socket.flush().good())
+    if (0 == ret && 0 < content().size()) {
+        struct iovec body;
+        body.iov_base = const_cast<char *>(content().data());
+        body.iov_len = content().size();
+
+        if (!socket.Writev(&body, 1))
             ret = static_cast<int>(socket.LastError());
     }
 
@@ -174,12 +256,15 @@ int HttpRequest::Send(BaseTcpStream &socket) const {
 }
 
 BaseResponse *HttpRequest::GenResponse() const {
-    return new HttpResponse;
+    HttpResponse *resp{NewMessage<HttpResponse>(arena())};
+    HttpProtocol::FixRespHeaders(*this, resp);
+
+    return resp;
 }
 
 bool HttpRequest::keep_alive() const {
-    const char *proxy{GetHeaderValue(HEADER_PROXY_CONNECTION)};
-    const char *local{GetHeaderValue(HEADER_CONNECTION)};
+    const char *proxy{GetHeaderValue(HttpHeaderId::PROXY_CONNECTION)};
+    const char *local{GetHeaderValue(HttpHeaderId::CONNECTION)};
 
     if ((nullptr != proxy && 0 == strcasecmp(proxy, "Keep-Alive"))
         || (nullptr != local && 0 == strcasecmp(local, "Keep-Alive"))) {
@@ -191,9 +276,9 @@ bool HttpRequest::keep_alive() const {
 
 void HttpRequest::set_keep_alive(const bool keep_alive) {
     if (keep_alive) {
-        AddHeader(HttpMessage::HEADER_CONNECTION, "Keep-Alive");
+        SetHeader(HttpHeaderId::CONNECTION, "Keep-Alive");
     } else {
-        AddHeader(HttpMessage::HEADER_CONNECTION, "");
+        SetHeader(HttpHeaderId::CONNECTION, "");
     }
 }
 
@@ -269,28 +354,7 @@ HttpResponse::~HttpResponse() {
 }
 
 int HttpResponse::Send(BaseTcpStream &socket) const {
-    socket << version() << " " << status_code() << " " << reason_phrase() << "\r\n";
-
-    for (size_t i{0}; GetHeaderCount() > i; ++i) {
-        socket << GetHeaderName(i) << ": " << GetHeaderValue(i) << "\r\n";
-    }
-
-    if (content().size() > 0) {
-        if (nullptr == GetHeaderValue(HttpMessage::HEADER_CONTENT_LENGTH)) {
-            socket << HttpMessage::HEADER_CONTENT_LENGTH << ": " << content().size() << "\r\n";
-        }
-    }
-
-    socket << "\r\n";
-
-    if (content().size() > 0)
-        socket << content();
-
-    if (socket.flush().good()) {
-        return 0;
-    } else {
-        return static_cast<int>(socket.LastError());
-    }
+    return HttpProtocol::SendResp(socket, *this);
 }
 
 void HttpResponse::SetFake(FakeReason reason) {
@@ -312,12 +376,35 @@ int HttpResponse::Modify(const bool keep_alive, const string &version) {
 }
 
 int HttpResponse::result() {
-    const char *result{GetHeaderValue(HttpMessage::HEADER_X_PHXRPC_RESULT)};
+    if (nullptr != stream())
+        return stream()->result();
+
+    const char *result{GetHeaderValue(HttpHeaderId::X_PHXRPC_RESULT)};
     return atoi(nullptr == result ? "-1" : result);
 }
 
 void HttpResponse::set_result(const int result) {
-    AddHeader(HttpMessage::HEADER_X_PHXRPC_RESULT, result);
+    // the head of a stream may be on the wire already, its result goes in the trailer
+    if (nullptr != stream()) {
+        stream()->set_result(result);
+
+        return;
+    }
+
+    AddHeader(HttpHeaderId::X_PHXRPC_RESULT, result);
+}
+
+int HttpResponse::SendStream(BaseTcpStream &socket, const vector<string> &frames,
+                             const bool finished) {
+    const bool with_head{!stream_head_sent_};
+    stream_head_sent_ = true;
+
+    return HttpProtocol::SendRespStream(socket, *this, with_head, frames,
+                                        finished, finished ? result() : 0);
+}
+
+int HttpResponse::RecvStream(BaseTcpStream &socket, string *data, bool *finished) {
+    return HttpProtocol::RecvRespStream(socket, this, data, finished);
 }
 
 void HttpResponse::set_status_code(int status_code) {
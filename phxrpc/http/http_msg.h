@@ -24,6 +24,7 @@ See the AUTHORS file for names of contributors.
 #include <vector>
 #include <string>
 
+#include "phxrpc/http/http_headers.h"
 #include "phxrpc/msg.h"
 
 
@@ -48,39 +49,67 @@ class HttpMessage : virtual public BaseMessage {
     static const char *HEADER_SERVER;
 
     static const char *HEADER_X_PHXRPC_RESULT;
+    static const char *HEADER_X_PHXRPC_CMDID;
+    static const char *HEADER_X_PHXRPC_ONEWAY;
 
     HttpMessage() = default;
     virtual ~HttpMessage() override = default;
 
     virtual int ToPb(google::protobuf::Message *const message) const override;
+    // a message on the request arena is not serialized here but by the io
+    // thread, straight into the socket, see body_pb()
     virtual int FromPb(const google::protobuf::Message &message) override;
     virtual size_t size() const override;
+    // header copies go to the arena too
+    virtual void set_arena(Arena *arena) override;
 
     void AddHeader(const char *name, const char *value);
     void AddHeader(const char *name, int value);
+    void AddHeader(const HttpHeaderId id, const char *value);
+    void AddHeader(const HttpHeaderId id, int value);
+    void SetHeader(const HttpHeaderId id, const char *value);
     bool RemoveHeader(const char *name);
+    bool RemoveHeader(const HttpHeaderId id);
     size_t GetHeaderCount() const;
     const char *GetHeaderName(size_t index) const;
     const char *GetHeaderValue(size_t index) const;
     const char *GetHeaderValue(const char *name) const;
+    const char *GetHeaderValue(const HttpHeaderId id) const;
     void AppendContent(const void *content, const int length = 0, const int max_length = 0);
 
     const std::string &content() const;
     void set_content(const char *const content, const int length = 0);
     std::string *mutable_content();
+    // appends a piece of size bytes to be filled in place, pieces are
+    // parsed by ToPb as they are and only joined when content() is asked for
+    std::string *AddContentPiece(const size_t size);
+    // body left to be serialized on sending, nullptr if it is in content
+    const google::protobuf::Message *body_pb() const { return body_pb_; }
 
     const char *version() const;
     void set_version(const char *version);
 
     Direction direction() const { return direction_; }
 
+    // received start line and headers, header views point into it
+    std::string *mutable_head() { return &head_; }
+    const HttpHeaders &headers() const { return headers_; }
+    HttpHeaders *mutable_headers() { return &headers_; }
+
   protected:
     void set_direction(const Direction direction) { direction_ = direction; }
 
-    std::vector<std::string> header_name_list_, header_value_list_;
+    HttpHeaders headers_;
 
   private:
-    std::string content_;
+    void JoinContentPieces() const;
+
+    std::string head_;
+    mutable std::string content_;
+    mutable std::vector<std::string> content_pieces_;
+    mutable size_t content_pieces_size_{0};
+    mutable const google::protobuf::Message *body_pb_{nullptr};
+    size_t body_pb_size_{0};
     char version_[16];
     Direction direction_{Direction::NONE};
 };
@@ -128,15 +157,30 @@ class HttpResponse : public HttpMessage, public BaseResponse {
     virtual int result() override;
     virtual void set_result(const int result) override;
 
+    virtual int SendStream(BaseTcpStream &socket, const std::vector<std::string> &frames,
+                           const bool finished) override;
+    virtual int RecvStream(BaseTcpStream &socket, std::string *data, bool *finished) override;
+
     void set_status_code(int status_code);
     int status_code() const;
 
     void set_reason_phrase(const char *reason_phrase);
     const char *reason_phrase() const;
 
+    // whether Send should announce Connection: Keep-Alive
+    void set_keep_alive(const bool keep_alive) { keep_alive_ = keep_alive; }
+    bool keep_alive() const { return keep_alive_; }
+
+    // Content-Encoding the io thread is to send the body in, nullptr to send it as it is
+    void set_coding(const char *coding) { coding_ = coding; }
+    const char *coding() const { return coding_; }
+
   private:
     int status_code_;
     char reason_phrase_[128];
+    bool keep_alive_{false};
+    const char *coding_{nullptr};
+    bool stream_head_sent_{false};
 };
 
 
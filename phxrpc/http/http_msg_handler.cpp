@@ -34,7 +34,7 @@ using namespace std;
 
 
 int HttpMessageHandler::RecvRequest(BaseTcpStream &socket, BaseRequest *&req) {
-    HttpRequest *http_req{new HttpRequest};
+    HttpRequest *http_req{NewMessage<HttpRequest>(arena_)};
 
     int ret{HttpProtocol::RecvReq(socket, http_req)};
     if (0 == ret) {
@@ -42,7 +42,7 @@ int HttpMessageHandler::RecvRequest(BaseTcpStream &socket, BaseRequest *&req) {
         version_ = (http_req->version() != nullptr ? http_req->version() : "");
         keep_alive_ = http_req->keep_alive();
     } else {
-        delete http_req;
+        DeleteMessage(http_req);
         http_req = nullptr;
     }
 
@@ -63,6 +63,20 @@ int HttpMessageHandler::RecvResponse(BaseTcpStream &socket, BaseResponse *&resp)
     return ret;
 }
 
+int HttpMessageHandler::RecvResponseHead(BaseTcpStream &socket, BaseResponse *&resp) {
+    HttpResponse *http_resp{new HttpResponse};
+
+    int ret{HttpProtocol::RecvRespHead(socket, http_resp)};
+    if (0 == ret) {
+        resp = http_resp;
+    } else {
+        delete http_resp;
+        http_resp = nullptr;
+    }
+
+    return ret;
+}
+
 int HttpMessageHandler::GenRequest(BaseRequest *&req) {
     req = new HttpRequest;
 
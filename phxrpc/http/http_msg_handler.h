@@ -40,6 +40,7 @@ class HttpMessageHandler : public BaseMessageHandler {
 
     virtual int RecvRequest(BaseTcpStream &socket, BaseRequest *&req) override;
     virtual int RecvResponse(BaseTcpStream &socket, BaseResponse *&resp) override;
+    virtual int RecvResponseHead(BaseTcpStream &socket, BaseResponse *&resp) override;
 
     virtual int GenRequest(BaseRequest *&req) override;
     virtual int GenResponse(BaseResponse *&resp) override;
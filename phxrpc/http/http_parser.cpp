@@ -0,0 +1,344 @@
+/*
+Tencent is pleased to support the open source community by making
+PhxRPC available.
+Copyright (C) 2016 THL A29 Limited, a Tencent company.
+All rights reserved.
+
+Licensed under the BSD 3-Clause License (the "License"); you may
+not use this file except in compliance with the License. You may
+obtain a copy of the License at
+
+https://opensource.org/licenses/BSD-3-Clause
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" basis,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+implied. See the License for the specific language governing
+permissions and limitations under the License.
+
+See the AUTHORS file for names of contributors.
+*/
+
+
+#include "phxrpc/http/http_parser.h"
+
+#include <atomic>
+#include <cctype>
+#include <cstring>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define PHXRPC_HTTP_PARSER_X86 1
+#include <immintrin.h>
+#endif
+
+
+namespace {
+
+
+using namespace std;
+using namespace phxrpc;
+
+
+typedef const char *(*FindByteFunc)(const char *begin, const char *end, const char c);
+
+
+const char *FindByteScalar(const char *begin, const char *end, const char c) {
+    return static_cast<const char *>(memchr(begin, c, end - begin));
+}
+
+#ifdef PHXRPC_HTTP_PARSER_X86
+
+// the simd versions are built with target attributes and picked at runtime,
+// so the library itself still builds with the default -m64 flags
+
+__attribute__((target("sse4.2")))
+const char *FindByteSSE42(const char *begin, const char *end, const char c) {
+    const __m128i needle{_mm_set1_epi8(c)};
+    const char *pos{begin};
+
+    for (; 16 <= end - pos; pos += 16) {
+        const __m128i chunk{_mm_loadu_si128(reinterpret_cast<const __m128i *>(pos))};
+        const int idx{_mm_cmpestri(needle, 1, chunk, 16, _SIDD_UBYTE_OPS |
+                                   _SIDD_CMP_EQUAL_ANY | _SIDD_LEAST_SIGNIFICANT)};
+        if (16 > idx)
+            return pos + idx;
+    }
+
+    return FindByteScalar(pos, end, c);
+}
+
+__attribute__((target("avx2")))
+const char *FindByteAVX2(const char *begin, const char *end, const char c) {
+    const __m256i needle{_mm256_set1_epi8(c)};
+    const char *pos{begin};
+
+    for (; 32 <= end - pos; pos += 32) {
+        const __m256i chunk{_mm256_loadu_si256(reinterpret_cast<const __m256i *>(pos))};
+        const unsigned int mask{static_cast<unsigned int>(
+                _mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, needle)))};
+        if (0 != mask)
+            return pos + __builtin_ctz(mask);
+    }
+
+    return FindByteSSE42(pos, end, c);
+}
+
+#endif
+
+bool CpuSupports(const HttpParser::ScanImpl scan_impl) {
+#ifdef PHXRPC_HTTP_PARSER_X86
+    __builtin_cpu_init();
+    switch (scan_impl) {
+      case HttpParser::ScanImpl::AVX2:
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("sse4.2");
+      case HttpParser::ScanImpl::SSE42:
+        return __builtin_cpu_supports("sse4.2");
+      default:
+        return true;
+    }
+#else
+    return HttpParser::ScanImpl::AVX2 != scan_impl && HttpParser::ScanImpl::SSE42 != scan_impl;
+#endif
+}
+
+HttpParser::ScanImpl ResolveScanImpl(const HttpParser::ScanImpl scan_impl) {
+    if (HttpParser::ScanImpl::AUTO != scan_impl)
+        return CpuSupports(scan_impl) ? scan_impl : HttpParser::ScanImpl::SCALAR;
+
+    if (CpuSupports(HttpParser::ScanImpl::AVX2))
+        return HttpParser::ScanImpl::AVX2;
+    if (CpuSupports(HttpParser::ScanImpl::SSE42))
+        return HttpParser::ScanImpl::SSE42;
+
+    return HttpParser::ScanImpl::SCALAR;
+}
+
+FindByteFunc GetFindByteFunc(const HttpParser::ScanImpl scan_impl) {
+    switch (scan_impl) {
+#ifdef PHXRPC_HTTP_PARSER_X86
+      case HttpParser::ScanImpl::AVX2:
+        return FindByteAVX2;
+      case HttpParser::ScanImpl::SSE42:
+        return FindByteSSE42;
+#endif
+      default:
+        return FindByteScalar;
+    }
+}
+
+// read by every io thread, set_scan_impl may switch them under a running server
+atomic<HttpParser::ScanImpl> &CurrentScanImpl() {
+    static atomic<HttpParser::ScanImpl> scan_impl{ResolveScanImpl(HttpParser::ScanImpl::AUTO)};
+    return scan_impl;
+}
+
+atomic<FindByteFunc> &CurrentFindByteFunc() {
+    static atomic<FindByteFunc> func{GetFindByteFunc(CurrentScanImpl())};
+    return func;
+}
+
+inline bool IsBlank(const char c) {
+    return ' ' == c || '\t' == c;
+}
+
+inline HttpParser::Slice MakeSlice(const size_t begin, const size_t end) {
+    HttpParser::Slice slice;
+    slice.offset = static_cast<uint32_t>(begin);
+    slice.length = static_cast<uint32_t>(end - begin);
+    return slice;
+}
+
+
+}  // namespace
+
+
+namespace phxrpc {
+
+
+HttpParser::HttpParser(const Type type) {
+    headers_.reserve(16);
+    Reset(type);
+}
+
+HttpParser::~HttpParser() {
+}
+
+void HttpParser::Reset(const Type type) {
+    type_ = type;
+    state_ = Type::HEADERS == type ? State::HEADER_LINE : State::START_LINE;
+    line_begin_ = 0;
+    scan_pos_ = 0;
+    consumed_ = 0;
+    method_ = uri_ = version_ = reason_phrase_ = Slice();
+    status_code_ = 0;
+    headers_.clear();
+}
+
+HttpParser::Status HttpParser::Execute(const char *data, const size_t len) {
+    if (State::DONE == state_)
+        return Status::DONE;
+
+    for (; State::ERROR != state_;) {
+        const char *lf{FindByte(data + scan_pos_, data + len, '\n')};
+        if (nullptr == lf) {
+            scan_pos_ = len;
+            if (MAX_HEAD_LEN < len)
+                state_ = State::ERROR;
+            break;
+        }
+
+        const size_t next{static_cast<size_t>(lf - data) + 1};
+        size_t line_end{next - 1};
+        if (line_end > line_begin_ && '\r' == data[line_end - 1])
+            --line_end;
+
+        if (State::START_LINE == state_) {
+            // tolerate empty lines left over before the start line, rfc7230 section[3.5]
+            if (line_end > line_begin_) {
+                bool ok{Type::REQUEST == type_ ? ParseRequestLine(data, line_begin_, line_end) :
+                        ParseStatusLine(data, line_begin_, line_end)};
+                state_ = ok ? State::HEADER_LINE : State::ERROR;
+            }
+        } else if (line_end == line_begin_) {
+            state_ = State::DONE;
+            consumed_ = next;
+
+            return Status::DONE;
+        } else if (!ParseHeaderLine(data, line_begin_, line_end)) {
+            state_ = State::ERROR;
+        }
+
+        line_begin_ = scan_pos_ = next;
+        if (MAX_HEAD_LEN < next)
+            state_ = State::ERROR;
+    }
+
+    return State::ERROR == state_ ? Status::ERROR : Status::NEED_MORE;
+}
+
+bool HttpParser::ParseRequestLine(const char *data, const size_t begin, const size_t end) {
+    // method SP request-target SP HTTP-version
+    const char *line{data + begin};
+    const char *line_end{data + end};
+
+    const char *sp1{static_cast<const char *>(memchr(line, ' ', line_end - line))};
+    if (nullptr == sp1 || line == sp1)
+        return false;
+    method_ = MakeSlice(begin, sp1 - data);
+
+    const char *target{sp1 + 1};
+    const char *sp2{static_cast<const char *>(memchr(target, ' ', line_end - target))};
+    if (nullptr == sp2)
+        sp2 = line_end;
+    if (target == sp2)
+        return false;
+    uri_ = MakeSlice(target - data, sp2 - data);
+
+    if (sp2 < line_end)
+        version_ = MakeSlice(sp2 + 1 - data, end);
+
+    return true;
+}
+
+bool HttpParser::ParseStatusLine(const char *data, const size_t begin, const size_t end) {
+    // HTTP-version SP status-code SP reason-phrase
+    const char *line{data + begin};
+    const char *line_end{data + end};
+
+    if (4 > end - begin || 0 != strncasecmp(line, "HTTP", 4))
+        return false;
+
+    const char *sp1{static_cast<const char *>(memchr(line, ' ', line_end - line))};
+    if (nullptr == sp1)
+        return false;
+    version_ = MakeSlice(begin, sp1 - data);
+
+    const char *pos{sp1 + 1};
+    int status_code{0};
+    for (; line_end > pos && isdigit(static_cast<unsigned char>(*pos)); ++pos)
+        status_code = status_code * 10 + (*pos - '0');
+    if (sp1 + 1 == pos || sp1 + 4 < pos)
+        return false;
+    status_code_ = status_code;
+
+    if (line_end > pos) {
+        if (' ' != *pos)
+            return false;
+        reason_phrase_ = MakeSlice(pos + 1 - data, end);
+    }
+
+    return true;
+}
+
+bool HttpParser::ParseHeaderLine(const char *data, const size_t begin, const size_t end) {
+    size_t value_end{end};
+    for (; value_end > begin && IsBlank(data[value_end - 1]);)
+        --value_end;
+
+    if (IsBlank(data[begin])) {
+        // obsolete line folding, rfc7230 section[3.2.4]
+        if (headers_.empty())
+            return false;
+
+        Header &header = headers_.back();
+        if (0 == header.value.length) {
+            size_t value_begin{begin};
+            for (; value_end > value_begin && IsBlank(data[value_begin]);)
+                ++value_begin;
+            header.value = MakeSlice(value_begin, value_end);
+        } else if (value_end > begin) {
+            header.value.length = static_cast<uint32_t>(value_end - header.value.offset);
+            header.folded = true;
+        }
+
+        return true;
+    }
+
+    if (MAX_HEADER_COUNT <= headers_.size())
+        return false;
+
+    const char *colon{FindByte(data + begin, data + end, ':')};
+    if (nullptr == colon)
+        return false;
+
+    size_t name_end{static_cast<size_t>(colon - data)};
+    for (; name_end > begin && IsBlank(data[name_end - 1]);)
+        --name_end;
+    if (name_end == begin)
+        return false;
+
+    size_t value_begin{static_cast<size_t>(colon - data) + 1};
+    for (; value_end > value_begin && IsBlank(data[value_begin]);)
+        ++value_begin;
+    if (value_begin > value_end)
+        value_begin = value_end;
+
+    Header header;
+    header.name = MakeSlice(begin, name_end);
+    header.value = MakeSlice(value_begin, value_end);
+    headers_.push_back(header);
+
+    return true;
+}
+
+const char *HttpParser::FindByte(const char *begin, const char *end, const char c) {
+    return CurrentFindByteFunc().load(memory_order_relaxed)(begin, end, c);
+}
+
+void HttpParser::set_scan_impl(const ScanImpl scan_impl) {
+    const ScanImpl resolved{ResolveScanImpl(scan_impl)};
+    CurrentScanImpl() = resolved;
+    CurrentFindByteFunc() = GetFindByteFunc(resolved);
+}
+
+HttpParser::ScanImpl HttpParser::scan_impl() {
+    return CurrentScanImpl();
+}
+
+bool HttpParser::IsScanImplSupported(const ScanImpl scan_impl) {
+    return CpuSupports(scan_impl);
+}
+
+
+}  // namespace phxrpc
+
@@ -0,0 +1,141 @@
+/*
+Tencent is pleased to support the open source community by making
+PhxRPC available.
+Copyright (C) 2016 THL A29 Limited, a Tencent company.
+All rights reserved.
+
+Licensed under the BSD 3-Clause License (the "License"); you may
+not use this file except in compliance with the License. You may
+obtain a copy of the License at
+
+https://opensource.org/licenses/BSD-3-Clause
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" basis,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+implied. See the License for the specific language governing
+permissions and limitations under the License.
+
+See the AUTHORS file for names of contributors.
+*/
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+namespace phxrpc {
+
+
+// Incremental HTTP/1.x head parser.
+//
+// The parser never copies: start line tokens and header names/values are
+// returned as slices (offset + length) into the buffer handed to Execute().
+// It is resumable, a partial head returns NEED_MORE and the next call only
+// scans the bytes appended since, so the caller may grow (and reallocate)
+// its buffer between calls as long as the bytes already fed keep their
+// offsets.
+class HttpParser {
+  public:
+    enum class Type {
+        REQUEST = 0,
+        RESPONSE,
+        // header lines only, e.g. the trailer of a chunked body
+        HEADERS,
+    };
+
+    enum class Status {
+        ERROR = -1,
+        NEED_MORE = 0,
+        DONE = 1,
+    };
+
+    // line scanning implementation, AUTO picks the best one the cpu supports
+    enum class ScanImpl {
+        AUTO = 0,
+        SCALAR,
+        SSE42,
+        AVX2,
+    };
+
+    enum {
+        MAX_HEAD_LEN = 64 * 1024,
+        MAX_HEADER_COUNT = 128,
+    };
+
+    struct Slice {
+        uint32_t offset{0};
+        uint32_t length{0};
+    };
+
+    struct Header {
+        Slice name;
+        Slice value;
+        // value spans obsolete line folding, CRLF and leading spaces of the
+        // continuation lines are still inside the slice
+        bool folded{false};
+    };
+
+    explicit HttpParser(const Type type);
+    ~HttpParser();
+
+    void Reset(const Type type);
+
+    // data must start at the first byte of the head and contain every byte
+    // fed by the previous calls since Reset()
+    Status Execute(const char *data, const size_t len);
+
+    Type type() const { return type_; }
+    // length of the whole head including the empty line, valid after DONE
+    size_t consumed() const { return consumed_; }
+
+    const Slice &method() const { return method_; }
+    const Slice &uri() const { return uri_; }
+    const Slice &version() const { return version_; }
+    int status_code() const { return status_code_; }
+    const Slice &reason_phrase() const { return reason_phrase_; }
+
+    size_t header_count() const { return headers_.size(); }
+    const Header &header(const size_t index) const { return headers_[index]; }
+
+    static const char *FindByte(const char *begin, const char *end, const char c);
+
+    // for all threads at once, safe with a server running
+    static void set_scan_impl(const ScanImpl scan_impl);
+    static ScanImpl scan_impl();
+    static bool IsScanImplSupported(const ScanImpl scan_impl);
+
+  private:
+    enum class State {
+        START_LINE = 0,
+        HEADER_LINE,
+        DONE,
+        ERROR,
+    };
+
+    bool ParseRequestLine(const char *data, const size_t begin, const size_t end);
+    bool ParseStatusLine(const char *data, const size_t begin, const size_t end);
+    bool ParseHeaderLine(const char *data, const size_t begin, const size_t end);
+
+    Type type_;
+    State state_{State::START_LINE};
+    // offset of the first byte of the line being parsed
+    size_t line_begin_{0};
+    // offset to resume the line end scanning from
+    size_t scan_pos_{0};
+    size_t consumed_{0};
+
+    Slice method_;
+    Slice uri_;
+    Slice version_;
+    int status_code_{0};
+    Slice reason_phrase_;
+    std::vector<Header> headers_;
+};
+
+
+}  // namespace phxrpc
+
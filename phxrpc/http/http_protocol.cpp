@@ -21,12 +21,24 @@ See the AUTHORS file for names of contributors.
 
 #include "phxrpc/http/http_protocol.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cctype>
+#include <cstdlib>
 #include <cstring>
+#include <ctime>
+#include <limits>
 #include <string>
 
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/message.h>
+#include <zlib.h>
+
 #include "phxrpc/file.h"
 #include "phxrpc/http/http_msg.h"
+#include "phxrpc/http/http_parser.h"
+#include "phxrpc/msg/zero_copy_stream.h"
 #include "phxrpc/network/socket_stream_base.h"
 
 
@@ -34,24 +46,222 @@ namespace {
 
 
 using namespace std;
+using namespace phxrpc;
 
 
-char *SeparateStr(char **s, const char *del) {
-    char *d, *tok;
+// the head is ours, so a slice can be handed out as a c string by
+// overwriting the delimiter that follows it
+const char *TerminateSlice(string *head, const HttpParser::Slice &slice) {
+    if (0 == slice.length)
+        return "";
 
-    if (!s || !*s)
-        return nullptr;
-    tok = *s;
-    d = strstr(tok, del);
+    char *begin{&(*head)[slice.offset]};
+    begin[slice.length] = '\0';
+
+    return begin;
+}
+
+// joins folded lines with a single space, rfc7230 section[3.2.4]
+const char *TerminateFoldedSlice(string *head, const HttpParser::Slice &slice) {
+    char *begin{&(*head)[slice.offset]};
+    const char *end{begin + slice.length};
+    char *out{begin};
+
+    for (const char *pos{begin}; end > pos;) {
+        if ('\r' == *pos || '\n' == *pos) {
+            for (; end > pos && isspace(static_cast<unsigned char>(*pos));)
+                ++pos;
+            *out++ = ' ';
+        } else {
+            *out++ = *pos++;
+        }
+    }
+    *out = '\0';
+
+    return begin;
+}
+
+int RecvHead(BaseTcpStream &socket, HttpParser *parser, string *head) {
+    head->clear();
+
+    for (;;) {
+        const char *data{nullptr};
+        ssize_t len{socket.Peek(&data)};
+        if (0 >= len)
+            return static_cast<int>(socket.LastError());
+
+        const size_t fed{head->size()};
+        head->append(data, len);
+
+        HttpParser::Status status{parser->Execute(head->data(), head->size())};
+        if (HttpParser::Status::DONE == status) {
+            // leave the bytes after the head, i.e. the body, in the stream
+            socket.Consume(parser->consumed() - fed);
+            head->resize(parser->consumed());
+
+            return 0;
+        }
+
+        socket.Consume(len);
+
+        if (HttpParser::Status::ERROR == status) {
+            phxrpc::log(LOG_WARNING, "%s invalid http head, len %zu", __func__, head->size());
+
+            return -1;
+        }
+    }
+}
+
+// with adopted the head is kept by msg and headers are views into it
+void AddHeaders(const HttpParser &parser, string *head, const bool adopted, HttpMessage *msg) {
+    for (size_t i{0}; parser.header_count() > i; ++i) {
+        const HttpParser::Header &header = parser.header(i);
+        const char *value{header.folded ? TerminateFoldedSlice(head, header.value) :
+                          TerminateSlice(head, header.value)};
+        const char *name{TerminateSlice(head, header.name)};
+
+        if (adopted) {
+            msg->mutable_headers()->AddView(name, header.name.length, value);
+        } else {
+            msg->AddHeader(name, value);
+        }
+    }
+}
+
+// common head lines, prebuilt for each (version, keep-alive)
+struct RespHeadBlock {
+    const char *data;
+    size_t len;
+    // length of the "200 OK" status line at the front of data
+    size_t status_line_len;
+};
+
+#define RESP_HEAD_BLOCK(version, connection) \
+    {version " 200 OK\r\n" connection "Server: http/phxrpc\r\n", \
+     sizeof(version " 200 OK\r\n" connection "Server: http/phxrpc\r\n") - 1, \
+     sizeof(version " 200 OK\r\n") - 1}
+
+const RespHeadBlock RESP_HEAD_BLOCKS[2][2] = {
+    {RESP_HEAD_BLOCK("HTTP/1.0", ""), RESP_HEAD_BLOCK("HTTP/1.0", "Connection: Keep-Alive\r\n")},
+    {RESP_HEAD_BLOCK("HTTP/1.1", ""), RESP_HEAD_BLOCK("HTTP/1.1", "Connection: Keep-Alive\r\n")},
+};
+
+#undef RESP_HEAD_BLOCK
+
+// the Date line only changes once a second, format it at most that often per thread
+struct DateLine {
+    time_t time{0};
+    char data[64];
+    size_t len{0};
+};
+
+const DateLine &GetDateLine() {
+    static thread_local DateLine date_line;
+
+    const time_t now{time(nullptr)};
+    if (now != date_line.time) {
+        struct tm tm_time;
+        gmtime_r(&now, &tm_time);
+        date_line.len = strftime(date_line.data, sizeof(date_line.data),
+                                 "Date: %a, %d %b %Y %H:%M:%S %Z\r\n", &tm_time);
+        date_line.time = now;
+    }
+
+    return date_line;
+}
+
+// appends to the socket output buffer, which sends by itself when full
+class HeadWriter {
+  public:
+    explicit HeadWriter(streambuf *buf) : buf_(buf) {}
+
+    void Put(const char *data, const size_t len) {
+        if (good_ && static_cast<streamsize>(len) != buf_->sputn(data, len))
+            good_ = false;
+    }
+
+    void Put(const char *data) { Put(data, strlen(data)); }
+
+    bool good() const { return good_; }
+
+  private:
+    streambuf *buf_{nullptr};
+    bool good_{true};
+};
+
+// serializes behind the head in the socket buffer, so a small body leaves
+// with it in one send, a big one through pooled staging buffers
+bool SendPb(BaseTcpStream &socket, const google::protobuf::Message &message,
+            const size_t size) {
+    TcpStreamOutputStream stream(socket);
+    {
+        google::protobuf::io::CodedOutputStream output(&stream);
+        message.SerializeWithCachedSizes(&output);
+        if (output.HadError() || output.ByteCount() != static_cast<int64_t>(size)) {
+            log(LOG_ERR, "SerializeWithCachedSizes err, %lld bytes of %zu",
+                static_cast<long long>(output.ByteCount()), size);
+
+            return false;
+        }
+    }
+
+    return stream.Flush();
+}
+
+// status line and headers, a chunked head announces the result as a trailer
+void PutRespHead(HeadWriter *writer, const HttpResponse &resp, const bool chunked) {
+    char tmp[32];
 
-    if (d) {
-        *s = d + strlen(del);
-        *d = '\0';
+    const bool http11{0 == strcasecmp(resp.version(), "HTTP/1.1")};
+    const bool keep_alive{resp.keep_alive() &&
+                          nullptr == resp.GetHeaderValue(HttpHeaderId::CONNECTION)};
+    const RespHeadBlock &block = RESP_HEAD_BLOCKS[http11 ? 1 : 0][keep_alive ? 1 : 0];
+
+    if (200 == resp.status_code() && 0 == strcmp(resp.reason_phrase(), "OK") &&
+        (http11 || 0 == strcasecmp(resp.version(), "HTTP/1.0"))) {
+        writer->Put(block.data, block.len);
     } else {
-        *s = nullptr;
+        writer->Put(resp.version());
+        writer->Put(" ", 1);
+        writer->Put(tmp, HttpProtocol::FormatInt(resp.status_code(), tmp));
+        writer->Put(" ", 1);
+        writer->Put(resp.reason_phrase());
+        writer->Put("\r\n", 2);
+        writer->Put(block.data + block.status_line_len, block.len - block.status_line_len);
+    }
+
+    const DateLine &date_line = GetDateLine();
+    writer->Put(date_line.data, date_line.len);
+
+    const HttpHeaders &headers = resp.headers();
+    for (size_t i{0}; headers.count() > i; ++i) {
+        const HttpHeaderId id{headers.id(i)};
+        if (HttpHeaderId::DATE == id || HttpHeaderId::SERVER == id)
+            continue;
+        if (chunked && (HttpHeaderId::CONTENT_LENGTH == id ||
+                        HttpHeaderId::TRANSFER_ENCODING == id ||
+                        HttpHeaderId::X_PHXRPC_RESULT == id))
+            continue;
+
+        writer->Put(headers.name(i));
+        writer->Put(": ", 2);
+        writer->Put(headers.value(i));
+        writer->Put("\r\n", 2);
     }
 
-    return tok;
+    if (chunked) {
+        static const char CHUNKED_LINES[] =
+                "Transfer-Encoding: chunked\r\nTrailer: X-PHXRPC-Result\r\n";
+        writer->Put(CHUNKED_LINES, sizeof(CHUNKED_LINES) - 1);
+    } else if (HttpProtocol::SC_NOT_MODIFIED != resp.status_code() &&
+               nullptr == headers.Get(HttpHeaderId::CONTENT_LENGTH) &&
+               nullptr == headers.Get(HttpHeaderId::TRANSFER_ENCODING)) {
+        writer->Put("Content-Length: ", sizeof("Content-Length: ") - 1);
+        writer->Put(tmp, HttpProtocol::FormatInt(resp.size(), tmp));
+        writer->Put("\r\n", 2);
+    }
+
+    writer->Put("\r\n", 2);
 }
 
 void URLEncode(const char *source, char *dest, size_t length) {
@@ -84,6 +294,89 @@ void URLEncode(const char *source, char *dest, size_t length) {
     *q = 0;
 }
 
+const char *HEADER_ACCEPT_ENCODING = "Accept-Encoding";
+const char *HEADER_CONTENT_ENCODING = "Content-Encoding";
+
+// a z_stream kept by each thread for each direction, reset for every body
+// rather than set up again, which costs more than compressing a small one
+class GzipContext {
+  public:
+    explicit GzipContext(const bool deflate) : deflate_(deflate) {
+        memset(&stream_, 0, sizeof(stream_));
+        // 16 writes the gzip wrapper, 32 detects it
+        if (deflate_) {
+            ok_ = Z_OK == deflateInit2(&stream_, Z_BEST_SPEED, Z_DEFLATED, 15 + 16, 8,
+                                       Z_DEFAULT_STRATEGY);
+        } else {
+            ok_ = Z_OK == inflateInit2(&stream_, 15 + 32);
+        }
+    }
+
+    ~GzipContext() {
+        if (ok_)
+            deflate_ ? deflateEnd(&stream_) : inflateEnd(&stream_);
+    }
+
+    // fails rather than put out more than max_out bytes, e.g. for a gzip bomb
+    bool Run(const string &in, string *out, const size_t max_out) {
+        if (!ok_)
+            return false;
+
+        if (deflate_) {
+            deflateReset(&stream_);
+            out->resize(deflateBound(&stream_, in.size()));
+        } else {
+            inflateReset(&stream_);
+            out->resize(min(in.size() * 4 + 64, max_out));
+        }
+        stream_.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(in.data()));
+        stream_.avail_in = static_cast<uInt>(in.size());
+
+        size_t used{0};
+        while (true) {
+            stream_.next_out = reinterpret_cast<Bytef *>(&(*out)[used]);
+            stream_.avail_out = static_cast<uInt>(out->size() - used);
+            const int ret{deflate_ ? deflate(&stream_, Z_FINISH) : inflate(&stream_, Z_FINISH)};
+            used = out->size() - stream_.avail_out;
+
+            if (Z_STREAM_END == ret)
+                break;
+            // out of room, anything else is a body cut short or corrupt
+            if ((Z_OK != ret && Z_BUF_ERROR != ret) || 0 != stream_.avail_out)
+                return false;
+            if (max_out <= out->size()) {
+                phxrpc::log(LOG_ERR, "%s coded body of %zu over max %zu", __func__,
+                            in.size(), max_out);
+
+                return false;
+            }
+            out->resize(min(out->size() * 2, max_out));
+        }
+        out->resize(used);
+
+        return true;
+    }
+
+  private:
+    const bool deflate_{true};
+    bool ok_{false};
+    z_stream stream_;
+};
+
+// the coding of a body in its place, buf keeps the capacity of the bodies before
+bool CodeBody(HttpMessage *msg, const bool deflate) {
+    static thread_local GzipContext deflater(true), inflater(false);
+    static thread_local string buf;
+
+    // the body decoded is held to the max of one received
+    const size_t max_out{deflate ? numeric_limits<size_t>::max() : HttpProtocol::GetMaxBodySize()};
+    if (!(deflate ? deflater : inflater).Run(msg->content(), &buf, max_out))
+        return false;
+    msg->mutable_content()->swap(buf);
+
+    return true;
+}
+
 
 }  // namespace
 
@@ -94,27 +387,23 @@ namespace phxrpc {
 using namespace std;
 
 
-void HttpProtocol::FixRespHeaders(bool keep_alive, const char *version, HttpResponse *resp) {
-    char buffer[256]{0};
+const char *HttpProtocol::CODING_GZIP = "gzip";
 
-    // check keep alive header
-    if (keep_alive) {
-        if (nullptr == resp->GetHeaderValue(HttpMessage::HEADER_CONNECTION)) {
-            resp->AddHeader(HttpMessage::HEADER_CONNECTION, "Keep-Alive");
-        }
-    }
+static atomic<size_t> max_body_size{HttpProtocol::DEFAULT_MAX_BODY_SIZE};
 
-    // check date header
-    resp->RemoveHeader(HttpMessage::HEADER_DATE);
-    time_t t_time = time(nullptr);
-    struct tm tm_time;
-    gmtime_r(&t_time, &tm_time);
-    strftime(buffer, sizeof(buffer), "%a, %d %b %Y %H:%M:%S %Z", &tm_time);
-    resp->AddHeader(HttpMessage::HEADER_DATE, buffer);
 
-    // check Server header
-    resp->RemoveHeader(HttpMessage::HEADER_SERVER);
-    resp->AddHeader(HttpMessage::HEADER_SERVER, "http/phxrpc");
+void HttpProtocol::SetMaxBodySize(const size_t size) {
+    max_body_size = size;
+}
+
+size_t HttpProtocol::GetMaxBodySize() {
+    return max_body_size;
+}
+
+
+void HttpProtocol::FixRespHeaders(bool keep_alive, const char *version, HttpResponse *resp) {
+    // Connection, Date and Server come from the prebuilt blocks in SendResp
+    resp->set_keep_alive(keep_alive);
 
     // use the same version
     resp->set_version(version);
@@ -153,8 +442,16 @@ int HttpProtocol::SendReqHeader(BaseTcpStream &socket, const char *method, const
         socket << name << ": " << val << "\r\n";
     }
 
+    if (0 <= req.cmd_id() && nullptr == req.GetHeaderValue(HttpHeaderId::X_PHXRPC_CMDID)) {
+        socket << HttpMessage::HEADER_X_PHXRPC_CMDID << ": " << req.cmd_id() << "\r\n";
+    }
+
+    if (req.one_way() && nullptr == req.GetHeaderValue(HttpHeaderId::X_PHXRPC_ONEWAY)) {
+        socket << HttpMessage::HEADER_X_PHXRPC_ONEWAY << ": 1\r\n";
+    }
+
     if (0 < req.content().size()) {
-        if (nullptr == req.GetHeaderValue(HttpMessage::HEADER_CONTENT_LENGTH)) {
+        if (nullptr == req.GetHeaderValue(HttpHeaderId::CONTENT_LENGTH)) {
             socket << HttpMessage::HEADER_CONTENT_LENGTH << ": "
                     << req.content().size() << "\r\n";
         }
@@ -173,168 +470,196 @@ int HttpProtocol::SendReqHeader(BaseTcpStream &socket, const char *method, const
     return 0;
 }
 
-int HttpProtocol::RecvRespStartLine(BaseTcpStream &socket, HttpResponse *resp) {
-    char line[1024]{0};
+int HttpProtocol::SendResp(BaseTcpStream &socket, const HttpResponse &resp) {
+    HeadWriter writer(socket.rdbuf());
+    PutRespHead(&writer, resp, false);
 
-    bool is_good{socket.getlineWithTrimRight(line, sizeof(line)).good()};
-    if (is_good) {
-        if (0 == strncasecmp(line, "HTTP", strlen("HTTP"))) {
-            char *pos = line;
-            char *first = SeparateStr(&pos, " ");
-            char *second = SeparateStr(&pos, " ");
-
-            if (nullptr != first)
-                resp->set_version(first);
-            if (nullptr != second)
-                resp->set_status_code(atoi(second));
-            if (nullptr != pos)
-                resp->set_reason_phrase(pos);
+    if (nullptr != resp.body_pb()) {
+        if (writer.good() && SendPb(socket, *resp.body_pb(), resp.size())) {
+            return 0;
         } else {
-            is_good = false;
-            phxrpc::log(LOG_WARNING, "WARN: Invalid response <%s>, ignored", line);
+            return static_cast<int>(socket.LastError());
         }
     }
 
-    if (is_good) {
+    const string &content = resp.content();
+    struct iovec body;
+    body.iov_base = const_cast<char *>(content.data());
+    body.iov_len = content.size();
+
+    if (writer.good() && socket.Writev(&body, 1)) {
         return 0;
     } else {
-        phxrpc::log(LOG_WARNING, "%s, fail", __func__);
         return static_cast<int>(socket.LastError());
     }
 }
 
-int HttpProtocol::RecvReqStartLine(BaseTcpStream &socket, HttpRequest *req) {
-    char line[1024]{0};
+int HttpProtocol::SendRespStream(BaseTcpStream &socket, const HttpResponse &resp,
+                                 const bool with_head, const vector<string> &frames,
+                                 const bool finished, const int result) {
+    HeadWriter writer(socket.rdbuf());
+    char tmp[32];
+
+    if (with_head)
+        PutRespHead(&writer, resp, true);
+
+    for (const auto &frame : frames) {
+        writer.Put(tmp, FormatHex(frame.size(), tmp));
+        writer.Put("\r\n", 2);
+        if (MAX_COPY_CHUNK_LEN >= frame.size()) {
+            writer.Put(frame.data(), frame.size());
+            writer.Put("\r\n", 2);
+        } else if (writer.good()) {
+            // large frames go out from where they are, after what is buffered
+            struct iovec chunk[2];
+            chunk[0].iov_base = const_cast<char *>(frame.data());
+            chunk[0].iov_len = frame.size();
+            chunk[1].iov_base = const_cast<char *>("\r\n");
+            chunk[1].iov_len = 2;
+            if (!socket.Writev(chunk, 2))
+                return static_cast<int>(socket.LastError());
+        }
+    }
 
-    bool is_good = socket.getlineWithTrimRight(line, sizeof(line)).good();
-    if (is_good) {
-        char *pos = line;
-        char *first = SeparateStr(&pos, " ");
-        char *second = SeparateStr(&pos, " ");
-
-        if (nullptr != first)
-            req->set_method(first);
-        if (nullptr != second)
-            req->set_uri(second);
-        if (nullptr != pos)
-            req->set_version(pos);
-    } else {
-        //phxrpc::log(LOG_WARNING, "WARN: Invalid request <%s>, ignored", line);
+    if (finished) {
+        writer.Put("0\r\n", 3);
+        writer.Put(HttpMessage::HEADER_X_PHXRPC_RESULT);
+        writer.Put(": ", 2);
+        if (0 > result)
+            writer.Put("-", 1);
+        writer.Put(tmp, FormatInt(0 > result ? 0 - static_cast<uint64_t>(result) : result, tmp));
+        writer.Put("\r\n\r\n", 4);
     }
 
-    if (is_good) {
+    if (writer.good() && socket.flush().good()) {
         return 0;
     } else {
         return static_cast<int>(socket.LastError());
     }
 }
 
-int HttpProtocol::RecvHeaders(BaseTcpStream &socket, HttpMessage *msg) {
-    bool is_good{false};
+int HttpProtocol::RecvRespHead(BaseTcpStream &socket, HttpResponse *resp) {
+    HttpParser parser(HttpParser::Type::RESPONSE);
+    string *head{resp->mutable_head()};
 
-    char *line = (char *)malloc(MAX_RECV_LEN);
-    assert(nullptr != line);
+    int ret{RecvHead(socket, &parser, head)};
+    if (0 != ret)
+        return ret;
 
-    string multi_line;
-    char *pos{nullptr};
+    if (0 < parser.version().length)
+        resp->set_version(TerminateSlice(head, parser.version()));
+    resp->set_status_code(parser.status_code());
+    resp->set_reason_phrase(TerminateSlice(head, parser.reason_phrase()));
+    AddHeaders(parser, head, true, resp);
 
-    do {
-        is_good = socket.getlineWithTrimRight(line, MAX_RECV_LEN).good();
-        if (!is_good)
-            break;
-
-        if ((!isspace(*line)) || '\0' == *line) {
-            if (multi_line.size() > 0) {
-                char * header = (char*) multi_line.c_str();
-                pos = header;
-                SeparateStr(&pos, ":");
-                for (; nullptr != pos && '\0' != *pos && isspace(*pos);)
-                    pos++;
-                msg->AddHeader(header, nullptr == pos ? "" : pos);
-            }
-            multi_line.clear();
-        }
+    return 0;
+}
 
-        for (pos = line; '\0' != *pos && isspace(*pos);)
-            pos++;
-        if ('\0' != *pos)
-            multi_line.append(pos);
-    } while (is_good && '\0' != *line);
+int HttpProtocol::RecvReqHead(BaseTcpStream &socket, HttpRequest *req) {
+    HttpParser parser(HttpParser::Type::REQUEST);
+    string *head{req->mutable_head()};
 
-    free(line);
-    line = nullptr;
+    int ret{RecvHead(socket, &parser, head)};
+    if (0 != ret)
+        return ret;
 
-    if (is_good) {
-        return 0;
-    } else {
-        return static_cast<int>(socket.LastError());
-    }
+    req->set_method(TerminateSlice(head, parser.method()));
+    req->set_uri(TerminateSlice(head, parser.uri()));
+    if (0 < parser.version().length)
+        req->set_version(TerminateSlice(head, parser.version()));
+    AddHeaders(parser, head, true, req);
+
+    const char *cmd_id{req->GetHeaderValue(HttpHeaderId::X_PHXRPC_CMDID)};
+    if (nullptr != cmd_id)
+        req->set_cmd_id(atoi(cmd_id));
+
+    const char *one_way{req->GetHeaderValue(HttpHeaderId::X_PHXRPC_ONEWAY)};
+    if (nullptr != one_way)
+        req->set_one_way(0 != atoi(one_way));
+
+    return 0;
+}
+
+int HttpProtocol::RecvHeaders(BaseTcpStream &socket, HttpMessage *msg) {
+    HttpParser parser(HttpParser::Type::HEADERS);
+    string head;
+
+    int ret{RecvHead(socket, &parser, &head)};
+    if (0 == ret)
+        AddHeaders(parser, &head, false, msg);
+
+    return ret;
 }
 
 int HttpProtocol::RecvBody(BaseTcpStream &socket, HttpMessage *msg) {
     bool is_good{true};
 
-    const char *encoding{msg->GetHeaderValue(HttpMessage::HEADER_TRANSFER_ENCODING)};
-
-    char *buff{(char *)malloc(MAX_RECV_LEN)};
-    assert(nullptr != buff);
+    const char *encoding{msg->GetHeaderValue(HttpHeaderId::TRANSFER_ENCODING)};
 
     if (nullptr != encoding && 0 == strcasecmp(encoding, "chunked")) {
         // read chunked, refer to rfc2616 section[19.4.6]
+        // every chunk is read in place into a body piece of its own
+        char line[1024];
+        size_t received{0};
 
         for (; is_good;) {
-            is_good = socket.getline(buff, MAX_RECV_LEN).good();
+            is_good = socket.getline(line, sizeof(line)).good();
             if (!is_good)
                 break;
 
-            int size{static_cast<int>(strtol(buff, nullptr, 16))};
-            if (size > 0) {
-                for (; size > 0;) {
-                    int read_len = size > MAX_RECV_LEN ? MAX_RECV_LEN : size;
-                    is_good = socket.read(buff, read_len).good();
-                    if (is_good) {
-                        size -= read_len;
-                        msg->AppendContent(buff, read_len);
-                    } else {
-                        break;
-                    }
-                }
-                is_good = socket.getline(buff, MAX_RECV_LEN).good();
+            long size{strtol(line, nullptr, 16)};
+            if (0 > size || GetMaxBodySize() - received < static_cast<size_t>(size)) {
+                log(LOG_ERR, "%s chunk size %ld over MaxBodySize", __func__, size);
+                is_good = false;
+            } else if (0 < size) {
+                received += size;
+                string *piece{msg->AddContentPiece(size)};
+                is_good = socket.read(&(*piece)[0], size).good();
+                if (is_good)
+                    is_good = socket.getline(line, sizeof(line)).good();
             } else {
-                break;
+                // trailer and the final empty line
+                return RecvHeaders(socket, msg);
             }
         }
     } else {
-        const char *content_length{msg->GetHeaderValue(HttpMessage::HEADER_CONTENT_LENGTH)};
+        const char *content_length{msg->GetHeaderValue(HttpHeaderId::CONTENT_LENGTH)};
 
         if (nullptr != content_length) {
-            int size{atoi(content_length)};
-
-            for (; size > 0 && is_good;) {
-                int read_len = size > MAX_RECV_LEN ? MAX_RECV_LEN : size;
-                is_good = socket.read(buff, read_len).good();
-                if (is_good) {
-                    size -= read_len;
-                    msg->AppendContent(buff, read_len);
-                } else {
-                    break;
+            long long size{strtoll(content_length, nullptr, 10)};
+
+            if (0 > size || GetMaxBodySize() < static_cast<unsigned long long>(size)) {
+                log(LOG_ERR, "%s Content-Length %lld over MaxBodySize", __func__, size);
+                is_good = false;
+            } else if (0 < size) {
+                // filled by the socket without a scratch buffer, grown as the bytes come
+                // rather than by what the peer claims
+                string *content{msg->mutable_content()};
+                const size_t offset{content->size()};
+                size_t received{0};
+                while (is_good && static_cast<size_t>(size) > received) {
+                    const size_t step{min(static_cast<size_t>(size) - received,
+                                          max(static_cast<size_t>(MAX_RECV_LEN), received))};
+                    content->resize(offset + received + step);
+                    is_good = socket.read(&(*content)[offset + received], step).good();
+                    received += step;
                 }
             }
         } else if (HttpMessage::Direction::RESPONSE == msg->direction()) {
             // hasn't Content-Length header, read until socket close
+            string *content{msg->mutable_content()};
+
             for (; is_good;) {
-                is_good = socket.read(buff, MAX_RECV_LEN).good();
-                if (socket.gcount() > 0) {
-                    msg->AppendContent(buff, socket.gcount());
-                }
+                const size_t offset{content->size()};
+                content->resize(offset + MAX_RECV_LEN);
+                is_good = socket.read(&(*content)[offset], MAX_RECV_LEN).good();
+                content->resize(offset + socket.gcount());
             }
             if (socket.eof())
                 is_good = true;
         }
     }
 
-    free(buff);
-
     if (is_good) {
         return 0;
     } else {
@@ -342,11 +667,53 @@ int HttpProtocol::RecvBody(BaseTcpStream &socket, HttpMessage *msg) {
     }
 }
 
-int HttpProtocol::RecvReq(BaseTcpStream &socket, HttpRequest *req) {
-    int ret{RecvReqStartLine(socket, req)};
+int HttpProtocol::RecvRespStream(BaseTcpStream &socket, HttpResponse *resp,
+                                 string *data, bool *finished) {
+    const char *encoding{resp->GetHeaderValue(HttpHeaderId::TRANSFER_ENCODING)};
 
-    if (0 == ret)
-        ret = RecvHeaders(socket, req);
+    if (nullptr == encoding || 0 != strcasecmp(encoding, "chunked")) {
+        // not streamed, e.g. the handler failed before writing anything
+        *finished = true;
+
+        int ret{RecvBody(socket, resp)};
+        if (0 == ret)
+            data->append(resp->content());
+
+        return ret;
+    }
+
+    char line[1024];
+    if (!socket.getline(line, sizeof(line)).good())
+        return static_cast<int>(socket.LastError());
+
+    long size{strtol(line, nullptr, 16)};
+    if (0 > size || GetMaxBodySize() < static_cast<unsigned long>(size)) {
+        log(LOG_ERR, "%s chunk size %ld over MaxBodySize", __func__, size);
+
+        return -1;
+    }
+
+    if (0 == size) {
+        // trailer carries the result
+        *finished = true;
+
+        return RecvHeaders(socket, resp);
+    }
+
+    const size_t offset{data->size()};
+    data->resize(offset + size);
+    if (socket.read(&(*data)[offset], size).good() &&
+        socket.getline(line, sizeof(line)).good()) {
+        *finished = false;
+
+        return 0;
+    } else {
+        return static_cast<int>(socket.LastError());
+    }
+}
+
+int HttpProtocol::RecvReq(BaseTcpStream &socket, HttpRequest *req) {
+    int ret{RecvReqHead(socket, req)};
 
     if (0 == ret)
         ret = RecvBody(socket, req);
@@ -355,17 +722,123 @@ int HttpProtocol::RecvReq(BaseTcpStream &socket, HttpRequest *req) {
 }
 
 int HttpProtocol::RecvResp(BaseTcpStream &socket, HttpResponse *resp) {
-    int ret{RecvRespStartLine(socket, resp)};
-    if (0 == ret)
-        ret = RecvHeaders(socket, resp);
+    int ret{RecvRespHead(socket, resp)};
 
     if (0 == ret && SC_NOT_MODIFIED != resp->status_code()) {
         ret = RecvBody(socket, resp);
     }
 
+    // the server closes it after this response, keep it out of a connection pool
+    if (0 == ret) {
+        const char *connection{resp->GetHeaderValue(HttpHeaderId::CONNECTION)};
+        if (nullptr == connection || 0 != strcasecmp(connection, "Keep-Alive"))
+            socket.setstate(ios_base::eofbit);
+    }
+
     return ret;
 }
 
 
+const char *HttpProtocol::NegotiateCoding(const char *accept_encoding) {
+    if (nullptr == accept_encoding)
+        return nullptr;
+
+    // e.g. "br, gzip;q=0.8", a q of 0 turns it down
+    const char *pos{accept_encoding};
+    while ('\0' != *pos) {
+        while (' ' == *pos || ',' == *pos)
+            ++pos;
+        const char *end{pos};
+        while ('\0' != *end && ',' != *end)
+            ++end;
+
+        size_t len{0};
+        while (pos + len < end && ';' != pos[len] && ' ' != pos[len])
+            ++len;
+        if (strlen(CODING_GZIP) == len && 0 == strncasecmp(pos, CODING_GZIP, len)) {
+            const string item(pos, end);
+            const char *q{strstr(item.c_str(), "q=")};
+            if (nullptr == q || 0 < atof(q + 2))
+                return CODING_GZIP;
+        }
+
+        pos = end;
+    }
+
+    return nullptr;
+}
+
+void HttpProtocol::AcceptCodings(HttpRequest *req) {
+    req->AddHeader(HEADER_ACCEPT_ENCODING, CODING_GZIP);
+}
+
+int HttpProtocol::EncodeBody(HttpMessage *msg, const char *coding) {
+    if (nullptr == coding || 0 != strcasecmp(coding, CODING_GZIP))
+        return -1;
+
+    if (!CodeBody(msg, true))
+        return -1;
+    msg->AddHeader(HEADER_CONTENT_ENCODING, CODING_GZIP);
+
+    return 0;
+}
+
+int HttpProtocol::DecodeBody(HttpMessage *msg) {
+    const char *coding{msg->GetHeaderValue(HEADER_CONTENT_ENCODING)};
+    if (nullptr == coding || 0 == strcasecmp(coding, "identity"))
+        return 0;
+
+    if (0 != strcasecmp(coding, CODING_GZIP) || !CodeBody(msg, false))
+        return -1;
+    msg->RemoveHeader(HEADER_CONTENT_ENCODING);
+
+    return 0;
+}
+
+size_t HttpProtocol::FormatInt(uint64_t value, char *buf) {
+    static const char DIGITS[] =
+        "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+        "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+        "8081828384858687888990919293949596979899";
+
+    char tmp[20];
+    char *pos{tmp + sizeof(tmp)};
+
+    for (; 100 <= value; value /= 100) {
+        const size_t idx{static_cast<size_t>(value % 100) * 2};
+        *--pos = DIGITS[idx + 1];
+        *--pos = DIGITS[idx];
+    }
+    if (10 <= value) {
+        *--pos = DIGITS[value * 2 + 1];
+        *--pos = DIGITS[value * 2];
+    } else {
+        *--pos = static_cast<char>('0' + value);
+    }
+
+    const size_t len{static_cast<size_t>(tmp + sizeof(tmp) - pos)};
+    memcpy(buf, pos, len);
+
+    return len;
+}
+
+size_t HttpProtocol::FormatHex(uint64_t value, char *buf) {
+    static const char DIGITS[] = "0123456789abcdef";
+
+    char tmp[16];
+    char *pos{tmp + sizeof(tmp)};
+
+    do {
+        *--pos = DIGITS[value & 0xf];
+        value >>= 4;
+    } while (0 < value);
+
+    const size_t len{static_cast<size_t>(tmp + sizeof(tmp) - pos)};
+    memcpy(buf, pos, len);
+
+    return len;
+}
+
+
 }  // namespace phxrpc
 
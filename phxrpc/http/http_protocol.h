@@ -21,6 +21,11 @@ See the AUTHORS file for names of contributors.
 
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
 
 namespace phxrpc {
 
@@ -41,6 +46,15 @@ class HttpProtocol {
         SC_NOT_MODIFIED = 304
     };
 
+    enum {
+        // stream frames up to this size are copied into the socket buffer
+        MAX_COPY_CHUNK_LEN = 4096
+    };
+
+    enum {
+        DEFAULT_MAX_BODY_SIZE = 64 * 1024 * 1024
+    };
+
     enum class Direction {
         NONE = 0,
         REQUEST,
@@ -51,12 +65,46 @@ class HttpProtocol {
     static void FixRespHeaders(const HttpRequest &req, HttpResponse *resp);
     static void FixRespHeaders(bool keep_alive, const char *version, HttpResponse *resp);
     static int SendReqHeader(BaseTcpStream &socket, const char *method, const HttpRequest &req);
-    static int RecvRespStartLine(BaseTcpStream &socket, HttpResponse *resp);
-    static int RecvReqStartLine(BaseTcpStream &socket, HttpRequest *req);
+    // head and body in one scatter/gather write
+    static int SendResp(BaseTcpStream &socket, const HttpResponse &resp);
+    // server-streaming, a chunk per frame after a head announcing a chunked
+    // body, the last chunk carries the result in the trailer
+    static int SendRespStream(BaseTcpStream &socket, const HttpResponse &resp,
+                              const bool with_head, const std::vector<std::string> &frames,
+                              const bool finished, const int result);
+    // start line and headers
+    static int RecvRespHead(BaseTcpStream &socket, HttpResponse *resp);
+    static int RecvReqHead(BaseTcpStream &socket, HttpRequest *req);
+    // header lines only, e.g. the trailer of a chunked body
     static int RecvHeaders(BaseTcpStream &socket, HttpMessage *msg);
     static int RecvBody(BaseTcpStream &socket, HttpMessage *msg);
     static int RecvReq(BaseTcpStream &socket, HttpRequest *req);
     static int RecvResp(BaseTcpStream &socket, HttpResponse *resp);
+    // next chunk of a streamed response after RecvRespHead
+    static int RecvRespStream(BaseTcpStream &socket, HttpResponse *resp,
+                              std::string *data, bool *finished);
+
+    // bodies and chunks received, and bodies decoded, larger than this fail rather than
+    // take memory by what the peer says, for the whole process
+    static void SetMaxBodySize(const size_t max_body_size);
+    static size_t GetMaxBodySize();
+
+    // the Content-Encoding built in, as zlib is all it needs
+    static const char *CODING_GZIP;
+
+    // a coding of Accept-Encoding accept_encoding a body can be sent in, nullptr if none
+    static const char *NegotiateCoding(const char *accept_encoding);
+    // tells the server the codings a response can come in
+    static void AcceptCodings(HttpRequest *req);
+    // body of msg in coding, with Content-Encoding set, the zlib contexts are per thread
+    static int EncodeBody(HttpMessage *msg, const char *coding);
+    // body of msg as it was before its Content-Encoding, if any
+    static int DecodeBody(HttpMessage *msg);
+
+    // decimal without snprintf or iostream, buf needs 20 bytes
+    static size_t FormatInt(uint64_t value, char *buf);
+    // lower case hex, e.g. chunk sizes, buf needs 16 bytes
+    static size_t FormatHex(uint64_t value, char *buf);
 };
 
 
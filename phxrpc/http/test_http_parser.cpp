@@ -0,0 +1,284 @@
+/*
+Tencent is pleased to support the open source community by making
+PhxRPC available.
+Copyright (C) 2016 THL A29 Limited, a Tencent company.
+All rights reserved.
+
+Licensed under the BSD 3-Clause License (the "License"); you may
+not use this file except in compliance with the License. You may
+obtain a copy of the License at
+
+https://opensource.org/licenses/BSD-3-Clause
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" basis,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+implied. See the License for the specific language governing
+permissions and limitations under the License.
+
+See the AUTHORS file for names of contributors.
+*/
+
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "phxrpc/http/http_parser.h"
+#include "phxrpc/network/timer.h"
+
+
+using namespace phxrpc;
+using namespace std;
+
+
+namespace {
+
+
+const char *BUILTIN_CORPUS[] = {
+    // phxrpc client request
+    "POST /search/PHXEcho HTTP/1.1\r\n"
+    "Connection: Keep-Alive\r\n"
+    "Content-Length: 12\r\n"
+    "\r\n"
+    "hello phxrpc",
+
+    // browser style request
+    "GET /search/Search?query=phxrpc&page=2 HTTP/1.1\r\n"
+    "Host: www.example.com\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/60.0.3112.113 Safari/537.36\r\n"
+    "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,image/webp,image/apng,*/*;q=0.8\r\n"
+    "Accept-Encoding: gzip, deflate, br\r\n"
+    "Accept-Language: zh-CN,zh;q=0.8,en;q=0.6\r\n"
+    "Cache-Control: max-age=0\r\n"
+    "Cookie: uin=o0123456789; skey=@AbCdEfGhIj; pgv_pvid=1234567890; pgv_info=ssid=s9876543210\r\n"
+    "Referer: https://www.example.com/search/index.html\r\n"
+    "Upgrade-Insecure-Requests: 1\r\n"
+    "\r\n",
+
+    // response with folded header
+    "HTTP/1.1 200 OK\r\n"
+    "Connection: Keep-Alive\r\n"
+    "Date: Tue, 19 Sep 2017 08:00:00 GMT\r\n"
+    "Server: http/phxrpc\r\n"
+    "X-Folded: first\r\n"
+    "   second\r\n"
+    "X-PHXRPC-Result: 0\r\n"
+    "Content-Length: 5\r\n"
+    "\r\n"
+    "hello",
+};
+
+
+struct Message {
+    HttpParser::Type type;
+    string data;
+};
+
+
+bool IsResponse(const string &data) {
+    return 0 == strncmp(data.c_str(), "HTTP/", 5);
+}
+
+// splits a captured stream of messages, every message needs a Content-Length or no body
+bool LoadCorpus(const char *path, vector<Message> *messages) {
+    FILE *fp{fopen(path, "rb")};
+    if (nullptr == fp) {
+        printf("open %s fail\n", path);
+        return false;
+    }
+
+    string raw;
+    char buf[4096];
+    for (size_t len{0}; 0 < (len = fread(buf, 1, sizeof(buf), fp));)
+        raw.append(buf, len);
+    fclose(fp);
+
+    for (size_t pos{0}; raw.size() > pos;) {
+        Message message;
+        message.type = IsResponse(raw.substr(pos, 5)) ? HttpParser::Type::RESPONSE :
+                HttpParser::Type::REQUEST;
+
+        HttpParser parser(message.type);
+        if (HttpParser::Status::DONE != parser.Execute(raw.data() + pos, raw.size() - pos)) {
+            printf("corpus %s broken at offset %zu\n", path, pos);
+            return false;
+        }
+
+        size_t body{0};
+        for (size_t i{0}; parser.header_count() > i; ++i) {
+            const HttpParser::Header &header = parser.header(i);
+            if (0 == strncasecmp(raw.data() + pos + header.name.offset, "Content-Length",
+                                 header.name.length)) {
+                body = strtoul(raw.data() + pos + header.value.offset, nullptr, 10);
+            }
+        }
+
+        message.data = raw.substr(pos, parser.consumed() + body);
+        messages->push_back(message);
+        pos += message.data.size();
+    }
+
+    return true;
+}
+
+string Dump(const HttpParser &parser, const char *data) {
+    string out;
+    out.append(data + parser.method().offset, parser.method().length).append("|");
+    out.append(data + parser.uri().offset, parser.uri().length).append("|");
+    out.append(data + parser.version().offset, parser.version().length).append("|");
+    out.append(to_string(parser.status_code())).append("|");
+    out.append(data + parser.reason_phrase().offset, parser.reason_phrase().length).append("\n");
+
+    for (size_t i{0}; parser.header_count() > i; ++i) {
+        const HttpParser::Header &header = parser.header(i);
+        out.append(data + header.name.offset, header.name.length).append(": ");
+        out.append(data + header.value.offset, header.value.length).append("\n");
+    }
+    out.append(to_string(parser.consumed()));
+
+    return out;
+}
+
+// every message must give the same result whole and fed one byte at a time
+bool Check(const vector<Message> &messages) {
+    for (auto &message : messages) {
+        HttpParser whole(message.type);
+        if (HttpParser::Status::DONE != whole.Execute(message.data.data(), message.data.size())) {
+            printf("parse fail:\n%s\n", message.data.c_str());
+            return false;
+        }
+
+        HttpParser partial(message.type);
+        HttpParser::Status status{HttpParser::Status::NEED_MORE};
+        for (size_t len{1}; message.data.size() >= len &&
+             HttpParser::Status::NEED_MORE == status; ++len) {
+            // a fresh copy each time, slices must survive the buffer moving
+            string buf(message.data, 0, len);
+            status = partial.Execute(buf.data(), buf.size());
+        }
+
+        if (HttpParser::Status::DONE != status ||
+            Dump(whole, message.data.data()) != Dump(partial, message.data.data())) {
+            printf("partial parse mismatch:\n%s\n", message.data.c_str());
+            return false;
+        }
+    }
+
+    return true;
+}
+
+const char *ScanImplName(const HttpParser::ScanImpl scan_impl) {
+    switch (scan_impl) {
+      case HttpParser::ScanImpl::AVX2:
+        return "avx2";
+      case HttpParser::ScanImpl::SSE42:
+        return "sse4.2";
+      default:
+        return "scalar";
+    }
+}
+
+void Bench(const vector<Message> &messages, const int loop) {
+    size_t bytes{0};
+    for (auto &message : messages)
+        bytes += message.data.size();
+
+    const HttpParser::ScanImpl impls[] = {HttpParser::ScanImpl::SCALAR,
+            HttpParser::ScanImpl::SSE42, HttpParser::ScanImpl::AVX2};
+
+    HttpParser parser(HttpParser::Type::REQUEST);
+    for (auto impl : impls) {
+        if (!HttpParser::IsScanImplSupported(impl)) {
+            printf("%-8s not supported\n", ScanImplName(impl));
+            continue;
+        }
+        HttpParser::set_scan_impl(impl);
+
+        size_t headers{0};
+        uint64_t begin{Timer::GetSteadyClockMS()};
+        for (int i{0}; loop > i; ++i) {
+            for (auto &message : messages) {
+                parser.Reset(message.type);
+                parser.Execute(message.data.data(), message.data.size());
+                headers += parser.header_count();
+            }
+        }
+        uint64_t cost{Timer::GetSteadyClockMS() - begin};
+        if (0 == cost)
+            cost = 1;
+
+        printf("%-8s %d x %zu msgs, %zu headers, cost %lu ms, %.1f MB/s, %.1f ns/msg\n",
+               ScanImplName(impl), loop, messages.size(), headers, cost,
+               (double)bytes * loop / 1024 / 1024 / cost * 1000,
+               (double)cost * 1000000 / loop / messages.size());
+    }
+
+    HttpParser::set_scan_impl(HttpParser::ScanImpl::AUTO);
+}
+
+void ShowUsage(const char *program) {
+    printf("\n");
+    printf("Usage: %s [-f <corpus>] [-n <loop>] [-v]\n", program);
+    printf("\n");
+    printf("\t-f captured requests/responses, default to the builtin corpus\n");
+    printf("\t-n benchmark loop count, default 100000\n");
+    printf("\n");
+
+    exit(0);
+}
+
+
+}  // namespace
+
+
+int main(int argc, char **argv) {
+    const char *corpus{nullptr};
+    int loop{100000};
+
+    extern char *optarg;
+    int c;
+    while (EOF != (c = getopt(argc, argv, "f:n:v"))) {
+        switch (c) {
+            case 'f': corpus = optarg; break;
+            case 'n': loop = atoi(optarg); break;
+            default: ShowUsage(argv[0]); break;
+        }
+    }
+
+    vector<Message> messages;
+    if (nullptr != corpus) {
+        if (!LoadCorpus(corpus, &messages))
+            return -1;
+    } else {
+        for (auto data : BUILTIN_CORPUS) {
+            Message message;
+            message.data = data;
+            message.type = IsResponse(message.data) ? HttpParser::Type::RESPONSE :
+                    HttpParser::Type::REQUEST;
+            messages.push_back(message);
+        }
+    }
+
+    const HttpParser::ScanImpl impls[] = {HttpParser::ScanImpl::SCALAR,
+            HttpParser::ScanImpl::SSE42, HttpParser::ScanImpl::AVX2};
+    for (auto impl : impls) {
+        if (!HttpParser::IsScanImplSupported(impl))
+            continue;
+        HttpParser::set_scan_impl(impl);
+        if (!Check(messages)) {
+            printf("check %s fail\n", ScanImplName(impl));
+            return -1;
+        }
+    }
+    HttpParser::set_scan_impl(HttpParser::ScanImpl::AUTO);
+    printf("check %zu msgs ok\n", messages.size());
+
+    Bench(messages, loop);
+
+    return 0;
+}
+
@@ -21,9 +21,11 @@ See the AUTHORS file for names of contributors.
 
 #pragma once
 
+#include "msg/arena.h"
 #include "msg/base_dispatcher.h"
 #include "msg/base_msg.h"
 #include "msg/base_msg_handler.h"
 #include "msg/base_msg_handler_factory.h"
 #include "msg/common.h"
+#include "msg/response_stream.h"
 
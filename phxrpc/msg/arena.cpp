@@ -0,0 +1,126 @@
+/*
+Tencent is pleased to support the open source community by making
+PhxRPC available.
+Copyright (C) 2016 THL A29 Limited, a Tencent company.
+All rights reserved.
+
+Licensed under the BSD 3-Clause License (the "License"); you may
+not use this file except in compliance with the License. You may
+obtain a copy of the License at
+
+https://opensource.org/licenses/BSD-3-Clause
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" basis,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+implied. See the License for the specific language governing
+permissions and limitations under the License.
+
+See the AUTHORS file for names of contributors.
+*/
+
+
+#include "phxrpc/msg/arena.h"
+
+#include <algorithm>
+#include <cstdint>
+
+
+namespace phxrpc {
+
+
+namespace {
+
+
+const size_t BLOCK_HEADER_SIZE{(sizeof(void *) * 2 + alignof(std::max_align_t) - 1) &
+                               ~(alignof(std::max_align_t) - 1)};
+// smallest first block protobuf makes use of, a smaller one is ignored by it
+const size_t MIN_PB_INITIAL_BLOCK_SIZE{256};
+
+
+}  // namespace
+
+
+Arena::Arena(const size_t block_size) : block_size_(std::max(block_size, BLOCK_HEADER_SIZE * 4)) {
+}
+
+Arena::~Arena() {
+    // reverse order of creation, so the protobuf arena goes before what made it
+    while (cleanups_) {
+        cleanups_->destroy(cleanups_->object);
+        cleanups_ = cleanups_->next;
+    }
+
+    while (blocks_) {
+        Block *next{blocks_->next};
+        ::operator delete(blocks_);
+        blocks_ = next;
+    }
+}
+
+void *Arena::Allocate(const size_t size, const size_t align) {
+    const size_t padding{static_cast<size_t>(-reinterpret_cast<uintptr_t>(ptr_) & (align - 1))};
+    if (nullptr != ptr_ && static_cast<size_t>(end_ - ptr_) >= size + padding) {
+        char *data{ptr_ + padding};
+        ptr_ = data + size;
+        space_used_ += size;
+
+        return data;
+    }
+
+    space_used_ += size;
+
+    return AllocateBlock(size);
+}
+
+void *Arena::AllocateBlock(const size_t size) {
+    // block data is aligned for anything, the header is padded to keep it so
+    if (size > block_size_ / 4) {
+        // a big one gets a block of its own, the current block is kept for small ones
+        Block *block{static_cast<Block *>(::operator new(BLOCK_HEADER_SIZE + size))};
+        block->size = size;
+        if (blocks_) {
+            block->next = blocks_->next;
+            blocks_->next = block;
+        } else {
+            block->next = nullptr;
+            blocks_ = block;
+        }
+
+        return reinterpret_cast<char *>(block) + BLOCK_HEADER_SIZE;
+    }
+
+    Block *block{static_cast<Block *>(::operator new(BLOCK_HEADER_SIZE + block_size_))};
+    block->size = block_size_;
+    block->next = blocks_;
+    blocks_ = block;
+
+    char *data{reinterpret_cast<char *>(block) + BLOCK_HEADER_SIZE};
+    ptr_ = data + size;
+    end_ = data + block_size_;
+
+    return data;
+}
+
+void Arena::AddCleanup(void *object, void (*destroy)(void *)) {
+    Cleanup *cleanup{static_cast<Cleanup *>(Allocate(sizeof(Cleanup), alignof(Cleanup)))};
+    cleanup->next = cleanups_;
+    cleanup->object = object;
+    cleanup->destroy = destroy;
+    cleanups_ = cleanup;
+}
+
+google::protobuf::Arena *Arena::pb_arena() {
+    if (nullptr == pb_arena_) {
+        google::protobuf::ArenaOptions options;
+        options.initial_block_size = std::max(block_size_ / 4, MIN_PB_INITIAL_BLOCK_SIZE);
+        options.initial_block = static_cast<char *>(Allocate(options.initial_block_size));
+        pb_arena_ = Create<google::protobuf::Arena>(options);
+    }
+
+    return pb_arena_;
+}
+
+
+}  // namespace phxrpc
+
@@ -0,0 +1,139 @@
+/*
+Tencent is pleased to support the open source community by making
+PhxRPC available.
+Copyright (C) 2016 THL A29 Limited, a Tencent company.
+All rights reserved.
+
+Licensed under the BSD 3-Clause License (the "License"); you may
+not use this file except in compliance with the License. You may
+obtain a copy of the License at
+
+https://opensource.org/licenses/BSD-3-Clause
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" basis,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+implied. See the License for the specific language governing
+permissions and limitations under the License.
+
+See the AUTHORS file for names of contributors.
+*/
+
+
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include <google/protobuf/arena.h>
+
+
+namespace phxrpc {
+
+
+// Request-scoped bump allocator.
+//
+// The request, its response, copied header strings and the protobuf messages
+// of a call are carved out of a few blocks, and all of them are destroyed and
+// freed at once with the arena when the response has been written.
+// An arena is used by one thread at a time, it is handed over with the request.
+class Arena final {
+  public:
+    enum {
+        DEFAULT_BLOCK_SIZE = 4096,
+    };
+
+    // no memory is taken before the first allocation
+    explicit Arena(const size_t block_size = DEFAULT_BLOCK_SIZE);
+    ~Arena();
+
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    void *Allocate(const size_t size, const size_t align = alignof(std::max_align_t));
+
+    // the object is destructed with the arena, never delete it
+    template <typename T, typename... Args>
+    T *Create(Args &&... args) {
+        T *object{new (Allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...)};
+        AddCleanup(object, &Destroy<T>);
+
+        return object;
+    }
+
+    // made on first use, its first block is carved from this arena
+    google::protobuf::Arena *pb_arena();
+
+    // bytes handed out so far, protobuf blocks excluded
+    size_t space_used() const { return space_used_; }
+
+  private:
+    struct Block {
+        Block *next;
+        size_t size;
+    };
+
+    struct Cleanup {
+        Cleanup *next;
+        void *object;
+        void (*destroy)(void *);
+    };
+
+    template <typename T>
+    static void Destroy(void *object) {
+        static_cast<T *>(object)->~T();
+    }
+
+    void AddCleanup(void *object, void (*destroy)(void *));
+    void *AllocateBlock(const size_t size);
+
+    size_t block_size_{DEFAULT_BLOCK_SIZE};
+    size_t space_used_{0};
+    Block *blocks_{nullptr};
+    char *ptr_{nullptr};
+    char *end_{nullptr};
+    Cleanup *cleanups_{nullptr};
+    google::protobuf::Arena *pb_arena_{nullptr};
+};
+
+
+// protobuf message on a protobuf arena, or owned by the holder if there is none
+template <typename Message>
+class ArenaMessage final {
+  public:
+    explicit ArenaMessage(google::protobuf::Arena *const arena)
+            : ArenaMessage(arena, google::protobuf::Arena::is_arena_constructable<Message>()) {
+    }
+
+    ~ArenaMessage() {
+        if (owned_)
+            delete message_;
+    }
+
+    ArenaMessage(const ArenaMessage &) = delete;
+    ArenaMessage &operator=(const ArenaMessage &) = delete;
+
+    Message &operator*() const { return *message_; }
+    Message *operator->() const { return message_; }
+    Message *get() const { return message_; }
+
+  private:
+    ArenaMessage(google::protobuf::Arena *const arena, std::true_type)
+            : message_(google::protobuf::Arena::CreateMessage<Message>(arena)),
+              owned_(nullptr == arena) {
+    }
+
+    // generated without arena support, it stays on the heap
+    ArenaMessage(google::protobuf::Arena *const, std::false_type)
+            : message_(new Message), owned_(true) {
+    }
+
+    Message *message_{nullptr};
+    bool owned_{false};
+};
+
+
+}  // namespace phxrpc
+
@@ -21,6 +21,7 @@ See the AUTHORS file for names of contributors.
 
 #pragma once
 
+#include <cstring>
 #include <map>
 #include <string>
 
@@ -37,28 +38,52 @@ class BaseDispatcher {
 
     typedef std::map<std::string, URIFunc_t> URIFuncMap;
 
-    BaseDispatcher(Dispatcher &dispatcher, const URIFuncMap &uri_func_map)
-            : dispatcher_(dispatcher), uri_func_map_(uri_func_map) {
+    // generated switch over CmdID, nullptr for an unknown one or one shared by methods,
+    // the uri of the method found is set to *uri
+    typedef URIFunc_t (*CmdIDFunc_t)(const int cmd_id, const char **uri);
+
+    BaseDispatcher(Dispatcher &dispatcher, const URIFuncMap &uri_func_map,
+                   CmdIDFunc_t cmd_id_func = nullptr)
+            : dispatcher_(dispatcher), uri_func_map_(uri_func_map),
+              cmd_id_func_(cmd_id_func) {
     }
 
     virtual ~BaseDispatcher() = default;
 
     bool Dispatch(const BaseRequest &req, BaseResponse *const resp) {
         int ret{-1};
-        typename URIFuncMap::const_iterator iter(uri_func_map_.find(req.uri()));
+        URIFunc_t func{nullptr};
+
+        if (nullptr != cmd_id_func_ && 0 <= req.cmd_id()) {
+            const char *uri{nullptr};
+            func = cmd_id_func_(req.cmd_id(), &uri);
+            // a client of an older proto may send a CmdID renumbered since, its uri tells
+            if (nullptr != func && 0 != strcmp(uri, req.uri())) {
+                func = nullptr;
+            }
+        }
+
+        // clients not sending CmdID, or methods without one
+        if (nullptr == func) {
+            typename URIFuncMap::const_iterator iter(uri_func_map_.find(req.uri()));
+            if (uri_func_map_.end() != iter) {
+                func = iter->second;
+            }
+        }
 
-        if (uri_func_map_.end() != iter) {
-            ret = (dispatcher_.*iter->second)(req, resp);
+        if (nullptr != func) {
+            ret = (dispatcher_.*func)(req, resp);
         }
 
         resp->set_result(ret);
 
-        return uri_func_map_.end() != iter;
+        return nullptr != func;
     }
 
   private:
     Dispatcher &dispatcher_;
     const URIFuncMap &uri_func_map_;
+    CmdIDFunc_t cmd_id_func_{nullptr};
 };
 
 
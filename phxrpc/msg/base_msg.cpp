@@ -38,6 +38,27 @@ BaseMessage::BaseMessage() {
 BaseMessage::~BaseMessage() {
 }
 
+google::protobuf::Arena *BaseMessage::pb_arena() const {
+    return nullptr != arena_ ? arena_->pb_arena() : nullptr;
+}
+
+
+void DeleteMessage(BaseMessage *message) {
+    if (nullptr != message && nullptr == message->arena())
+        delete message;
+}
+
+void ReleaseMessage(BaseMessage *message) {
+    if (nullptr == message)
+        return;
+
+    if (nullptr != message->arena()) {
+        delete message->arena();
+    } else {
+        delete message;
+    }
+}
+
 
 BaseRequest::BaseRequest() {
 }
@@ -61,6 +82,12 @@ BaseResponse::BaseResponse() {
 
 BaseResponse::~BaseResponse() {}
 
+ResponseStream *BaseResponse::EnableStream(ResponseStream::NotifyFunc_t notify_func) {
+    stream_.reset(new ResponseStream(this, notify_func));
+
+    return stream_.get();
+}
+
 
 }
 
@@ -21,10 +21,13 @@ See the AUTHORS file for names of contributors.
 
 #pragma once
 
+#include <memory>
 #include <vector>
 #include <string>
 
+#include "phxrpc/msg/arena.h"
 #include "phxrpc/msg/common.h"
+#include "phxrpc/msg/response_stream.h"
 #include "phxrpc/network.h"
 
 
@@ -54,14 +57,40 @@ class BaseMessage {
 
     bool fake() const { return fake_; };
 
+    // request arena the message lives on, nullptr if it is on the heap
+    Arena *arena() const { return arena_; }
+    virtual void set_arena(Arena *arena) { arena_ = arena; }
+    // for the protobuf messages of the call, nullptr without a request arena
+    google::protobuf::Arena *pb_arena() const;
+
   protected:
     void set_fake(const bool fake) { fake_ = fake; }
 
   private:
     bool fake_{false};
+    Arena *arena_{nullptr};
 };
 
 
+// makes a message on arena, or on the heap if arena is nullptr
+template <typename Message>
+Message *NewMessage(Arena *const arena) {
+    if (nullptr == arena)
+        return new Message;
+
+    Message *message{arena->Create<Message>()};
+    message->set_arena(arena);
+
+    return message;
+}
+
+// done with one message, an arena message is left for its arena to destroy
+void DeleteMessage(BaseMessage *message);
+
+// done with the whole request, for an arena message the arena and everything on it is freed
+void ReleaseMessage(BaseMessage *message);
+
+
 class BaseResponse;
 
 class BaseRequest : virtual public BaseMessage {
@@ -76,8 +105,18 @@ class BaseRequest : virtual public BaseMessage {
     void set_uri(const char *uri);
     const char *uri() const;
 
+    // CmdID of the method, lets the server dispatch without matching the uri, -1 if unknown
+    void set_cmd_id(const int cmd_id) { cmd_id_ = cmd_id; }
+    int cmd_id() const { return cmd_id_; }
+
+    // the caller does not wait for a response, the server sends none
+    void set_one_way(const bool one_way) { one_way_ = one_way; }
+    bool one_way() const { return one_way_; }
+
   private:
     std::string uri_;
+    int cmd_id_{-1};
+    bool one_way_{false};
 };
 
 
@@ -96,6 +135,19 @@ class BaseResponse : virtual public BaseMessage {
 
     virtual int result() = 0;
     virtual void set_result(const int result) = 0;
+
+    // server-streaming, frames written by the handler are sent as they come
+    ResponseStream *EnableStream(ResponseStream::NotifyFunc_t notify_func);
+    ResponseStream *stream() const { return stream_.get(); }
+
+    // the head goes out with the first call, the result with the finishing one
+    virtual int SendStream(BaseTcpStream &socket, const std::vector<std::string> &frames,
+                           const bool finished) = 0;
+    // client side of a streamed response, appends the next piece of body to data
+    virtual int RecvStream(BaseTcpStream &socket, std::string *data, bool *finished) = 0;
+
+  private:
+    std::unique_ptr<ResponseStream> stream_;
 };
 
 
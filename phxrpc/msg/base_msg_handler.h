@@ -35,14 +35,20 @@ class BaseMessageHandler {
 
     virtual int RecvRequest(BaseTcpStream &socket, BaseRequest *&req) = 0;
     virtual int RecvResponse(BaseTcpStream &socket, BaseResponse *&resp) = 0;
+    // head only, the body of a streamed response is read by BaseResponse::RecvStream
+    virtual int RecvResponseHead(BaseTcpStream &socket, BaseResponse *&resp) = 0;
 
     virtual int GenRequest(BaseRequest *&req) = 0;
     virtual int GenResponse(BaseResponse *&resp) = 0;
 
     virtual bool keep_alive() const = 0;
 
+    // requests received from now on are made on arena, which the caller owns
+    void set_arena(Arena *arena) { arena_ = arena; }
+
   protected:
     BaseRequest *req_{nullptr};
+    Arena *arena_{nullptr};
 };
 
 
@@ -0,0 +1,157 @@
+/*
+Tencent is pleased to support the open source community by making
+PhxRPC available.
+Copyright (C) 2016 THL A29 Limited, a Tencent company.
+All rights reserved.
+
+Licensed under the BSD 3-Clause License (the "License"); you may
+not use this file except in compliance with the License. You may
+obtain a copy of the License at
+
+https://opensource.org/licenses/BSD-3-Clause
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" basis,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+implied. See the License for the specific language governing
+permissions and limitations under the License.
+
+See the AUTHORS file for names of contributors.
+*/
+
+
+#include "phxrpc/msg/response_stream.h"
+
+#include <climits>
+
+#include <google/protobuf/message.h>
+
+
+namespace phxrpc {
+
+
+using namespace std;
+
+
+ResponseStream::ResponseStream(BaseResponse *resp, NotifyFunc_t notify_func)
+        : resp_(resp), notify_func_(notify_func) {
+    // no connection to drain the frames, as for a one-way or local req
+    abandoned_ = !notify_func_;
+}
+
+ResponseStream::~ResponseStream() {
+}
+
+int ResponseStream::Write(const google::protobuf::Message &message) {
+    string frame;
+    if (!AppendFrame(message, &frame))
+        return -1;
+
+    bool notify{false};
+    {
+        lock_guard<mutex> lock(mutex_);
+        if (abandoned_)
+            return -1;
+
+        frames_.push_back(move(frame));
+        if (!notified_) {
+            notified_ = true;
+            notify = true;
+        }
+    }
+
+    if (notify && notify_func_)
+        notify_func_(resp_);
+
+    return 0;
+}
+
+void ResponseStream::Finish() {
+    bool notify{false};
+    {
+        lock_guard<mutex> lock(mutex_);
+        finished_ = true;
+        if (!notified_) {
+            notified_ = true;
+            notify = true;
+        }
+    }
+
+    if (notify && notify_func_)
+        notify_func_(resp_);
+}
+
+bool ResponseStream::Take(vector<string> *frames) {
+    lock_guard<mutex> lock(mutex_);
+    frames->swap(frames_);
+    frames_.clear();
+    // nothing left, the next Write or Finish notifies again
+    if (frames->empty() && !finished_)
+        notified_ = false;
+
+    return finished_;
+}
+
+bool ResponseStream::Abandon(const bool release) {
+    lock_guard<mutex> lock(mutex_);
+    abandoned_ = true;
+    frames_.clear();
+    if (release)
+        notified_ = false;
+
+    return finished_ && !notified_;
+}
+
+bool ResponseStream::AppendFrame(const google::protobuf::Message &message, string *data) {
+    string body;
+    if (!message.SerializeToString(&body))
+        return false;
+
+    char varint[10];
+    size_t len{0};
+    for (uint64_t size{body.size()}; ; size >>= 7) {
+        if (size < 0x80) {
+            varint[len++] = static_cast<char>(size);
+            break;
+        }
+        varint[len++] = static_cast<char>((size & 0x7f) | 0x80);
+    }
+
+    data->reserve(data->size() + len + body.size());
+    data->append(varint, len);
+    data->append(body);
+
+    return true;
+}
+
+int ResponseStream::ParseFrame(const string &data, size_t *pos,
+                               google::protobuf::Message *message) {
+    uint64_t size{0};
+    size_t i{*pos};
+    for (int shift{0}; ; shift += 7) {
+        if (data.size() <= i)
+            return 0;
+        if (63 < shift)
+            return -1;
+
+        const uint8_t byte{static_cast<uint8_t>(data[i++])};
+        size |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (0 == (byte & 0x80))
+            break;
+    }
+
+    if (static_cast<uint64_t>(INT_MAX) < size)
+        return -1;
+    if (data.size() - i < size)
+        return 0;
+
+    if (!message->ParseFromArray(data.data() + i, static_cast<int>(size)))
+        return -1;
+    *pos = i + size;
+
+    return 1;
+}
+
+
+}  // namespace phxrpc
+
@@ -0,0 +1,108 @@
+/*
+Tencent is pleased to support the open source community by making
+PhxRPC available.
+Copyright (C) 2016 THL A29 Limited, a Tencent company.
+All rights reserved.
+
+Licensed under the BSD 3-Clause License (the "License"); you may
+not use this file except in compliance with the License. You may
+obtain a copy of the License at
+
+https://opensource.org/licenses/BSD-3-Clause
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" basis,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+implied. See the License for the specific language governing
+permissions and limitations under the License.
+
+See the AUTHORS file for names of contributors.
+*/
+
+
+#pragma once
+
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+
+namespace google {
+
+namespace protobuf {
+
+class Message;
+
+}  // protobuf
+
+}  // google
+
+
+namespace phxrpc {
+
+
+class BaseResponse;
+
+// frames of a server-streaming response, written by the worker running the
+// handler and drained by the io uthread which owns the connection.
+// at most one notification for a stream is queued at a time, the io side
+// re-arms it by taking frames, so it is never resumed while sending.
+class ResponseStream {
+  public:
+    typedef std::function<void (BaseResponse *)> NotifyFunc_t;
+
+    // abandoned from the start without a notify_func
+    ResponseStream(BaseResponse *resp, NotifyFunc_t notify_func);
+    ~ResponseStream();
+
+    // writer side, returns -1 once the connection is abandoned
+    int Write(const google::protobuf::Message &message);
+    // no more frames, the response is handed over to the io side
+    void Finish();
+
+    int result() const { return result_; }
+    void set_result(const int result) { result_ = result; }
+
+    // io side, moves the pending frames out, returns whether the writer has finished
+    bool Take(std::vector<std::string> *frames);
+    // the connection is gone, pass true if a notification was taken and not re-armed.
+    // returns true if nothing will be notified any more, the caller cleans up then.
+    bool Abandon(const bool release);
+
+    // length-delimited protobuf, a varint size followed by the message
+    static bool AppendFrame(const google::protobuf::Message &message, std::string *data);
+    // parses the frame at *pos and moves past it, returns 1 if a frame is parsed,
+    // 0 if data holds an incomplete frame only, -1 if malformed
+    static int ParseFrame(const std::string &data, size_t *pos,
+                          google::protobuf::Message *message);
+
+  private:
+    BaseResponse *resp_{nullptr};
+    NotifyFunc_t notify_func_;
+
+    std::mutex mutex_;
+    std::vector<std::string> frames_;
+    bool notified_{false};
+    bool finished_{false};
+    bool abandoned_{false};
+    int result_{-1};
+};
+
+
+template <typename Message>
+class StreamWriter {
+  public:
+    explicit StreamWriter(ResponseStream *stream) : stream_(stream) {}
+
+    // queued and sent to the client as soon as the io thread gets to it,
+    // -1 once the client is gone, the handler may stop early then
+    int Write(const Message &message) { return stream_->Write(message); }
+
+  private:
+    ResponseStream *stream_{nullptr};
+};
+
+
+}  // namespace phxrpc
+
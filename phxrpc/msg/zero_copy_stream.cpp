@@ -0,0 +1,196 @@
+/*
+Tencent is pleased to support the open source community by making
+PhxRPC available.
+Copyright (C) 2016 THL A29 Limited, a Tencent company.
+All rights reserved.
+
+Licensed under the BSD 3-Clause License (the "License"); you may
+not use this file except in compliance with the License. You may
+obtain a copy of the License at
+
+https://opensource.org/licenses/BSD-3-Clause
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" basis,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+implied. See the License for the specific language governing
+permissions and limitations under the License.
+
+See the AUTHORS file for names of contributors.
+*/
+
+
+#include "phxrpc/msg/zero_copy_stream.h"
+
+#include <sys/uio.h>
+
+#include <memory>
+
+#include "phxrpc/network/socket_stream_base.h"
+
+
+namespace {
+
+
+// staging buffers of this thread, a sender may yield to another uthread of
+// the same thread while sending, so each one takes a buffer of its own
+thread_local std::vector<std::unique_ptr<char[]>> staging_pool;
+
+char *AcquireStaging() {
+    if (staging_pool.empty())
+        return new char[phxrpc::TcpStreamOutputStream::STAGING_SIZE];
+
+    char *staging{staging_pool.back().release()};
+    staging_pool.pop_back();
+
+    return staging;
+}
+
+void ReleaseStaging(char *staging) {
+    staging_pool.emplace_back(staging);
+}
+
+
+}  // namespace
+
+
+namespace phxrpc {
+
+
+using namespace std;
+
+
+BufferChainInputStream::BufferChainInputStream(const vector<string> &buffers)
+        : buffers_(buffers) {
+}
+
+BufferChainInputStream::~BufferChainInputStream() {
+}
+
+bool BufferChainInputStream::Next(const void **data, int *size) {
+    for (; buffers_.size() > index_ && buffers_[index_].size() <= offset_; ++index_)
+        offset_ = 0;
+
+    if (buffers_.size() <= index_)
+        return false;
+
+    const string &buffer = buffers_[index_];
+    *data = buffer.data() + offset_;
+    *size = static_cast<int>(buffer.size() - offset_);
+
+    byte_count_ += *size;
+    offset_ = buffer.size();
+
+    return true;
+}
+
+void BufferChainInputStream::BackUp(int count) {
+    // only the tail of the last Next() may be returned
+    offset_ -= count;
+    byte_count_ -= count;
+}
+
+bool BufferChainInputStream::Skip(int count) {
+    const void *data{nullptr};
+    int size{0};
+
+    for (; 0 < count;) {
+        if (!Next(&data, &size))
+            return false;
+
+        if (size > count) {
+            BackUp(size - count);
+            count = 0;
+        } else {
+            count -= size;
+        }
+    }
+
+    return true;
+}
+
+google::protobuf::int64 BufferChainInputStream::ByteCount() const {
+    return byte_count_;
+}
+
+
+TcpStreamOutputStream::TcpStreamOutputStream(BaseTcpStream &socket) : socket_(socket) {
+}
+
+TcpStreamOutputStream::~TcpStreamOutputStream() {
+    if (staging_)
+        ReleaseStaging(staging_);
+}
+
+bool TcpStreamOutputStream::Next(void **data, int *size) {
+    if (failed_)
+        return false;
+
+    socket_.Commit(socket_pending_);
+    socket_pending_ = 0;
+
+    // the socket buffer comes first, staged bytes have to go after it
+    if (0 == staged_) {
+        char *room{nullptr};
+        const size_t len{socket_.Prepare(&room)};
+        if (0 < len) {
+            *data = room;
+            *size = static_cast<int>(len);
+            socket_pending_ = len;
+            byte_count_ += len;
+
+            return true;
+        }
+    }
+
+    if (STAGING_SIZE == staged_ && !Flush())
+        return false;
+
+    if (!staging_)
+        staging_ = AcquireStaging();
+
+    *data = staging_ + staged_;
+    *size = static_cast<int>(STAGING_SIZE - staged_);
+    byte_count_ += *size;
+    staged_ = STAGING_SIZE;
+
+    return true;
+}
+
+void TcpStreamOutputStream::BackUp(int count) {
+    // only the tail of the last Next() may be returned
+    if (0 < socket_pending_) {
+        socket_pending_ -= count;
+    } else {
+        staged_ -= count;
+    }
+    byte_count_ -= count;
+}
+
+google::protobuf::int64 TcpStreamOutputStream::ByteCount() const {
+    return byte_count_;
+}
+
+bool TcpStreamOutputStream::Flush() {
+    if (failed_)
+        return false;
+
+    socket_.Commit(socket_pending_);
+    socket_pending_ = 0;
+
+    struct iovec iov;
+    iov.iov_base = staging_;
+    iov.iov_len = staged_;
+    if (!socket_.Writev(&iov, 0 < staged_ ? 1 : 0)) {
+        failed_ = true;
+
+        return false;
+    }
+    staged_ = 0;
+
+    return true;
+}
+
+
+}  // namespace phxrpc
+
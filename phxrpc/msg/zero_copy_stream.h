@@ -0,0 +1,90 @@
+/*
+Tencent is pleased to support the open source community by making
+PhxRPC available.
+Copyright (C) 2016 THL A29 Limited, a Tencent company.
+All rights reserved.
+
+Licensed under the BSD 3-Clause License (the "License"); you may
+not use this file except in compliance with the License. You may
+obtain a copy of the License at
+
+https://opensource.org/licenses/BSD-3-Clause
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" basis,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+implied. See the License for the specific language governing
+permissions and limitations under the License.
+
+See the AUTHORS file for names of contributors.
+*/
+
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <google/protobuf/io/zero_copy_stream.h>
+
+
+namespace phxrpc {
+
+
+class BaseTcpStream;
+
+
+// reads a body kept as several buffers, e.g. the chunks of a chunked
+// http body, without joining them first
+class BufferChainInputStream : public google::protobuf::io::ZeroCopyInputStream {
+  public:
+    BufferChainInputStream(const std::vector<std::string> &buffers);
+    virtual ~BufferChainInputStream() override;
+
+    virtual bool Next(const void **data, int *size) override;
+    virtual void BackUp(int count) override;
+    virtual bool Skip(int count) override;
+    virtual google::protobuf::int64 ByteCount() const override;
+
+  private:
+    const std::vector<std::string> &buffers_;
+    size_t index_{0};
+    // offset inside buffers_[index_]
+    size_t offset_{0};
+    google::protobuf::int64 byte_count_{0};
+};
+
+
+// writes into the output buffer of a socket in place, and once that is full
+// into staging buffers taken from a per-thread pool, which are sent together
+// with the socket buffer whenever one fills up. so a big body is never built
+// in one piece before sending.
+class TcpStreamOutputStream : public google::protobuf::io::ZeroCopyOutputStream {
+  public:
+    enum {
+        STAGING_SIZE = 64 * 1024,
+    };
+
+    TcpStreamOutputStream(BaseTcpStream &socket);
+    virtual ~TcpStreamOutputStream() override;
+
+    virtual bool Next(void **data, int *size) override;
+    virtual void BackUp(int count) override;
+    virtual google::protobuf::int64 ByteCount() const override;
+
+    // sends everything written so far, false if the socket failed
+    bool Flush();
+
+  private:
+    BaseTcpStream &socket_;
+    // handed out from the socket buffer but not committed yet
+    size_t socket_pending_{0};
+    char *staging_{nullptr};
+    size_t staged_{0};
+    google::protobuf::int64 byte_count_{0};
+    bool failed_{false};
+};
+
+
+}  // namespace phxrpc
+
@@ -23,6 +23,7 @@ See the AUTHORS file for names of contributors.
 
 #include "network/socket_stream_base.h"
 #include "network/socket_stream_block.h"
+#include "network/socket_stream_shm.h"
 #include "network/socket_stream_uthread.h"
 #include "network/uthread_context_base.h"
 #include "network/uthread_context_util.h"
@@ -64,6 +64,30 @@ int BaseTcpStreamBuf::underflow() {
     }
 }
 
+std::streamsize BaseTcpStreamBuf::xsgetn(char * s, std::streamsize n) {
+    std::streamsize got = 0;
+
+    while (got < n) {
+        std::streamsize avail = egptr() - gptr();
+        if (avail > 0) {
+            std::streamsize len = avail < n - got ? avail : n - got;
+            memcpy(s + got, gptr(), len);
+            gbump(static_cast<int>(len));
+            got += len;
+        } else if (n - got >= static_cast<std::streamsize>(buf_size_)) {
+            ssize_t ret = precv(s + got, n - got, 0);
+            if (ret <= 0) {
+                break;
+            }
+            got += ret;
+        } else if (traits_type::eq_int_type(underflow(), traits_type::eof())) {
+            break;
+        }
+    }
+
+    return got;
+}
+
 int BaseTcpStreamBuf::sync() {
     int sent = 0;
     int total = pptr() - pbase();
@@ -95,6 +119,89 @@ int BaseTcpStreamBuf::overflow(int c) {
     }
 }
 
+ssize_t BaseTcpStreamBuf::peek(const char ** data) {
+    if (gptr() == egptr() && traits_type::eq_int_type(underflow(), traits_type::eof())) {
+        return -1;
+    }
+
+    *data = gptr();
+
+    return egptr() - gptr();
+}
+
+void BaseTcpStreamBuf::consume(size_t len) {
+    gbump(static_cast<int>(len));
+}
+
+int BaseTcpStreamBuf::sendv(const struct iovec * iov, int iovcnt) {
+    enum { MAX_IOV = 16 };
+
+    struct iovec vec[MAX_IOV];
+    int count = 0;
+
+    if (pptr() > pbase()) {
+        vec[count].iov_base = pbase();
+        vec[count].iov_len = pptr() - pbase();
+        count++;
+    }
+
+    for (int i = 0; i < iovcnt; i++) {
+        if (iov[i].iov_len > 0) {
+            if (MAX_IOV == count) {
+                phxrpc::log(LOG_ERR, "sendv too many buffers %d", iovcnt);
+                return -1;
+            }
+            vec[count++] = iov[i];
+        }
+    }
+
+    struct iovec * pos = vec;
+    while (count > 0) {
+        ssize_t ret = psendv(pos, count, 0);
+        if (ret <= 0) {
+            return -1;
+        }
+
+        for (; count > 0 && static_cast<size_t>(ret) >= pos->iov_len; pos++, count--) {
+            ret -= pos->iov_len;
+        }
+        if (count > 0) {
+            pos->iov_base = static_cast<char *>(pos->iov_base) + ret;
+            pos->iov_len -= ret;
+        }
+    }
+
+    // iov and the output buffer are the caller's to reuse after this
+    if (0 != pdrain()) {
+        return -1;
+    }
+
+    setp(pbase(), pbase() + buf_size_);
+
+    return 0;
+}
+
+size_t BaseTcpStreamBuf::prepare(char ** data) {
+    *data = pptr();
+
+    return epptr() - pptr();
+}
+
+void BaseTcpStreamBuf::commit(size_t len) {
+    pbump(static_cast<int>(len));
+}
+
+ssize_t BaseTcpStreamBuf::psendv(const struct iovec * iov, int iovcnt, int flags) {
+    return psend(iov[0].iov_base, iov[0].iov_len, flags);
+}
+
+int BaseTcpStreamBuf::pdrain() {
+    return 0;
+}
+
+void BaseTcpStreamBuf::Adopt(UThreadEpollScheduler * scheduler) {
+}
+
 //---------------------------------------------------------
 
 BaseTcpStream::BaseTcpStream(size_t buf_size)
@@ -111,6 +218,10 @@ void BaseTcpStream::NewRdbuf(BaseTcpStreamBuf * buf) {
     delete old;
 }
 
+size_t BaseTcpStream::buf_size() const {
+    return buf_size_;
+}
+
 bool BaseTcpStream::GetRemoteHost(char * ip, size_t size, int * port) {
     struct sockaddr_in addr;
     socklen_t slen = sizeof(addr);
@@ -141,6 +252,36 @@ std::istream & BaseTcpStream::getlineWithTrimRight(char * line, size_t size) {
     return *this;
 }
 
+ssize_t BaseTcpStream::Peek(const char ** data) {
+    ssize_t len = static_cast<BaseTcpStreamBuf *>(rdbuf())->peek(data);
+    if (len <= 0) {
+        setstate(std::ios_base::eofbit | std::ios_base::failbit);
+    }
+
+    return len;
+}
+
+void BaseTcpStream::Consume(size_t len) {
+    static_cast<BaseTcpStreamBuf *>(rdbuf())->consume(len);
+}
+
+size_t BaseTcpStream::Prepare(char ** data) {
+    return static_cast<BaseTcpStreamBuf *>(rdbuf())->prepare(data);
+}
+
+void BaseTcpStream::Commit(size_t len) {
+    static_cast<BaseTcpStreamBuf *>(rdbuf())->commit(len);
+}
+
+bool BaseTcpStream::Writev(const struct iovec * iov, int iovcnt) {
+    if (0 != static_cast<BaseTcpStreamBuf *>(rdbuf())->sendv(iov, iovcnt)) {
+        setstate(std::ios_base::badbit);
+        return false;
+    }
+
+    return true;
+}
+
 //---------------------------------------------------------
 
 bool BaseTcpUtils::SetNonBlock(int fd, bool flag) {
@@ -166,6 +307,11 @@ bool BaseTcpUtils::SetNoDelay(int fd, bool flag) {
 
     int ret = setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, (char*) &tmp, sizeof(tmp));
 
+    // a Unix socket, which has no Nagle to turn off
+    if (0 != ret && EOPNOTSUPP == errno) {
+        return true;
+    }
+
     if (0 != ret) {
         phxrpc::log(LOG_WARNING, "SetDelay(%d) fail, errno %d, %s", fd, errno, strerror(errno));
     }
@@ -21,10 +21,14 @@ See the AUTHORS file for names of contributors.
 
 #pragma once
 
+#include <sys/uio.h>
+
 #include <iostream>
 
 namespace phxrpc {
 
+class UThreadEpollScheduler;
+
 enum SocketStreamError {
     SocketStreamError_Refused = -1,
     SocketStreamError_Timeout = -202,
@@ -39,10 +43,30 @@ public:
     int underflow();
     int overflow(int c = traits_type::eof());
     int sync();
+    // large reads bypass the get area and go straight into s
+    std::streamsize xsgetn(char * s, std::streamsize n);
+
+    // buffered input, filled from the socket only when it is empty
+    ssize_t peek(const char ** data);
+    void consume(size_t len);
+
+    // sends the pending output followed by iov, without copying iov into the buffer
+    int sendv(const struct iovec * iov, int iovcnt);
+
+    // free room of the output buffer, to be filled in place and then committed
+    size_t prepare(char ** data);
+    void commit(size_t len);
+
+    // for a stream going on in the uthreads of another scheduler, e.g. a pooled one,
+    // what it waits on of its own is moved over to scheduler
+    virtual void Adopt(UThreadEpollScheduler * scheduler);
 
 protected:
     virtual ssize_t precv(void * buf, size_t len, int flags) = 0;
     virtual ssize_t psend(const void *buf, size_t len, int flags) = 0;
+    virtual ssize_t psendv(const struct iovec * iov, int iovcnt, int flags);
+    // till the kernel no longer reads the buffers handed to psendv, for zero-copy sends
+    virtual int pdrain();
 
     const size_t buf_size_;
 };
@@ -61,8 +85,24 @@ public:
 
     std::istream & getlineWithTrimRight(char * line, size_t size);
 
+    // let parsers scan the received bytes in place, returns <= 0 on eof or error
+    ssize_t Peek(const char ** data);
+
+    void Consume(size_t len);
+
+    // let serializers write into the output buffer in place, see BaseTcpStreamBuf::prepare
+    size_t Prepare(char ** data);
+
+    void Commit(size_t len);
+
+    // flush the buffered output and iov with scatter/gather writes
+    bool Writev(const struct iovec * iov, int iovcnt);
+
     virtual int LastError() = 0;
 
+    // of each of the get and put areas of its stream buf
+    size_t buf_size() const;
+
 protected:
     virtual int SocketFd() = 0;
 
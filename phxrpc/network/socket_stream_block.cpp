@@ -21,6 +21,8 @@ See the AUTHORS file for names of contributors.
 
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
 #include <arpa/inet.h>
@@ -56,6 +58,15 @@ ssize_t BlockTcpStreamBuf::psend(const void *buf, size_t len, int flags) {
     return send(socket_, buf, len, flags);
 }
 
+ssize_t BlockTcpStreamBuf::psendv(const struct iovec * iov, int iovcnt, int flags) {
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = const_cast<struct iovec *>(iov);
+    msg.msg_iovlen = iovcnt;
+
+    return sendmsg(socket_, &msg, flags);
+}
+
 ////////////////////////////////////////////////////////////
 
 BlockTcpStream::BlockTcpStream(size_t buf_size)
@@ -144,13 +155,30 @@ bool BlockTcpUtils::Open(BlockTcpStream * stream, const char * ip, unsigned shor
     in_addr.sin_addr.s_addr = inet_addr(ip);
     in_addr.sin_port = htons(port);
 
+    return Connect(stream, sockfd, (struct sockaddr*) &in_addr, sizeof(in_addr), connect_timeout_ms);
+}
+
+bool BlockTcpUtils::Open(BlockTcpStream * stream, const struct sockaddr * addr, socklen_t addrlen,
+                         int connect_timeout_ms) {
+    int sockfd = socket(addr->sa_family, SOCK_STREAM, IPPROTO_IP);
+
+    if (sockfd < 0) {
+        phxrpc::log(LOG_WARNING, "TcpSocket::Connect().socket()=%d", sockfd);
+        return false;
+    }
+
+    return Connect(stream, sockfd, addr, addrlen, connect_timeout_ms);
+}
+
+bool BlockTcpUtils::Connect(BlockTcpStream * stream, int sockfd, const struct sockaddr * addr,
+                            socklen_t addrlen, int connect_timeout_ms) {
     BaseTcpUtils::SetNonBlock(sockfd, true);
 
     int error = 0;
-    int ret = connect(sockfd, (struct sockaddr*) &in_addr, sizeof(in_addr));
+    int ret = connect(sockfd, addr, addrlen);
 
     if (0 != ret && ((errno != EINPROGRESS) && (errno != EAGAIN))) {
-        phxrpc::log(LOG_ERR, "connect(%d{%s:%d}) errno %d, %s", sockfd, ip, port, errno, strerror(errno));
+        phxrpc::log(LOG_ERR, "connect(%d) errno %d, %s", sockfd, errno, strerror(errno));
         error = -1;
     }
 
@@ -239,6 +267,77 @@ bool BlockTcpUtils::Listen(int * listenfd, const char * ip, unsigned short port)
     return 0 == ret;
 }
 
+bool BlockTcpUtils::ListenUnix(int * listenfd, const char * path) {
+    struct sockaddr_un addr;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    const size_t path_len = strlen(path);
+    if (path_len >= sizeof(addr.sun_path)) {
+        phxrpc::log(LOG_CRIT, "unix socket path too long [%s]", path);
+        return false;
+    }
+    memcpy(addr.sun_path, path, path_len);
+
+    int sockfd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (sockfd < 0) {
+        phxrpc::log(LOG_WARNING, "socket failed, errno %d, %s", errno, strerror(errno));
+        return false;
+    }
+
+    // a socket left by a server before this one is removed once nothing accepts on it,
+    // a live server keeps its path, anything else at path is not ours to remove
+    struct stat st;
+    if (0 == lstat(path, &st)) {
+        if (!S_ISSOCK(st.st_mode)) {
+            phxrpc::log(LOG_CRIT, "unix socket path [%s] is not a socket", path);
+            close(sockfd);
+            return false;
+        }
+
+        // not blocking on a server with its backlog full
+        int probefd = socket(AF_UNIX, SOCK_STREAM, 0);
+        int probe_errno = 0;
+        if (probefd < 0 || !BaseTcpUtils::SetNonBlock(probefd, true)
+                || connect(probefd, (struct sockaddr*) &addr, sizeof(addr)) < 0)
+            probe_errno = errno;
+        if (probefd >= 0)
+            close(probefd);
+
+        if (ECONNREFUSED != probe_errno) {
+            phxrpc::log(LOG_CRIT, "unix socket path [%s] in use, errno %d, %s", path,
+                        probe_errno, strerror(probe_errno));
+            close(sockfd);
+            return false;
+        }
+        unlink(path);
+    }
+
+    int ret = 0;
+
+    if (bind(sockfd, (struct sockaddr*) &addr, sizeof(addr)) < 0) {
+        phxrpc::log(LOG_CRIT, "bind failed, errno %d, %s", errno, strerror(errno));
+        ret = -1;
+    }
+
+    if (0 == ret) {
+        if (listen(sockfd, 1024) < 0) {
+            phxrpc::log(LOG_CRIT, "listen failed, errno %d, %s", errno, strerror(errno));
+            ret = -1;
+        }
+    }
+
+    if (0 != ret)
+        close(sockfd);
+
+    if (0 == ret) {
+        *listenfd = sockfd;
+        phxrpc::log(LOG_NOTICE, "Listen on unix socket [%s]", path);
+    }
+
+    return 0 == ret;
+}
+
 int BlockTcpUtils::Poll(int fd, int events, int * revents, int timeout_ms) {
     int ret = -1;
 
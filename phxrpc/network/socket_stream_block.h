@@ -21,6 +21,8 @@ See the AUTHORS file for names of contributors.
 
 #pragma once
 
+#include <sys/socket.h>
+
 #include <iostream>
 #include "socket_stream_base.h"
 
@@ -33,6 +35,7 @@ public:
 
     ssize_t precv(void * buf, size_t len, int flags);
     ssize_t psend(const void *buf, size_t len, int flags);
+    ssize_t psendv(const struct iovec * iov, int iovcnt, int flags);
 
 private:
     int socket_;
@@ -64,14 +67,26 @@ public:
     static bool Open(BlockTcpStream * stream, const char * ip, unsigned short port, int connect_timeout_ms,
                      const char * bind_addr, int bind_port);
 
+    // connects to an address resolved beforehand
+    static bool Open(BlockTcpStream * stream, const struct sockaddr * addr, socklen_t addrlen,
+                     int connect_timeout_ms);
+
     static bool Listen(int * listenfd, const char * ip, unsigned short port);
 
+    // on a Unix socket at path, for callers on the same host, a socket left there
+    // with nothing accepting on it is removed, anything else there fails it
+    static bool ListenUnix(int * listenfd, const char * path);
+
     /**
      * return > 0 : how many events
      * return 0 : timeout,
      * return -1 : error, and errno is set appropriately
      */
     static int Poll(int fd, int events, int * revents, int timeout_ms);
+
+private:
+    static bool Connect(BlockTcpStream * stream, int sockfd, const struct sockaddr * addr,
+                        socklen_t addrlen, int connect_timeout_ms);
 };
 
 }
@@ -0,0 +1,664 @@
+/*
+Tencent is pleased to support the open source community by making
+PhxRPC available.
+Copyright (C) 2016 THL A29 Limited, a Tencent company.
+All rights reserved.
+
+Licensed under the BSD 3-Clause License (the "License"); you may
+not use this file except in compliance with the License. You may
+obtain a copy of the License at
+
+https://opensource.org/licenses/BSD-3-Clause
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" basis,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+implied. See the License for the specific language governing
+permissions and limitations under the License.
+
+See the AUTHORS file for names of contributors.
+*/
+
+
+
+#include "phxrpc/network/socket_stream_shm.h"
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <new>
+
+#ifdef __APPLE__
+#include "epoll-darwin.h"
+#else
+#include <sys/epoll.h>
+#endif
+
+#include "phxrpc/file/log_utils.h"
+
+
+namespace phxrpc {
+
+
+using namespace std;
+
+
+// followed by the data of the ring
+struct ShmRingHeader {
+    // bytes written so far, moved by the writer only
+    atomic<uint64_t> head;
+    char pad0[56];
+    // bytes read so far, moved by the reader only
+    atomic<uint64_t> tail;
+    char pad1[56];
+    // set by the reader before it sleeps, taken by the writer that signals it
+    atomic<uint32_t> reader_waiting;
+    // by either end when it goes
+    atomic<uint32_t> closed;
+    uint64_t size;
+    char pad2[48];
+};
+
+
+namespace {
+
+
+// sent by the client end instead of the first request, no request line starts with it
+const char SHM_MAGIC[8]{'P', 'H', 'X', 'R', 'I', 'N', 'G', '1'};
+
+const size_t SHM_MIN_RING_SIZE{4096};
+
+const int SHM_OFFER_FDS{3};
+
+char *DataOf(ShmRingHeader *ring) {
+    return reinterpret_cast<char *>(ring) + sizeof(ShmRingHeader);
+}
+
+// the answer of the server end, with mem_fd, the wait_fd of the client end and its own
+// if it offers a channel
+bool SendOffer(const int fd, const ShmChannel *channel) {
+    char offer{nullptr == channel ? '0' : '1'};
+    struct iovec iov;
+    iov.iov_base = &offer;
+    iov.iov_len = 1;
+
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+
+    char control[CMSG_SPACE(sizeof(int) * SHM_OFFER_FDS)];
+    if (nullptr != channel) {
+        memset(control, 0, sizeof(control));
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        struct cmsghdr *cmsg{CMSG_FIRSTHDR(&msg)};
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int) * SHM_OFFER_FDS);
+        const int fds[SHM_OFFER_FDS]{channel->mem_fd(), channel->peer_fd(), channel->wait_fd()};
+        memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+    }
+
+    return 1 == sendmsg(fd, &msg, MSG_NOSIGNAL);
+}
+
+// 1 with the fds of an offer, 0 if the server end has no channel, -1 on error
+int RecvOffer(const int fd, int fds[SHM_OFFER_FDS]) {
+    char offer{'\0'};
+    struct iovec iov;
+    iov.iov_base = &offer;
+    iov.iov_len = 1;
+
+    char control[CMSG_SPACE(sizeof(int) * SHM_OFFER_FDS)];
+    memset(control, 0, sizeof(control));
+
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    if (1 != recvmsg(fd, &msg, MSG_CMSG_CLOEXEC)) {
+        phxrpc::log(LOG_ERR, "%s recvmsg fd %d errno %d, %s", __func__, fd, errno, strerror(errno));
+
+        return -1;
+    }
+
+    int count{0};
+    struct cmsghdr *cmsg{CMSG_FIRSTHDR(&msg)};
+    if (nullptr != cmsg && SOL_SOCKET == cmsg->cmsg_level && SCM_RIGHTS == cmsg->cmsg_type) {
+        count = static_cast<int>((cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int));
+        memcpy(fds, CMSG_DATA(cmsg), sizeof(int) * min(count, SHM_OFFER_FDS));
+    }
+
+    if ('1' == offer && SHM_OFFER_FDS == count)
+        return 1;
+
+    for (int i{0}; min(count, SHM_OFFER_FDS) > i; ++i)
+        close(fds[i]);
+
+    if ('0' == offer)
+        return 0;
+
+    phxrpc::log(LOG_ERR, "%s bad offer %d with %d fds", __func__, offer, count);
+
+    return -1;
+}
+
+
+}  // namespace
+
+
+ShmChannel *ShmChannel::Create(const size_t ring_size) {
+    size_t size{SHM_MIN_RING_SIZE};
+    while (size < ring_size)
+        size <<= 1;
+    const size_t map_size{2 * (sizeof(ShmRingHeader) + size)};
+
+    int mem_fd{memfd_create("phxrpc_shm_channel", MFD_CLOEXEC)};
+    if (0 > mem_fd) {
+        phxrpc::log(LOG_ERR, "%s memfd_create errno %d, %s", __func__, errno, strerror(errno));
+
+        return nullptr;
+    }
+
+    if (0 != ftruncate(mem_fd, static_cast<off_t>(map_size))) {
+        phxrpc::log(LOG_ERR, "%s ftruncate %zu errno %d, %s", __func__, map_size,
+                    errno, strerror(errno));
+        close(mem_fd);
+
+        return nullptr;
+    }
+
+    void *base{mmap(nullptr, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, mem_fd, 0)};
+    if (MAP_FAILED == base) {
+        phxrpc::log(LOG_ERR, "%s mmap %zu errno %d, %s", __func__, map_size, errno, strerror(errno));
+        close(mem_fd);
+
+        return nullptr;
+    }
+
+    int wait_fd{eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)};
+    int peer_fd{eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)};
+    if (0 > wait_fd || 0 > peer_fd) {
+        phxrpc::log(LOG_ERR, "%s eventfd errno %d, %s", __func__, errno, strerror(errno));
+        if (0 <= wait_fd)
+            close(wait_fd);
+        if (0 <= peer_fd)
+            close(peer_fd);
+        munmap(base, map_size);
+        close(mem_fd);
+
+        return nullptr;
+    }
+
+    ShmChannel *channel{new ShmChannel(static_cast<char *>(base), map_size, size, mem_fd,
+                                       wait_fd, peer_fd, true)};
+    for (int i{0}; 2 > i; ++i) {
+        ShmRingHeader *ring{new(channel->ring(i)) ShmRingHeader};
+        ring->head = 0;
+        ring->tail = 0;
+        ring->reader_waiting = 0;
+        ring->closed = 0;
+        ring->size = size;
+    }
+
+    return channel;
+}
+
+ShmChannel *ShmChannel::Attach(const int mem_fd, const int wait_fd, const int peer_fd) {
+    struct stat st;
+    void *base{MAP_FAILED};
+    size_t map_size{0};
+    if (0 == fstat(mem_fd, &st)) {
+        map_size = static_cast<size_t>(st.st_size);
+        base = mmap(nullptr, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, mem_fd, 0);
+    }
+
+    // as Create sizes the rings, either header is to say so
+    const size_t ring_size{map_size / 2 - sizeof(ShmRingHeader)};
+    if (MAP_FAILED == base || map_size < 2 * (sizeof(ShmRingHeader) + SHM_MIN_RING_SIZE) ||
+        0 != (ring_size & (ring_size - 1)) ||
+        reinterpret_cast<ShmRingHeader *>(base)->size != ring_size ||
+        reinterpret_cast<ShmRingHeader *>(static_cast<char *>(base) + map_size / 2)->size != ring_size) {
+        phxrpc::log(LOG_ERR, "%s bad channel of %zu bytes errno %d, %s", __func__, map_size,
+                    errno, strerror(errno));
+        if (MAP_FAILED != base)
+            munmap(base, map_size);
+        close(mem_fd);
+        close(wait_fd);
+        close(peer_fd);
+
+        return nullptr;
+    }
+
+    return new ShmChannel(static_cast<char *>(base), map_size, ring_size,
+                          mem_fd, wait_fd, peer_fd, false);
+}
+
+ShmChannel::ShmChannel(char *base, const size_t map_size, const size_t size, const int mem_fd,
+                       const int wait_fd, const int peer_fd, const bool server_end)
+        : base_(base), map_size_(map_size), size_(size), mem_fd_(mem_fd),
+          wait_fd_(wait_fd), peer_fd_(peer_fd) {
+    // ring 0 from the client end to the server end, ring 1 back
+    in_ = ring(server_end ? 0 : 1);
+    out_ = ring(server_end ? 1 : 0);
+}
+
+ShmChannel::~ShmChannel() {
+    in_->closed = 1;
+    out_->closed = 1;
+    eventfd_write(peer_fd_, 1);
+
+    munmap(base_, map_size_);
+    close(mem_fd_);
+    close(wait_fd_);
+    close(peer_fd_);
+}
+
+ShmRingHeader *ShmChannel::ring(const int idx) const {
+    return reinterpret_cast<ShmRingHeader *>(base_ + idx * (map_size_ / 2));
+}
+
+ssize_t ShmChannel::Break(const char *func, const uint64_t head, const uint64_t tail) {
+    if (!broken_) {
+        phxrpc::log(LOG_ERR, "%s head %llu tail %llu of a ring of %zu bytes, channel broken",
+                    func, static_cast<unsigned long long>(head),
+                    static_cast<unsigned long long>(tail), size_);
+        broken_ = true;
+        in_->closed = 1;
+        out_->closed = 1;
+        eventfd_write(peer_fd_, 1);
+    }
+    errno = EPROTO;
+
+    return -1;
+}
+
+ssize_t ShmChannel::Read(void *buf, const size_t len) {
+    if (broken_)
+        return Break(__func__, 0, 0);
+
+    // closed before head, all the writer wrote is seen once it has gone
+    const bool closed{0 != in_->closed.load(memory_order_acquire)};
+    const uint64_t head{in_->head.load(memory_order_acquire)};
+    const uint64_t tail{in_->tail.load(memory_order_relaxed)};
+
+    if (head == tail) {
+        if (closed)
+            return 0;
+
+        errno = EAGAIN;
+
+        return -1;
+    }
+    if (head - tail > size_)
+        return Break(__func__, head, tail);
+
+    const size_t count{min(len, static_cast<size_t>(head - tail))};
+    const size_t offset{static_cast<size_t>(tail & (size_ - 1))};
+    const size_t first{min(count, size_ - offset)};
+    memcpy(buf, DataOf(in_) + offset, first);
+    memcpy(static_cast<char *>(buf) + first, DataOf(in_), count - first);
+
+    in_->tail.store(tail + count, memory_order_release);
+
+    return static_cast<ssize_t>(count);
+}
+
+ssize_t ShmChannel::Writev(const struct iovec *iov, const int iovcnt) {
+    if (broken_)
+        return Break(__func__, 0, 0);
+
+    if (0 != out_->closed.load(memory_order_acquire)) {
+        errno = EPIPE;
+
+        return -1;
+    }
+
+    const uint64_t head{out_->head.load(memory_order_relaxed)};
+    const uint64_t tail{out_->tail.load(memory_order_acquire)};
+    // tail past head wraps around to more than the ring holds as well
+    if (head - tail > size_)
+        return Break(__func__, head, tail);
+    size_t room{size_ - static_cast<size_t>(head - tail)};
+
+    size_t count{0};
+    for (int i{0}; iovcnt > i && 0 < room; ++i) {
+        const size_t len{min(iov[i].iov_len, room)};
+        const size_t offset{static_cast<size_t>((head + count) & (size_ - 1))};
+        const size_t first{min(len, size_ - offset)};
+        memcpy(DataOf(out_) + offset, iov[i].iov_base, first);
+        memcpy(DataOf(out_), static_cast<const char *>(iov[i].iov_base) + first, len - first);
+
+        count += len;
+        room -= len;
+    }
+
+    if (0 == count) {
+        for (int i{0}; iovcnt > i; ++i) {
+            if (0 < iov[i].iov_len) {
+                errno = EAGAIN;
+
+                return -1;
+            }
+        }
+
+        return 0;
+    }
+
+    // seq_cst against PrepareSleep, either the reader sees head or this sees it waiting
+    out_->head.store(head + count);
+    if (0 != out_->reader_waiting.load() && 0 != out_->reader_waiting.exchange(0))
+        eventfd_write(peer_fd_, 1);
+
+    return static_cast<ssize_t>(count);
+}
+
+bool ShmChannel::PrepareSleep() {
+    in_->reader_waiting.store(1);
+    if (in_->head.load() != in_->tail.load(memory_order_relaxed) || 0 != in_->closed.load()) {
+        in_->reader_waiting.store(0);
+
+        return false;
+    }
+
+    return true;
+}
+
+void ShmChannel::ClearWakeUps() {
+    eventfd_t value{0};
+    eventfd_read(wait_fd_, &value);
+}
+
+int ShmChannel::mem_fd() const {
+    return mem_fd_;
+}
+
+int ShmChannel::wait_fd() const {
+    return wait_fd_;
+}
+
+int ShmChannel::peer_fd() const {
+    return peer_fd_;
+}
+
+
+//---------------------------------------------------------
+
+ShmStreamBuf::ShmStreamBuf(ShmChannel *channel, const size_t buf_size)
+        : BaseTcpStreamBuf(buf_size), channel_(channel) {
+}
+
+ShmStreamBuf::~ShmStreamBuf() {
+    delete channel_;
+}
+
+ssize_t ShmStreamBuf::precv(void *buf, size_t len, int flags) {
+    while (true) {
+        ssize_t ret{channel_->Read(buf, len)};
+        if (0 <= ret || EAGAIN != errno)
+            return ret;
+
+        if (!channel_->PrepareSleep())
+            continue;
+
+        if (0 >= WaitSignal(TimeoutMS()))
+            return -1;
+        channel_->ClearWakeUps();
+    }
+}
+
+ssize_t ShmStreamBuf::psend(const void *buf, size_t len, int flags) {
+    struct iovec iov;
+    iov.iov_base = const_cast<void *>(buf);
+    iov.iov_len = len;
+
+    return psendv(&iov, 1, flags);
+}
+
+ssize_t ShmStreamBuf::psendv(const struct iovec *iov, int iovcnt, int flags) {
+    const int timeout_ms{TimeoutMS()};
+
+    for (int waited_ms{0}; ; ++waited_ms) {
+        ssize_t ret{channel_->Writev(iov, iovcnt)};
+        if (0 <= ret || EAGAIN != errno)
+            return ret;
+
+        if (0 <= timeout_ms && waited_ms >= timeout_ms) {
+            errno = timeout_errno_;
+
+            return -1;
+        }
+
+        Nap();
+    }
+}
+
+
+BlockShmStreamBuf::BlockShmStreamBuf(ShmChannel *channel, const int socket,
+                                     const size_t buf_size)
+        : ShmStreamBuf(channel, buf_size), socket_(socket) {
+    timeout_errno_ = EAGAIN;
+}
+
+BlockShmStreamBuf::~BlockShmStreamBuf() {
+}
+
+int BlockShmStreamBuf::TimeoutMS() {
+    // as set on the socket by BlockTcpStream::SetTimeout, only asked for before sleeping
+    struct timeval to;
+    socklen_t len{sizeof(to)};
+    if (0 != getsockopt(socket_, SOL_SOCKET, SO_RCVTIMEO, &to, &len) ||
+        (0 == to.tv_sec && 0 == to.tv_usec)) {
+        return -1;
+    }
+
+    return static_cast<int>(to.tv_sec * 1000 + to.tv_usec / 1000);
+}
+
+int BlockShmStreamBuf::WaitSignal(const int timeout_ms) {
+    // nothing comes on the socket any more, it turns readable once the peer is gone
+    struct pollfd fds[2];
+    fds[0].fd = channel_->wait_fd();
+    fds[0].events = POLLIN;
+    fds[0].revents = 0;
+    fds[1].fd = socket_;
+    fds[1].events = POLLIN;
+    fds[1].revents = 0;
+
+    int ret{poll(fds, 2, timeout_ms)};
+    if (0 > ret)
+        return EINTR == errno ? 1 : -1;
+
+    if (0 == ret) {
+        errno = EAGAIN;
+
+        return 0;
+    }
+
+    if (0 == fds[0].revents) {
+        errno = ECONNRESET;
+
+        return -1;
+    }
+
+    return 1;
+}
+
+void BlockShmStreamBuf::Nap() {
+    poll(nullptr, 0, 1);
+}
+
+
+UThreadShmStreamBuf::UThreadShmStreamBuf(ShmChannel *channel, UThreadEpollScheduler *scheduler,
+                                         UThreadSocket_t *socket, const size_t buf_size)
+        : ShmStreamBuf(channel, buf_size), socket_(socket), poll_fd_(epoll_create(2)),
+          nap_socket_(NewUThreadWaiter(scheduler)) {
+    // a uthread socket takes one fd, the signal and the peer going are waited for on both
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    if (0 > poll_fd_ ||
+        0 != epoll_ctl(poll_fd_, EPOLL_CTL_ADD, channel->wait_fd(), &event) ||
+        0 != epoll_ctl(poll_fd_, EPOLL_CTL_ADD, UThreadSocketFd(*socket), &event)) {
+        phxrpc::log(LOG_ERR, "%s epoll errno %d, %s", __func__, errno, strerror(errno));
+    }
+    wait_socket_ = scheduler->CreateSocket(poll_fd_, -1, -1, false);
+}
+
+UThreadShmStreamBuf::~UThreadShmStreamBuf() {
+    // wait_fd is closed with the channel
+    if (0 <= poll_fd_)
+        close(poll_fd_);
+    free(wait_socket_);
+    free(nap_socket_);
+}
+
+void UThreadShmStreamBuf::Adopt(UThreadEpollScheduler *scheduler) {
+    scheduler->AdoptSocket(wait_socket_);
+    scheduler->AdoptSocket(nap_socket_);
+}
+
+int UThreadShmStreamBuf::TimeoutMS() {
+    return UThreadSocketTimeout(*socket_);
+}
+
+int UThreadShmStreamBuf::WaitSignal(const int timeout_ms) {
+    int revents{0};
+    const int ret{UThreadPoll(*wait_socket_, EPOLLIN, &revents, timeout_ms)};
+    if (0 >= ret)
+        return ret;
+
+    // nothing comes on the socket any more, it turns readable once the peer is gone
+    struct pollfd fd;
+    fd.fd = channel_->wait_fd();
+    fd.events = POLLIN;
+    fd.revents = 0;
+    if (0 >= poll(&fd, 1, 0)) {
+        errno = ECONNRESET;
+
+        return -1;
+    }
+
+    return 1;
+}
+
+void UThreadShmStreamBuf::Nap() {
+    UThreadWait(*nap_socket_, 1);
+}
+
+
+//---------------------------------------------------------
+
+bool ShmStreamUtils::Open(BlockTcpStream *stream, const int timeout_ms) {
+    const int fd{stream->SocketFd()};
+    if (sizeof(SHM_MAGIC) != send(fd, SHM_MAGIC, sizeof(SHM_MAGIC), MSG_NOSIGNAL)) {
+        phxrpc::log(LOG_ERR, "%s send fd %d errno %d, %s", __func__, fd, errno, strerror(errno));
+
+        return false;
+    }
+
+    int revents{0};
+    if (0 >= BlockTcpUtils::Poll(fd, POLLIN, &revents, timeout_ms)) {
+        phxrpc::log(LOG_ERR, "%s no offer on fd %d in %d ms", __func__, fd, timeout_ms);
+
+        return false;
+    }
+
+    int fds[SHM_OFFER_FDS]{-1, -1, -1};
+    const int ret{RecvOffer(fd, fds)};
+    if (0 == ret)
+        return true;
+    if (0 > ret)
+        return false;
+
+    ShmChannel *channel{ShmChannel::Attach(fds[0], fds[1], fds[2])};
+    if (nullptr == channel)
+        return false;
+    stream->NewRdbuf(new BlockShmStreamBuf(channel, fd, stream->buf_size()));
+
+    return true;
+}
+
+bool ShmStreamUtils::Open(UThreadEpollScheduler *tt, UThreadTcpStream *stream,
+                          const int timeout_ms) {
+    UThreadSocket_t *socket{stream->GetSocket()};
+    const int fd{UThreadSocketFd(*socket)};
+    if (sizeof(SHM_MAGIC) != UThreadSend(*socket, SHM_MAGIC, sizeof(SHM_MAGIC), MSG_NOSIGNAL)) {
+        phxrpc::log(LOG_ERR, "%s send fd %d errno %d, %s", __func__, fd, errno, strerror(errno));
+
+        return false;
+    }
+
+    int revents{0};
+    if (0 >= UThreadPoll(*socket, EPOLLIN, &revents, timeout_ms)) {
+        phxrpc::log(LOG_ERR, "%s no offer on fd %d in %d ms", __func__, fd, timeout_ms);
+
+        return false;
+    }
+
+    int fds[SHM_OFFER_FDS]{-1, -1, -1};
+    const int ret{RecvOffer(fd, fds)};
+    if (0 == ret)
+        return true;
+    if (0 > ret)
+        return false;
+
+    ShmChannel *channel{ShmChannel::Attach(fds[0], fds[1], fds[2])};
+    if (nullptr == channel)
+        return false;
+    stream->NewRdbuf(new UThreadShmStreamBuf(channel, tt, socket, stream->buf_size()));
+
+    return true;
+}
+
+bool ShmStreamUtils::Accept(UThreadEpollScheduler *tt, UThreadTcpStream *stream,
+                            const size_t ring_size) {
+    UThreadSocket_t *socket{stream->GetSocket()};
+    const int fd{UThreadSocketFd(*socket)};
+
+    struct sockaddr_storage addr;
+    socklen_t addrlen{sizeof(addr)};
+    if (0 != getsockname(fd, reinterpret_cast<struct sockaddr *>(&addr), &addrlen) ||
+        AF_UNIX != addr.ss_family) {
+        return true;
+    }
+
+    // the client end sends it at once, so it all comes in the first segment
+    char magic[sizeof(SHM_MAGIC)];
+    ssize_t ret{UThreadRecv(*socket, magic, sizeof(magic), MSG_PEEK)};
+    if (0 >= ret)
+        return false;
+    if (sizeof(magic) != static_cast<size_t>(ret) || 0 != memcmp(magic, SHM_MAGIC, sizeof(magic)))
+        return true;
+    recv(fd, magic, sizeof(magic), 0);
+
+    ShmChannel *channel{0 < ring_size ? ShmChannel::Create(ring_size) : nullptr};
+    if (!SendOffer(fd, channel)) {
+        phxrpc::log(LOG_ERR, "%s sendmsg fd %d errno %d, %s", __func__, fd, errno, strerror(errno));
+        delete channel;
+
+        return false;
+    }
+
+    if (nullptr != channel)
+        stream->NewRdbuf(new UThreadShmStreamBuf(channel, tt, socket, stream->buf_size()));
+
+    return true;
+}
+
+
+}  // namespace phxrpc
+
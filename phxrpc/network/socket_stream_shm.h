@@ -0,0 +1,174 @@
+/*
+Tencent is pleased to support the open source community by making
+PhxRPC available.
+Copyright (C) 2016 THL A29 Limited, a Tencent company.
+All rights reserved.
+
+Licensed under the BSD 3-Clause License (the "License"); you may
+not use this file except in compliance with the License. You may
+obtain a copy of the License at
+
+https://opensource.org/licenses/BSD-3-Clause
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" basis,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+implied. See the License for the specific language governing
+permissions and limitations under the License.
+
+See the AUTHORS file for names of contributors.
+*/
+
+
+
+#pragma once
+
+#include <sys/uio.h>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+
+#include "phxrpc/network/socket_stream_base.h"
+#include "phxrpc/network/socket_stream_block.h"
+#include "phxrpc/network/socket_stream_uthread.h"
+
+
+namespace phxrpc {
+
+
+struct ShmRingHeader;
+
+// a pair of single producer single consumer byte rings in memory shared by the two
+// ends of a connection on the same host, one for each way; an end sleeps on its
+// eventfd only after saying so in the ring it reads, the other end signals it then only
+class ShmChannel final {
+  public:
+    // by the server end, ring_size is rounded up to a power of 2, nullptr on failure
+    static ShmChannel *Create(size_t ring_size);
+
+    // by the client end, on the fds sent by the server end, taken over even on failure
+    static ShmChannel *Attach(int mem_fd, int wait_fd, int peer_fd);
+
+    // the peer sees eof after what was written
+    ~ShmChannel();
+
+    // like recv on a non-blocking socket: -1 with EAGAIN if empty, 0 once the peer is gone,
+    // with EPROTO once the peer broke the ring
+    ssize_t Read(void *buf, size_t len);
+
+    // -1 with EAGAIN if full, with EPIPE once the peer is gone, with EPROTO as Read
+    ssize_t Writev(const struct iovec *iov, int iovcnt);
+
+    // says this end is to sleep on wait_fd, false if there is something to read already
+    bool PrepareSleep();
+
+    // resets wait_fd after it was signalled
+    void ClearWakeUps();
+
+    int mem_fd() const;
+    int wait_fd() const;
+    int peer_fd() const;
+
+  private:
+    ShmChannel(char *base, size_t map_size, size_t size, int mem_fd, int wait_fd, int peer_fd,
+               bool server_end);
+
+    ShmRingHeader *ring(int idx) const;
+
+    // the peer moved head or tail more than the size of the ring apart, closes both ways
+    ssize_t Break(const char *func, uint64_t head, uint64_t tail);
+
+    char *base_{nullptr};
+    size_t map_size_{0};
+    // of each ring as checked on Create or Attach, the one in shared memory is the peer's to change
+    size_t size_{0};
+    bool broken_{false};
+    int mem_fd_{-1};
+    int wait_fd_{-1};
+    int peer_fd_{-1};
+    ShmRingHeader *in_{nullptr};
+    ShmRingHeader *out_{nullptr};
+};
+
+//////////////////////////////////////////////////////
+
+class ShmStreamBuf : public BaseTcpStreamBuf {
+  public:
+    ShmStreamBuf(ShmChannel *channel, size_t buf_size);
+    virtual ~ShmStreamBuf();
+
+    ssize_t precv(void *buf, size_t len, int flags);
+    ssize_t psend(const void *buf, size_t len, int flags);
+    ssize_t psendv(const struct iovec *iov, int iovcnt, int flags);
+
+  protected:
+    // of the socket the rings were set up over, -1 for none
+    virtual int TimeoutMS() = 0;
+
+    // > 0 once wait_fd of the channel is signalled, 0 on timeout and < 0 on error with errno set
+    virtual int WaitSignal(int timeout_ms) = 0;
+
+    // a millisecond, while the ring to write is full, as the reader signals no room
+    virtual void Nap() = 0;
+
+    ShmChannel *channel_{nullptr};
+    // as the socket would set it on timeout
+    int timeout_errno_{ETIMEDOUT};
+};
+
+class BlockShmStreamBuf : public ShmStreamBuf {
+  public:
+    BlockShmStreamBuf(ShmChannel *channel, int socket, size_t buf_size);
+    virtual ~BlockShmStreamBuf();
+
+  protected:
+    int TimeoutMS();
+    int WaitSignal(int timeout_ms);
+    void Nap();
+
+  private:
+    int socket_;
+};
+
+class UThreadShmStreamBuf : public ShmStreamBuf {
+  public:
+    UThreadShmStreamBuf(ShmChannel *channel, UThreadEpollScheduler *scheduler,
+                        UThreadSocket_t *socket, size_t buf_size);
+    virtual ~UThreadShmStreamBuf();
+
+    void Adopt(UThreadEpollScheduler *scheduler);
+
+  protected:
+    int TimeoutMS();
+    int WaitSignal(int timeout_ms);
+    void Nap();
+
+  private:
+    UThreadSocket_t *socket_{nullptr};
+    // an epoll of wait_fd of the channel and the socket
+    int poll_fd_{-1};
+    UThreadSocket_t *wait_socket_{nullptr};
+    UThreadSocket_t *nap_socket_{nullptr};
+};
+
+///////////////////////////////////////////////////////
+
+// moves a stream on a Unix socket over to a ShmChannel, asked for by the client end with
+// the first bytes it sends; the socket stays open to tell the server end the peer is gone
+class ShmStreamUtils {
+  public:
+    // by the client end on a stream just connected, stays on the socket if the server
+    // end offers no rings
+    static bool Open(BlockTcpStream *stream, int timeout_ms);
+
+    static bool Open(UThreadEpollScheduler *tt, UThreadTcpStream *stream, int timeout_ms);
+
+    // by the server end on a stream just accepted, one not asking is left as it is,
+    // ring_size 0 offers none
+    static bool Accept(UThreadEpollScheduler *tt, UThreadTcpStream *stream, size_t ring_size);
+};
+
+
+}  // namespace phxrpc
+
@@ -41,6 +41,19 @@ ssize_t UThreadTcpStreamBuf::psend(const void *buf, size_t len, int flags) {
     return UThreadSend(*uthread_socket_, buf, len, flags);
 }
 
+ssize_t UThreadTcpStreamBuf::psendv(const struct iovec * iov, int iovcnt, int flags) {
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = const_cast<struct iovec *>(iov);
+    msg.msg_iovlen = iovcnt;
+
+    return UThreadSendmsg(*uthread_socket_, &msg, flags);
+}
+
+int UThreadTcpStreamBuf::pdrain() {
+    return UThreadWaitZeroCopy(*uthread_socket_);
+}
+
 ////////////////////////////////////////////////////////////
 
 UThreadTcpStream::UThreadTcpStream(size_t buf_size)
@@ -66,6 +79,15 @@ UThreadSocket_t * UThreadTcpStream::DetachSocket() {
     return socket;
 }
 
+UThreadSocket_t * UThreadTcpStream::GetSocket() {
+    return uthread_socket_;
+}
+
+void UThreadTcpStream::Adopt(UThreadEpollScheduler * scheduler) {
+    scheduler->AdoptSocket(uthread_socket_);
+    static_cast<BaseTcpStreamBuf *>(rdbuf())->Adopt(scheduler);
+}
+
 bool UThreadTcpStream::SetTimeout(int socket_timeout_ms) {
     UThreadSetSocketTimeout(*uthread_socket_, socket_timeout_ms);
     return true;
@@ -91,12 +113,6 @@ int UThreadTcpStream :: LastError() {
 
 bool UThreadTcpUtils::Open(UThreadEpollScheduler * tt, UThreadTcpStream * stream, const char * ip, unsigned short port,
                            int connect_timeout_ms) {
-    int fd = ::socket(AF_INET, SOCK_STREAM, IPPROTO_IP);
-
-    UThreadSocket_t * socket = tt->CreateSocket(fd);
-    assert(NULL != socket);
-    UThreadSetConnectTimeout(*socket, connect_timeout_ms);
-
     struct sockaddr_in in_addr;
     memset(&in_addr, 0, sizeof(in_addr));
 
@@ -104,7 +120,18 @@ bool UThreadTcpUtils::Open(UThreadEpollScheduler * tt, UThreadTcpStream * stream
     in_addr.sin_addr.s_addr = inet_addr(ip);
     in_addr.sin_port = htons(port);
 
-    int ret = UThreadConnect(*socket, (struct sockaddr*) &in_addr, sizeof(in_addr));
+    return Open(tt, stream, (struct sockaddr*) &in_addr, sizeof(in_addr), connect_timeout_ms);
+}
+
+bool UThreadTcpUtils::Open(UThreadEpollScheduler * tt, UThreadTcpStream * stream, const struct sockaddr * addr,
+                           socklen_t addrlen, int connect_timeout_ms) {
+    int fd = ::socket(addr->sa_family, SOCK_STREAM, IPPROTO_IP);
+
+    UThreadSocket_t * socket = tt->CreateSocket(fd);
+    assert(NULL != socket);
+    UThreadSetConnectTimeout(*socket, connect_timeout_ms);
+
+    int ret = UThreadConnect(*socket, addr, addrlen);
     if (0 == ret) {
         stream->Attach(socket);
     } else {
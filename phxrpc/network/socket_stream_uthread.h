@@ -34,6 +34,8 @@ class UThreadTcpStreamBuf : public BaseTcpStreamBuf {
 
     ssize_t precv(void * buf, size_t len, int flags);
     ssize_t psend(const void *buf, size_t len, int flags);
+    ssize_t psendv(const struct iovec * iov, int iovcnt, int flags);
+    int pdrain();
 
  private:
     UThreadSocket_t * uthread_socket_;
@@ -50,6 +52,12 @@ class UThreadTcpStream : public BaseTcpStream {
 
     UThreadSocket_t * DetachSocket();
 
+    UThreadSocket_t * GetSocket();
+
+    // moves it over to scheduler, with the waits of its stream buf, for a stream kept
+    // open after the scheduler it was made in, e.g. a pooled one
+    void Adopt(UThreadEpollScheduler * scheduler);
+
     bool SetTimeout(int socket_timeout_ms);
 
     int SocketFd();
@@ -66,6 +74,10 @@ class UThreadTcpUtils {
  public:
     static bool Open(UThreadEpollScheduler * tt, UThreadTcpStream* stream, const char * ip, unsigned short port,
                      int connect_timeout_ms);
+
+    // connects to an address resolved beforehand
+    static bool Open(UThreadEpollScheduler * tt, UThreadTcpStream * stream, const struct sockaddr * addr,
+                     socklen_t addrlen, int connect_timeout_ms);
 };
 
 }
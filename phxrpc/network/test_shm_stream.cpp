@@ -0,0 +1,200 @@
+/*
+Tencent is pleased to support the open source community by making 
+PhxRPC available.
+Copyright (C) 2016 THL A29 Limited, a Tencent company. 
+All rights reserved.
+
+Licensed under the BSD 3-Clause License (the "License"); you may 
+not use this file except in compliance with the License. You may 
+obtain a copy of the License at
+
+https://opensource.org/licenses/BSD-3-Clause
+
+Unless required by applicable law or agreed to in writing, software 
+distributed under the License is distributed on an "AS IS" basis, 
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or 
+implied. See the License for the specific language governing 
+permissions and limitations under the License.
+
+See the AUTHORS file for names of contributors.
+*/
+
+#include <assert.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/un.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <string>
+#include <thread>
+
+#include "socket_stream_block.h"
+#include "socket_stream_shm.h"
+#include "socket_stream_uthread.h"
+#include "timer.h"
+#include "uthread_epoll.h"
+
+using namespace phxrpc;
+
+// round trips of a message over TCP loopback, a Unix socket and a ShmChannel on it
+
+const unsigned short PORT = 16262;
+const char * PATH = "/tmp/test_shm_stream.sock";
+const size_t RING_SIZE = 1024 * 1024;
+
+size_t msg_size = 0;
+
+void echoserver(void * args) {
+    UThreadEpollArgs_t * tt = (UThreadEpollArgs_t*) args;
+
+    UThreadTcpStream stream;
+    stream.Attach(tt->first->CreateSocket(tt->second));
+
+    if (ShmStreamUtils::Accept(tt->first, &stream, RING_SIZE)) {
+        std::string msg(msg_size, '\0');
+        while (stream.read(&msg[0], msg_size).good()) {
+            stream.write(msg.data(), msg_size);
+            if (!stream.flush().good())
+                break;
+        }
+    }
+
+    free(tt);
+}
+
+void echoaccept(void * args) {
+    UThreadEpollArgs_t * tt = (UThreadEpollArgs_t*) args;
+
+    UThreadSocket_t * acceptor = tt->first->CreateSocket(tt->second);
+
+    for (;;) {
+        int fd = UThreadAccept(*acceptor, NULL, NULL);
+        if (fd >= 0) {
+            UThreadEpollArgs_t * ct = (UThreadEpollArgs_t*) calloc(1, sizeof(UThreadEpollArgs_t));
+            ct->first = tt->first;
+            ct->second = fd;
+
+            tt->first->AddTask(echoserver, ct);
+        }
+    }
+}
+
+void serve(int tcp_fd, int unix_fd) {
+    UThreadEpollScheduler scheduler(64 * 1024, 16);
+
+    int fds[] = { tcp_fd, unix_fd };
+    for (int fd : fds) {
+        UThreadEpollArgs_t * args = (UThreadEpollArgs_t*) calloc(1, sizeof(UThreadEpollArgs_t));
+        args->first = &scheduler;
+        args->second = fd;
+
+        scheduler.AddTask(echoaccept, args);
+    }
+
+    scheduler.Run();
+}
+
+void bench(const char * name, int times, bool on_unix, bool shm) {
+    BlockTcpStream stream;
+
+    bool ok = false;
+    if (on_unix) {
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", PATH);
+
+        ok = BlockTcpUtils::Open(&stream, (struct sockaddr*) &addr, sizeof(addr), 1000)
+                && (!shm || ShmStreamUtils::Open(&stream, 1000));
+    } else {
+        ok = BlockTcpUtils::Open(&stream, "127.0.0.1", PORT, 1000, NULL, 0);
+    }
+    if (!ok) {
+        printf("%s connect fail\n", name);
+        return;
+    }
+    stream.SetTimeout(5000);
+
+    std::string msg(msg_size, 'x'), back(msg_size, '\0');
+
+    uint64_t begin = Timer::GetSteadyClockUS();
+    for (int i = 0; i < times; i++) {
+        stream.write(msg.data(), msg_size);
+        if (!stream.flush().good() || !stream.read(&back[0], msg_size).good()) {
+            printf("%s round trip %d fail, errno %d, %s\n", name, i, errno, strerror(errno));
+            return;
+        }
+        assert(msg == back);
+    }
+    uint64_t cost = Timer::GetSteadyClockUS() - begin;
+
+    printf("%-5s %d round trips of %zu bytes, avg %.1f us\n", name, times, msg_size,
+           (double) cost / times);
+}
+
+// a peer moving head or tail of a ring too far is refused, nothing is copied
+void broken() {
+    ShmChannel * channel = ShmChannel::Create(4096);
+    assert(NULL != channel);
+
+    size_t map_size = 2 * (192 + 4096);
+    char * peer = (char *) mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, channel->mem_fd(), 0);
+    assert(MAP_FAILED != peer);
+
+    // head of ring 0 at offset 0, read by the server end, past what the ring holds
+    *(uint64_t *) peer = 3 * 4096;
+    char buf[64];
+    assert(-1 == channel->Read(buf, sizeof(buf)) && EPROTO == errno);
+
+    struct iovec iov;
+    iov.iov_base = buf;
+    iov.iov_len = sizeof(buf);
+    assert(-1 == channel->Writev(&iov, 1) && EPROTO == errno);
+    delete channel;
+
+    channel = ShmChannel::Create(4096);
+    munmap(peer, map_size);
+    peer = (char *) mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, channel->mem_fd(), 0);
+    assert(MAP_FAILED != peer);
+
+    // tail of ring 1 at offset 64, written by the server end, ahead of head
+    *(uint64_t *) (peer + map_size / 2 + 64) = 1;
+    assert(-1 == channel->Writev(&iov, 1) && EPROTO == errno);
+    delete channel;
+
+    munmap(peer, map_size);
+
+    printf("broken rings refused\n");
+}
+
+int main(int argc, char * argv[]) {
+    if (argc < 3) {
+        printf("Usage: %s <round trips> <message bytes>\n", argv[0]);
+        return 0;
+    }
+
+    int times = atoi(argv[1]);
+    msg_size = atoi(argv[2]);
+
+    broken();
+
+    int tcp_fd = -1, unix_fd = -1;
+    if (!BlockTcpUtils::Listen(&tcp_fd, "127.0.0.1", PORT) || !BlockTcpUtils::ListenUnix(&unix_fd, PATH)) {
+        printf("listen fail\n");
+        return -1;
+    }
+
+    std::thread(serve, tcp_fd, unix_fd).detach();
+
+    bench("tcp", times, false, false);
+    bench("unix", times, true, false);
+    bench("shm", times, true, true);
+
+    unlink(PATH);
+
+    return 0;
+}
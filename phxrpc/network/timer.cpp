@@ -52,6 +52,12 @@ const uint64_t Timer::GetSteadyClockMS() {
     return now;
 }
 
+const uint64_t Timer::GetSteadyClockUS() {
+    auto now_time = chrono::steady_clock::now();
+    uint64_t now = (chrono::duration_cast<chrono::microseconds>(now_time.time_since_epoch())).count();
+    return now;
+}
+
 void Timer::MsSleep(const int time_ms) {
     timespec t;
     t.tv_sec = time_ms / 1000;
@@ -128,7 +134,8 @@ void Timer::RemoveTimer(const size_t timer_id) {
     std::swap(timer_heap_[timer_heap_.size() - 1], timer_heap_[now_idx]);
     timer_heap_.pop_back();
 
-    if (timer_heap_.empty()) {
+    // it was the last one, nothing moved into its place
+    if (now_idx == timer_heap_.size()) {
         return;
     }
 
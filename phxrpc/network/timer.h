@@ -43,6 +43,7 @@ class Timer final {
     const bool empty();
     static const uint64_t GetTimestampMS();
     static const uint64_t GetSteadyClockMS();
+    static const uint64_t GetSteadyClockUS();
     static void MsSleep(const int time_ms);
     std::vector<UThreadSocket_t *> GetSocketList();
 
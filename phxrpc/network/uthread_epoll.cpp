@@ -40,9 +40,15 @@ See the AUTHORS file for names of contributors.
 #ifdef __APPLE__
 #include "epoll-darwin.h"
 #else
+#include <linux/errqueue.h>
+#include <netinet/in.h>
 #include <sys/epoll.h>
 #endif
 
+#if defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY) && defined(SO_EE_ORIGIN_ZEROCOPY)
+#define PHXRPC_ZERO_COPY
+#endif
+
 #include "phxrpc/comm.h"
 #include "phxrpc/file/log_utils.h"
 #include "phxrpc/network/socket_stream_base.h"
@@ -68,6 +74,16 @@ typedef struct tagUThreadSocket {
     size_t timer_id;
     struct epoll_event event;
     void * args;
+
+    // see UThreadSetZeroCopy, sends and done count sendmsg calls as the kernel does
+    size_t zero_copy_min_bytes;
+    uint32_t zero_copy_sends;
+    uint32_t zero_copy_done;
+    bool zero_copy_copied;
+    // out of optmem, copies until the notifications are reaped
+    bool zero_copy_paused;
+    size_t zero_copy_pending_bytes;
+    size_t zero_copy_bytes;
 } UThreadSocket_t;
 
 EpollNotifier::EpollNotifier(UThreadEpollScheduler *scheduler)
@@ -292,6 +308,11 @@ UThreadSocket_t *UThreadEpollScheduler::CreateSocket(const int fd,
     return socket;
 }
 
+void UThreadEpollScheduler::AdoptSocket(UThreadSocket_t *socket) {
+    socket->scheduler = this;
+    socket->epoll_fd = epoll_fd_;
+}
+
 void UThreadEpollScheduler::ConsumeTodoList() {
     while (!todo_list_.empty()) {
         auto & it = todo_list_.front();
@@ -346,7 +367,8 @@ bool UThreadEpollScheduler::Run() {
     int next_timeout = timer_.GetNextTimeout();
 
     for (; (run_forever_) || (!runtime_.IsAllDone());) {
-        int nfds = epoll_wait(epoll_fd_, events, max_task_, 4);
+        // tasks added by a uthread resumed on timeout are not to wait for the next round
+        int nfds = epoll_wait(epoll_fd_, events, max_task_, todo_list_.empty() ? 4 : 0);
         if (nfds != -1) {
             for (int i = 0; i < nfds; i++) {
                 UThreadSocket_t * socket = (UThreadSocket_t*) events[i].data.ptr;
@@ -586,6 +608,157 @@ ssize_t UThreadSend(UThreadSocket_t &socket, const void *buf, size_t len, const
     return ret;
 }
 
+static ssize_t UThreadSendmsgOnce(UThreadSocket_t &socket, const struct msghdr *msg, const int flags) {
+    int ret = sendmsg(socket.socket, msg, flags);
+
+    if (ret < 0 && EAGAIN == errno) {
+        int revents = 0;
+        if (UThreadPoll(socket, EPOLLOUT, &revents, socket.socket_timeout_ms) > 0) {
+            ret = sendmsg(socket.socket, msg, flags);
+        } else {
+            ret = -1;
+        }
+    }
+
+    return ret;
+}
+
+ssize_t UThreadSendmsg(UThreadSocket_t &socket, const struct msghdr *msg, const int flags) {
+    int send_flags = flags;
+#ifdef PHXRPC_ZERO_COPY
+    if (0 < socket.zero_copy_min_bytes && !socket.zero_copy_paused) {
+        size_t len = 0;
+        for (size_t i = 0; msg->msg_iovlen > i; i++) {
+            len += msg->msg_iov[i].iov_len;
+        }
+        if (socket.zero_copy_min_bytes <= len) {
+            send_flags |= MSG_ZEROCOPY;
+        }
+    }
+#endif
+
+    int ret = UThreadSendmsgOnce(socket, msg, send_flags);
+
+#ifdef PHXRPC_ZERO_COPY
+    if (send_flags != flags) {
+        if (ret < 0 && ENOBUFS == errno) {
+            // out of optmem for the notifications, the rest of this send is a copy
+            socket.zero_copy_paused = true;
+            send_flags = flags;
+            ret = UThreadSendmsgOnce(socket, msg, send_flags);
+        } else if (ret > 0) {
+            socket.zero_copy_sends++;
+            socket.zero_copy_pending_bytes += ret;
+        }
+    }
+#endif
+
+    return ret;
+}
+
+bool UThreadSetZeroCopy(UThreadSocket_t &socket, const size_t min_bytes) {
+#ifdef PHXRPC_ZERO_COPY
+    if (0 < min_bytes) {
+        int on = 1;
+        if (0 != setsockopt(socket.socket, SOL_SOCKET, SO_ZEROCOPY, &on, sizeof(on))) {
+            socket.zero_copy_min_bytes = 0;
+
+            return false;
+        }
+    }
+    socket.zero_copy_min_bytes = min_bytes;
+
+    return true;
+#else
+    socket.zero_copy_min_bytes = 0;
+
+    return 0 == min_bytes;
+#endif
+}
+
+#ifdef PHXRPC_ZERO_COPY
+// how many completions were taken off the error queue, -1 on a socket error
+static int UThreadReapZeroCopy(UThreadSocket_t &socket) {
+    int reaped = 0;
+
+    while (true) {
+        char control[128];
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        if (recvmsg(socket.socket, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+            return (EAGAIN == errno || EWOULDBLOCK == errno) ? reaped : -1;
+        }
+
+        for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); nullptr != cmsg;
+             cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            if (!(SOL_IP == cmsg->cmsg_level && IP_RECVERR == cmsg->cmsg_type) &&
+                !(SOL_IPV6 == cmsg->cmsg_level && IPV6_RECVERR == cmsg->cmsg_type)) {
+                continue;
+            }
+
+            const struct sock_extended_err *err =
+                    reinterpret_cast<const struct sock_extended_err *>(CMSG_DATA(cmsg));
+            if (SO_EE_ORIGIN_ZEROCOPY != err->ee_origin) {
+                continue;
+            }
+
+            // the sends numbered ee_info through ee_data
+            socket.zero_copy_done += err->ee_data - err->ee_info + 1;
+            if (SO_EE_CODE_ZEROCOPY_COPIED & err->ee_code) {
+                socket.zero_copy_copied = true;
+            }
+            reaped++;
+        }
+    }
+}
+#endif
+
+int UThreadWaitZeroCopy(UThreadSocket_t &socket) {
+#ifdef PHXRPC_ZERO_COPY
+    while (socket.zero_copy_done != socket.zero_copy_sends) {
+        int ret = UThreadReapZeroCopy(socket);
+        if (0 == ret) {
+            // completions show up as EPOLLERR, as a socket error would
+            int revents = 0;
+            if (UThreadPoll(socket, EPOLLERR, &revents, socket.socket_timeout_ms) > 0) {
+                ret = UThreadReapZeroCopy(socket);
+            }
+        }
+
+        if (0 >= ret) {
+            // the buffers are the kernel's for as long as it keeps the data,
+            // a reset on close drops it
+            struct linger lg;
+            lg.l_onoff = 1;
+            lg.l_linger = 0;
+            setsockopt(socket.socket, SOL_SOCKET, SO_LINGER, &lg, sizeof(lg));
+            socket.zero_copy_min_bytes = 0;
+            errno = ETIMEDOUT;
+
+            return -1;
+        }
+    }
+
+    if (socket.zero_copy_copied) {
+        // the kernel copied anyway, as over loopback, no use paying for the notifications
+        socket.zero_copy_min_bytes = 0;
+    } else {
+        socket.zero_copy_bytes += socket.zero_copy_pending_bytes;
+    }
+    socket.zero_copy_pending_bytes = 0;
+    socket.zero_copy_paused = false;
+#endif
+
+    return 0;
+}
+
+size_t UThreadZeroCopyBytes(UThreadSocket_t &socket) {
+    return socket.zero_copy_bytes;
+}
+
 int UThreadClose(UThreadSocket_t &socket) {
     if (socket.socket >= 0) {
         return close(socket.socket);
@@ -605,6 +778,10 @@ int UThreadSocketFd(UThreadSocket_t &socket) {
     return socket.socket;
 }
 
+int UThreadSocketTimeout(UThreadSocket_t &socket) {
+    return socket.socket_timeout_ms;
+}
+
 size_t UThreadSocketTimerID(UThreadSocket_t &socket) {
     return socket.timer_id;
 }
@@ -633,6 +810,20 @@ void UThreadWait(UThreadSocket_t &socket, const int timeout_ms) {
     socket.scheduler->RemoveTimer(socket.timer_id);
 }
 
+UThreadSocket_t *NewUThreadWaiter(UThreadEpollScheduler *scheduler) {
+    UThreadSocket_t *socket = (UThreadSocket_t *)calloc(1, sizeof(UThreadSocket_t));
+    socket->scheduler = scheduler;
+    socket->socket = -1;
+    return socket;
+}
+
+void UThreadWakeUp(UThreadSocket_t &socket) {
+    // its timer goes off at once, the next round of the scheduler resumes it
+    if (0 != socket.timer_id) {
+        socket.scheduler->AddTimer(&socket, 0);
+    }
+}
+
 void UThreadLazyDestory(UThreadSocket_t &socket) {
     socket.uthread_id = -1;
 }
@@ -22,9 +22,11 @@ See the AUTHORS file for names of contributors.
 #pragma once
 
 #include <arpa/inet.h>
+#include <sys/socket.h>
 
 #include <map>
 #include <queue>
+#include <string>
 #include <vector>
 
 #include "phxrpc/network/timer.h"
@@ -106,6 +108,9 @@ class UThreadEpollScheduler final {
     UThreadSocket_t *CreateSocket(const int fd, const int socket_timeout_ms = 5000,
             const int connect_timeout_ms = 200, const bool no_delay = true);
 
+    // takes over a socket created by another scheduler, it must not be waiting on that one
+    void AdoptSocket(UThreadSocket_t *socket);
+
     void SetActiveSocketFunc(UThreadActiveSocket_t active_socket_func);
 
     void SetHandlerAcceptedFdFunc(UThreadHandlerAcceptedFdFunc_t handler_accepted_fd_func);
@@ -190,6 +195,19 @@ ssize_t UThreadRead(UThreadSocket_t &socket, void *buf, size_t len, const int fl
 
 ssize_t UThreadSend(UThreadSocket_t &socket, const void *buf, size_t len, const int flags);
 
+ssize_t UThreadSendmsg(UThreadSocket_t &socket, const struct msghdr *msg, const int flags);
+
+// sendmsg of min_bytes or more on socket goes with MSG_ZEROCOPY from here on, 0 to stop,
+// false if the kernel or socket does not support it
+bool UThreadSetZeroCopy(UThreadSocket_t &socket, const size_t min_bytes);
+
+// yields till the kernel is done with the buffers of the zero-copy sends on socket,
+// taking their completions off the error queue, -1 past the socket timeout
+int UThreadWaitZeroCopy(UThreadSocket_t &socket);
+
+// sent on socket with no copy so far
+size_t UThreadZeroCopyBytes(UThreadSocket_t &socket);
+
 int UThreadClose(UThreadSocket_t &socket);
 
 void UThreadSetConnectTimeout(UThreadSocket_t &socket, const int connect_timeout_ms);
@@ -198,6 +216,8 @@ void UThreadSetSocketTimeout(UThreadSocket_t &socket, const int socket_timeout_m
 
 int UThreadSocketFd(UThreadSocket_t &socket);
 
+int UThreadSocketTimeout(UThreadSocket_t &socket);
+
 size_t UThreadSocketTimerID(UThreadSocket_t &socket);
 
 void UThreadSocketSetTimerID(UThreadSocket_t &socket, size_t timer_id);
@@ -210,6 +230,13 @@ void *UThreadGetArgs(UThreadSocket_t &socket);
 
 void UThreadWait(UThreadSocket_t &socket, const int timeout_ms);
 
+// no fd, only for a uthread to UThreadWait on, free() it when done
+UThreadSocket_t *NewUThreadWaiter(UThreadEpollScheduler *scheduler);
+
+// ends the UThreadWait on socket of another uthread of the same scheduler early,
+// nothing if none is waiting
+void UThreadWakeUp(UThreadSocket_t &socket);
+
 void UThreadLazyDestory(UThreadSocket_t &socket);
 
 bool IsUThreadDestory(UThreadSocket_t &socket);
@@ -21,14 +21,26 @@ See the AUTHORS file for names of contributors.
 
 #pragma once
 
+#include "rpc/cache_table.h"
+#include "rpc/call_batcher.h"
 #include "rpc/caller.h"
 #include "rpc/client_config.h"
 #include "rpc/client_monitor.h"
+#include "rpc/client_runtime.h"
+#include "rpc/connection_pool.h"
+#include "rpc/content_coding.h"
+#include "rpc/etag.h"
+#include "rpc/hedged_caller.h"
 #include "rpc/hsha_server.h"
+#include "rpc/load_balancer.h"
 #include "rpc/monitor_factory.h"
 #include "rpc/phxrpc.pb.h"
+#include "rpc/pipelined_connection.h"
+#include "rpc/response_cache.h"
 #include "rpc/server_config.h"
 #include "rpc/server_monitor.h"
+#include "rpc/server_response_cache.h"
 #include "rpc/socket_stream_phxrpc.h"
+#include "rpc/stream_reader.h"
 #include "rpc/uthread_caller.h"
 
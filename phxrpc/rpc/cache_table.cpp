@@ -0,0 +1,215 @@
+/*
+Tencent is pleased to support the open source community by making
+PhxRPC available.
+Copyright (C) 2016 THL A29 Limited, a Tencent company.
+All rights reserved.
+
+Licensed under the BSD 3-Clause License (the "License"); you may
+not use this file except in compliance with the License. You may
+obtain a copy of the License at
+
+https://opensource.org/licenses/BSD-3-Clause
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" basis,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+implied. See the License for the specific language governing
+permissions and limitations under the License.
+
+See the AUTHORS file for names of contributors.
+*/
+
+
+
+#include "cache_table.h"
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <vector>
+
+#include "phxrpc/file/log_utils.h"
+#include "phxrpc/network.h"
+
+
+namespace phxrpc {
+
+
+using namespace std;
+
+
+class CacheTable::Flight {
+  public:
+    Flight(Shard *shard, const string &key, UThreadEpollScheduler *scheduler)
+            : shard(shard), key(key), scheduler(scheduler) {}
+
+    Shard *shard{nullptr};
+    const string key;
+    // of the uthread filling it, nullptr for a thread
+    UThreadEpollScheduler *scheduler{nullptr};
+
+    bool done{false};
+    int ret{-1};
+    string value;
+    // threads waiting
+    condition_variable cond;
+    // uthreads of scheduler waiting, Fill is in the same thread as them
+    vector<UThreadSocket_t *> waiters;
+    // eventfds of uthreads waiting in other threads
+    vector<int> wait_fds;
+};
+
+
+CacheTable::CacheTable() {
+}
+
+CacheTable::~CacheTable() {
+}
+
+void CacheTable::set_max_entries(const int max_entries) {
+    max_entries_ = max_entries;
+}
+
+int CacheTable::max_entries() const {
+    return max_entries_;
+}
+
+CacheSource CacheTable::Lookup(const string &key, const int max_stale_ms,
+                               UThreadEpollScheduler *scheduler, const int timeout_ms,
+                               string *value, shared_ptr<Flight> *flight, int *ret) {
+    Shard *shard{&shards_[hash<string>()(key) % SHARD_COUNT]};
+    shared_ptr<Flight> in_flight;
+    UThreadSocket_t *waiter{nullptr};
+    int wait_fd{-1};
+    {
+        lock_guard<mutex> lock(shard->mutex);
+
+        auto it(shard->entries.find(key));
+        if (shard->entries.end() != it) {
+            const uint64_t now{Timer::GetSteadyClockMS()};
+            if (now < it->second.expire_ms + max_stale_ms) {
+                shard->lru.splice(shard->lru.begin(), shard->lru, it->second.lru);
+                *value = it->second.value;
+                *ret = 0;
+
+                return now < it->second.expire_ms ? CacheSource::HIT : CacheSource::STALE;
+            }
+        }
+
+        auto &flight_of_key(shard->flights[key]);
+        if (!flight_of_key) {
+            flight_of_key.reset(new Flight(shard, key, scheduler));
+            *flight = flight_of_key;
+
+            return CacheSource::MISS;
+        }
+        in_flight = flight_of_key;
+
+        // woken up by Fill, a uthread of another thread through an eventfd
+        if (nullptr != scheduler && scheduler == in_flight->scheduler) {
+            waiter = NewUThreadWaiter(scheduler);
+            in_flight->waiters.push_back(waiter);
+        } else if (nullptr != scheduler) {
+            wait_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            if (0 <= wait_fd) {
+                in_flight->wait_fds.push_back(wait_fd);
+            } else {
+                log(LOG_ERR, "%s eventfd errno %d, %s", __func__, errno, strerror(errno));
+            }
+        }
+    }
+
+    bool done{false};
+    if (nullptr == scheduler) {
+        unique_lock<mutex> lock(shard->mutex);
+        done = in_flight->cond.wait_for(lock, chrono::milliseconds(timeout_ms),
+                                        [&]() { return in_flight->done; });
+    } else {
+        if (nullptr != waiter) {
+            UThreadWait(*waiter, timeout_ms);
+        } else if (0 <= wait_fd) {
+            UThreadSocket_t *socket{scheduler->CreateSocket(wait_fd, -1, -1, false)};
+            int revents{0};
+            UThreadPoll(*socket, EPOLLIN, &revents, timeout_ms);
+            free(socket);
+        }
+
+        lock_guard<mutex> lock(shard->mutex);
+        done = in_flight->done;
+        // not to be woken up any more past the timeout
+        auto &waiters(in_flight->waiters);
+        waiters.erase(remove(waiters.begin(), waiters.end(), waiter), waiters.end());
+        auto &wait_fds(in_flight->wait_fds);
+        wait_fds.erase(remove(wait_fds.begin(), wait_fds.end(), wait_fd), wait_fds.end());
+    }
+    free(waiter);
+    if (0 <= wait_fd)
+        close(wait_fd);
+
+    if (!done) {
+        // the flight is slow or stuck, this one goes on its own rather than wait longer
+        flight->reset(new Flight(shard, key, scheduler));
+
+        return CacheSource::MISS;
+    }
+
+    // done, no one writes to it any more
+    *ret = in_flight->ret;
+    *value = in_flight->value;
+
+    return CacheSource::COALESCED;
+}
+
+void CacheTable::Fill(const shared_ptr<Flight> &flight, const int ret, const string &value,
+                      const int ttl_ms) {
+    Shard *shard{flight->shard};
+
+    lock_guard<mutex> lock(shard->mutex);
+    if (0 == ret)
+        Put(shard, flight->key, value, ttl_ms);
+    // one of a caller that gave up waiting is not in flights
+    auto it(shard->flights.find(flight->key));
+    if (shard->flights.end() != it && flight == it->second)
+        shard->flights.erase(it);
+
+    flight->ret = ret;
+    flight->value = value;
+    flight->done = true;
+    flight->cond.notify_all();
+    for (auto waiter : flight->waiters)
+        UThreadWakeUp(*waiter);
+    flight->waiters.clear();
+    for (int wait_fd : flight->wait_fds)
+        eventfd_write(wait_fd, 1);
+    flight->wait_fds.clear();
+}
+
+void CacheTable::Put(Shard *shard, const string &key, const string &value, const int ttl_ms) {
+    auto &entry(shard->entries[key]);
+    if (0 != entry.expire_ms)
+        shard->lru.erase(entry.lru);
+
+    entry.value = value;
+    entry.expire_ms = Timer::GetSteadyClockMS() + ttl_ms;
+    shard->lru.push_front(&shard->entries.find(key)->first);
+    entry.lru = shard->lru.begin();
+
+    const size_t max_entries{static_cast<size_t>(max(1, max_entries_ / SHARD_COUNT))};
+    while (shard->entries.size() > max_entries) {
+        const string *oldest{shard->lru.back()};
+        shard->lru.pop_back();
+        shard->entries.erase(shard->entries.find(*oldest));
+    }
+}
+
+
+}  // namespace phxrpc
+
@@ -0,0 +1,103 @@
+/*
+Tencent is pleased to support the open source community by making
+PhxRPC available.
+Copyright (C) 2016 THL A29 Limited, a Tencent company.
+All rights reserved.
+
+Licensed under the BSD 3-Clause License (the "License"); you may
+not use this file except in compliance with the License. You may
+obtain a copy of the License at
+
+https://opensource.org/licenses/BSD-3-Clause
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" basis,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+implied. See the License for the specific language governing
+permissions and limitations under the License.
+
+See the AUTHORS file for names of contributors.
+*/
+
+
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+
+namespace phxrpc {
+
+
+class UThreadEpollScheduler;
+
+enum class CacheSource {
+    // found and fresh
+    HIT,
+    // found and expired, but still within the staleness allowed
+    STALE,
+    // to be filled by the caller, who got a flight to Fill
+    MISS,
+    // waited for the flight of someone else with the same key
+    COALESCED,
+};
+
+// bytes kept for a ttl, up to max_entries of them, least recently used out first, and
+// one flight at a time filling a key, the others looking it up meanwhile wait for it,
+// for the response caches of clients and servers
+class CacheTable {
+  public:
+    class Flight;
+
+    CacheTable();
+    ~CacheTable();
+
+    void set_max_entries(const int max_entries);
+    // 0 if the cache is off
+    int max_entries() const;
+
+    // *value of key if fresh, or expired less than max_stale_ms ago, else waits up to
+    // timeout_ms for the flight filling it, in a uthread of scheduler if it is not nullptr,
+    // then *ret and *value are what it was filled with, if none is filling it, or it is
+    // not filled in time, *flight is one to Fill
+    CacheSource Lookup(const std::string &key, const int max_stale_ms,
+                       UThreadEpollScheduler *scheduler, const int timeout_ms,
+                       std::string *value, std::shared_ptr<Flight> *flight, int *ret);
+
+    // value is kept for ttl_ms if ret is 0, those waiting for flight get both
+    void Fill(const std::shared_ptr<Flight> &flight, const int ret, const std::string &value,
+              const int ttl_ms);
+
+  private:
+    struct Entry {
+        std::string value;
+        uint64_t expire_ms{0};
+        std::list<const std::string *>::iterator lru;
+    };
+
+    // a lock of its own, for lookups of different keys not to contend
+    struct Shard {
+        std::mutex mutex;
+        std::unordered_map<std::string, Entry> entries;
+        // keys of entries, the most recently used first
+        std::list<const std::string *> lru;
+        std::unordered_map<std::string, std::shared_ptr<Flight>> flights;
+    };
+
+    static const int SHARD_COUNT = 16;
+
+    void Put(Shard *shard, const std::string &key, const std::string &value, const int ttl_ms);
+
+    std::atomic_int max_entries_{0};
+    Shard shards_[SHARD_COUNT];
+};
+
+
+}  // namespace phxrpc
+
@@ -0,0 +1,126 @@
+/*
+Tencent is pleased to support the open source community by making
+PhxRPC available.
+Copyright (C) 2016 THL A29 Limited, a Tencent company.
+All rights reserved.
+
+Licensed under the BSD 3-Clause License (the "License"); you may
+not use this file except in compliance with the License. You may
+obtain a copy of the License at
+
+https://opensource.org/licenses/BSD-3-Clause
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" basis,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+implied. See the License for the specific language governing
+permissions and limitations under the License.
+
+See the AUTHORS file for names of contributors.
+*/
+
+
+
+#include "call_batcher.h"
+
+#include <chrono>
+#include <condition_variable>
+
+#include <google/protobuf/message.h>
+
+#include "phxrpc.pb.h"
+
+#include "phxrpc/file.h"
+
+
+namespace phxrpc {
+
+
+using namespace std;
+
+
+struct CallBatcher::Batch {
+    BatchRequest req;
+    BatchResponse resp;
+    int ret{-1};
+    bool done{false};
+    condition_variable cond;
+};
+
+
+CallBatcher::CallBatcher(const char *uri, const BatchPolicy &policy, FlushFunc flush)
+        : uri_(uri), policy_(policy), flush_(flush) {
+}
+
+CallBatcher::~CallBatcher() {
+}
+
+int CallBatcher::Call(const google::protobuf::Message &req, google::protobuf::Message *resp) {
+    string request;
+    if (!req.SerializeToString(&request)) {
+        log(LOG_ERR, "%s %s SerializeToString err", __func__, uri_.c_str());
+
+        return -1;
+    }
+
+    unique_lock<mutex> lock(mutex_);
+
+    shared_ptr<Batch> batch(open_);
+    const bool opener{!batch};
+    if (opener) {
+        batch.reset(new Batch);
+        batch->req.set_uri(uri_);
+        open_ = batch;
+    }
+
+    const int index{batch->req.requests_size()};
+    batch->req.add_requests()->swap(request);
+    if (policy_.max_size <= batch->req.requests_size()) {
+        open_.reset();
+        batch->cond.notify_all();
+    }
+
+    if (opener) {
+        batch->cond.wait_for(lock, chrono::milliseconds(policy_.window_ms),
+                             [&]() { return open_ != batch; });
+        if (open_ == batch)
+            open_.reset();
+
+        // no one adds to it any more
+        lock.unlock();
+        batch->ret = flush_(batch->req, &batch->resp);
+        lock.lock();
+
+        batch->done = true;
+        batch->cond.notify_all();
+    } else {
+        batch->cond.wait(lock, [&]() { return batch->done; });
+    }
+    lock.unlock();
+
+    if (0 != batch->ret) {
+        log(LOG_ERR, "%s %s batch of %d err %d", __func__, uri_.c_str(),
+            batch->req.requests_size(), batch->ret);
+
+        return batch->ret;
+    }
+
+    if (batch->resp.results_size() <= index || batch->resp.responses_size() <= index) {
+        log(LOG_ERR, "%s %s %d responses to a batch of %d", __func__, uri_.c_str(),
+            batch->resp.responses_size(), batch->req.requests_size());
+
+        return -1;
+    }
+
+    if (!resp->ParseFromString(batch->resp.responses(index))) {
+        log(LOG_ERR, "%s %s ParseFromString err", __func__, uri_.c_str());
+
+        return -1;
+    }
+
+    return batch->resp.results(index);
+}
+
+
+}  // namespace phxrpc
+
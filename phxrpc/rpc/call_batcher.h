@@ -0,0 +1,85 @@
+/*
+Tencent is pleased to support the open source community by making
+PhxRPC available.
+Copyright (C) 2016 THL A29 Limited, a Tencent company.
+All rights reserved.
+
+Licensed under the BSD 3-Clause License (the "License"); you may
+not use this file except in compliance with the License. You may
+obtain a copy of the License at
+
+https://opensource.org/licenses/BSD-3-Clause
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" basis,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+implied. See the License for the specific language governing
+permissions and limitations under the License.
+
+See the AUTHORS file for names of contributors.
+*/
+
+
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+
+
+namespace google {
+
+namespace protobuf {
+
+
+class Message;
+
+
+}
+
+}
+
+
+namespace phxrpc {
+
+
+class BatchRequest;
+class BatchResponse;
+
+struct BatchPolicy {
+    // how long the first call of a batch waits for others to join it
+    int window_ms{1};
+    // a batch this large goes out at once
+    int max_size{64};
+};
+
+// for a blocking client, concurrent calls to a method marked option (phxrpc.Batch) are
+// gathered for up to window_ms, or max_size calls, and sent together by flush in one
+// PHXBatch call, then each caller gets its own result and response back
+class CallBatcher {
+  public:
+    typedef std::function<int(const BatchRequest &req, BatchResponse *resp)> FlushFunc;
+
+    CallBatcher(const char *uri, const BatchPolicy &policy, FlushFunc flush);
+    ~CallBatcher();
+
+    // blocks till the batch req goes out in is answered
+    int Call(const google::protobuf::Message &req, google::protobuf::Message *resp);
+
+  private:
+    struct Batch;
+
+    std::string uri_;
+    const BatchPolicy &policy_;
+    FlushFunc flush_;
+
+    std::mutex mutex_;
+    // the one calls are joining, sent by the thread which opened it
+    std::shared_ptr<Batch> open_;
+};
+
+
+}  // namespace phxrpc
+
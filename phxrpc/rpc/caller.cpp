@@ -25,7 +25,11 @@ See the AUTHORS file for names of contributors.
 
 #include <google/protobuf/message_lite.h>
 
+#include "content_coding.h"
+#include "etag.h"
+#include "hsha_server.h"
 #include "monitor_factory.h"
+#include "pipelined_connection.h"
 
 #include "phxrpc/network.h"
 #include "phxrpc/file.h"
@@ -55,6 +59,10 @@ void Caller::MonitorReport(ClientMonitor &client_monitor, bool send_error,
                            bool recv_error, size_t send_size,
                            size_t recv_size, uint64_t call_begin,
                            uint64_t call_end) {
+    if (nullptr != endpoint_stat_) {
+        endpoint_stat_->CallEnd(stat_begin_us_, send_error || recv_error, client_monitor);
+    }
+
     if (send_error) {
         client_monitor.SendError();
     }
@@ -67,13 +75,12 @@ void Caller::MonitorReport(ClientMonitor &client_monitor, bool send_error,
     client_monitor.RecvBytes(recv_size);
     client_monitor.RequestCost(call_begin, call_end);
     if (0 < cmd_id_) {
-        client_monitor.ClientCall(cmd_id_, req_->uri());
+        client_monitor.ClientCall(cmd_id_, uri_.c_str());
     }
 }
 
-int Caller::Call(const google::protobuf::Message &req,
-                 google::protobuf::Message *resp) {
-    auto msg_handler(msg_handler_factory_.Create());
+int Caller::GenRequest(BaseMessageHandler *msg_handler,
+                       const google::protobuf::Message &req) {
     BaseRequest *tmp_req{nullptr};
     int ret{msg_handler->GenRequest(tmp_req)};
     if (0 != ret || !tmp_req) {
@@ -91,27 +98,83 @@ int Caller::Call(const google::protobuf::Message &req,
     }
 
     req_->set_uri(uri_.c_str());
-    req_->set_keep_alive(keep_alive_);
+    req_->set_cmd_id(cmd_id_);
+    // a pipelined connection outlives the calls over it
+    req_->set_keep_alive(keep_alive_ || nullptr != pipeline_);
+    // a local server answers all the same
+    req_->set_one_way(one_way_ && nullptr == local_server_);
+
+    return 0;
+}
+
+int Caller::Call(const google::protobuf::Message &req,
+                 google::protobuf::Message *resp) {
+    auto msg_handler(msg_handler_factory_.Create());
+    int ret{GenRequest(msg_handler.get(), req)};
+    if (0 != ret) {
+        return ret;
+    }
+
+    // nothing to save on without a connection or a response
+    if (accept_encoding_ && nullptr == local_server_ && !req_->one_way()) {
+        ContentCodingUtils::Accept(req_.get());
+    }
+
+    std::string etag_key;
+    if (nullptr != etag_cache_ && !req_->one_way()) {
+        etag_cache_->Prepare(req_.get(), &etag_key);
+    }
 
     bool send_error{false}, recv_error{false};
     uint64_t call_begin{Timer::GetSteadyClockMS()};
-    ret = req_->Send(socket_);
-    if (0 != ret && SocketStreamError_Normal_Closed != ret) {
-        send_error = true;
-        log(LOG_ERR, "Send err %d", ret);
+    if (nullptr != endpoint_stat_) {
+        stat_begin_us_ = endpoint_stat_->CallBegin();
     }
-
-    if (0 == ret) {
+    const size_t req_size{req_->size()};
+    if (nullptr != local_server_) {
+        // the server frees req, gone from here on
         BaseResponse *tmp_resp{nullptr};
-        ret = msg_handler->RecvResponse(socket_, tmp_resp);
-        if ((0 != ret && SocketStreamError_Normal_Closed != ret) || !tmp_resp) {
+        ret = local_server_->CallLocal(req_.release(), local_scheduler_, tmp_resp);
+        if (0 != ret) {
             recv_error = true;
-            log(LOG_ERR, "RecvResponse err %d", ret);
+            log(LOG_ERR, "CallLocal err %d", ret);
         }
         resp_.reset(tmp_resp);
+    } else {
+        UThreadPipelinedConnection::Ticket *ticket{nullptr};
+        if (nullptr != pipeline_) {
+            ret = pipeline_->Send(*req_, client_monitor_, req_->one_way() ? nullptr : &ticket);
+        } else {
+            ret = req_->Send(socket_);
+        }
+        if (0 != ret && SocketStreamError_Normal_Closed != ret) {
+            send_error = true;
+            log(LOG_ERR, "Send err %d", ret);
+        }
+
+        if (0 == ret && req_->one_way()) {
+            MonitorReport(client_monitor_, send_error, recv_error, req_size, 0,
+                          call_begin, Timer::GetSteadyClockMS());
+
+            return 0;
+        }
+
+        if (0 == ret) {
+            BaseResponse *tmp_resp{nullptr};
+            if (nullptr != pipeline_) {
+                ret = pipeline_->RecvResponse(ticket, msg_handler.get(), tmp_resp);
+            } else {
+                ret = msg_handler->RecvResponse(socket_, tmp_resp);
+            }
+            if ((0 != ret && SocketStreamError_Normal_Closed != ret) || !tmp_resp) {
+                recv_error = true;
+                log(LOG_ERR, "RecvResponse err %d", ret);
+            }
+            resp_.reset(tmp_resp);
+        }
     }
     MonitorReport(client_monitor_, send_error,
-                  recv_error, req_->size(),
+                  recv_error, req_size,
                   resp_ ? resp_->size() : 0, call_begin,
                   Timer::GetSteadyClockMS());
 
@@ -121,7 +184,16 @@ int Caller::Call(const google::protobuf::Message &req,
         return ret;
     }
 
-    ret = resp_->ToPb(resp);
+    ret = ContentCodingUtils::Decode(resp_.get(), client_monitor_);
+    if (0 != ret) {
+        return ret;
+    }
+
+    if (nullptr != etag_cache_) {
+        ret = etag_cache_->ToPb(etag_key, resp_.get(), resp);
+    } else {
+        ret = resp_->ToPb(resp);
+    }
     if (0 != ret) {
         log(LOG_ERR, "ToPb err %d", ret);
 
@@ -130,7 +202,55 @@ int Caller::Call(const google::protobuf::Message &req,
 
     ret = resp_->result();
     if (0 > ret) {
-        log(LOG_ERR, "call %s err %d", req_->uri(), ret);
+        log(LOG_ERR, "call %s err %d", uri_.c_str(), ret);
+    }
+
+    return ret;
+}
+
+int Caller::CallStream(const google::protobuf::Message &req,
+                       BaseStreamReader *reader) {
+    if (nullptr != local_server_) {
+        log(LOG_ERR, "CallStream %s not over a local server", uri_.c_str());
+
+        return -1;
+    }
+
+    auto msg_handler(msg_handler_factory_.Create());
+    int ret{GenRequest(msg_handler.get(), req)};
+    if (0 != ret) {
+        return ret;
+    }
+
+    bool send_error{false}, recv_error{false};
+    uint64_t call_begin{Timer::GetSteadyClockMS()};
+    if (nullptr != endpoint_stat_) {
+        stat_begin_us_ = endpoint_stat_->CallBegin();
+    }
+    ret = req_->Send(socket_);
+    if (0 != ret && SocketStreamError_Normal_Closed != ret) {
+        send_error = true;
+        log(LOG_ERR, "Send err %d", ret);
+    }
+
+    if (0 == ret) {
+        BaseResponse *tmp_resp{nullptr};
+        ret = msg_handler->RecvResponseHead(socket_, tmp_resp);
+        if ((0 != ret && SocketStreamError_Normal_Closed != ret) || !tmp_resp) {
+            recv_error = true;
+            log(LOG_ERR, "RecvResponseHead err %d", ret);
+        }
+        if (0 == ret) {
+            reader->Reset(&socket_, tmp_resp);
+        }
+    }
+    // the body is not here yet, cost is the time to first byte
+    MonitorReport(client_monitor_, send_error,
+                  recv_error, req_->size(), 0, call_begin,
+                  Timer::GetSteadyClockMS());
+
+    if (0 != ret) {
+        log(LOG_ERR, "call err %d", ret);
     }
 
     return ret;
@@ -145,6 +265,31 @@ void Caller::set_keep_alive(const bool keep_alive) {
     keep_alive_ = keep_alive;
 }
 
+void Caller::set_endpoint_stat(EndpointStat *endpoint_stat) {
+    endpoint_stat_ = endpoint_stat;
+}
+
+void Caller::set_pipeline(UThreadPipelinedConnection *pipeline) {
+    pipeline_ = pipeline;
+}
+
+void Caller::set_etag_cache(ETagCache *etag_cache) {
+    etag_cache_ = etag_cache;
+}
+
+void Caller::set_accept_encoding(const bool accept_encoding) {
+    accept_encoding_ = accept_encoding;
+}
+
+void Caller::set_local(HshaServer *local_server, UThreadEpollScheduler *scheduler) {
+    local_server_ = local_server;
+    local_scheduler_ = scheduler;
+}
+
+void Caller::set_one_way(const bool one_way) {
+    one_way_ = one_way;
+}
+
 
 }  // namespace phxrpc
 
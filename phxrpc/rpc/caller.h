@@ -22,14 +22,20 @@ See the AUTHORS file for names of contributors.
 #pragma once
 
 #include "phxrpc/rpc/client_monitor.h"
+#include "phxrpc/rpc/load_balancer.h"
 
 #include "phxrpc/msg.h"
+#include "phxrpc/rpc/stream_reader.h"
 
 
 namespace phxrpc {
 
 
 class BaseTcpStream;
+class ETagCache;
+class HshaServer;
+class UThreadEpollScheduler;
+class UThreadPipelinedConnection;
 
 class Caller {
   public:
@@ -45,11 +51,40 @@ class Caller {
     int Call(const google::protobuf::Message &req,
              google::protobuf::Message *resp);
 
+    // server-streaming, returns once the head is received, the messages
+    // are pulled through reader which reads from socket
+    int CallStream(const google::protobuf::Message &req,
+                   BaseStreamReader *reader);
+
     void set_uri(const char *const uri, const int cmd_id);
 
     void set_keep_alive(const bool keep_alive);
 
+    // of the endpoint socket is connected to, for the load balancer
+    void set_endpoint_stat(EndpointStat *endpoint_stat);
+
+    // Call goes over pipeline, shared with other calls, in place of socket,
+    // CallStream does not
+    void set_pipeline(UThreadPipelinedConnection *pipeline);
+
+    // Call revalidates the response kept in etag_cache rather than get it again
+    void set_etag_cache(ETagCache *etag_cache);
+
+    // lets the server compress the response, see ContentCodingUtils
+    void set_accept_encoding(const bool accept_encoding);
+
+    // Call goes to the workers of local_server of this process in place of socket,
+    // CallStream fails, scheduler is that of a uthread caller, nullptr otherwise
+    void set_local(HshaServer *local_server, UThreadEpollScheduler *scheduler);
+
+    // Call returns once req is sent, with resp left as it is, the server sends no response,
+    // over a local server it still waits for the workers
+    void set_one_way(const bool one_way);
+
   protected:
+    int GenRequest(BaseMessageHandler *msg_handler,
+                   const google::protobuf::Message &req);
+
     void MonitorReport(ClientMonitor &client_monitor, bool send_error,
                        bool recv_error, size_t send_size, size_t recv_size,
                        uint64_t call_begin, uint64_t call_end);
@@ -59,6 +94,14 @@ class Caller {
     int cmd_id_;
     std::string uri_;
     bool keep_alive_{false};
+    EndpointStat *endpoint_stat_{nullptr};
+    UThreadPipelinedConnection *pipeline_{nullptr};
+    ETagCache *etag_cache_{nullptr};
+    bool accept_encoding_{false};
+    HshaServer *local_server_{nullptr};
+    UThreadEpollScheduler *local_scheduler_{nullptr};
+    bool one_way_{false};
+    uint64_t stat_begin_us_{0};
 
     std::unique_ptr<BaseRequest> req_;
     std::unique_ptr<BaseResponse> resp_;
@@ -22,21 +22,97 @@ See the AUTHORS file for names of contributors.
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 
 #include "client_config.h"
 #include "client_monitor.h"
 #include "monitor_factory.h"
 
 #include "phxrpc/file.h"
+#include "phxrpc/network.h"
 
 
 namespace phxrpc {
 
 
+namespace {
+
+
+const char UNIX_PREFIX[] = "unix:";
+const char SHM_PREFIX[] = "shm:";
+const char LOCAL_PREFIX[] = "local:";
+
+bool IsLocal(const char *ip) {
+    return 0 == strncmp(ip, LOCAL_PREFIX, sizeof(LOCAL_PREFIX) - 1);
+}
+
+bool IsShm(const char *ip) {
+    return 0 == strncmp(ip, SHM_PREFIX, sizeof(SHM_PREFIX) - 1);
+}
+
+bool IsUnix(const char *ip) {
+    return 0 == strncmp(ip, UNIX_PREFIX, sizeof(UNIX_PREFIX) - 1) || IsShm(ip);
+}
+
+bool Resolve(const char *ip, const int port, struct sockaddr_storage *addr,
+             socklen_t *addrlen) {
+    memset(addr, 0, sizeof(*addr));
+
+    if (IsUnix(ip)) {
+        struct sockaddr_un *un_addr{reinterpret_cast<struct sockaddr_un *>(addr)};
+        const char *path{strchr(ip, ':') + 1};
+        const size_t path_len{strlen(path)};
+        if (path_len >= sizeof(un_addr->sun_path)) {
+            log(LOG_ERR, "unix socket path too long %s", path);
+
+            return false;
+        }
+
+        un_addr->sun_family = AF_UNIX;
+        memcpy(un_addr->sun_path, path, path_len);
+        *addrlen = sizeof(*un_addr);
+
+        return true;
+    }
+
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+
+    struct addrinfo *result{nullptr};
+    int ret{getaddrinfo(ip, nullptr, &hints, &result)};
+    if (0 != ret || nullptr == result) {
+        log(LOG_ERR, "getaddrinfo %s err %s", ip, gai_strerror(ret));
+
+        return false;
+    }
+
+    struct sockaddr_in *in_addr{reinterpret_cast<struct sockaddr_in *>(addr)};
+    memcpy(in_addr, result->ai_addr, sizeof(*in_addr));
+    in_addr->sin_port = htons(port);
+    *addrlen = sizeof(*in_addr);
+    freeaddrinfo(result);
+
+    return true;
+}
+
+
+}  // namespace
+
+
 ClientConfig::ClientConfig() {
     connect_timeout_ms_ = 200;
     socket_timeout_ms_ = 5000;
     memset(package_name_, 0, sizeof(package_name_));
+    max_idle_per_endpoint_ = 8;
+    max_active_per_endpoint_ = 0;
+    idle_timeout_ms_ = 3000;
+    warm_up_per_endpoint_ = 0;
+    pipelines_per_endpoint_ = 0;
+    cache_max_entries_ = 10000;
 }
 
 ClientConfig::~ClientConfig() {
@@ -66,6 +142,16 @@ bool ClientConfig::Read(const char *config_file) {
 
     config.ReadItem("Server", "PackageName", package_name_, sizeof(package_name_));
 
+    char balancer[32]{0};
+    config.ReadItem("Server", "LoadBalancer", balancer, sizeof(balancer), "Random");
+    if (!balancer_) {
+        balancer_ = LoadBalancer::Create(balancer);
+        if (!balancer_) {
+            log(LOG_ERR, "Config::%s unknown LoadBalancer %s, Random instead", __func__, balancer);
+            balancer_.reset(new RandomBalancer);
+        }
+    }
+
     for (int i{0}; count > i; ++i) {
         char section[64]{0};
         snprintf(section, sizeof(section), "Server%d", i);
@@ -73,17 +159,67 @@ bool ClientConfig::Read(const char *config_file) {
         Endpoint_t ep;
         bool succ{true};
         succ &= config.ReadItem(section, "IP", ep.ip, sizeof(ep.ip));
-        succ &= config.ReadItem(section, "Port", &(ep.port));
+        // none for a Unix socket
+        ep.port = 0;
+        if (succ && !IsUnix(ep.ip) && !IsLocal(ep.ip)) {
+            succ &= config.ReadItem(section, "Port", &(ep.port));
+        }
         if (!succ) {
             continue;
         }
 
+        ep.local = IsLocal(ep.ip);
+        if (ep.local) {
+            memset(&ep.addr, 0, sizeof(ep.addr));
+            ep.addrlen = 0;
+        } else if (!Resolve(ep.ip, ep.port, &ep.addr, &ep.addrlen)) {
+            continue;
+        }
+        ep.shm = IsShm(ep.ip);
+
+        config.ReadItem(section, "Weight", &(ep.weight), 1);
+
+        stats_.emplace_back(new EndpointStat);
+        ep.stat = stats_.back().get();
+
+        ep.index = static_cast<int>(endpoints_.size());
         endpoints_.push_back(ep);
     }
 
     config.ReadItem("ClientTimeout", "ConnectTimeoutMS", &connect_timeout_ms_);
     config.ReadItem("ClientTimeout", "SocketTimeoutMS", &socket_timeout_ms_);
 
+    config.ReadItem("ConnectionPool", "MaxIdlePerEndpoint", &max_idle_per_endpoint_);
+    config.ReadItem("ConnectionPool", "MaxActivePerEndpoint", &max_active_per_endpoint_);
+    config.ReadItem("ConnectionPool", "IdleTimeoutMS", &idle_timeout_ms_);
+    config.ReadItem("ConnectionPool", "WarmUpPerEndpoint", &warm_up_per_endpoint_);
+    config.ReadItem("ConnectionPool", "PipelinesPerEndpoint", &pipelines_per_endpoint_);
+
+    config.ReadItem("OutlierDetection", "ConsecutiveFailures",
+                    &outlier_policy_.consecutive_failures);
+    config.ReadItem("OutlierDetection", "BaseEjectionMS", &outlier_policy_.base_ejection_ms);
+    config.ReadItem("OutlierDetection", "MaxEjectionMS", &outlier_policy_.max_ejection_ms);
+    config.ReadItem("OutlierDetection", "MaxEjectionPercent",
+                    &outlier_policy_.max_ejection_percent);
+    config.ReadItem("OutlierDetection", "ProbeIntervalMS", &outlier_policy_.probe_interval_ms);
+    config.ReadItem("OutlierDetection", "SlowCallMS", &outlier_policy_.slow_call_ms);
+
+    config.ReadItem("Hedge", "DelayMS", &hedge_policy_.delay_ms);
+    config.ReadItem("Hedge", "Percentile", &hedge_policy_.percentile);
+    config.ReadItem("Hedge", "BudgetPercent", &hedge_policy_.budget_percent);
+
+    config.ReadItem("Batch", "WindowMS", &batch_policy_.window_ms);
+    config.ReadItem("Batch", "MaxSize", &batch_policy_.max_size);
+
+    config.ReadItem("Cache", "MaxEntries", &cache_max_entries_);
+
+    outlier_policy_.endpoint_count = static_cast<int>(endpoints_.size());
+    for (auto &ep : endpoints_) {
+        ep.stat->Init(&ep, &outlier_policy_);
+    }
+
+    balancer_->Reset(endpoints_);
+
     if (endpoints_.size() == 0) {
         log(LOG_ERR, "Config::%s no endpoints", __func__);
     }
@@ -94,7 +230,7 @@ const Endpoint_t *ClientConfig::GetRandom() const {
     const Endpoint_t *ret{nullptr};
 
     if (endpoints_.size() > 0) {
-        ret = &(endpoints_[random() % endpoints_.size()]);
+        ret = &(endpoints_[FastRandom() % endpoints_.size()]);
     }
 
     if (!ret) {
@@ -107,6 +243,42 @@ const Endpoint_t *ClientConfig::GetRandom() const {
     return ret;
 }
 
+const Endpoint_t *ClientConfig::Select() const {
+    const Endpoint_t *ret{nullptr};
+
+    if (endpoints_.size() > 0 && balancer_) {
+        const uint64_t now_us{Timer::GetSteadyClockUS()};
+
+        // the balancer picks again if it hits an ejected one, then the next one let in goes
+        const Endpoint_t *ep{balancer_->Select(endpoints_)};
+        if (nullptr == ep->stat || ep->stat->Allow(now_us)) {
+            ret = ep;
+        } else {
+            ep = balancer_->Select(endpoints_);
+            for (size_t i{0}; endpoints_.size() > i && !ret; ++i) {
+                const Endpoint_t &next = endpoints_[(ep->index + i) % endpoints_.size()];
+                if (nullptr == next.stat || next.stat->Allow(now_us)) {
+                    ret = &next;
+                }
+            }
+        }
+    }
+
+    if (!ret) {
+        if (client_monitor_.get()) {
+            client_monitor_->GetEndpointFail();
+        }
+
+        log(LOG_ERR, "Select fail, list.size %lu", endpoints_.size());
+    }
+    return ret;
+}
+
+void ClientConfig::SetLoadBalancer(std::unique_ptr<LoadBalancer> balancer) {
+    balancer_ = std::move(balancer);
+    balancer_->Reset(endpoints_);
+}
+
 const Endpoint_t *ClientConfig::GetByIndex(const size_t index) const {
     const Endpoint_t *ret{nullptr};
 
@@ -134,6 +306,46 @@ const char *ClientConfig::GetPackageName() const {
     return package_name_;
 }
 
+int ClientConfig::GetMaxIdlePerEndpoint() const {
+    return max_idle_per_endpoint_;
+}
+
+int ClientConfig::GetMaxActivePerEndpoint() const {
+    return max_active_per_endpoint_;
+}
+
+int ClientConfig::GetIdleTimeoutMS() const {
+    return idle_timeout_ms_;
+}
+
+int ClientConfig::GetWarmUpPerEndpoint() const {
+    return warm_up_per_endpoint_;
+}
+
+int ClientConfig::GetPipelinesPerEndpoint() const {
+    return pipelines_per_endpoint_;
+}
+
+int ClientConfig::GetCacheMaxEntries() const {
+    return cache_max_entries_;
+}
+
+size_t ClientConfig::GetEndpointCount() const {
+    return endpoints_.size();
+}
+
+const HedgePolicy &ClientConfig::GetHedgePolicy() const {
+    return hedge_policy_;
+}
+
+HedgeBudget &ClientConfig::GetHedgeBudget() {
+    return hedge_budget_;
+}
+
+const BatchPolicy &ClientConfig::GetBatchPolicy() const {
+    return batch_policy_;
+}
+
 
 }  // namespace phxrpc
 
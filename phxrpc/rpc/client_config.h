@@ -21,9 +21,14 @@ See the AUTHORS file for names of contributors.
 
 #pragma once
 
+#include "call_batcher.h"
 #include "client_monitor.h"
+#include "hedged_caller.h"
+#include "load_balancer.h"
 
 #include <memory>
+#include <netinet/in.h>
+#include <sys/socket.h>
 #include <sys/types.h>
 #include <vector>
 
@@ -32,8 +37,26 @@ namespace phxrpc {
 
 
 typedef struct tagEndpoint {
-    char ip[32];
-    int port;
+    // or unix:<path> of a Unix socket on this host, port is 0 then, or shm:<path>
+    // to move over to a ShmChannel once connected to it, if the server offers one,
+    // or local:<package name> of an HshaServer in this process, see HshaServer::CallLocal
+    char ip[128]{0};
+    int port{0};
+
+    // position in the config, pools keep their per endpoint state by it
+    int index{0};
+    // resolved once by ClientConfig::Read, ss_family is 0 until then
+    struct sockaddr_storage addr{};
+    socklen_t addrlen{0};
+    // from shm:<path>
+    bool shm{false};
+    // from local:<package name>, there is nothing to connect to
+    bool local{false};
+
+    // [ServerN] Weight, 1 by default
+    int weight{1};
+    // owned by the ClientConfig, nullptr for endpoints made by hand
+    EndpointStat *stat{nullptr};
 } Endpoint_t;
 
 
@@ -47,6 +70,13 @@ class ClientConfig {
 
     const Endpoint_t *GetRandom() const;
 
+    // by the balancer of [Server] LoadBalancer, Random by default, skipping
+    // endpoints ejected by [OutlierDetection], nullptr if all are
+    const Endpoint_t *Select() const;
+
+    // in place of the one from the config, it is Reset with the endpoints once read
+    void SetLoadBalancer(std::unique_ptr<LoadBalancer> balancer);
+
     const Endpoint_t *GetByIndex(const size_t index) const;
 
     int GetConnectTimeoutMS();
@@ -55,18 +85,53 @@ class ClientConfig {
 
     const char *GetPackageName() const;
 
+    int GetMaxIdlePerEndpoint() const;
+
+    int GetMaxActivePerEndpoint() const;
+
+    int GetIdleTimeoutMS() const;
+
+    int GetWarmUpPerEndpoint() const;
+
+    int GetPipelinesPerEndpoint() const;
+
+    // of the response cache, 0 to turn it off
+    int GetCacheMaxEntries() const;
+
+    size_t GetEndpointCount() const;
+
+    const HedgePolicy &GetHedgePolicy() const;
+
+    // shared by the hedged methods of the client
+    HedgeBudget &GetHedgeBudget();
+
+    const BatchPolicy &GetBatchPolicy() const;
+
     void SetClientMonitor(ClientMonitorPtr client_monitor);
 
     ClientMonitorPtr GetClientMonitor();
 
   private:
     std::vector<Endpoint_t> endpoints_;
+    std::vector<std::unique_ptr<EndpointStat>> stats_;
+    std::unique_ptr<LoadBalancer> balancer_;
+    OutlierPolicy outlier_policy_;
+    HedgePolicy hedge_policy_;
+    BatchPolicy batch_policy_;
+    HedgeBudget hedge_budget_;
 
     int connect_timeout_ms_;
     int socket_timeout_ms_;
 
     char package_name_[64];
 
+    int max_idle_per_endpoint_;
+    int max_active_per_endpoint_;
+    int idle_timeout_ms_;
+    int warm_up_per_endpoint_;
+    int pipelines_per_endpoint_;
+    int cache_max_entries_;
+
     ClientMonitorPtr client_monitor_;
 };
 
@@ -65,6 +65,28 @@ void ClientMonitor::GetEndpointFail() {
 void ClientMonitor::ClientCall(const int cmd_id, const char *method_name) {
 }
 
+void ClientMonitor::EndpointEject(const char *ip, const int port, const int eject_ms) {
+}
+
+void ClientMonitor::EndpointRestore(const char *ip, const int port) {
+}
+
+void ClientMonitor::ClientHedge(const char *ip, const int port, const bool won) {
+}
+
+void ClientMonitor::ClientCacheHit(const char *uri) {
+}
+
+void ClientMonitor::ClientCacheMiss(const char *uri) {
+}
+
+void ClientMonitor::ClientCacheCoalesce(const char *uri) {
+}
+
+void ClientMonitor::ClientDecode(const char *coding, const size_t wire_bytes,
+                                 const size_t raw_bytes, const uint64_t cost_us) {
+}
+
 
 }  // namespace phxrpc
 
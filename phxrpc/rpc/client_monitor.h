@@ -55,6 +55,29 @@ class ClientMonitor {
     virtual void GetEndpointFail();
 
     virtual void ClientCall(const int cmd_id, const char *method_name);
+
+    // outlier detection took ip:port out of rotation for eject_ms
+    virtual void EndpointEject(const char *ip, const int port, const int eject_ms);
+
+    // a half-open probe to ip:port went through, it is back in rotation
+    virtual void EndpointRestore(const char *ip, const int port);
+
+    // a backup call went to ip:port, won tells whether its response was taken
+    virtual void ClientHedge(const char *ip, const int port, const bool won);
+
+    // a call to uri answered from the response cache
+    virtual void ClientCacheHit(const char *uri);
+
+    // a call to uri not in the response cache, sent to the server
+    virtual void ClientCacheMiss(const char *uri);
+
+    // a call to uri waited for the response of an identical one in flight
+    virtual void ClientCacheCoalesce(const char *uri);
+
+    // a response body received as wire_bytes in coding, decompressing it to raw_bytes
+    // took cost_us
+    virtual void ClientDecode(const char *coding, const size_t wire_bytes,
+                              const size_t raw_bytes, const uint64_t cost_us);
 };
 
 typedef std::shared_ptr<ClientMonitor> ClientMonitorPtr;
@@ -0,0 +1,129 @@
+/*
+Tencent is pleased to support the open source community by making
+PhxRPC available.
+Copyright (C) 2016 THL A29 Limited, a Tencent company.
+All rights reserved.
+
+Licensed under the BSD 3-Clause License (the "License"); you may
+not use this file except in compliance with the License. You may
+obtain a copy of the License at
+
+https://opensource.org/licenses/BSD-3-Clause
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" basis,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+implied. See the License for the specific language governing
+permissions and limitations under the License.
+
+See the AUTHORS file for names of contributors.
+*/
+
+
+#include "client_runtime.h"
+
+#include <algorithm>
+#include <cassert>
+#include <future>
+
+#include "phxrpc/network.h"
+
+
+namespace phxrpc {
+
+
+using namespace std;
+
+
+namespace {
+
+
+atomic<int> default_thread_count{1};
+
+
+}  // namespace
+
+
+struct ClientRuntime::Loop {
+    thread worker;
+    UThreadEpollScheduler *scheduler{nullptr};
+    ThdQueue<Task *> tasks;
+};
+
+ClientRuntime::ClientRuntime(const int thread_count, const int uthread_count,
+                             const int uthread_stack_size)
+        : uthread_count_(uthread_count), uthread_stack_size_(uthread_stack_size) {
+    for (int i{0}; max(thread_count, 1) > i; ++i) {
+        loops_.emplace_back(new Loop);
+        Loop *loop{loops_.back().get()};
+
+        // Submit may notify the scheduler once it is running
+        promise<void> started;
+        future<void> running(started.get_future());
+        loop->worker = thread([this, loop, &started]() {
+            loop->scheduler = new UThreadEpollScheduler(uthread_stack_size_, uthread_count_, true);
+            assert(nullptr != loop->scheduler);
+            loop->scheduler->SetHandlerNewRequestFunc(bind(&ClientRuntime::HandlerNewTask,
+                                                           this, loop));
+            started.set_value();
+            loop->scheduler->RunForever();
+        });
+        running.wait();
+    }
+}
+
+ClientRuntime::~ClientRuntime() {
+    shut_down_ = true;
+    for (auto &loop : loops_) {
+        loop->scheduler->NotifyEpoll();
+        loop->worker.join();
+
+        Task *task{nullptr};
+        while (loop->tasks.pick(task))
+            delete task;
+        delete loop->scheduler;
+    }
+}
+
+bool ClientRuntime::Submit(Task task) {
+    if (shut_down_)
+        return false;
+
+    Loop *loop{loops_[next_loop_++ % loops_.size()].get()};
+    loop->tasks.push(new Task(move(task)));
+    loop->scheduler->NotifyEpoll();
+
+    return true;
+}
+
+ClientRuntime *ClientRuntime::Default() {
+    static ClientRuntime runtime(default_thread_count);
+
+    return &runtime;
+}
+
+void ClientRuntime::SetDefaultThreadCount(const int thread_count) {
+    default_thread_count = thread_count;
+}
+
+void ClientRuntime::HandlerNewTask(Loop *loop) {
+    if (shut_down_) {
+        // the calls still waiting fail, then RunForever returns
+        loop->scheduler->Close();
+
+        return;
+    }
+
+    Task *task{nullptr};
+    while (!loop->scheduler->IsTaskFull() && loop->tasks.pick(task)) {
+        UThreadEpollScheduler *scheduler{loop->scheduler};
+        loop->scheduler->AddTask([task, scheduler](void *) {
+            unique_ptr<Task> owned(task);
+            (*owned)(scheduler);
+        }, nullptr);
+    }
+}
+
+
+}  // namespace phxrpc
+
@@ -0,0 +1,74 @@
+/*
+Tencent is pleased to support the open source community by making
+PhxRPC available.
+Copyright (C) 2016 THL A29 Limited, a Tencent company.
+All rights reserved.
+
+Licensed under the BSD 3-Clause License (the "License"); you may
+not use this file except in compliance with the License. You may
+obtain a copy of the License at
+
+https://opensource.org/licenses/BSD-3-Clause
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" basis,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+implied. See the License for the specific language governing
+permissions and limitations under the License.
+
+See the AUTHORS file for names of contributors.
+*/
+
+
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "thread_queue.h"
+
+
+namespace phxrpc {
+
+
+class UThreadEpollScheduler;
+
+// background threads each running a UThreadEpollScheduler, so threads outside any
+// scheduler can have many calls outstanding without a thread blocked for each
+class ClientRuntime {
+  public:
+    // runs in a uthread of scheduler
+    typedef std::function<void(UThreadEpollScheduler *scheduler)> Task;
+
+    ClientRuntime(const int thread_count, const int uthread_count = 1024,
+                  const int uthread_stack_size = 64 * 1024);
+    // tasks not started yet are dropped
+    ~ClientRuntime();
+
+    // to the threads in turn, false once shut down
+    bool Submit(Task task);
+
+    // the one generated clients use, with SetDefaultThreadCount threads, 1 by default
+    static ClientRuntime *Default();
+
+    // before the first Default
+    static void SetDefaultThreadCount(const int thread_count);
+
+  private:
+    struct Loop;
+
+    void HandlerNewTask(Loop *loop);
+
+    int uthread_count_;
+    int uthread_stack_size_;
+    std::vector<std::unique_ptr<Loop>> loops_;
+    std::atomic<size_t> next_loop_{0};
+    std::atomic<bool> shut_down_{false};
+};
+
+
+}  // namespace phxrpc
+
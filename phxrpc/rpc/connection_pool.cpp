@@ -0,0 +1,196 @@
+/*
+Tencent is pleased to support the open source community by making
+PhxRPC available.
+Copyright (C) 2016 THL A29 Limited, a Tencent company.
+All rights reserved.
+
+Licensed under the BSD 3-Clause License (the "License"); you may
+not use this file except in compliance with the License. You may
+obtain a copy of the License at
+
+https://opensource.org/licenses/BSD-3-Clause
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" basis,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+implied. See the License for the specific language governing
+permissions and limitations under the License.
+
+See the AUTHORS file for names of contributors.
+*/
+
+
+#include "connection_pool.h"
+
+#include <poll.h>
+
+#include "client_monitor.h"
+#include "socket_stream_phxrpc.h"
+
+#include "phxrpc/file.h"
+
+
+namespace phxrpc {
+
+
+using namespace std;
+
+
+bool IsConnectionReusable(BaseTcpStream &stream, const int fd) {
+    if (!stream.good() || 0 != stream.rdbuf()->in_avail())
+        return false;
+
+    // an idle connection is readable only if the peer has closed it or reset it
+    struct pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+
+    return 0 == poll(&pfd, 1, 0);
+}
+
+
+BlockConnectionPool::BlockConnectionPool(ClientConfig &config)
+        : ConnectionPool<BlockTcpStream>(config) {
+}
+
+BlockConnectionPool::~BlockConnectionPool() {
+}
+
+EndpointConnections<BlockTcpStream> *BlockConnectionPool::GetEndpoint(const Endpoint_t &ep) {
+    lock_guard<mutex> lock(mutex_);
+
+    // config is read after the pool is made, size it up on first use
+    if (endpoints_.size() <= static_cast<size_t>(ep.index)) {
+        const size_t size{max(config_.GetEndpointCount(), static_cast<size_t>(ep.index) + 1)};
+        while (endpoints_.size() < size)
+            endpoints_.emplace_back(new EndpointConnections<BlockTcpStream>);
+    }
+
+    return endpoints_[ep.index].get();
+}
+
+PooledConnection<BlockTcpStream> BlockConnectionPool::Get(const Endpoint_t &ep,
+                                                          ClientMonitor &client_monitor) {
+    EndpointConnections<BlockTcpStream> *conns{GetEndpoint(ep)};
+
+    unique_ptr<BlockTcpStream> stream;
+    int ret{Checkout(conns, &stream)};
+    if (0 > ret) {
+        log(LOG_ERR, "%s %s:%d MaxActivePerEndpoint %d reached", __func__,
+            ep.ip, ep.port, config_.GetMaxActivePerEndpoint());
+
+        return PooledConnection<BlockTcpStream>();
+    }
+
+    if (0 == ret) {
+        stream.reset(new BlockTcpStream);
+        if (!PhxrpcTcpUtils::Open(stream.get(), ep, config_.GetConnectTimeoutMS(),
+                                  client_monitor)) {
+            Detach(conns);
+
+            return PooledConnection<BlockTcpStream>();
+        }
+        stream->SetTimeout(config_.GetSocketTimeoutMS());
+    }
+
+    return PooledConnection<BlockTcpStream>(this, conns, move(stream));
+}
+
+void BlockConnectionPool::WarmUp() {
+    const int count{min(config_.GetWarmUpPerEndpoint(), config_.GetMaxIdlePerEndpoint())};
+    if (0 >= count)
+        return;
+
+    ClientMonitorPtr client_monitor{config_.GetClientMonitor()};
+    if (!client_monitor)
+        client_monitor.reset(new ClientMonitor);
+
+    for (size_t i{0}; config_.GetEndpointCount() > i; ++i) {
+        const Endpoint_t *ep{config_.GetByIndex(i)};
+
+        // all held at once, or each would get the previous one back
+        vector<PooledConnection<BlockTcpStream>> conns;
+        for (int j{0}; count > j; ++j) {
+            PooledConnection<BlockTcpStream> conn{Get(*ep, *client_monitor)};
+            if (!conn)
+                break;
+            conns.emplace_back(move(conn));
+        }
+    }
+}
+
+
+UThreadConnectionPool::UThreadConnectionPool(ClientConfig &config)
+        : ConnectionPool<UThreadTcpStream>(config) {
+}
+
+UThreadConnectionPool::~UThreadConnectionPool() {
+}
+
+EndpointConnections<UThreadTcpStream> *
+UThreadConnectionPool::GetEndpoint(UThreadEpollScheduler *scheduler, const Endpoint_t &ep) {
+    lock_guard<mutex> lock(mutex_);
+
+    auto &endpoints(schedulers_[scheduler]);
+    if (endpoints.size() <= static_cast<size_t>(ep.index)) {
+        const size_t size{max(config_.GetEndpointCount(), static_cast<size_t>(ep.index) + 1)};
+        while (endpoints.size() < size)
+            endpoints.emplace_back(new EndpointConnections<UThreadTcpStream>);
+    }
+
+    return endpoints[ep.index].get();
+}
+
+PooledConnection<UThreadTcpStream>
+UThreadConnectionPool::Get(UThreadEpollScheduler *scheduler, const Endpoint_t &ep,
+                           ClientMonitor &client_monitor) {
+    EndpointConnections<UThreadTcpStream> *conns{GetEndpoint(scheduler, ep)};
+
+    unique_ptr<UThreadTcpStream> stream;
+    int ret{Checkout(conns, &stream)};
+    if (0 > ret) {
+        log(LOG_ERR, "%s %s:%d MaxActivePerEndpoint %d reached", __func__,
+            ep.ip, ep.port, config_.GetMaxActivePerEndpoint());
+
+        return PooledConnection<UThreadTcpStream>();
+    }
+
+    if (0 == ret) {
+        stream.reset(new UThreadTcpStream);
+        if (!PhxrpcTcpUtils::Open(scheduler, stream.get(), ep, config_.GetConnectTimeoutMS(),
+                                  client_monitor)) {
+            Detach(conns);
+
+            return PooledConnection<UThreadTcpStream>();
+        }
+        stream->SetTimeout(config_.GetSocketTimeoutMS());
+    } else {
+        // a scheduler freed and another made at the same address gets the sockets of the old one
+        stream->Adopt(scheduler);
+    }
+
+    return PooledConnection<UThreadTcpStream>(this, conns, move(stream));
+}
+
+void UThreadConnectionPool::Forget(UThreadEpollScheduler *scheduler) {
+    lock_guard<mutex> lock(mutex_);
+
+    auto it(schedulers_.find(scheduler));
+    if (schedulers_.end() == it)
+        return;
+
+    bool in_use{false};
+    for (auto &conns : it->second) {
+        conns->idle.clear();
+        in_use = in_use || 0 < conns->active;
+    }
+
+    // one still handed out is put back to its EndpointConnections later
+    if (!in_use)
+        schedulers_.erase(it);
+}
+
+
+}  // namespace phxrpc
+
@@ -0,0 +1,216 @@
+/*
+Tencent is pleased to support the open source community by making
+PhxRPC available.
+Copyright (C) 2016 THL A29 Limited, a Tencent company.
+All rights reserved.
+
+Licensed under the BSD 3-Clause License (the "License"); you may
+not use this file except in compliance with the License. You may
+obtain a copy of the License at
+
+https://opensource.org/licenses/BSD-3-Clause
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" basis,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+implied. See the License for the specific language governing
+permissions and limitations under the License.
+
+See the AUTHORS file for names of contributors.
+*/
+
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "client_config.h"
+#include "phxrpc/network.h"
+
+
+namespace phxrpc {
+
+
+class ClientMonitor;
+
+// connections to one endpoint, idle ones sorted by when they came back
+template <typename Stream>
+struct EndpointConnections {
+    std::deque<std::pair<uint64_t, std::unique_ptr<Stream>>> idle;
+    // handed out and not back yet, including those being opened
+    int active{0};
+};
+
+// false if the peer has closed fd, or there is something unread left on stream
+bool IsConnectionReusable(BaseTcpStream &stream, const int fd);
+
+template <typename Stream>
+class ConnectionPool;
+
+// gives the connection back to its pool when going out of scope
+template <typename Stream>
+class PooledConnection {
+  public:
+    PooledConnection() = default;
+    PooledConnection(ConnectionPool<Stream> *pool, EndpointConnections<Stream> *conns,
+                     std::unique_ptr<Stream> stream)
+            : pool_(pool), conns_(conns), stream_(std::move(stream)) {}
+    PooledConnection(PooledConnection &&other)
+            : pool_(other.pool_), conns_(other.conns_), stream_(std::move(other.stream_)) {}
+    PooledConnection(const PooledConnection &) = delete;
+    PooledConnection &operator=(const PooledConnection &) = delete;
+
+    ~PooledConnection() {
+        if (stream_)
+            pool_->Put(conns_, std::move(stream_));
+    }
+
+    explicit operator bool() const { return static_cast<bool>(stream_); }
+    Stream &operator*() const { return *stream_; }
+    Stream *get() const { return stream_.get(); }
+
+    // takes it out of the pool for good, e.g. for a stream reader to hold
+    std::unique_ptr<Stream> Release() {
+        if (stream_)
+            pool_->Detach(conns_);
+
+        return std::move(stream_);
+    }
+
+  private:
+    ConnectionPool<Stream> *pool_{nullptr};
+    EndpointConnections<Stream> *conns_{nullptr};
+    std::unique_ptr<Stream> stream_;
+};
+
+// keeps up to [ConnectionPool] MaxIdlePerEndpoint connections to each endpoint open
+// between calls, so a call reuses one instead of a connect and a TIME_WAIT of its own
+template <typename Stream>
+class ConnectionPool {
+  public:
+    explicit ConnectionPool(ClientConfig &config) : config_(config) {}
+    virtual ~ConnectionPool() = default;
+
+    // whether to ask the server to keep connections open
+    bool keep_alive() const { return 0 < config_.GetMaxIdlePerEndpoint(); }
+
+    void Put(EndpointConnections<Stream> *conns, std::unique_ptr<Stream> stream);
+    void Detach(EndpointConnections<Stream> *conns);
+
+  protected:
+    // 1 with an idle connection passing the health check in stream, 0 if a new one
+    // is to be opened, -1 if MaxActivePerEndpoint is reached
+    int Checkout(EndpointConnections<Stream> *conns, std::unique_ptr<Stream> *stream);
+
+    ClientConfig &config_;
+    std::mutex mutex_;
+};
+
+template <typename Stream>
+void ConnectionPool<Stream>::Put(EndpointConnections<Stream> *conns,
+                                 std::unique_ptr<Stream> stream) {
+    // a call failed halfway or the server said close, the rest of it can't be told apart
+    const bool reusable{stream->good() && 0 == stream->rdbuf()->in_avail()};
+    const uint64_t now{Timer::GetSteadyClockMS()};
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    --conns->active;
+    if (reusable && conns->idle.size() < static_cast<size_t>(config_.GetMaxIdlePerEndpoint()))
+        conns->idle.emplace_back(now, std::move(stream));
+}
+
+template <typename Stream>
+void ConnectionPool<Stream>::Detach(EndpointConnections<Stream> *conns) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    --conns->active;
+}
+
+template <typename Stream>
+int ConnectionPool<Stream>::Checkout(EndpointConnections<Stream> *conns,
+                                     std::unique_ptr<Stream> *stream) {
+    const uint64_t now{Timer::GetSteadyClockMS()};
+    const uint64_t idle_timeout_ms = config_.GetIdleTimeoutMS();
+
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+
+            // the server drops connections idle for its SocketTimeoutMS, oldest first
+            while (!conns->idle.empty() && conns->idle.front().first + idle_timeout_ms <= now)
+                conns->idle.pop_front();
+
+            if (conns->idle.empty()) {
+                const int max_active{config_.GetMaxActivePerEndpoint()};
+                if (0 < max_active && max_active <= conns->active)
+                    return -1;
+
+                ++conns->active;
+
+                return 0;
+            }
+
+            // the most recently used is the least likely to be closed by now
+            *stream = std::move(conns->idle.back().second);
+            conns->idle.pop_back();
+            ++conns->active;
+        }
+
+        if (IsConnectionReusable(**stream, (*stream)->SocketFd()))
+            return 1;
+
+        stream->reset();
+        Detach(conns);
+    }
+}
+
+// for blocking clients, shared by all threads
+class BlockConnectionPool : public ConnectionPool<BlockTcpStream> {
+  public:
+    explicit BlockConnectionPool(ClientConfig &config);
+    virtual ~BlockConnectionPool();
+
+    // an idle connection to ep or a new one, empty if it can't connect or ep is at its
+    // MaxActivePerEndpoint
+    PooledConnection<BlockTcpStream> Get(const Endpoint_t &ep, ClientMonitor &client_monitor);
+
+    // connects WarmUpPerEndpoint times to each endpoint ahead of the first call
+    void WarmUp();
+
+  private:
+    EndpointConnections<BlockTcpStream> *GetEndpoint(const Endpoint_t &ep);
+
+    std::vector<std::unique_ptr<EndpointConnections<BlockTcpStream>>> endpoints_;
+};
+
+// for uthread clients, connections are kept per UThreadEpollScheduler, as a socket waits
+// on the epoll of its scheduler
+class UThreadConnectionPool : public ConnectionPool<UThreadTcpStream> {
+  public:
+    explicit UThreadConnectionPool(ClientConfig &config);
+    virtual ~UThreadConnectionPool();
+
+    // same as BlockConnectionPool::Get, connecting in the current uthread of scheduler
+    PooledConnection<UThreadTcpStream> Get(UThreadEpollScheduler *scheduler,
+                                           const Endpoint_t &ep, ClientMonitor &client_monitor);
+
+    // closes the idle connections of scheduler and drops them, for a scheduler going away
+    // with its owner, e.g. that of a UThreadMultiCaller
+    void Forget(UThreadEpollScheduler *scheduler);
+
+  private:
+    EndpointConnections<UThreadTcpStream> *GetEndpoint(UThreadEpollScheduler *scheduler,
+                                                       const Endpoint_t &ep);
+
+    std::map<UThreadEpollScheduler *,
+             std::vector<std::unique_ptr<EndpointConnections<UThreadTcpStream>>>> schedulers_;
+};
+
+
+}  // namespace phxrpc
+
@@ -0,0 +1,111 @@
+/*
+Tencent is pleased to support the open source community by making
+PhxRPC available.
+Copyright (C) 2016 THL A29 Limited, a Tencent company.
+All rights reserved.
+
+Licensed under the BSD 3-Clause License (the "License"); you may
+not use this file except in compliance with the License. You may
+obtain a copy of the License at
+
+https://opensource.org/licenses/BSD-3-Clause
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" basis,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+implied. See the License for the specific language governing
+permissions and limitations under the License.
+
+See the AUTHORS file for names of contributors.
+*/
+
+
+
+
+#include "content_coding.h"
+
+#include <syslog.h>
+
+#include <string>
+
+#include "client_monitor.h"
+#include "server_monitor.h"
+
+#include "phxrpc/file.h"
+#include "phxrpc/http.h"
+#include "phxrpc/http/http_protocol.h"
+#include "phxrpc/network.h"
+
+
+namespace phxrpc {
+
+
+using namespace std;
+
+
+int ContentCodingUtils::Negotiate(const BaseRequest &req, BaseResponse *const resp,
+                                  const size_t min_bytes, const int ret) {
+    const HttpRequest *http_req{dynamic_cast<const HttpRequest *>(&req)};
+    HttpResponse *http_resp{dynamic_cast<HttpResponse *>(resp)};
+    if (nullptr == http_req || nullptr == http_resp || 0 == http_resp->size() ||
+        min_bytes > http_resp->size())
+        return ret;
+
+    http_resp->set_coding(HttpProtocol::NegotiateCoding(
+            http_req->GetHeaderValue("Accept-Encoding")));
+
+    return ret;
+}
+
+void ContentCodingUtils::Encode(BaseResponse *const resp, ServerMonitor &server_monitor) {
+    HttpResponse *http_resp{dynamic_cast<HttpResponse *>(resp)};
+    if (nullptr == http_resp || nullptr == http_resp->coding())
+        return;
+
+    const uint64_t begin_us{Timer::GetSteadyClockUS()};
+    const size_t raw_bytes{http_resp->content().size()};
+    if (0 != HttpProtocol::EncodeBody(http_resp, http_resp->coding())) {
+        // goes out as it is then
+        log(LOG_ERR, "EncodeBody %s err", http_resp->coding());
+
+        return;
+    }
+
+    server_monitor.SvrEncode(http_resp->coding(), raw_bytes, http_resp->content().size(),
+                             Timer::GetSteadyClockUS() - begin_us);
+}
+
+void ContentCodingUtils::Accept(BaseRequest *const req) {
+    HttpRequest *http_req{dynamic_cast<HttpRequest *>(req)};
+    if (nullptr != http_req)
+        HttpProtocol::AcceptCodings(http_req);
+}
+
+int ContentCodingUtils::Decode(BaseResponse *const resp, ClientMonitor &client_monitor) {
+    HttpResponse *http_resp{dynamic_cast<HttpResponse *>(resp)};
+    if (nullptr == http_resp)
+        return 0;
+
+    const char *header{http_resp->GetHeaderValue("Content-Encoding")};
+    if (nullptr == header)
+        return 0;
+
+    // the header goes with the coding
+    const string coding(header);
+    const uint64_t begin_us{Timer::GetSteadyClockUS()};
+    const size_t wire_bytes{http_resp->content().size()};
+    if (0 != HttpProtocol::DecodeBody(http_resp)) {
+        log(LOG_ERR, "DecodeBody %s err", coding.c_str());
+
+        return -1;
+    }
+
+    client_monitor.ClientDecode(coding.c_str(), wire_bytes, http_resp->content().size(),
+                                Timer::GetSteadyClockUS() - begin_us);
+
+    return 0;
+}
+
+
+}  // namespace phxrpc
+
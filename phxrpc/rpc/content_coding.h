@@ -0,0 +1,59 @@
+/*
+Tencent is pleased to support the open source community by making
+PhxRPC available.
+Copyright (C) 2016 THL A29 Limited, a Tencent company.
+All rights reserved.
+
+Licensed under the BSD 3-Clause License (the "License"); you may
+not use this file except in compliance with the License. You may
+obtain a copy of the License at
+
+https://opensource.org/licenses/BSD-3-Clause
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" basis,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+implied. See the License for the specific language governing
+permissions and limitations under the License.
+
+See the AUTHORS file for names of contributors.
+*/
+
+
+
+
+#pragma once
+
+#include <cstddef>
+
+
+namespace phxrpc {
+
+
+class BaseRequest;
+class BaseResponse;
+class ClientMonitor;
+class ServerMonitor;
+
+// responses of methods marked option (phxrpc.CompressMinBytes) are compressed by the io
+// thread of the server in a coding the client accepts, and decompressed by the Caller
+class ContentCodingUtils {
+  public:
+    // resp is to be compressed if its body has min_bytes at least and req accepts a coding
+    // HttpProtocol has, returns ret
+    static int Negotiate(const BaseRequest &req, BaseResponse *const resp,
+                         const size_t min_bytes, const int ret);
+
+    // in the coding Negotiate chose, if any
+    static void Encode(BaseResponse *const resp, ServerMonitor &server_monitor);
+
+    // lets the server compress the response to req
+    static void Accept(BaseRequest *const req);
+
+    // the body of resp as it was before it was compressed, <0 if it cannot be decompressed
+    static int Decode(BaseResponse *const resp, ClientMonitor &client_monitor);
+};
+
+
+}  // namespace phxrpc
+
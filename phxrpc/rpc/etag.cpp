@@ -0,0 +1,160 @@
+/*
+Tencent is pleased to support the open source community by making
+PhxRPC available.
+Copyright (C) 2016 THL A29 Limited, a Tencent company.
+All rights reserved.
+
+Licensed under the BSD 3-Clause License (the "License"); you may
+not use this file except in compliance with the License. You may
+obtain a copy of the License at
+
+https://opensource.org/licenses/BSD-3-Clause
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" basis,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+implied. See the License for the specific language governing
+permissions and limitations under the License.
+
+See the AUTHORS file for names of contributors.
+*/
+
+
+
+
+#include "etag.h"
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+
+#include <google/protobuf/message.h>
+
+#include "phxrpc/http.h"
+#include "phxrpc/http/http_protocol.h"
+
+
+namespace phxrpc {
+
+
+using namespace std;
+
+
+namespace {
+
+
+const char *HEADER_ETAG = "ETag";
+const char *HEADER_IF_NONE_MATCH = "If-None-Match";
+
+// strong, the same body makes the same one on every server, FNV-1a and the length
+void MakeETag(const string &body, char *etag, const size_t size) {
+    uint64_t hash{14695981039346656037ULL};
+    for (const char c : body) {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 1099511628211ULL;
+    }
+
+    snprintf(etag, size, "\"%zx-%016" PRIx64 "\"", body.size(), hash);
+}
+
+
+}  // namespace
+
+
+int ETagUtils::Respond(const BaseRequest &req, BaseResponse *const resp, const int ret) {
+    const HttpRequest *http_req{dynamic_cast<const HttpRequest *>(&req)};
+    HttpResponse *http_resp{dynamic_cast<HttpResponse *>(resp)};
+    if (0 != ret || nullptr == http_req || nullptr == http_resp)
+        return ret;
+
+    char etag[64]{0};
+    MakeETag(http_resp->content(), etag, sizeof(etag));
+    http_resp->AddHeader(HEADER_ETAG, etag);
+
+    const char *if_none_match{http_req->GetHeaderValue(HEADER_IF_NONE_MATCH)};
+    if (nullptr != if_none_match && 0 == strcmp(if_none_match, etag)) {
+        http_resp->set_status_code(HttpProtocol::SC_NOT_MODIFIED);
+        http_resp->set_reason_phrase("Not Modified");
+        http_resp->set_content("", 0);
+    }
+
+    return ret;
+}
+
+
+ETagCache::ETagCache(const size_t max_entries) : max_entries_(max_entries) {
+}
+
+ETagCache::~ETagCache() {
+}
+
+void ETagCache::Prepare(BaseRequest *const req, string *key) {
+    HttpRequest *http_req{dynamic_cast<HttpRequest *>(req)};
+    if (nullptr == http_req)
+        return;
+
+    key->assign(req->uri());
+    key->push_back('\0');
+    key->append(http_req->content());
+
+    lock_guard<mutex> lock(mutex_);
+    auto it(entries_.find(*key));
+    if (entries_.end() != it)
+        http_req->AddHeader(HEADER_IF_NONE_MATCH, it->second.etag.c_str());
+}
+
+int ETagCache::ToPb(const string &key, BaseResponse *const resp,
+                    google::protobuf::Message *const resp_pb) {
+    HttpResponse *http_resp{dynamic_cast<HttpResponse *>(resp)};
+    if (nullptr == http_resp || key.empty())
+        return resp->ToPb(resp_pb);
+
+    if (HttpProtocol::SC_NOT_MODIFIED == http_resp->status_code()) {
+        shared_ptr<const google::protobuf::Message> kept;
+        {
+            lock_guard<mutex> lock(mutex_);
+            auto it(entries_.find(key));
+            if (entries_.end() != it) {
+                lru_.splice(lru_.begin(), lru_, it->second.lru);
+                kept = it->second.resp_pb;
+            }
+        }
+        // dropped since the request was sent
+        if (!kept)
+            return -1;
+
+        resp_pb->CopyFrom(*kept);
+
+        return 0;
+    }
+
+    int ret{resp->ToPb(resp_pb)};
+    const char *etag{http_resp->GetHeaderValue(HEADER_ETAG)};
+    if (0 != ret || nullptr == etag || 0 != http_resp->result())
+        return ret;
+
+    shared_ptr<google::protobuf::Message> copy(resp_pb->New());
+    copy->CopyFrom(*resp_pb);
+
+    lock_guard<mutex> lock(mutex_);
+    auto &entry(entries_[key]);
+    if (entry.resp_pb)
+        lru_.erase(entry.lru);
+
+    entry.etag = etag;
+    entry.resp_pb = copy;
+    lru_.push_front(&entries_.find(key)->first);
+    entry.lru = lru_.begin();
+
+    while (entries_.size() > max_entries_) {
+        const string *oldest{lru_.back()};
+        lru_.pop_back();
+        entries_.erase(entries_.find(*oldest));
+    }
+
+    return 0;
+}
+
+
+}  // namespace phxrpc
+
@@ -0,0 +1,93 @@
+/*
+Tencent is pleased to support the open source community by making
+PhxRPC available.
+Copyright (C) 2016 THL A29 Limited, a Tencent company.
+All rights reserved.
+
+Licensed under the BSD 3-Clause License (the "License"); you may
+not use this file except in compliance with the License. You may
+obtain a copy of the License at
+
+https://opensource.org/licenses/BSD-3-Clause
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" basis,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+implied. See the License for the specific language governing
+permissions and limitations under the License.
+
+See the AUTHORS file for names of contributors.
+*/
+
+
+
+
+#pragma once
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+
+namespace google {
+
+namespace protobuf {
+
+
+class Message;
+
+
+}
+
+}
+
+
+namespace phxrpc {
+
+
+class BaseRequest;
+class BaseResponse;
+
+// responses of methods marked option (phxrpc.ETag) carry an ETag of their body, a request
+// with If-None-Match of it gets a 304 with no body then
+class ETagUtils {
+  public:
+    // the ETag of a successful resp, a 304 in place of it if req has it already, returns ret
+    static int Respond(const BaseRequest &req, BaseResponse *const resp, const int ret);
+};
+
+
+// the last response to each request to a method marked option (phxrpc.ETag), up to
+// max_entries of them, least recently used out first, sent back to revalidate them
+class ETagCache {
+  public:
+    explicit ETagCache(const size_t max_entries = 1024);
+    ~ETagCache();
+
+    // key of req, which gets If-None-Match if a response to it is kept
+    void Prepare(BaseRequest *const req, std::string *key);
+
+    // resp_pb from the response kept for key if resp is a 304, else from resp, which is
+    // kept for key then if it has an ETag
+    int ToPb(const std::string &key, BaseResponse *const resp,
+             google::protobuf::Message *const resp_pb);
+
+  private:
+    struct Entry {
+        std::string etag;
+        std::shared_ptr<const google::protobuf::Message> resp_pb;
+        std::list<const std::string *>::iterator lru;
+    };
+
+    const size_t max_entries_{0};
+    std::mutex mutex_;
+    std::unordered_map<std::string, Entry> entries_;
+    // keys of entries, the most recently used first
+    std::list<const std::string *> lru_;
+};
+
+
+}  // namespace phxrpc
+
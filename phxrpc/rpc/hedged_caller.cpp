@@ -0,0 +1,316 @@
+/*
+Tencent is pleased to support the open source community by making
+PhxRPC available.
+Copyright (C) 2016 THL A29 Limited, a Tencent company.
+All rights reserved.
+
+Licensed under the BSD 3-Clause License (the "License"); you may
+not use this file except in compliance with the License. You may
+obtain a copy of the License at
+
+https://opensource.org/licenses/BSD-3-Clause
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" basis,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+implied. See the License for the specific language governing
+permissions and limitations under the License.
+
+See the AUTHORS file for names of contributors.
+*/
+
+
+#include "hedged_caller.h"
+
+#include <cstdlib>
+
+#include <google/protobuf/message.h>
+
+#include "client_config.h"
+#include "client_monitor.h"
+#include "connection_pool.h"
+#include "socket_stream_phxrpc.h"
+
+#include "phxrpc/network.h"
+
+
+namespace phxrpc {
+
+
+using namespace std;
+
+
+namespace {
+
+
+// the buckets are halved this often, so the percentile follows what latency is now
+const uint64_t DECAY_SAMPLES{4096};
+
+const int64_t MILLI_TOKENS_PER_CALL{1000};
+// backup calls that can be saved up
+const int64_t MAX_MILLI_TOKENS{10 * MILLI_TOKENS_PER_CALL};
+
+
+}  // namespace
+
+
+LatencyHistogram::LatencyHistogram() {
+    for (auto &bucket : buckets_)
+        bucket.store(0, memory_order_relaxed);
+}
+
+int LatencyHistogram::Bucket(const uint64_t latency_us) {
+    if (4 > latency_us)
+        return static_cast<int>(latency_us);
+
+    // 4 buckets for [2^e, 2^(e+1)), by the 2 bits under the highest one
+    const int e{63 - __builtin_clzll(latency_us)};
+    const int bucket{4 * (e - 1) + static_cast<int>((latency_us >> (e - 2)) & 3)};
+
+    return bucket < BUCKET_COUNT ? bucket : BUCKET_COUNT - 1;
+}
+
+uint64_t LatencyHistogram::UpperBound(const int bucket) {
+    if (4 > bucket)
+        return bucket + 1;
+
+    const int e{bucket / 4 + 1};
+
+    return static_cast<uint64_t>(5 + bucket % 4) << (e - 2);
+}
+
+void LatencyHistogram::Add(const uint64_t latency_us) {
+    buckets_[Bucket(latency_us)].fetch_add(1, memory_order_relaxed);
+
+    if (0 == count_.fetch_add(1, memory_order_relaxed) % DECAY_SAMPLES) {
+        for (auto &bucket : buckets_)
+            bucket.store(bucket.load(memory_order_relaxed) / 2, memory_order_relaxed);
+    }
+}
+
+uint64_t LatencyHistogram::Percentile(const int percentile) const {
+    uint32_t counts[BUCKET_COUNT];
+    uint64_t total{0};
+    for (int i{0}; BUCKET_COUNT > i; ++i) {
+        counts[i] = buckets_[i].load(memory_order_relaxed);
+        total += counts[i];
+    }
+
+    if (MIN_SAMPLES > total)
+        return 0;
+
+    const uint64_t rank{(total * percentile + 99) / 100};
+    uint64_t seen{0};
+    for (int i{0}; BUCKET_COUNT > i; ++i) {
+        seen += counts[i];
+        if (rank <= seen)
+            return UpperBound(i);
+    }
+
+    return UpperBound(BUCKET_COUNT - 1);
+}
+
+void HedgeBudget::Deposit(const int percent) {
+    const int64_t now{milli_tokens_.fetch_add(percent * MILLI_TOKENS_PER_CALL / 100,
+                                              memory_order_relaxed)};
+    if (MAX_MILLI_TOKENS < now)
+        milli_tokens_.store(MAX_MILLI_TOKENS, memory_order_relaxed);
+}
+
+bool HedgeBudget::Withdraw() {
+    const int64_t before{milli_tokens_.fetch_sub(MILLI_TOKENS_PER_CALL, memory_order_relaxed)};
+    if (MILLI_TOKENS_PER_CALL > before) {
+        milli_tokens_.fetch_add(MILLI_TOKENS_PER_CALL, memory_order_relaxed);
+
+        return false;
+    }
+
+    return true;
+}
+
+//---------------------------------------------------------
+
+// shared by the caller and the calls it launched, as the call not taken outlives Call
+struct UThreadHedgedCaller::State {
+    State(const UThreadHedgedCaller &caller, const google::protobuf::Message &req,
+          const google::protobuf::Message &resp)
+            : caller(caller), req(req.New()) {
+        this->req->CopyFrom(req);
+        resps[0].reset(resp.New());
+        resps[1].reset(resp.New());
+        waiter = NewUThreadWaiter(caller.scheduler_);
+    }
+
+    ~State() {
+        free(waiter);
+    }
+
+    bool done() const { return 0 <= winner || launched == finished; }
+
+    UThreadHedgedCaller caller;
+    unique_ptr<google::protobuf::Message> req;
+    unique_ptr<google::protobuf::Message> resps[2];
+    int rets[2]{-1, -1};
+
+    int launched{0};
+    int finished{0};
+    // the first call to succeed
+    int winner{-1};
+
+    UThreadSocket_t *waiter{nullptr};
+};
+
+UThreadHedgedCaller::UThreadHedgedCaller(UThreadEpollScheduler *scheduler, ClientConfig &config,
+                                         UThreadConnectionPool *pool,
+                                         ClientMonitor &client_monitor,
+                                         LatencyHistogram &latency, CallFunc func)
+        : scheduler_(scheduler), config_(config), pool_(pool),
+          client_monitor_(client_monitor), latency_(latency), func_(func) {
+}
+
+UThreadHedgedCaller::~UThreadHedgedCaller() {
+}
+
+int UThreadHedgedCaller::Call(const google::protobuf::Message &req,
+                              google::protobuf::Message *resp) {
+    const Endpoint_t *ep{config_.Select()};
+    if (nullptr == ep)
+        return -1;
+
+    return Call(*ep, req, resp);
+}
+
+int UThreadHedgedCaller::Call(const Endpoint_t &first, const google::protobuf::Message &req,
+                              google::protobuf::Message *resp) {
+    const Endpoint_t *ep{&first};
+    const int delay_ms{GetDelayMS()};
+    if (0 > delay_ms || scheduler_->IsTaskFull()) {
+        const uint64_t begin_us{Timer::GetSteadyClockUS()};
+        int ret{CallOnce(*ep, req, resp)};
+        if (0 <= ret)
+            latency_.Add(Timer::GetSteadyClockUS() - begin_us);
+
+        return ret;
+    }
+
+    HedgeBudget &budget(config_.GetHedgeBudget());
+    budget.Deposit(config_.GetHedgePolicy().budget_percent);
+
+    shared_ptr<State> state(new State(*this, req, *resp));
+    Launch(state, ep);
+
+    // both calls are over by then, each within its own connect and socket timeout
+    const uint64_t deadline_ms{Timer::GetSteadyClockMS() + delay_ms +
+                               config_.GetConnectTimeoutMS() + config_.GetSocketTimeoutMS()};
+
+    UThreadWait(*state->waiter, delay_ms);
+
+    const Endpoint_t *backup{nullptr};
+    if (!state->done()) {
+        backup = SelectOther(*ep);
+        if (nullptr != backup && budget.Withdraw()) {
+            Launch(state, backup);
+        } else {
+            backup = nullptr;
+        }
+    }
+
+    while (!state->done()) {
+        const uint64_t now_ms{Timer::GetSteadyClockMS()};
+        if (deadline_ms <= now_ms)
+            break;
+
+        UThreadWait(*state->waiter, static_cast<int>(deadline_ms - now_ms));
+    }
+
+    if (nullptr != backup)
+        client_monitor_.ClientHedge(backup->ip, backup->port, 1 == state->winner);
+
+    if (0 > state->winner)
+        return state->rets[0];
+
+    resp->GetReflection()->Swap(resp, state->resps[state->winner].get());
+
+    return state->rets[state->winner];
+}
+
+void UThreadHedgedCaller::Launch(shared_ptr<State> state, const Endpoint_t *ep) {
+    const int index{state->launched++};
+
+    state->caller.scheduler_->AddTask([state, index, ep](void *) {
+        const uint64_t begin_us{Timer::GetSteadyClockUS()};
+        const int ret{state->caller.CallOnce(*ep, *state->req, state->resps[index].get())};
+
+        state->rets[index] = ret;
+        ++state->finished;
+        if (0 <= ret) {
+            // each call on its own, or the backups would pull the delay down
+            state->caller.latency_.Add(Timer::GetSteadyClockUS() - begin_us);
+            if (0 > state->winner)
+                state->winner = index;
+        }
+
+        // nothing if Call has returned already
+        if (state->done())
+            UThreadWakeUp(*state->waiter);
+    }, nullptr);
+}
+
+int UThreadHedgedCaller::CallOnce(const Endpoint_t &ep, const google::protobuf::Message &req,
+                                  google::protobuf::Message *resp) {
+    if (nullptr != pool_) {
+        auto socket(pool_->Get(scheduler_, ep, client_monitor_));
+        if (!socket)
+            return -1;
+
+        return func_(*socket, ep.stat, req, resp);
+    }
+
+    UThreadTcpStream socket;
+    if (!PhxrpcTcpUtils::Open(scheduler_, &socket, ep, config_.GetConnectTimeoutMS(),
+                              client_monitor_)) {
+        return -1;
+    }
+    socket.SetTimeout(config_.GetSocketTimeoutMS());
+
+    return func_(socket, ep.stat, req, resp);
+}
+
+int UThreadHedgedCaller::GetDelayMS() {
+    const HedgePolicy &policy(config_.GetHedgePolicy());
+    if (0 >= policy.budget_percent || 2 > config_.GetEndpointCount())
+        return -1;
+
+    if (0 < policy.delay_ms)
+        return policy.delay_ms;
+
+    // not hedged until enough calls are seen to tell what slow is
+    const uint64_t latency_us{latency_.Percentile(policy.percentile)};
+    if (0 == latency_us)
+        return -1;
+
+    return static_cast<int>((latency_us + 999) / 1000);
+}
+
+const Endpoint_t *UThreadHedgedCaller::SelectOther(const Endpoint_t &ep) {
+    // a backup to the same endpoint is as slow as the first call
+    for (int i{0}; 3 > i; ++i) {
+        const Endpoint_t *other{config_.Select()};
+        if (nullptr != other && other->index != ep.index && !other->local)
+            return other;
+    }
+
+    // the balancer keeps to ep, e.g. a random one with few endpoints, the next one then
+    const size_t count{config_.GetEndpointCount()};
+    if (1 >= count)
+        return nullptr;
+
+    const Endpoint_t *next{config_.GetByIndex((ep.index + 1) % count)};
+
+    // one of this process has no connection to call over
+    return nullptr != next && !next->local ? next : nullptr;
+}
+
+
+}  // namespace phxrpc
+
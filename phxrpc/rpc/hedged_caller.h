@@ -0,0 +1,145 @@
+/*
+Tencent is pleased to support the open source community by making
+PhxRPC available.
+Copyright (C) 2016 THL A29 Limited, a Tencent company.
+All rights reserved.
+
+Licensed under the BSD 3-Clause License (the "License"); you may
+not use this file except in compliance with the License. You may
+obtain a copy of the License at
+
+https://opensource.org/licenses/BSD-3-Clause
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" basis,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+implied. See the License for the specific language governing
+permissions and limitations under the License.
+
+See the AUTHORS file for names of contributors.
+*/
+
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+
+namespace google {
+
+namespace protobuf {
+
+class Message;
+
+}  // protobuf
+
+}  // google
+
+
+namespace phxrpc {
+
+
+class BaseTcpStream;
+class ClientConfig;
+class ClientMonitor;
+class EndpointStat;
+class UThreadConnectionPool;
+class UThreadEpollScheduler;
+
+typedef struct tagEndpoint Endpoint_t;
+
+// latencies of the calls to one method, log-bucketed, older calls weigh less and less
+class LatencyHistogram {
+  public:
+    LatencyHistogram();
+
+    void Add(const uint64_t latency_us);
+
+    // upper bound of the percentile-th latency, 0 before MIN_SAMPLES calls are seen
+    uint64_t Percentile(const int percentile) const;
+
+    static const uint64_t MIN_SAMPLES{100};
+
+  private:
+    // 4 buckets per power of 2, up to about 9 minutes
+    static const int BUCKET_COUNT{4 * 28};
+
+    static int Bucket(const uint64_t latency_us);
+    static uint64_t UpperBound(const int bucket);
+
+    std::atomic<uint32_t> buckets_[BUCKET_COUNT];
+    std::atomic<uint64_t> count_{0};
+};
+
+// [Hedge] of the client config
+struct HedgePolicy {
+    // wait this long for the first call before the backup one, 0 to wait for
+    // the percentile-th latency seen so far
+    int delay_ms{0};
+    int percentile{95};
+    // backup calls allowed per 100 hedged calls, 0 turns hedging off
+    int budget_percent{5};
+};
+
+// each hedged call earns budget_percent / 100 of a backup call, a few are saved up
+// for a burst, so a slow backend does not get its load doubled
+class HedgeBudget {
+  public:
+    HedgeBudget() = default;
+
+    void Deposit(const int percent);
+    bool Withdraw();
+
+  private:
+    std::atomic<int64_t> milli_tokens_{0};
+};
+
+// for idempotent methods, sends a backup call to another endpoint once the first
+// one has taken longer than the delay of [Hedge], and takes whichever response comes
+// back first, the other call is left to finish on its own
+class UThreadHedgedCaller {
+  public:
+    // one call on socket connected to the endpoint of endpoint_stat
+    typedef std::function<int(BaseTcpStream &socket, EndpointStat *endpoint_stat,
+                              const google::protobuf::Message &req,
+                              google::protobuf::Message *resp)> CallFunc;
+
+    // connects for each call if pool is nullptr
+    UThreadHedgedCaller(UThreadEpollScheduler *scheduler, ClientConfig &config,
+                        UThreadConnectionPool *pool, ClientMonitor &client_monitor,
+                        LatencyHistogram &latency, CallFunc func);
+    ~UThreadHedgedCaller();
+
+    // in a uthread of scheduler, req is copied if a call is left running
+    int Call(const google::protobuf::Message &req, google::protobuf::Message *resp);
+
+    // the first call to ep, of config, rather than to the endpoint it selects
+    int Call(const Endpoint_t &ep, const google::protobuf::Message &req,
+             google::protobuf::Message *resp);
+
+  private:
+    struct State;
+
+    // a uthread calling ep, to be waited for on state
+    static void Launch(std::shared_ptr<State> state, const Endpoint_t *ep);
+
+    int CallOnce(const Endpoint_t &ep, const google::protobuf::Message &req,
+                 google::protobuf::Message *resp);
+    // -1 if not to hedge
+    int GetDelayMS();
+    const Endpoint_t *SelectOther(const Endpoint_t &ep);
+
+    UThreadEpollScheduler *scheduler_{nullptr};
+    ClientConfig &config_;
+    UThreadConnectionPool *pool_{nullptr};
+    ClientMonitor &client_monitor_;
+    LatencyHistogram &latency_;
+    CallFunc func_;
+};
+
+
+}  // namespace phxrpc
+
@@ -22,11 +22,19 @@ See the AUTHORS file for names of contributors.
 #include "hsha_server.h"
 
 #include <cassert>
+#include <condition_variable>
+#include <map>
+#include <poll.h>
 #include <random>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
 
 #include "server_monitor.h"
 #include "monitor_factory.h"
 
+#include "phxrpc/http/http_protocol.h"
+
 
 namespace phxrpc {
 
@@ -34,6 +42,90 @@ namespace phxrpc {
 using namespace std;
 
 
+namespace {
+
+
+mutex local_servers_mutex;
+map<string, HshaServer *> local_servers;
+// a server going waits on it for the ones found by FindLocal to be let go
+condition_variable local_servers_cond;
+
+
+}  // namespace
+
+
+// a request from the same process, answered by the worker in place of the io thread
+class LocalCall final {
+  public:
+    // a uthread caller waits on an eventfd in its scheduler rather than block it
+    LocalCall(UThreadEpollScheduler *scheduler) : scheduler_(scheduler) {
+        if (nullptr != scheduler_) {
+            event_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        }
+    }
+
+    ~LocalCall() {
+        if (0 <= event_fd_) {
+            close(event_fd_);
+        }
+    }
+
+    // by the worker, the call is freed here if the caller gave up on it
+    void Done(BaseResponse *resp) {
+        unique_lock<mutex> lock(mutex_);
+        if (abandoned_) {
+            lock.unlock();
+            ReleaseMessage(resp);
+            delete this;
+
+            return;
+        }
+
+        resp_ = resp;
+        done_ = true;
+        if (0 <= event_fd_) {
+            const uint64_t one{1};
+            if (sizeof(one) != write(event_fd_, &one, sizeof(one))) {
+                log(LOG_ERR, "%s eventfd write err %d", __func__, errno);
+            }
+        }
+        cv_.notify_one();
+    }
+
+    // the response once done, the caller deletes the call then, nullptr past
+    // timeout_ms, the call is the worker's to free from then on
+    BaseResponse *Wait(const int timeout_ms) {
+        if (0 <= event_fd_) {
+            UThreadSocket_t *socket{scheduler_->CreateSocket(event_fd_, -1, -1, false)};
+            int revents{0};
+            UThreadPoll(*socket, EPOLLIN, &revents, timeout_ms);
+            free(socket);
+        }
+
+        unique_lock<mutex> lock(mutex_);
+        if (0 > event_fd_) {
+            cv_.wait_for(lock, chrono::milliseconds(timeout_ms), [this]() { return done_; });
+        }
+        if (!done_) {
+            abandoned_ = true;
+
+            return nullptr;
+        }
+
+        return resp_;
+    }
+
+  private:
+    UThreadEpollScheduler *scheduler_{nullptr};
+    int event_fd_{-1};
+    mutex mutex_;
+    condition_variable cv_;
+    bool done_{false};
+    bool abandoned_{false};
+    BaseResponse *resp_{nullptr};
+};
+
+
 DataFlow::DataFlow() {
 }
 
@@ -44,7 +136,11 @@ void DataFlow::PushRequest(void *args, BaseRequest *req) {
     in_queue_.push(make_pair(QueueExtData(args), req));
 }
 
-int DataFlow::PluckRequest(void *&args, BaseRequest *&req) {
+void DataFlow::PushLocalRequest(LocalCall *call, BaseRequest *req) {
+    in_queue_.push(make_pair(QueueExtData(call, true), req));
+}
+
+int DataFlow::PluckRequest(void *&args, BaseRequest *&req, bool &local) {
     pair<QueueExtData, BaseRequest *> rp;
     bool succ = in_queue_.pluck(rp);
     if (!succ) {
@@ -52,12 +148,13 @@ int DataFlow::PluckRequest(void *&args, BaseRequest *&req) {
     }
     args = rp.first.args;
     req = rp.second;
+    local = rp.first.local;
 
     auto now_time = Timer::GetSteadyClockMS();
     return now_time > rp.first.enqueue_time_ms ? now_time - rp.first.enqueue_time_ms : 0;
 }
 
-int DataFlow::PickRequest(void *&args, BaseRequest *&req) {
+int DataFlow::PickRequest(void *&args, BaseRequest *&req, bool &local) {
     pair<QueueExtData, BaseRequest *> rp;
     bool succ = in_queue_.pick(rp);
     if (!succ) {
@@ -65,6 +162,7 @@ int DataFlow::PickRequest(void *&args, BaseRequest *&req) {
     }
     args = rp.first.args;
     req = rp.second;
+    local = rp.first.local;
 
     auto now_time(Timer::GetSteadyClockMS());
     return now_time > rp.first.enqueue_time_ms ? now_time - rp.first.enqueue_time_ms : 0;
@@ -156,6 +254,8 @@ HshaServerStat::HshaServerStat(const HshaServerConfig *config, ServerMonitorPtr
     io_write_responses_ = 0;
     io_write_response_qps_ = 0;
     io_write_bytes_ = 0;
+    io_zero_copy_bytes_ = 0;
+    io_zero_copy_bytes_qps_ = 0;
 
     io_read_fails_ = 0;
     io_read_fail_qps_ = 0;
@@ -225,6 +325,7 @@ void HshaServerStat::MonitorReport() {
     hsha_server_monitor_->FastRejectAfterRead(enqueue_fast_reject_qps_);
     hsha_server_monitor_->RecvBytes(io_read_bytes_qps_);
     hsha_server_monitor_->SendBytes(io_write_bytes_qps_);
+    hsha_server_monitor_->SendZeroCopyBytes(io_zero_copy_bytes_qps_);
     hsha_server_monitor_->WaitInInQueue(inqueue_wait_time_costs_per_period_);
     hsha_server_monitor_->WaitInOutQueue(outqueue_wait_time_costs_per_period_);
 
@@ -260,6 +361,8 @@ void HshaServerStat::CalFunc() {
         io_read_bytes_ = 0;
         io_write_bytes_qps_ = static_cast<int>(io_write_bytes_);
         io_write_bytes_ = 0;
+        io_zero_copy_bytes_qps_ = static_cast<int>(io_zero_copy_bytes_);
+        io_zero_copy_bytes_ = 0;
 
         io_read_fail_qps_ = static_cast<int>(io_read_fails_);
         io_read_fails_ = 0;
@@ -368,6 +471,10 @@ bool HshaServerQos::CanEnqueue() {
     return ((int)(e_rand() % 100)) >= enqueue_reject_rate_;
 }
 
+bool HshaServerQos::IsOverloaded() const {
+    return 0 < enqueue_reject_rate_;
+}
+
 void HshaServerQos::CalFunc() {
     while (!break_out_) {
         unique_lock<mutex> lock(mutex_);
@@ -406,6 +513,9 @@ Worker::Worker(const int idx, WorkerPool *const pool,
                const int uthread_count, int uthread_stack_size)
         : idx_(idx), pool_(pool), uthread_count_(uthread_count),
           uthread_stack_size_(uthread_stack_size),
+          // up before the thread, requests may be pushed and notified right away
+          worker_scheduler_(0 == uthread_count ? nullptr :
+                            new UThreadEpollScheduler(uthread_stack_size, uthread_count, true)),
           thread_(&Worker::Func, this) {
 }
 
@@ -428,19 +538,19 @@ void Worker::ThreadMode() {
 
         void *args{nullptr};
         BaseRequest *request{nullptr};
-        int queue_wait_time_ms{pool_->data_flow_->PluckRequest(args, request)};
+        bool local{false};
+        int queue_wait_time_ms{pool_->data_flow_->PluckRequest(args, request, local)};
         if (request == nullptr) {
             // break out
             continue;
         }
         pool_->hsha_server_stat_->worker_idles_--;
 
-        WorkerLogic(args, request, queue_wait_time_ms);
+        WorkerLogic(args, request, queue_wait_time_ms, local);
     }
 }
 
 void Worker::UThreadMode() {
-    worker_scheduler_ = new UThreadEpollScheduler(uthread_stack_size_, uthread_count_, true);
     assert(worker_scheduler_ != nullptr);
     worker_scheduler_->SetHandlerNewRequestFunc(bind(&Worker::HandlerNewRequestFunc, this));
     worker_scheduler_->RunForever();
@@ -453,20 +563,21 @@ void Worker::HandlerNewRequestFunc() {
 
     void *args{nullptr};
     BaseRequest *request{nullptr};
-    int queue_wait_time_ms{pool_->data_flow_->PickRequest(args, request)};
+    bool local{false};
+    int queue_wait_time_ms{pool_->data_flow_->PickRequest(args, request, local)};
     if (!request) {
         return;
     }
 
     worker_scheduler_->AddTask(bind(&Worker::UThreadFunc, this, args,
-                                    request, queue_wait_time_ms), nullptr);
+                                    request, queue_wait_time_ms, local), nullptr);
 }
 
-void Worker::UThreadFunc(void *args, BaseRequest *req, int queue_wait_time_ms) {
-    WorkerLogic(args, req, queue_wait_time_ms);
+void Worker::UThreadFunc(void *args, BaseRequest *req, int queue_wait_time_ms, bool local) {
+    WorkerLogic(args, req, queue_wait_time_ms, local);
 }
 
-void Worker::WorkerLogic(void *args, BaseRequest *req, int queue_wait_time_ms) {
+void Worker::WorkerLogic(void *args, BaseRequest *req, int queue_wait_time_ms, bool local) {
     pool_->hsha_server_stat_->inqueue_pop_requests_++;
     pool_->hsha_server_stat_->inqueue_wait_time_costs_ += queue_wait_time_ms;
     pool_->hsha_server_stat_->inqueue_wait_time_costs_count_++;
@@ -477,6 +588,16 @@ void Worker::WorkerLogic(void *args, BaseRequest *req, int queue_wait_time_ms) {
 
         DispatcherArgs_t dispatcher_args(pool_->hsha_server_stat_->hsha_server_monitor_,
                 worker_scheduler_, pool_->args_, args);
+        dispatcher_args.response_cache = pool_->response_cache_;
+        // a local caller takes no stream, see Caller::CallStream
+        if (!local && nullptr != args) {
+            dispatcher_args.stream_notify_func = [this, args](BaseResponse *stream_resp) {
+                pool_->data_flow_->PushResponse(args, stream_resp);
+                pool_->hsha_server_stat_->outqueue_push_responses_++;
+
+                pool_->scheduler_->NotifyEpoll();
+            };
+        }
         pool_->dispatch_(*req, resp, &dispatcher_args);
 
         pool_->hsha_server_stat_->worker_time_costs_ += time_cost.Cost();
@@ -484,15 +605,27 @@ void Worker::WorkerLogic(void *args, BaseRequest *req, int queue_wait_time_ms) {
     } else {
         pool_->hsha_server_stat_->worker_drop_requests_++;
     }
-    // event loop server should also PushResponse, otherwise session_id (which args points to) will memory leak
-    pool_->data_flow_->PushResponse(args, resp);
-    pool_->hsha_server_stat_->outqueue_push_responses_++;
 
-    pool_->scheduler_->NotifyEpoll();
+    // before resp is handed over, the other side may release it and the arena with it
+    // at once, an arena request stays till then
+    DeleteMessage(req);
+    req = nullptr;
+
+    if (local) {
+        // straight back to the caller, no io thread in between
+        static_cast<LocalCall *>(args)->Done(resp);
+    } else if (nullptr == args) {
+        // one-way, nobody to hand it to
+        ReleaseMessage(resp);
+    } else if (nullptr != resp->stream()) {
+        // the stream notifies by itself, resp belongs to the io thread after this
+        resp->stream()->Finish();
+    } else {
+        // event loop server should also PushResponse, otherwise session_id (which args points to) will memory leak
+        pool_->data_flow_->PushResponse(args, resp);
+        pool_->hsha_server_stat_->outqueue_push_responses_++;
 
-    if (req) {
-        delete req;
-        req = nullptr;
+        pool_->scheduler_->NotifyEpoll();
     }
 }
 
@@ -518,11 +651,12 @@ WorkerPool::WorkerPool(const int idx,
                        const int uthread_stack_size,
                        DataFlow *const data_flow,
                        HshaServerStat *const hsha_server_stat,
+                       ServerResponseCache *const response_cache,
                        Dispatch_t dispatch,
                        void *args)
         : idx_(idx), scheduler_(scheduler), config_(config),
           data_flow_(data_flow), hsha_server_stat_(hsha_server_stat),
-          dispatch_(dispatch), args_(args), last_notify_idx_(0) {
+          response_cache_(response_cache), dispatch_(dispatch), args_(args), last_notify_idx_(0) {
     for (int i{0}; i < thread_count; ++i) {
         auto worker(new Worker(i, this, uthread_count_per_thread, uthread_stack_size));
         assert(worker != nullptr);
@@ -588,6 +722,18 @@ void HshaServerIO::IOFunc(int accepted_fd) {
     UThreadTcpStream stream;
     stream.Attach(socket);
     UThreadSetSocketTimeout(*socket, config_->GetSocketTimeoutMS());
+    // none over a Unix socket
+    UThreadSetZeroCopy(*socket, static_cast<size_t>(config_->GetZeroCopyMinBytes()));
+    size_t zero_copy_bytes{0};
+
+    // a caller on the Unix socket may ask to move over to shared memory first
+    if (!ShmStreamUtils::Accept(scheduler_, &stream,
+                                static_cast<size_t>(config_->GetShmRingSize()))) {
+        log(LOG_ERR, "%s shm channel fail fd %d", __func__, accepted_fd);
+        hsha_server_stat_->hold_fds_--;
+
+        return;
+    }
 
     while (true) {
         HshaServerStat::TimeCost time_cost;
@@ -601,14 +747,23 @@ void HshaServerIO::IOFunc(int accepted_fd) {
             break;
         }
 
+        // request, response and their protobufs are freed at once with it
+        // after the response is written, if enabled
+        Arena *arena{nullptr};
+        if (0 < config_->GetRequestArenaSize()) {
+            arena = new Arena(config_->GetRequestArenaSize());
+            msg_handler->set_arena(arena);
+        }
+
         // will be deleted by worker
         BaseRequest *req{nullptr};
         int ret{msg_handler->RecvRequest(stream, req)};
         if (0 != ret) {
             if (req) {
-                delete req;
+                DeleteMessage(req);
                 req = nullptr;
             }
+            delete arena;
             hsha_server_stat_->io_read_fails_++;
             hsha_server_stat_->rpc_time_costs_count_++;
             hsha_server_stat_->rpc_time_costs_ += time_cost.Cost();
@@ -625,7 +780,7 @@ void HshaServerIO::IOFunc(int accepted_fd) {
 
         if (!data_flow_->CanPushRequest(config_->GetMaxQueueLength())) {
             if (req) {
-                delete req;
+                ReleaseMessage(req);
                 req = nullptr;
             }
             hsha_server_stat_->queue_full_rejected_after_accepted_fds_++;
@@ -637,7 +792,7 @@ void HshaServerIO::IOFunc(int accepted_fd) {
         if (!hsha_server_qos_->CanEnqueue()) {
             // fast reject don't cal rpc_time_cost;
             if (req) {
-                delete req;
+                ReleaseMessage(req);
                 req = nullptr;
             }
             hsha_server_stat_->enqueue_fast_rejects_++;
@@ -648,6 +803,20 @@ void HshaServerIO::IOFunc(int accepted_fd) {
 
         // if have enqueue, request will be deleted after pop.
         hsha_server_stat_->inqueue_push_requests_++;
+        if (req->one_way()) {
+            // no response to wait for, on to the next request at once
+            data_flow_->PushRequest(nullptr, req);
+            worker_pool_->NotifyEpoll();
+
+            hsha_server_stat_->rpc_time_costs_count_++;
+            hsha_server_stat_->rpc_time_costs_ += time_cost.Cost();
+
+            if (!msg_handler->keep_alive()) {
+                break;
+            }
+
+            continue;
+        }
         data_flow_->PushRequest(socket, req);
         // if is uthread worker mode, need notify.
         // req deleted by worker after this line
@@ -671,9 +840,25 @@ void HshaServerIO::IOFunc(int accepted_fd) {
         }
 
         hsha_server_stat_->io_write_responses_++;
-        {
-            BaseResponse *resp{(BaseResponse *)UThreadGetArgs(*socket)};
+        BaseResponse *resp{(BaseResponse *)UThreadGetArgs(*socket)};
+        if (nullptr != resp->stream()) {
+            ret = SendStream(socket, stream, resp);
+            if (0 < ret) {
+                // abandoned, socket and resp are released by the last notification
+                hsha_server_stat_->rpc_time_costs_count_++;
+                hsha_server_stat_->rpc_time_costs_ += time_cost.Cost();
+
+                socket = stream.DetachSocket();
+                UThreadLazyDestory(*socket);
+
+                log(LOG_ERR, "%s stream abandoned fd %d", __func__, accepted_fd);
+                break;
+            }
+            ReleaseMessage(resp);
+        } else {
             if (!resp->fake()) {
+                // off the workers, which only chose the coding
+                ContentCodingUtils::Encode(resp, *hsha_server_stat_->hsha_server_monitor_);
                 ret = resp->Send(stream);
                 if (0 != ret) {
                     log(LOG_ERR, "%s Send err %d fd %d", __func__,
@@ -684,7 +869,12 @@ void HshaServerIO::IOFunc(int accepted_fd) {
                 }
                 hsha_server_stat_->io_write_bytes_ += resp->size();
             }
-            delete resp;
+            ReleaseMessage(resp);
+        }
+
+        if (zero_copy_bytes != UThreadZeroCopyBytes(*socket)) {
+            hsha_server_stat_->io_zero_copy_bytes_ += UThreadZeroCopyBytes(*socket) - zero_copy_bytes;
+            zero_copy_bytes = UThreadZeroCopyBytes(*socket);
         }
 
         hsha_server_stat_->rpc_time_costs_count_++;
@@ -702,6 +892,51 @@ void HshaServerIO::IOFunc(int accepted_fd) {
     hsha_server_stat_->hold_fds_--;
 }
 
+int HshaServerIO::SendStream(UThreadSocket_t *socket, UThreadTcpStream &stream,
+                             BaseResponse *resp) {
+    ResponseStream *resp_stream{resp->stream()};
+    vector<string> frames;
+
+    while (true) {
+        const bool finished{resp_stream->Take(&frames)};
+
+        if (!frames.empty() || finished) {
+            int ret{resp->SendStream(stream, frames, finished)};
+            if (0 != ret) {
+                log(LOG_ERR, "%s SendStream err %d", __func__, ret);
+
+                // the notification was taken, nothing is queued for this stream
+                if (resp_stream->Abandon(true))
+                    return ret;
+                hsha_server_stat_->io_write_fails_++;
+
+                return 1;
+            }
+
+            for (const auto &frame : frames)
+                hsha_server_stat_->io_write_bytes_ += frame.size();
+            frames.clear();
+
+            if (finished)
+                return 0;
+
+            continue;
+        }
+
+        // Take re-armed the notification, nothing runs in between till the wait
+        UThreadSetArgs(*socket, nullptr);
+        UThreadWait(*socket, config_->GetSocketTimeoutMS());
+        if (UThreadGetArgs(*socket) == nullptr) {
+            hsha_server_stat_->worker_timeouts_++;
+            log(LOG_ERR, "%s timeout, socket_timeout_ms %d",
+                __func__, config_->GetSocketTimeoutMS());
+            resp_stream->Abandon(false);
+
+            return 1;
+        }
+    }
+}
+
 UThreadSocket_t *HshaServerIO::ActiveSocketFunc() {
     while (data_flow_->CanPluckResponse()) {
         void *args{nullptr};
@@ -718,9 +953,13 @@ UThreadSocket_t *HshaServerIO::ActiveSocketFunc() {
         if (socket != nullptr && IsUThreadDestory(*socket)) {
             // socket aready timeout
             //log(LOG_ERR, "%s socket aready timeout", __func__);
+            if (nullptr != resp->stream() && !resp->stream()->Abandon(true)) {
+                // still being written, wait for the notification of Finish
+                continue;
+            }
             UThreadClose(*socket);
             free(socket);
-            delete resp;
+            ReleaseMessage(resp);
 
             continue;
         }
@@ -752,7 +991,8 @@ HshaServerUnit::HshaServerUnit(const int idx, HshaServer *const hsha_server,
           worker_pool_(idx, &scheduler_, hsha_server_->config_,
                        worker_thread_count, worker_uthread_count_per_thread,
                        worker_uthread_stack_size, &data_flow_,
-                       &hsha_server_->hsha_server_stat_, dispatch, args),
+                       &hsha_server_->hsha_server_stat_, &hsha_server_->response_cache_,
+                       dispatch, args),
           hsha_server_io_(idx, &scheduler_, hsha_server_->config_,
                           &data_flow_, &hsha_server_->hsha_server_stat_,
                           &hsha_server_->hsha_server_qos_, &worker_pool_,
@@ -772,6 +1012,57 @@ bool HshaServerUnit::AddAcceptedFd(const int accepted_fd) {
     return hsha_server_io_.AddAcceptedFd(accepted_fd);
 }
 
+int HshaServerUnit::CallLocal(BaseRequest *req, UThreadEpollScheduler *scheduler,
+                              BaseResponse *&resp) {
+    const HshaServerConfig *config{hsha_server_->config_};
+    HshaServerStat *hsha_server_stat{&hsha_server_->hsha_server_stat_};
+    HshaServerStat::TimeCost time_cost;
+
+    // counted as io_read, as HshaServerIO::IOFunc would
+    hsha_server_stat->io_read_requests_++;
+    hsha_server_stat->io_read_bytes_ += req->size();
+
+    if (!data_flow_.CanPushRequest(config->GetMaxQueueLength())) {
+        ReleaseMessage(req);
+        hsha_server_stat->queue_full_rejected_after_accepted_fds_++;
+        log(LOG_ERR, "%s overflow can't enqueue", __func__);
+
+        return -1;
+    }
+
+    if (!hsha_server_->hsha_server_qos_.CanEnqueue()) {
+        ReleaseMessage(req);
+        hsha_server_stat->enqueue_fast_rejects_++;
+        log(LOG_ERR, "%s fast reject can't enqueue", __func__);
+
+        return -1;
+    }
+
+    // req deleted by worker after this line
+    LocalCall *call{new LocalCall(scheduler)};
+    hsha_server_stat->inqueue_push_requests_++;
+    data_flow_.PushLocalRequest(call, req);
+    worker_pool_.NotifyEpoll();
+
+    resp = call->Wait(config->GetSocketTimeoutMS());
+    hsha_server_stat->rpc_time_costs_count_++;
+    hsha_server_stat->rpc_time_costs_ += time_cost.Cost();
+    if (nullptr == resp) {
+        // call is freed by the worker
+        hsha_server_stat->worker_timeouts_++;
+        log(LOG_ERR, "%s timeout, socket_timeout_ms %d",
+            __func__, config->GetSocketTimeoutMS());
+
+        return -1;
+    }
+    delete call;
+
+    hsha_server_stat->io_write_responses_++;
+    hsha_server_stat->io_write_bytes_ += resp->size();
+
+    return 0;
+}
+
 
 HshaServerAcceptor::HshaServerAcceptor(HshaServer *hsha_server)
         : hsha_server_(hsha_server) {
@@ -780,14 +1071,37 @@ HshaServerAcceptor::HshaServerAcceptor(HshaServer *hsha_server)
 HshaServerAcceptor::~HshaServerAcceptor() {
 }
 
-void HshaServerAcceptor::LoopAccept(const char *const bind_ip, const int port) {
-    int listen_fd{-1};
-    if (!BlockTcpUtils::Listen(&listen_fd, bind_ip, port)) {
-        printf("listen %s:%d err\n", bind_ip, port);
-        exit(-1);
+void HshaServerAcceptor::LoopAccept(const char *const bind_ip, const int port,
+                                    const char *const unix_socket_path) {
+    struct pollfd listen_fds[2];
+    nfds_t listen_fd_count{0};
+
+    if (0 != port) {
+        int listen_fd{-1};
+        if (!BlockTcpUtils::Listen(&listen_fd, bind_ip, port)) {
+            printf("listen %s:%d err\n", bind_ip, port);
+            exit(-1);
+        }
+
+        printf("listen %s:%d ok\n", bind_ip, port);
+        listen_fds[listen_fd_count++].fd = listen_fd;
+    }
+
+    if ('\0' != *unix_socket_path) {
+        int listen_fd{-1};
+        if (!BlockTcpUtils::ListenUnix(&listen_fd, unix_socket_path)) {
+            printf("listen unix:%s err\n", unix_socket_path);
+            exit(-1);
+        }
+
+        printf("listen unix:%s ok\n", unix_socket_path);
+        listen_fds[listen_fd_count++].fd = listen_fd;
     }
 
-    printf("listen %s:%d ok\n", bind_ip, port);
+    if (0 == listen_fd_count) {
+        printf("no Port nor UnixSocketPath to listen on\n");
+        exit(-1);
+    }
 
 #ifndef __APPLE__
     cpu_set_t mask;
@@ -800,34 +1114,57 @@ void HshaServerAcceptor::LoopAccept(const char *const bind_ip, const int port) {
     }
 #endif
 
-    while (true) {
-        struct sockaddr_in addr;
-        socklen_t socklen = sizeof(addr);
-        int accepted_fd{accept(listen_fd, (struct sockaddr *) &addr, &socklen)};
-        if (accepted_fd >= 0) {
-            if (!hsha_server_->hsha_server_qos_.CanAccept()) {
-                hsha_server_->hsha_server_stat_.rejected_fds_++;
-                log(LOG_ERR, "%s too many connection, reject accept, fd %d", __func__, accepted_fd);
-                close(accepted_fd);
-                continue;
-            }
+    // a blocking accept as before with one, else whichever is ready
+    if (1 == listen_fd_count) {
+        while (true) {
+            Accept(listen_fds[0].fd);
+        }
+    }
 
-            idx_ %= hsha_server_->server_unit_list_.size();
-            if (!hsha_server_->server_unit_list_[idx_++]->AddAcceptedFd(accepted_fd)) {
-                hsha_server_->hsha_server_stat_.rejected_fds_++;
-                log(LOG_ERR, "%s accept queue full, reject accept, fd %d", __func__, accepted_fd);
-                close(accepted_fd);
-                continue;
-            }
+    while (true) {
+        for (nfds_t i{0}; listen_fd_count > i; ++i) {
+            listen_fds[i].events = POLLIN;
+            listen_fds[i].revents = 0;
+        }
+        if (0 >= poll(listen_fds, listen_fd_count, -1))
+            continue;
 
-            hsha_server_->hsha_server_stat_.accepted_fds_++;
-            hsha_server_->hsha_server_stat_.hold_fds_++;
-        } else {
-            hsha_server_->hsha_server_stat_.accept_fail_++;
+        for (nfds_t i{0}; listen_fd_count > i; ++i) {
+            if (0 != listen_fds[i].revents)
+                Accept(listen_fds[i].fd);
         }
     }
 
-    close(listen_fd);
+    for (nfds_t i{0}; listen_fd_count > i; ++i) {
+        close(listen_fds[i].fd);
+    }
+}
+
+void HshaServerAcceptor::Accept(const int listen_fd) {
+    struct sockaddr_storage addr;
+    socklen_t socklen = sizeof(addr);
+    int accepted_fd{accept(listen_fd, (struct sockaddr *) &addr, &socklen)};
+    if (accepted_fd >= 0) {
+        if (!hsha_server_->hsha_server_qos_.CanAccept()) {
+            hsha_server_->hsha_server_stat_.rejected_fds_++;
+            log(LOG_ERR, "%s too many connection, reject accept, fd %d", __func__, accepted_fd);
+            close(accepted_fd);
+            return;
+        }
+
+        idx_ %= hsha_server_->server_unit_list_.size();
+        if (!hsha_server_->server_unit_list_[idx_++]->AddAcceptedFd(accepted_fd)) {
+            hsha_server_->hsha_server_stat_.rejected_fds_++;
+            log(LOG_ERR, "%s accept queue full, reject accept, fd %d", __func__, accepted_fd);
+            close(accepted_fd);
+            return;
+        }
+
+        hsha_server_->hsha_server_stat_.accepted_fds_++;
+        hsha_server_->hsha_server_stat_.hold_fds_++;
+    } else {
+        hsha_server_->hsha_server_stat_.accept_fail_++;
+    }
 }
 
 
@@ -838,6 +1175,9 @@ HshaServer::HshaServer(const HshaServerConfig &config, const Dispatch_t &dispatc
                                CreateServerMonitor(config.GetPackageName())),
           hsha_server_stat_(&config, hsha_server_monitor_),
           hsha_server_qos_(&config, &hsha_server_stat_),
+          response_cache_(config.GetServerCacheMaxEntries(), config.GetServerCacheMaxStaleMS(),
+                          config.GetSocketTimeoutMS(),
+                          [this]() { return hsha_server_qos_.IsOverloaded(); }),
           hsha_server_acceptor_(this) {
     size_t io_count{(size_t)config.GetIOThreadCount()};
     size_t worker_thread_count{(size_t)config.GetMaxThreads()};
@@ -846,6 +1186,9 @@ HshaServer::HshaServer(const HshaServerConfig &config, const Dispatch_t &dispatc
         io_count = worker_thread_count;
     }
 
+    if (0 < config.GetMaxBodyBytes())
+        HttpProtocol::SetMaxBodySize(static_cast<size_t>(config.GetMaxBodyBytes()));
+
     int worker_uthread_stack_size{config.GetWorkerUThreadStackSize()};
     size_t worker_thread_count_per_io{worker_thread_count / io_count};
     for (size_t i{0}; i < io_count; ++i) {
@@ -860,6 +1203,15 @@ HshaServer::HshaServer(const HshaServerConfig &config, const Dispatch_t &dispatc
         assert(hsha_server_unit != nullptr);
         server_unit_list_.push_back(hsha_server_unit);
     }
+    {
+        lock_guard<mutex> lock(local_servers_mutex);
+        if (!local_servers.emplace(config.GetPackageName(), this).second) {
+            // local: calls stay with the one that has it
+            log(LOG_ERR, "%s PackageName %s taken by another server of this process",
+                __func__, config.GetPackageName());
+        }
+    }
+
     printf("server already started, %zu io threads %zu workers\n", io_count, worker_thread_count);
     if (config.GetWorkerUThreadCount() > 0) {
         printf("server in uthread mode, %d uthread per worker\n", config.GetWorkerUThreadCount());
@@ -867,13 +1219,50 @@ HshaServer::HshaServer(const HshaServerConfig &config, const Dispatch_t &dispatc
 }
 
 HshaServer::~HshaServer() {
+    {
+        unique_lock<mutex> lock(local_servers_mutex);
+        auto it(local_servers.find(config_->GetPackageName()));
+        if (local_servers.end() != it && this == it->second) {
+            local_servers.erase(it);
+        }
+        // found no more, the local calls in flight still go to the units
+        local_servers_cond.wait(lock, [this]() { return 0 == local_users_; });
+    }
+
     for (auto &hsha_server_unit : server_unit_list_) {
         delete hsha_server_unit;
     }
 }
 
 void HshaServer::RunForever() {
-    hsha_server_acceptor_.LoopAccept(config_->GetBindIP(), config_->GetPort());
+    hsha_server_acceptor_.LoopAccept(config_->GetBindIP(), config_->GetPort(),
+                                     config_->GetUnixSocketPath());
+}
+
+shared_ptr<HshaServer> HshaServer::FindLocal(const char *package_name) {
+    lock_guard<mutex> lock(local_servers_mutex);
+    auto it(local_servers.find(package_name));
+    if (local_servers.end() == it) {
+        return nullptr;
+    }
+
+    HshaServer *local_server{it->second};
+    ++local_server->local_users_;
+
+    return shared_ptr<HshaServer>(local_server, [](HshaServer *local_server) {
+        lock_guard<mutex> lock(local_servers_mutex);
+        if (0 == --local_server->local_users_) {
+            local_servers_cond.notify_all();
+        }
+    });
+}
+
+int HshaServer::CallLocal(BaseRequest *req, UThreadEpollScheduler *scheduler,
+                          BaseResponse *&resp) {
+    // spread over the units as accepted connections are
+    const size_t idx{local_idx_++ % server_unit_list_.size()};
+
+    return server_unit_list_[idx]->CallLocal(req, scheduler, resp);
 }
 
 
@@ -27,23 +27,30 @@ See the AUTHORS file for names of contributors.
 #include "phxrpc/http.h"
 #include "phxrpc/msg.h"
 
+#include "phxrpc/rpc/content_coding.h"
 #include "phxrpc/rpc/server_base.h"
 #include "phxrpc/rpc/server_config.h"
 #include "phxrpc/rpc/server_monitor.h"
+#include "phxrpc/rpc/server_response_cache.h"
 #include "phxrpc/rpc/thread_queue.h"
 
 
 namespace phxrpc {
 
 
+class LocalCall;
+
 class DataFlow final {
   public:
     DataFlow();
     ~DataFlow();
 
+    // args nullptr for a one-way req, nobody to answer
     void PushRequest(void *args, BaseRequest *req);
-    int PluckRequest(void *&args, BaseRequest *&req);
-    int PickRequest(void *&args, BaseRequest *&req);
+    // from the same process, args points to the LocalCall to answer
+    void PushLocalRequest(LocalCall *call, BaseRequest *req);
+    int PluckRequest(void *&args, BaseRequest *&req, bool &local);
+    int PickRequest(void *&args, BaseRequest *&req, bool &local);
     void PushResponse(void *args, BaseResponse *resp);
     int PluckResponse(void *&args, BaseResponse *&resp);
     int PickResponse(void *&args, BaseResponse *&resp);
@@ -59,13 +66,16 @@ class DataFlow final {
         QueueExtData() {
             enqueue_time_ms = 0;
             args = nullptr;
+            local = false;
         }
-        QueueExtData(void *t_args) {
+        QueueExtData(void *t_args, const bool t_local = false) {
             enqueue_time_ms = Timer::GetSteadyClockMS();
             args = t_args;
+            local = t_local;
         }
         uint64_t enqueue_time_ms;
         void *args;
+        bool local;
     };
 
     ThdQueue<std::pair<QueueExtData, BaseRequest *>> in_queue_;
@@ -135,6 +145,8 @@ class HshaServerStat final {
     int io_read_bytes_qps_;
     std::atomic_int io_write_bytes_;
     int io_write_bytes_qps_;
+    std::atomic_int io_zero_copy_bytes_;
+    int io_zero_copy_bytes_qps_;
 
     std::atomic_int io_read_fails_;
     int io_read_fail_qps_;
@@ -194,6 +206,8 @@ class HshaServerQos final {
     void CalFunc();
     bool CanAccept();
     bool CanEnqueue();
+    // requests are being fast rejected
+    bool IsOverloaded() const;
 
   private:
     const HshaServerConfig *config_{nullptr};
@@ -219,8 +233,8 @@ class Worker final {
     void ThreadMode();
     void UThreadMode();
     void HandlerNewRequestFunc();
-    void UThreadFunc(void *args, BaseRequest *req, int queue_wait_time_ms);
-    void WorkerLogic(void *args, BaseRequest *req, int queue_wait_time_ms);
+    void UThreadFunc(void *args, BaseRequest *req, int queue_wait_time_ms, bool local);
+    void WorkerLogic(void *args, BaseRequest *req, int queue_wait_time_ms, bool local);
     void NotifyEpoll();
 
   private:
@@ -247,6 +261,7 @@ class WorkerPool final {
                const int uthread_stack_size,
                DataFlow *const data_flow,
                HshaServerStat *const hsha_server_stat,
+               ServerResponseCache *const response_cache,
                Dispatch_t dispatch,
                void *args);
     ~WorkerPool();
@@ -260,6 +275,7 @@ class WorkerPool final {
     const HshaServerConfig *config_{nullptr};
     DataFlow *data_flow_{nullptr};
     HshaServerStat *hsha_server_stat_{nullptr};
+    ServerResponseCache *response_cache_{nullptr};
     Dispatch_t dispatch_;
     void *args_{nullptr};
     std::vector<Worker *> worker_list_;
@@ -284,6 +300,10 @@ class HshaServerIO final {
     UThreadSocket_t *ActiveSocketFunc();
 
   private:
+    // drains a server-streaming response, 0 once sent in full, <0 if sending failed
+    // after the worker finished, >0 if abandoned before, resp is not to be deleted then
+    int SendStream(UThreadSocket_t *socket, UThreadTcpStream &stream, BaseResponse *resp);
+
     int idx_{-1};
     UThreadEpollScheduler *scheduler_{nullptr};
     const HshaServerConfig *config_{nullptr};
@@ -311,6 +331,8 @@ class HshaServerUnit {
 
     void RunFunc();
     bool AddAcceptedFd(const int accepted_fd);
+    // see HshaServer::CallLocal
+    int CallLocal(BaseRequest *req, UThreadEpollScheduler *scheduler, BaseResponse *&resp);
 
   private:
     HshaServer *hsha_server_{nullptr};
@@ -328,9 +350,13 @@ class HshaServerAcceptor final {
     HshaServerAcceptor(HshaServer *hsha_server);
     ~HshaServerAcceptor();
 
-    void LoopAccept(const char *const bind_ip, const int port);
+    // on bind_ip:port unless port is 0, and on unix_socket_path unless it is empty
+    void LoopAccept(const char *const bind_ip, const int port,
+                    const char *const unix_socket_path);
 
   private:
+    void Accept(const int listen_fd);
+
     HshaServer *hsha_server_{nullptr};
     size_t idx_{0};
 };
@@ -347,6 +373,18 @@ class HshaServer {
 
     void RunForever();
 
+    // the server of this process with [Server] PackageName package_name, nullptr if none,
+    // it is up from construction till destruction, whether RunForever or not; of servers
+    // sharing one, the first constructed. it is not destructed till the one returned is let go
+    static std::shared_ptr<HshaServer> FindLocal(const char *package_name);
+
+    // hands req over to the workers as a request read from a connection would be,
+    // under the same qos, with no socket or http framing in between, req is freed
+    // by the server, resp is the caller's if 0 is returned, -1 if rejected or
+    // not answered within [Server] SocketTimeoutMS, a uthread caller passes its
+    // scheduler to yield to the others meanwhile
+    int CallLocal(BaseRequest *req, UThreadEpollScheduler *scheduler, BaseResponse *&resp);
+
   private:
     friend class HshaServerAcceptor;
     friend class HshaServerUnit;
@@ -356,9 +394,13 @@ class HshaServer {
     ServerMonitorPtr hsha_server_monitor_;
     HshaServerStat hsha_server_stat_;
     HshaServerQos hsha_server_qos_;
+    ServerResponseCache response_cache_;
     HshaServerAcceptor hsha_server_acceptor_;
 
     std::vector<HshaServerUnit *> server_unit_list_;
+    std::atomic<size_t> local_idx_{0};
+    // found by FindLocal and not let go yet, under its mutex
+    int local_users_{0};
 
     void LoopReadCrossUnitResponse();
 };
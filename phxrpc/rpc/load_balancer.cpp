@@ -0,0 +1,315 @@
+/*
+Tencent is pleased to support the open source community by making
+PhxRPC available.
+Copyright (C) 2016 THL A29 Limited, a Tencent company.
+All rights reserved.
+
+Licensed under the BSD 3-Clause License (the "License"); you may
+not use this file except in compliance with the License. You may
+obtain a copy of the License at
+
+https://opensource.org/licenses/BSD-3-Clause
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" basis,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+implied. See the License for the specific language governing
+permissions and limitations under the License.
+
+See the AUTHORS file for names of contributors.
+*/
+
+
+#include "load_balancer.h"
+
+#include <cmath>
+#include <cstring>
+#include <numeric>
+
+#include "client_config.h"
+#include "client_monitor.h"
+
+#include "phxrpc/network.h"
+
+
+namespace phxrpc {
+
+
+using namespace std;
+
+
+namespace {
+
+
+// how fast a latency sample fades out, in us
+const double DECAY_US{10.0 * 1000 * 1000};
+// a failed call counts as at least this slow, or failing fast would look good
+const double ERROR_PENALTY_US{1000.0 * 1000};
+// caps the round-robin schedule at this many slots per endpoint
+const int MAX_WEIGHT{100};
+
+
+int Weight(const Endpoint_t &ep) {
+    return max(1, min(ep.weight, MAX_WEIGHT));
+}
+
+
+}  // namespace
+
+
+uint64_t FastRandom() {
+    // xorshift64*, seeded apart for each thread
+    static thread_local uint64_t state{0};
+    if (0 == state) {
+        state = Timer::GetSteadyClockUS() ^ reinterpret_cast<uintptr_t>(&state);
+        if (0 == state)
+            state = 1;
+    }
+
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+
+    return state * 2685821657736338717ULL;
+}
+
+
+void EndpointStat::Init(const Endpoint_t *ep, OutlierPolicy *policy) {
+    ep_ = ep;
+    policy_ = policy;
+}
+
+uint64_t EndpointStat::CallBegin() {
+    outstanding_.fetch_add(1, memory_order_relaxed);
+
+    return Timer::GetSteadyClockUS();
+}
+
+void EndpointStat::CallEnd(const uint64_t begin_us, const bool error,
+                           ClientMonitor &client_monitor) {
+    outstanding_.fetch_sub(1, memory_order_relaxed);
+
+    const uint64_t now_us{Timer::GetSteadyClockUS()};
+    const double cost_us{static_cast<double>(now_us - begin_us)};
+    const double sample_us{error ? max(cost_us, ERROR_PENALTY_US) : cost_us};
+
+    const double ewma_us{latency_us(now_us)};
+    // a slow call counts in full at once, recovering takes a while
+    const double next_us{sample_us > ewma_us ? sample_us :
+                         ewma_us + (sample_us - ewma_us) * 0.25};
+
+    ewma_us_.store(next_us, memory_order_relaxed);
+    last_us_.store(now_us, memory_order_relaxed);
+
+    if (nullptr == policy_ || 0 >= policy_->consecutive_failures)
+        return;
+
+    const bool slow{0 < policy_->slow_call_ms && cost_us >= policy_->slow_call_ms * 1000.0};
+    if (error || slow) {
+        Fail(begin_us, now_us, client_monitor);
+    } else {
+        Succeed(begin_us, now_us, client_monitor);
+    }
+}
+
+void EndpointStat::ConnectFail(ClientMonitor &client_monitor) {
+    if (nullptr == policy_ || 0 >= policy_->consecutive_failures)
+        return;
+
+    const uint64_t now_us{Timer::GetSteadyClockUS()};
+    Fail(now_us, now_us, client_monitor);
+}
+
+bool EndpointStat::Allow(const uint64_t now_us) {
+    const uint64_t ejected_until_us{ejected_until_us_.load(memory_order_relaxed)};
+    if (0 == ejected_until_us)
+        return true;
+    if (now_us < ejected_until_us)
+        return false;
+
+    // half-open, the first to get here in this interval is the probe
+    uint64_t next_probe_us{next_probe_us_.load(memory_order_relaxed)};
+    if (now_us < next_probe_us)
+        return false;
+
+    return next_probe_us_.compare_exchange_strong(next_probe_us,
+            now_us + policy_->probe_interval_ms * 1000ULL, memory_order_relaxed);
+}
+
+EndpointStat::State EndpointStat::state(const uint64_t now_us) const {
+    const uint64_t ejected_until_us{ejected_until_us_.load(memory_order_relaxed)};
+    if (0 == ejected_until_us)
+        return State::CLOSED;
+
+    return now_us < ejected_until_us ? State::OPEN : State::HALF_OPEN;
+}
+
+void EndpointStat::Succeed(const uint64_t begin_us, const uint64_t now_us,
+                           ClientMonitor &client_monitor) {
+    consecutive_failures_.store(0, memory_order_relaxed);
+
+    // only a call made after the ejection tells the endpoint is back
+    uint64_t ejected_until_us{ejected_until_us_.load(memory_order_relaxed)};
+    if (0 == ejected_until_us || begin_us < ejected_until_us)
+        return;
+
+    if (ejected_until_us_.compare_exchange_strong(ejected_until_us, 0, memory_order_relaxed)) {
+        ejections_.store(0, memory_order_relaxed);
+        policy_->ejected.fetch_sub(1, memory_order_relaxed);
+        client_monitor.EndpointRestore(ep_->ip, ep_->port);
+    }
+}
+
+void EndpointStat::Fail(const uint64_t begin_us, const uint64_t now_us,
+                        ClientMonitor &client_monitor) {
+    uint64_t ejected_until_us{ejected_until_us_.load(memory_order_relaxed)};
+    if (0 != ejected_until_us) {
+        // a failed probe puts it out again for longer, calls made before say nothing new
+        if (begin_us >= ejected_until_us)
+            Eject(ejected_until_us, now_us, client_monitor);
+
+        return;
+    }
+
+    if (policy_->consecutive_failures >
+        consecutive_failures_.fetch_add(1, memory_order_relaxed) + 1)
+        return;
+
+    // ejecting too many would overload the rest
+    int ejected{policy_->ejected.load(memory_order_relaxed)};
+    do {
+        if ((ejected + 1) * 100 > policy_->max_ejection_percent * policy_->endpoint_count)
+            return;
+    } while (!policy_->ejected.compare_exchange_weak(ejected, ejected + 1,
+                                                     memory_order_relaxed));
+
+    if (!Eject(0, now_us, client_monitor))
+        policy_->ejected.fetch_sub(1, memory_order_relaxed);
+}
+
+bool EndpointStat::Eject(uint64_t ejected_until_us, const uint64_t now_us,
+                         ClientMonitor &client_monitor) {
+    const int ejections{min(ejections_.load(memory_order_relaxed), 16)};
+    const uint64_t eject_ms{min(static_cast<uint64_t>(policy_->base_ejection_ms) << ejections,
+                                static_cast<uint64_t>(policy_->max_ejection_ms))};
+    const uint64_t next_until_us{now_us + eject_ms * 1000};
+
+    // lost to another thread doing the same
+    if (!ejected_until_us_.compare_exchange_strong(ejected_until_us, next_until_us,
+                                                   memory_order_relaxed))
+        return false;
+
+    next_probe_us_.store(next_until_us, memory_order_relaxed);
+    ejections_.fetch_add(1, memory_order_relaxed);
+    consecutive_failures_.store(0, memory_order_relaxed);
+    client_monitor.EndpointEject(ep_->ip, ep_->port, static_cast<int>(eject_ms));
+
+    return true;
+}
+
+
+double EndpointStat::latency_us(const uint64_t now_us) const {
+    const uint64_t last_us{last_us_.load(memory_order_relaxed)};
+    const double ewma_us{ewma_us_.load(memory_order_relaxed)};
+    if (now_us <= last_us)
+        return ewma_us;
+
+    return ewma_us * exp(-static_cast<double>(now_us - last_us) / DECAY_US);
+}
+
+
+unique_ptr<LoadBalancer> LoadBalancer::Create(const char *name) {
+    if (0 == strcasecmp(name, "Random"))
+        return unique_ptr<LoadBalancer>(new RandomBalancer);
+    if (0 == strcasecmp(name, "RoundRobin"))
+        return unique_ptr<LoadBalancer>(new RoundRobinBalancer);
+    if (0 == strcasecmp(name, "LeastOutstanding"))
+        return unique_ptr<LoadBalancer>(new LeastOutstandingBalancer);
+    if (0 == strcasecmp(name, "P2C"))
+        return unique_ptr<LoadBalancer>(new P2CBalancer);
+
+    return nullptr;
+}
+
+
+const Endpoint_t *RandomBalancer::Select(const vector<Endpoint_t> &endpoints) {
+    return &endpoints[FastRandom() % endpoints.size()];
+}
+
+
+void RoundRobinBalancer::Reset(const vector<Endpoint_t> &endpoints) {
+    vector<int> weights, current(endpoints.size(), 0);
+    for (const auto &ep : endpoints)
+        weights.push_back(Weight(ep));
+    const int total{accumulate(weights.begin(), weights.end(), 0)};
+
+    // each turn the one furthest behind its share goes, as nginx does
+    schedule_.clear();
+    for (int i{0}; total > i; ++i) {
+        size_t best{0};
+        for (size_t j{0}; endpoints.size() > j; ++j) {
+            current[j] += weights[j];
+            if (current[j] > current[best])
+                best = j;
+        }
+        current[best] -= total;
+        schedule_.push_back(static_cast<int>(best));
+    }
+}
+
+const Endpoint_t *RoundRobinBalancer::Select(const vector<Endpoint_t> &endpoints) {
+    if (schedule_.empty())
+        return &endpoints[FastRandom() % endpoints.size()];
+
+    const size_t next{next_.fetch_add(1, memory_order_relaxed)};
+
+    return &endpoints[schedule_[next % schedule_.size()] % endpoints.size()];
+}
+
+
+const Endpoint_t *LeastOutstandingBalancer::Select(const vector<Endpoint_t> &endpoints) {
+    const size_t size{endpoints.size()};
+    const size_t start{static_cast<size_t>(FastRandom() % size)};
+
+    const Endpoint_t *best{nullptr};
+    double best_load{0.0};
+    for (size_t i{0}; size > i; ++i) {
+        const Endpoint_t &ep = endpoints[(start + i) % size];
+        const double load{(nullptr == ep.stat ? 0 : ep.stat->outstanding()) /
+                          static_cast<double>(Weight(ep))};
+        if (nullptr == best || load < best_load) {
+            best = &ep;
+            best_load = load;
+        }
+    }
+
+    return best;
+}
+
+
+const Endpoint_t *P2CBalancer::Select(const vector<Endpoint_t> &endpoints) {
+    const size_t size{endpoints.size()};
+    if (1 == size)
+        return &endpoints[0];
+
+    const uint64_t rand{FastRandom()};
+    const size_t a{static_cast<size_t>(rand % size)};
+    // another one than a
+    const size_t b{(a + 1 + static_cast<size_t>((rand >> 32) % (size - 1))) % size};
+
+    const uint64_t now_us{Timer::GetSteadyClockUS()};
+    auto cost = [now_us](const Endpoint_t &ep) {
+        if (nullptr == ep.stat)
+            return 0.0;
+
+        // an idle backend with no history still costs a little, so load spreads
+        return (ep.stat->latency_us(now_us) + 1.0) * (ep.stat->outstanding() + 1) /
+               Weight(ep);
+    };
+
+    return cost(endpoints[b]) < cost(endpoints[a]) ? &endpoints[b] : &endpoints[a];
+}
+
+
+}  // namespace phxrpc
+
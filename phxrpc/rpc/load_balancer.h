@@ -0,0 +1,161 @@
+/*
+Tencent is pleased to support the open source community by making
+PhxRPC available.
+Copyright (C) 2016 THL A29 Limited, a Tencent company.
+All rights reserved.
+
+Licensed under the BSD 3-Clause License (the "License"); you may
+not use this file except in compliance with the License. You may
+obtain a copy of the License at
+
+https://opensource.org/licenses/BSD-3-Clause
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" basis,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+implied. See the License for the specific language governing
+permissions and limitations under the License.
+
+See the AUTHORS file for names of contributors.
+*/
+
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+
+namespace phxrpc {
+
+
+typedef struct tagEndpoint Endpoint_t;
+
+class ClientMonitor;
+
+// [OutlierDetection] of the client config, shared by the endpoints of a ClientConfig
+struct OutlierPolicy {
+    // failed calls or connects in a row to eject an endpoint, 0 turns it off
+    int consecutive_failures{5};
+    // doubles with each ejection in a row, up to max_ejection_ms
+    int base_ejection_ms{5000};
+    int max_ejection_ms{60000};
+    // of the endpoints, at most this many are ejected at a time
+    int max_ejection_percent{50};
+    // once the ejection is over, one call goes through per interval until one succeeds
+    int probe_interval_ms{1000};
+    // calls as slow as this count as failures, 0 turns it off
+    int slow_call_ms{0};
+
+    int endpoint_count{0};
+    std::atomic<int> ejected{0};
+};
+
+// what the calls to one endpoint have been like, updated by Caller::MonitorReport
+// from any thread without a lock, a sample racing another one may be lost
+//
+// also a circuit breaker, closed while calls go through, open while the endpoint
+// is ejected, then half-open letting probes through until one succeeds
+class EndpointStat {
+  public:
+    enum class State {
+        CLOSED,
+        OPEN,
+        HALF_OPEN,
+    };
+
+    EndpointStat() = default;
+
+    // done by ClientConfig, without it the endpoint is never ejected
+    void Init(const Endpoint_t *ep, OutlierPolicy *policy);
+
+    // returns the time to hand to CallEnd
+    uint64_t CallBegin();
+    void CallEnd(const uint64_t begin_us, const bool error, ClientMonitor &client_monitor);
+    void ConnectFail(ClientMonitor &client_monitor);
+
+    // false while ejected, in half-open true once per probe interval
+    bool Allow(const uint64_t now_us);
+
+    State state(const uint64_t now_us) const;
+
+    int outstanding() const { return outstanding_.load(std::memory_order_relaxed); }
+
+    // peak EWMA of call latency, decaying toward 0 while no calls come back,
+    // so a backend once slow gets tried again sooner or later
+    double latency_us(const uint64_t now_us) const;
+
+  private:
+    // begin_us of the call that went through or failed
+    void Succeed(const uint64_t begin_us, const uint64_t now_us, ClientMonitor &client_monitor);
+    void Fail(const uint64_t begin_us, const uint64_t now_us, ClientMonitor &client_monitor);
+    // from ejected_until_us, false if another thread changed it first
+    bool Eject(uint64_t ejected_until_us, const uint64_t now_us, ClientMonitor &client_monitor);
+
+    const Endpoint_t *ep_{nullptr};
+    OutlierPolicy *policy_{nullptr};
+
+    std::atomic<int> outstanding_{0};
+    std::atomic<double> ewma_us_{0.0};
+    std::atomic<uint64_t> last_us_{0};
+
+    std::atomic<int> consecutive_failures_{0};
+    // 0 while closed
+    std::atomic<uint64_t> ejected_until_us_{0};
+    std::atomic<uint64_t> next_probe_us_{0};
+    // in a row, without a probe succeeding in between
+    std::atomic<int> ejections_{0};
+};
+
+class LoadBalancer {
+  public:
+    LoadBalancer() = default;
+    virtual ~LoadBalancer() = default;
+
+    // called with the endpoints read by ClientConfig before any Select
+    virtual void Reset(const std::vector<Endpoint_t> &endpoints) {}
+
+    // endpoints is never empty
+    virtual const Endpoint_t *Select(const std::vector<Endpoint_t> &endpoints) = 0;
+
+    // by [Server] LoadBalancer: Random, RoundRobin, LeastOutstanding or P2C,
+    // nullptr for other names
+    static std::unique_ptr<LoadBalancer> Create(const char *name);
+};
+
+class RandomBalancer : public LoadBalancer {
+  public:
+    virtual const Endpoint_t *Select(const std::vector<Endpoint_t> &endpoints) override;
+};
+
+// smooth weighted round-robin over [ServerN] Weight, a 5:1:1 split goes a,a,b,a,c,a,a
+class RoundRobinBalancer : public LoadBalancer {
+  public:
+    virtual void Reset(const std::vector<Endpoint_t> &endpoints) override;
+    virtual const Endpoint_t *Select(const std::vector<Endpoint_t> &endpoints) override;
+
+  private:
+    std::vector<int> schedule_;
+    std::atomic<size_t> next_{0};
+};
+
+// fewest calls in flight per weight, ties broken at random
+class LeastOutstandingBalancer : public LoadBalancer {
+  public:
+    virtual const Endpoint_t *Select(const std::vector<Endpoint_t> &endpoints) override;
+};
+
+// the better of two picked at random, by latency times calls in flight per weight
+class P2CBalancer : public LoadBalancer {
+  public:
+    virtual const Endpoint_t *Select(const std::vector<Endpoint_t> &endpoints) override;
+};
+
+// per thread, cheaper than random() which takes a lock in glibc
+uint64_t FastRandom();
+
+
+}  // namespace phxrpc
+
@@ -0,0 +1,319 @@
+/*
+Tencent is pleased to support the open source community by making
+PhxRPC available.
+Copyright (C) 2016 THL A29 Limited, a Tencent company.
+All rights reserved.
+
+Licensed under the BSD 3-Clause License (the "License"); you may
+not use this file except in compliance with the License. You may
+obtain a copy of the License at
+
+https://opensource.org/licenses/BSD-3-Clause
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" basis,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+implied. See the License for the specific language governing
+permissions and limitations under the License.
+
+See the AUTHORS file for names of contributors.
+*/
+
+
+
+#include "pipelined_connection.h"
+
+#include <cstdlib>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "client_monitor.h"
+#include "connection_pool.h"
+#include "socket_stream_phxrpc.h"
+
+#include "phxrpc/file.h"
+#include "phxrpc/msg.h"
+
+
+namespace phxrpc {
+
+
+using namespace std;
+
+
+namespace {
+
+
+// what is written to it is appended to a string, for a request to be serialized once
+// and go out with others in a single write
+class StringStreamBuf : public BaseTcpStreamBuf {
+  public:
+    StringStreamBuf(string *out, size_t buf_size) : BaseTcpStreamBuf(buf_size), out_(out) {}
+    virtual ~StringStreamBuf() override {}
+
+  protected:
+    virtual ssize_t precv(void *buf, size_t len, int flags) override {
+        return 0;
+    }
+
+    virtual ssize_t psend(const void *buf, size_t len, int flags) override {
+        out_->append(static_cast<const char *>(buf), len);
+
+        return static_cast<ssize_t>(len);
+    }
+
+  private:
+    string *out_{nullptr};
+};
+
+class StringStream : public BaseTcpStream {
+  public:
+    StringStream(string *out) : BaseTcpStream(1024) {
+        NewRdbuf(new StringStreamBuf(out, buf_size_));
+    }
+    virtual ~StringStream() override {}
+
+    virtual bool SetTimeout(int socket_timeout_ms) override { return true; }
+
+    virtual int LastError() override { return 0; }
+
+  protected:
+    virtual int SocketFd() override { return -1; }
+};
+
+
+}  // namespace
+
+
+UThreadPipelinedConnection::UThreadPipelinedConnection(UThreadEpollScheduler *scheduler,
+                                                       ClientConfig &config,
+                                                       const Endpoint_t &ep)
+        : scheduler_(scheduler), config_(config), ep_(ep), stream_(new UThreadTcpStream) {
+}
+
+UThreadPipelinedConnection::~UThreadPipelinedConnection() {
+    for (auto ticket : tickets_) {
+        free(ticket->waiter);
+        delete ticket;
+    }
+}
+
+int UThreadPipelinedConnection::Send(const BaseRequest &req, ClientMonitor &client_monitor,
+                                     Ticket **ticket) {
+    if (broken_)
+        return -1;
+
+    const size_t out_size{out_.size()};
+    {
+        StringStream stream(&out_);
+        int ret{req.Send(stream)};
+        if (0 != ret) {
+            out_.resize(out_size);
+            log(LOG_ERR, "%s Send err %d", __func__, ret);
+
+            return ret;
+        }
+    }
+
+    Ticket *new_ticket{nullptr};
+    if (nullptr != ticket) {
+        new_ticket = new Ticket;
+        new_ticket->waiter = NewUThreadWaiter(scheduler_);
+        tickets_.push_back(new_ticket);
+    }
+    last_used_ms_ = Timer::GetSteadyClockMS();
+
+    // goes out with the next write of the uthread writing now
+    if (writing_) {
+        if (nullptr != ticket)
+            *ticket = new_ticket;
+
+        return 0;
+    }
+
+    writing_ = true;
+    if (!connected_) {
+        connected_ = Connect(client_monitor);
+        if (!connected_) {
+            Break();
+            writing_ = false;
+
+            // the calls whose requests were queued with this one find out in RecvResponse
+            if (nullptr != new_ticket) {
+                tickets_.erase(find(tickets_.begin(), tickets_.end(), new_ticket));
+                free(new_ticket->waiter);
+                delete new_ticket;
+            }
+
+            return -1;
+        }
+
+        if (!tickets_.empty()) {
+            // behind a one-way req, which has none, the first call may be waiting for it
+            UThreadWakeUp(*tickets_.front()->waiter);
+        }
+    }
+
+    // in a uthread of its own, a call writing the requests after its own would not read
+    // its response, which the server may be blocked on before reading any more of them
+    scheduler_->AddTask([this](void *) { Flush(); }, nullptr);
+
+    if (nullptr != ticket)
+        *ticket = new_ticket;
+
+    return 0;
+}
+
+int UThreadPipelinedConnection::RecvResponse(Ticket *ticket, BaseMessageHandler *msg_handler,
+                                             BaseResponse *&resp) {
+    // the one ahead wakes this up when done, or all are woken up if it fails,
+    // the first one is woken up once connected
+    while (!broken_ && (tickets_.front() != ticket || !connected_))
+        UThreadWait(*ticket->waiter, -1);
+
+    int ret{-1};
+    if (!broken_) {
+        ret = msg_handler->RecvResponse(*stream_, resp);
+        last_used_ms_ = Timer::GetSteadyClockMS();
+
+        // the responses after a broken one or a close can't be read
+        if (0 != ret || !stream_->good()) {
+            log(LOG_ERR, "%s %s:%d err %d", __func__, ep_.ip, ep_.port, ret);
+            Break();
+        }
+    }
+
+    tickets_.erase(find(tickets_.begin(), tickets_.end(), ticket));
+    free(ticket->waiter);
+    delete ticket;
+
+    if (!broken_ && !tickets_.empty())
+        UThreadWakeUp(*tickets_.front()->waiter);
+
+    return ret;
+}
+
+void UThreadPipelinedConnection::Check() {
+    if (writing_ || !tickets_.empty())
+        return;
+
+    if (connected_ && !broken_ &&
+        last_used_ms_ + config_.GetIdleTimeoutMS() > Timer::GetSteadyClockMS() &&
+        IsConnectionReusable(*stream_, stream_->SocketFd())) {
+        // a scheduler freed and another made at the same address gets the sockets of the old one
+        stream_->Adopt(scheduler_);
+        writer_->Adopt(scheduler_);
+
+        return;
+    }
+
+    if (connected_ || broken_) {
+        stream_.reset(new UThreadTcpStream);
+        writer_.reset();
+        connected_ = false;
+        broken_ = false;
+    }
+}
+
+UThreadTcpStream &UThreadPipelinedConnection::stream() {
+    return *stream_;
+}
+
+size_t UThreadPipelinedConnection::in_flight() const {
+    return tickets_.size();
+}
+
+bool UThreadPipelinedConnection::usable() const {
+    return !broken_;
+}
+
+bool UThreadPipelinedConnection::Connect(ClientMonitor &client_monitor) {
+    if (!PhxrpcTcpUtils::Open(scheduler_, stream_.get(), ep_, config_.GetConnectTimeoutMS(),
+                              client_monitor)) {
+        return false;
+    }
+    stream_->SetTimeout(config_.GetSocketTimeoutMS());
+
+    const int fd{dup(stream_->SocketFd())};
+    if (0 > fd) {
+        log(LOG_ERR, "%s dup %s:%d errno %d", __func__, ep_.ip, ep_.port, errno);
+
+        return false;
+    }
+    writer_.reset(new UThreadTcpStream);
+    writer_->Attach(scheduler_->CreateSocket(fd, config_.GetSocketTimeoutMS(), -1, false));
+
+    return true;
+}
+
+void UThreadPipelinedConnection::Flush() {
+    while (!broken_ && !out_.empty()) {
+        batch_.clear();
+        batch_.swap(out_);
+
+        struct iovec iov;
+        iov.iov_base = &batch_[0];
+        iov.iov_len = batch_.size();
+        if (!writer_->Writev(&iov, 1)) {
+            // the calls whose requests were in it find out in RecvResponse
+            log(LOG_ERR, "%s Writev %s:%d err %d", __func__, ep_.ip, ep_.port,
+                writer_->LastError());
+            Break();
+        }
+    }
+    writing_ = false;
+}
+
+void UThreadPipelinedConnection::Break() {
+    broken_ = true;
+    out_.clear();
+
+    for (auto ticket : tickets_)
+        UThreadWakeUp(*ticket->waiter);
+}
+
+
+UThreadPipelinePool::UThreadPipelinePool(ClientConfig &config) : config_(config) {
+}
+
+UThreadPipelinePool::~UThreadPipelinePool() {
+}
+
+bool UThreadPipelinePool::enabled() const {
+    return 0 < config_.GetPipelinesPerEndpoint();
+}
+
+UThreadPipelinedConnection *UThreadPipelinePool::Get(UThreadEpollScheduler *scheduler,
+                                                     const Endpoint_t &ep) {
+    vector<unique_ptr<UThreadPipelinedConnection>> *conns{nullptr};
+    {
+        lock_guard<mutex> lock(mutex_);
+
+        auto &endpoints(schedulers_[scheduler]);
+        if (endpoints.size() <= static_cast<size_t>(ep.index))
+            endpoints.resize(max(config_.GetEndpointCount(), static_cast<size_t>(ep.index) + 1));
+
+        conns = &endpoints[ep.index];
+        while (conns->size() < static_cast<size_t>(config_.GetPipelinesPerEndpoint()))
+            conns->emplace_back(new UThreadPipelinedConnection(scheduler, config_, ep));
+    }
+
+    // the rest is only touched by the thread of scheduler
+    UThreadPipelinedConnection *least{nullptr};
+    for (auto &conn : *conns) {
+        conn->Check();
+        if (conn->usable() && (!least || conn->in_flight() < least->in_flight()))
+            least = conn.get();
+    }
+
+    if (!least) {
+        log(LOG_ERR, "%s %s:%d no usable connection", __func__, ep.ip, ep.port);
+    }
+
+    return least;
+}
+
+
+}  // namespace phxrpc
+
@@ -0,0 +1,136 @@
+/*
+Tencent is pleased to support the open source community by making
+PhxRPC available.
+Copyright (C) 2016 THL A29 Limited, a Tencent company.
+All rights reserved.
+
+Licensed under the BSD 3-Clause License (the "License"); you may
+not use this file except in compliance with the License. You may
+obtain a copy of the License at
+
+https://opensource.org/licenses/BSD-3-Clause
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" basis,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+implied. See the License for the specific language governing
+permissions and limitations under the License.
+
+See the AUTHORS file for names of contributors.
+*/
+
+
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "client_config.h"
+#include "phxrpc/network.h"
+
+
+namespace phxrpc {
+
+
+class BaseMessageHandler;
+class BaseRequest;
+class BaseResponse;
+class ClientMonitor;
+
+// a connection the uthreads of one scheduler call over all at once, by HTTP pipelining:
+// requests go out back to back, those made while one is being written go out together
+// in the next write, and responses, coming back in the order of the requests, are read
+// by each call in its turn
+class UThreadPipelinedConnection {
+  public:
+    // a request sent and its response not read yet
+    struct Ticket {
+        UThreadSocket_t *waiter{nullptr};
+    };
+
+    UThreadPipelinedConnection(UThreadEpollScheduler *scheduler, ClientConfig &config,
+                               const Endpoint_t &ep);
+    ~UThreadPipelinedConnection();
+
+    // queues req, connecting first if closed, ticket is to be given to RecvResponse
+    // once this returns 0, nullptr for a one-way req, which has no response to read;
+    // req is written after this returns, a write failing fails the calls in RecvResponse
+    int Send(const BaseRequest &req, ClientMonitor &client_monitor, Ticket **ticket);
+
+    // waits for the responses of the requests sent before, then reads its own
+    int RecvResponse(Ticket *ticket, BaseMessageHandler *msg_handler, BaseResponse *&resp);
+
+    // closes it if broken, idle too long or closed by the peer, only while idle,
+    // the next Send connects again
+    void Check();
+
+    UThreadTcpStream &stream();
+
+    // requests sent and not answered yet
+    size_t in_flight() const;
+
+    // false once a call over it failed, till it is idle and Checked
+    bool usable() const;
+
+  private:
+    bool Connect(ClientMonitor &client_monitor);
+
+    // writes out_ till it is empty, with writing_ set
+    void Flush();
+
+    // tells all calls waiting for their turn that they won't get one
+    void Break();
+
+    UThreadEpollScheduler *scheduler_{nullptr};
+    ClientConfig &config_;
+    const Endpoint_t ep_;
+
+    std::unique_ptr<UThreadTcpStream> stream_;
+    // over a dup of the fd of stream_, a UThreadSocket_t takes one waiter at a time, so
+    // the uthread writing can't wait on the one the call reading waits on
+    std::unique_ptr<UThreadTcpStream> writer_;
+    bool connected_{false};
+    bool broken_{false};
+    uint64_t last_used_ms_{0};
+
+    // bytes of the requests waiting for the uthread writing now
+    std::string out_;
+    std::string batch_;
+    bool writing_{false};
+
+    std::deque<Ticket *> tickets_;
+};
+
+// for uthread clients, up to [ConnectionPool] PipelinesPerEndpoint pipelined
+// connections to each endpoint, per UThreadEpollScheduler, in place of a connection
+// for each call in flight
+class UThreadPipelinePool {
+  public:
+    explicit UThreadPipelinePool(ClientConfig &config);
+    ~UThreadPipelinePool();
+
+    // false with PipelinesPerEndpoint 0, calls are to take connections from a
+    // UThreadConnectionPool then
+    bool enabled() const;
+
+    // the connection to ep with the fewest calls in flight, nullptr if all are broken
+    // and still busy
+    UThreadPipelinedConnection *Get(UThreadEpollScheduler *scheduler, const Endpoint_t &ep);
+
+  private:
+    ClientConfig &config_;
+    std::mutex mutex_;
+
+    std::map<UThreadEpollScheduler *,
+             std::vector<std::vector<std::unique_ptr<UThreadPipelinedConnection>>>> schedulers_;
+};
+
+
+}  // namespace phxrpc
+
@@ -0,0 +1,104 @@
+/*
+Tencent is pleased to support the open source community by making
+PhxRPC available.
+Copyright (C) 2016 THL A29 Limited, a Tencent company.
+All rights reserved.
+
+Licensed under the BSD 3-Clause License (the "License"); you may
+not use this file except in compliance with the License. You may
+obtain a copy of the License at
+
+https://opensource.org/licenses/BSD-3-Clause
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" basis,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+implied. See the License for the specific language governing
+permissions and limitations under the License.
+
+See the AUTHORS file for names of contributors.
+*/
+
+
+
+#include "response_cache.h"
+
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/io/zero_copy_stream_impl_lite.h>
+#include <google/protobuf/message.h>
+
+#include "client_config.h"
+#include "client_monitor.h"
+
+
+namespace phxrpc {
+
+
+using namespace std;
+
+
+namespace {
+
+
+// equal requests make equal keys, maps included
+bool AppendRequest(const google::protobuf::Message &req, string *key) {
+    google::protobuf::io::StringOutputStream output(key);
+    google::protobuf::io::CodedOutputStream stream(&output);
+    stream.SetSerializationDeterministic(true);
+
+    return req.SerializeToCodedStream(&stream);
+}
+
+
+}  // namespace
+
+
+ResponseCache::ResponseCache(ClientConfig &config) : config_(config) {
+}
+
+ResponseCache::~ResponseCache() {
+}
+
+int ResponseCache::Call(const char *uri, const google::protobuf::Message &req,
+                        google::protobuf::Message *resp, const int ttl_ms,
+                        ClientMonitor &client_monitor, UThreadEpollScheduler *scheduler,
+                        CallFunc call) {
+    // read after this is made, as it is a global of the client
+    table_.set_max_entries(config_.GetCacheMaxEntries());
+
+    string key(uri);
+    key.push_back('\0');
+    if (0 >= table_.max_entries() || !AppendRequest(req, &key))
+        return call();
+
+    string value;
+    shared_ptr<CacheTable::Flight> flight;
+    int ret{0};
+    switch (table_.Lookup(key, 0, scheduler, config_.GetSocketTimeoutMS(),
+                          &value, &flight, &ret)) {
+        case CacheSource::MISS:
+            client_monitor.ClientCacheMiss(uri);
+
+            ret = call();
+            value.clear();
+            if (0 == ret && !resp->SerializeToString(&value))
+                ret = -1;
+            table_.Fill(flight, ret, value, ttl_ms);
+
+            return ret;
+        case CacheSource::COALESCED:
+            client_monitor.ClientCacheCoalesce(uri);
+            break;
+        default:
+            client_monitor.ClientCacheHit(uri);
+    }
+
+    if (0 != ret)
+        return ret;
+
+    return resp->ParseFromString(value) ? 0 : -1;
+}
+
+
+}  // namespace phxrpc
+
@@ -0,0 +1,75 @@
+/*
+Tencent is pleased to support the open source community by making
+PhxRPC available.
+Copyright (C) 2016 THL A29 Limited, a Tencent company.
+All rights reserved.
+
+Licensed under the BSD 3-Clause License (the "License"); you may
+not use this file except in compliance with the License. You may
+obtain a copy of the License at
+
+https://opensource.org/licenses/BSD-3-Clause
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" basis,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+implied. See the License for the specific language governing
+permissions and limitations under the License.
+
+See the AUTHORS file for names of contributors.
+*/
+
+
+
+#pragma once
+
+#include <functional>
+
+#include "cache_table.h"
+
+
+namespace google {
+
+namespace protobuf {
+
+
+class Message;
+
+
+}
+
+}
+
+
+namespace phxrpc {
+
+
+class ClientConfig;
+class ClientMonitor;
+class UThreadEpollScheduler;
+
+// responses of methods marked option (phxrpc.CacheTTLMS), kept for that long, keyed by
+// uri and the serialized request, up to [Cache] MaxEntries of them
+class ResponseCache {
+  public:
+    // fills the resp given to Call
+    typedef std::function<int()> CallFunc;
+
+    explicit ResponseCache(ClientConfig &config);
+    ~ResponseCache();
+
+    // resp from the cache if there and not older than ttl_ms, or else from call, which
+    // goes out once for identical requests made at the same time, the others waiting
+    // for its response, in a uthread of scheduler if it is not nullptr
+    int Call(const char *uri, const google::protobuf::Message &req,
+             google::protobuf::Message *resp, const int ttl_ms,
+             ClientMonitor &client_monitor, UThreadEpollScheduler *scheduler, CallFunc call);
+
+  private:
+    ClientConfig &config_;
+    CacheTable table_;
+};
+
+
+}  // namespace phxrpc
+
@@ -21,6 +21,8 @@ See the AUTHORS file for names of contributors.
 
 #pragma once
 
+#include <functional>
+
 #include "server_monitor.h"
 #include "phxrpc/network.h"
 
@@ -28,13 +30,19 @@ See the AUTHORS file for names of contributors.
 namespace phxrpc {
 
 
+class BaseResponse;
 class DataFlow;
+class ServerResponseCache;
 
 typedef struct tagDispatcherArgs {
     ServerMonitorPtr server_monitor;
     UThreadEpollScheduler *server_worker_uthread_scheduler{nullptr};
     void *service_args{nullptr};
     void *data_flow_args{nullptr};
+    // hands the frames of a server-streaming response to the io thread
+    std::function<void (BaseResponse *)> stream_notify_func;
+    // of the methods marked phxrpc.ServerCacheTTLMS, see ServerCacheCall
+    ServerResponseCache *response_cache{nullptr};
 
     tagDispatcherArgs(ServerMonitorPtr server_monitor_value,
                       UThreadEpollScheduler *const server_worker_uthread_scheduler_value,
@@ -23,6 +23,7 @@ See the AUTHORS file for names of contributors.
 
 #include "server_config.h"
 #include "phxrpc/file.h"
+#include "phxrpc/http/http_protocol.h"
 
 
 namespace phxrpc {
@@ -148,7 +149,14 @@ HshaServerConfig::HshaServerConfig()
     fast_reject_adjust_rate_(5),
     io_thread_count_(3),
     worker_uthread_count_(0),
-    worker_uthread_stack_size_(64 * 1024) {
+    worker_uthread_stack_size_(64 * 1024),
+    request_arena_size_(0),
+    server_cache_max_entries_(10000),
+    server_cache_max_stale_ms_(0),
+    shm_ring_size_(0),
+    zero_copy_min_bytes_(0),
+    max_body_bytes_(HttpProtocol::DEFAULT_MAX_BODY_SIZE) {
+    memset(unix_socket_path_, 0, sizeof(unix_socket_path_));
 }
 
 HshaServerConfig::~HshaServerConfig() {
@@ -165,6 +173,15 @@ bool HshaServerConfig::DoRead(Config &config) {
     config.ReadItem(server_section_name, "MaxQueueLength", &max_queue_length_, 20480);
     config.ReadItem(server_section_name, "FastRejectThresholdMS", &fast_reject_threshold_ms_, 20);
     config.ReadItem(server_section_name, "FastRejectAdjustRate", &fast_reject_adjust_rate_, 5);
+    config.ReadItem(server_section_name, "RequestArenaSize", &request_arena_size_, 0);
+    config.ReadItem(server_section_name, "UnixSocketPath", unix_socket_path_,
+                    sizeof(unix_socket_path_), "");
+    config.ReadItem(server_section_name, "ShmRingSize", &shm_ring_size_, 0);
+    config.ReadItem(server_section_name, "ZeroCopyMinBytes", &zero_copy_min_bytes_, 0);
+    config.ReadItem(server_section_name, "MaxBodyBytes", &max_body_bytes_,
+                    HttpProtocol::DEFAULT_MAX_BODY_SIZE);
+    config.ReadItem("ServerCache", "MaxEntries", &server_cache_max_entries_, 10000);
+    config.ReadItem("ServerCache", "MaxStaleMS", &server_cache_max_stale_ms_, 0);
     return true;
 }
 
@@ -224,6 +241,62 @@ int HshaServerConfig::GetWorkerUThreadStackSize() const {
     return worker_uthread_stack_size_;
 }
 
+void HshaServerConfig::SetRequestArenaSize(const int request_arena_size) {
+    request_arena_size_ = request_arena_size;
+}
+
+int HshaServerConfig::GetRequestArenaSize() const {
+    return request_arena_size_;
+}
+
+void HshaServerConfig::SetServerCacheMaxEntries(const int server_cache_max_entries) {
+    server_cache_max_entries_ = server_cache_max_entries;
+}
+
+int HshaServerConfig::GetServerCacheMaxEntries() const {
+    return server_cache_max_entries_;
+}
+
+void HshaServerConfig::SetServerCacheMaxStaleMS(const int server_cache_max_stale_ms) {
+    server_cache_max_stale_ms_ = server_cache_max_stale_ms;
+}
+
+int HshaServerConfig::GetServerCacheMaxStaleMS() const {
+    return server_cache_max_stale_ms_;
+}
+
+void HshaServerConfig::SetUnixSocketPath(const char *unix_socket_path) {
+    snprintf(unix_socket_path_, sizeof(unix_socket_path_), "%s", unix_socket_path);
+}
+
+const char *HshaServerConfig::GetUnixSocketPath() const {
+    return unix_socket_path_;
+}
+
+void HshaServerConfig::SetShmRingSize(const int shm_ring_size) {
+    shm_ring_size_ = shm_ring_size;
+}
+
+int HshaServerConfig::GetShmRingSize() const {
+    return shm_ring_size_;
+}
+
+void HshaServerConfig::SetZeroCopyMinBytes(const int zero_copy_min_bytes) {
+    zero_copy_min_bytes_ = zero_copy_min_bytes;
+}
+
+int HshaServerConfig::GetZeroCopyMinBytes() const {
+    return zero_copy_min_bytes_;
+}
+
+void HshaServerConfig::SetMaxBodyBytes(const int max_body_bytes) {
+    max_body_bytes_ = max_body_bytes;
+}
+
+int HshaServerConfig::GetMaxBodyBytes() const {
+    return max_body_bytes_;
+}
+
 
 }  // namespace phxrpc
 
@@ -103,6 +103,39 @@ class HshaServerConfig : public ServerConfig {
     void SetWorkerUThreadStackSize(const int worker_uthread_stack_size);
     int GetWorkerUThreadStackSize() const;
 
+    // block size of the per-request arena, 0 allocates requests on the heap
+    void SetRequestArenaSize(const int request_arena_size);
+    int GetRequestArenaSize() const;
+
+    // responses kept by methods marked phxrpc.ServerCacheTTLMS, 0 turns the cache off
+    void SetServerCacheMaxEntries(const int server_cache_max_entries);
+    int GetServerCacheMaxEntries() const;
+
+    // how long past its ttl a cached response may still answer while requests are
+    // fast rejected
+    void SetServerCacheMaxStaleMS(const int server_cache_max_stale_ms);
+    int GetServerCacheMaxStaleMS() const;
+
+    // a Unix socket to listen on as well, for callers on the same host, only on it if Port
+    // is 0, none if empty
+    void SetUnixSocketPath(const char *unix_socket_path);
+    const char *GetUnixSocketPath() const;
+
+    // bytes of each way of the ShmChannel offered to callers asking for one on the Unix
+    // socket, 0 offers none
+    void SetShmRingSize(const int shm_ring_size);
+    int GetShmRingSize() const;
+
+    // responses of this many bytes or more are sent with MSG_ZEROCOPY where the kernel
+    // supports it, 0 sends all with a copy
+    void SetZeroCopyMinBytes(const int zero_copy_min_bytes);
+    int GetZeroCopyMinBytes() const;
+
+    // requests with a larger body are refused and their connections closed, see
+    // HttpProtocol::SetMaxBodySize
+    void SetMaxBodyBytes(const int max_body_bytes);
+    int GetMaxBodyBytes() const;
+
   private:
     int max_connections_;
     int max_queue_length_;
@@ -111,6 +144,13 @@ class HshaServerConfig : public ServerConfig {
     int io_thread_count_;
     int worker_uthread_count_;
     int worker_uthread_stack_size_;
+    int request_arena_size_;
+    int server_cache_max_entries_;
+    int server_cache_max_stale_ms_;
+    char unix_socket_path_[108];
+    int shm_ring_size_;
+    int zero_copy_min_bytes_;
+    int max_body_bytes_;
 };
 
 
@@ -84,6 +84,24 @@ void ServerMonitor :: WaitInOutQueue( uint64_t cost_ms ) {
 void ServerMonitor :: SvrCall( int cmdid, const char * method_name, int count ) {
 }
 
+void ServerMonitor :: SvrCacheHit( const char * method_name ) {
+}
+
+void ServerMonitor :: SvrCacheMiss( const char * method_name ) {
+}
+
+void ServerMonitor :: SvrCacheCoalesce( const char * method_name ) {
+}
+
+void ServerMonitor :: SvrCacheStale( const char * method_name ) {
+}
+
+void ServerMonitor :: SvrEncode( const char * coding, size_t raw_bytes, size_t wire_bytes, uint64_t cost_us ) {
+}
+
+void ServerMonitor :: SendZeroCopyBytes( size_t bytes ) {
+}
+
 //ServerMonitor end
 
 }
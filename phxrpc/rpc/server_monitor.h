@@ -66,6 +66,24 @@ class ServerMonitor {
     virtual void WaitInOutQueue( uint64_t cost_ms );
 
     virtual void SvrCall( int cmdid, const char * method_name, int count );
+
+    // a request answered from the response cache
+    virtual void SvrCacheHit( const char * method_name );
+
+    // a request not in the response cache, handled by the service
+    virtual void SvrCacheMiss( const char * method_name );
+
+    // a request waited for the response to an equal one being handled
+    virtual void SvrCacheCoalesce( const char * method_name );
+
+    // a request answered by an expired response, as the server is overloaded
+    virtual void SvrCacheStale( const char * method_name );
+
+    // a response body of raw_bytes sent as wire_bytes in coding, compressing took cost_us
+    virtual void SvrEncode( const char * coding, size_t raw_bytes, size_t wire_bytes, uint64_t cost_us );
+
+    // of the SendBytes, those the kernel sent with no copy, see ZeroCopyMinBytes
+    virtual void SendZeroCopyBytes( size_t bytes );
 };
 
 typedef std::shared_ptr<ServerMonitor> ServerMonitorPtr;
@@ -0,0 +1,119 @@
+/*
+Tencent is pleased to support the open source community by making
+PhxRPC available.
+Copyright (C) 2016 THL A29 Limited, a Tencent company.
+All rights reserved.
+
+Licensed under the BSD 3-Clause License (the "License"); you may
+not use this file except in compliance with the License. You may
+obtain a copy of the License at
+
+https://opensource.org/licenses/BSD-3-Clause
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" basis,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+implied. See the License for the specific language governing
+permissions and limitations under the License.
+
+See the AUTHORS file for names of contributors.
+*/
+
+
+
+#include "server_response_cache.h"
+
+#include "phxrpc/http.h"
+
+
+namespace phxrpc {
+
+
+using namespace std;
+
+
+ServerResponseCache::ServerResponseCache(const int max_entries, const int max_stale_ms,
+                                         const int wait_timeout_ms,
+                                         function<bool()> is_overloaded)
+        : max_stale_ms_(max_stale_ms), wait_timeout_ms_(wait_timeout_ms),
+          is_overloaded_(is_overloaded) {
+    table_.set_max_entries(max_entries);
+}
+
+ServerResponseCache::~ServerResponseCache() {
+}
+
+
+ServerCacheCall::ServerCacheCall(DispatcherArgs_t *const args, const char *const method_name,
+                                 const BaseRequest &req, BaseResponse *const resp,
+                                 const int ttl_ms)
+        : resp_(resp), ttl_ms_(ttl_ms) {
+    const HttpRequest *http_req{dynamic_cast<const HttpRequest *>(&req)};
+    if (nullptr == args->response_cache || 0 >= args->response_cache->table_.max_entries() ||
+        nullptr == http_req || nullptr == dynamic_cast<HttpResponse *>(resp))
+        return;
+
+    cache_ = args->response_cache;
+
+    // the bytes of equal requests are equal, as long as clients serialize alike
+    string key(req.uri());
+    key.push_back('\0');
+    key.append(http_req->content());
+
+    const int max_stale_ms{cache_->is_overloaded_() ? cache_->max_stale_ms_ : 0};
+    string value;
+    switch (cache_->table_.Lookup(key, max_stale_ms, args->server_worker_uthread_scheduler,
+                                  cache_->wait_timeout_ms_, &value, &flight_, &result_)) {
+        case CacheSource::MISS:
+            args->server_monitor->SvrCacheMiss(method_name);
+
+            return;
+        case CacheSource::COALESCED:
+            args->server_monitor->SvrCacheCoalesce(method_name);
+            break;
+        case CacheSource::STALE:
+            args->server_monitor->SvrCacheStale(method_name);
+            break;
+        default:
+            args->server_monitor->SvrCacheHit(method_name);
+    }
+
+    hit_ = true;
+    if (0 == result_)
+        dynamic_cast<HttpResponse *>(resp)->set_content(value.data(), value.size());
+}
+
+ServerCacheCall::~ServerCacheCall() {
+    // returned early, those waiting get an error rather than wait forever
+    if (flight_)
+        Done(-1);
+}
+
+bool ServerCacheCall::hit() const {
+    return hit_;
+}
+
+int ServerCacheCall::result() const {
+    return result_;
+}
+
+int ServerCacheCall::Done(const int ret) {
+    if (!flight_)
+        return ret;
+
+    shared_ptr<CacheTable::Flight> flight;
+    flight.swap(flight_);
+
+    if (0 == ret) {
+        cache_->table_.Fill(flight, ret, dynamic_cast<HttpResponse *>(resp_)->content(),
+                            ttl_ms_);
+    } else {
+        cache_->table_.Fill(flight, ret, string(), ttl_ms_);
+    }
+
+    return ret;
+}
+
+
+}  // namespace phxrpc
+
@@ -0,0 +1,88 @@
+/*
+Tencent is pleased to support the open source community by making
+PhxRPC available.
+Copyright (C) 2016 THL A29 Limited, a Tencent company.
+All rights reserved.
+
+Licensed under the BSD 3-Clause License (the "License"); you may
+not use this file except in compliance with the License. You may
+obtain a copy of the License at
+
+https://opensource.org/licenses/BSD-3-Clause
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" basis,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+implied. See the License for the specific language governing
+permissions and limitations under the License.
+
+See the AUTHORS file for names of contributors.
+*/
+
+
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "cache_table.h"
+#include "server_base.h"
+
+
+namespace phxrpc {
+
+
+class BaseRequest;
+class BaseResponse;
+
+// responses of methods marked option (phxrpc.ServerCacheTTLMS), up to [ServerCache]
+// MaxEntries of them, shared by the workers of a server
+class ServerResponseCache {
+  public:
+    // is_overloaded tells whether expired responses may answer, see MaxStaleMS, an equal
+    // request waits up to wait_timeout_ms for the one handled, then is handled as well
+    ServerResponseCache(const int max_entries, const int max_stale_ms,
+                        const int wait_timeout_ms, std::function<bool()> is_overloaded);
+    ~ServerResponseCache();
+
+  private:
+    friend class ServerCacheCall;
+
+    const int max_stale_ms_{0};
+    const int wait_timeout_ms_{0};
+    std::function<bool()> is_overloaded_;
+    CacheTable table_;
+};
+
+
+// one request to a cached method, answered from the cache if hit(), else handled by the
+// dispatcher, which gives what it returns to Done, equal requests at the same time wait
+// for that then
+class ServerCacheCall {
+  public:
+    ServerCacheCall(DispatcherArgs_t *const args, const char *const method_name,
+                    const BaseRequest &req, BaseResponse *const resp, const int ttl_ms);
+    ~ServerCacheCall();
+
+    // resp has the body of a cached response
+    bool hit() const;
+    // of the cached response, if hit()
+    int result() const;
+
+    // keeps the body of resp if ret is 0, returns ret
+    int Done(const int ret);
+
+  private:
+    ServerResponseCache *cache_{nullptr};
+    BaseResponse *resp_{nullptr};
+    const int ttl_ms_{0};
+    bool hit_{false};
+    int result_{-1};
+    std::shared_ptr<CacheTable::Flight> flight_;
+};
+
+
+}  // namespace phxrpc
+
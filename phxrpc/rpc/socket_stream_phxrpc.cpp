@@ -52,6 +52,50 @@ bool PhxrpcTcpUtils::Open(UThreadEpollScheduler *tt, UThreadTcpStream *stream,
     return ret;
 }
 
+bool PhxrpcTcpUtils::Open(BlockTcpStream *stream, const Endpoint_t &ep,
+                          int connect_timeout_ms, ClientMonitor &client_monitor) {
+    if (0 == ep.addr.ss_family) {
+        return Open(stream, ep.ip, ep.port, connect_timeout_ms, nullptr, 0, client_monitor);
+    }
+
+    bool ret = BlockTcpUtils::Open(stream, (const struct sockaddr *)&ep.addr,
+                                   ep.addrlen, connect_timeout_ms);
+    if (ret && ep.shm) {
+        ret = ShmStreamUtils::Open(stream, connect_timeout_ms);
+    }
+    client_monitor.ClientConnect(ret);
+    if (!ret && nullptr != ep.stat) {
+        ep.stat->ConnectFail(client_monitor);
+    }
+
+    return ret;
+}
+
+bool PhxrpcTcpUtils::Open(UThreadEpollScheduler *tt, UThreadTcpStream *stream,
+                          const Endpoint_t &ep, int connect_timeout_ms,
+                          ClientMonitor &client_monitor) {
+    if (0 == ep.addr.ss_family) {
+        return Open(tt, stream, ep.ip, ep.port, connect_timeout_ms, client_monitor);
+    }
+
+    bool ret = UThreadTcpUtils::Open(tt, stream, (const struct sockaddr *)&ep.addr,
+                                     ep.addrlen, connect_timeout_ms);
+    if (ret && ep.shm) {
+        ret = ShmStreamUtils::Open(tt, stream, connect_timeout_ms);
+    }
+    if (!ret && errno == 0) {
+        //normal active close
+        client_monitor.ClientConnect(true);
+    } else {
+        client_monitor.ClientConnect(ret);
+        if (!ret && nullptr != ep.stat) {
+            ep.stat->ConnectFail(client_monitor);
+        }
+    }
+
+    return ret;
+}
+
 
 }  // namespace phxrpc
 
@@ -21,6 +21,7 @@ See the AUTHORS file for names of contributors.
 
 #pragma once
 
+#include "client_config.h"
 #include "client_monitor.h"
 #include "phxrpc/network.h"
 
@@ -38,6 +39,14 @@ class PhxrpcTcpUtils {
     static bool Open(UThreadEpollScheduler *tt, UThreadTcpStream *stream,
                      const char *ip, unsigned short port,
                      int connect_timeout_ms, ClientMonitor &client_monitor);
+
+    // to the address resolved by ClientConfig, or to ip if it is not resolved
+    static bool Open(BlockTcpStream *stream, const Endpoint_t &ep,
+                     int connect_timeout_ms, ClientMonitor &client_monitor);
+
+    static bool Open(UThreadEpollScheduler *tt, UThreadTcpStream *stream,
+                     const Endpoint_t &ep, int connect_timeout_ms,
+                     ClientMonitor &client_monitor);
 };
 
 
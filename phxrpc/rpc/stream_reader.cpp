@@ -0,0 +1,102 @@
+/*
+Tencent is pleased to support the open source community by making
+PhxRPC available.
+Copyright (C) 2016 THL A29 Limited, a Tencent company.
+All rights reserved.
+
+Licensed under the BSD 3-Clause License (the "License"); you may
+not use this file except in compliance with the License. You may
+obtain a copy of the License at
+
+https://opensource.org/licenses/BSD-3-Clause
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" basis,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+implied. See the License for the specific language governing
+permissions and limitations under the License.
+
+See the AUTHORS file for names of contributors.
+*/
+
+
+#include "phxrpc/rpc/stream_reader.h"
+
+#include <syslog.h>
+
+#include "phxrpc/file.h"
+#include "phxrpc/network.h"
+
+
+namespace phxrpc {
+
+
+using namespace std;
+
+
+BaseStreamReader::BaseStreamReader() {
+}
+
+BaseStreamReader::~BaseStreamReader() {
+}
+
+void BaseStreamReader::Reset(BaseTcpStream *socket, BaseResponse *resp) {
+    socket_ = socket;
+    resp_.reset(resp);
+    data_.clear();
+    pos_ = 0;
+    finished_ = false;
+    result_ = -1;
+}
+
+void BaseStreamReader::HoldSocket(unique_ptr<BaseTcpStream> socket) {
+    held_socket_ = move(socket);
+}
+
+int BaseStreamReader::Read(google::protobuf::Message *message) {
+    if (!resp_) {
+        return -1;
+    }
+
+    while (true) {
+        int ret{ResponseStream::ParseFrame(data_, &pos_, message)};
+        if (0 != ret) {
+            if (0 > ret) {
+                log(LOG_ERR, "ParseFrame err %d", ret);
+            }
+
+            return ret;
+        }
+
+        if (finished_) {
+            if (data_.size() != pos_) {
+                log(LOG_ERR, "stream truncated, %zu bytes left", data_.size() - pos_);
+
+                return -1;
+            }
+
+            return 0;
+        }
+
+        // only an incomplete frame is left, drop what has been parsed
+        if (0 < pos_) {
+            data_.erase(0, pos_);
+            pos_ = 0;
+        }
+
+        ret = resp_->RecvStream(*socket_, &data_, &finished_);
+        if (0 != ret) {
+            log(LOG_ERR, "RecvStream err %d", ret);
+
+            return 0 > ret ? ret : -1;
+        }
+
+        if (finished_) {
+            result_ = resp_->result();
+        }
+    }
+}
+
+
+}  // namespace phxrpc
+
@@ -0,0 +1,84 @@
+/*
+Tencent is pleased to support the open source community by making
+PhxRPC available.
+Copyright (C) 2016 THL A29 Limited, a Tencent company.
+All rights reserved.
+
+Licensed under the BSD 3-Clause License (the "License"); you may
+not use this file except in compliance with the License. You may
+obtain a copy of the License at
+
+https://opensource.org/licenses/BSD-3-Clause
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" basis,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+implied. See the License for the specific language governing
+permissions and limitations under the License.
+
+See the AUTHORS file for names of contributors.
+*/
+
+
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include "phxrpc/msg.h"
+
+
+namespace google {
+
+namespace protobuf {
+
+class Message;
+
+}  // protobuf
+
+}  // google
+
+
+namespace phxrpc {
+
+
+class BaseTcpStream;
+
+// pulls the messages of a server-streaming response one at a time,
+// reading from the connection only when the buffered frames run out
+class BaseStreamReader {
+  public:
+    BaseStreamReader();
+    virtual ~BaseStreamReader();
+
+    // 1 if a message is read, 0 at the end of the stream with result()
+    // holding what the handler returned, <0 on error
+    int Read(google::protobuf::Message *message);
+    int result() const { return result_; }
+
+    // set by Caller::CallStream once the head is received, takes resp
+    void Reset(BaseTcpStream *socket, BaseResponse *resp);
+    // keeps the connection open as long as the reader is
+    void HoldSocket(std::unique_ptr<BaseTcpStream> socket);
+
+  private:
+    std::unique_ptr<BaseTcpStream> held_socket_;
+    BaseTcpStream *socket_{nullptr};
+    std::unique_ptr<BaseResponse> resp_;
+    std::string data_;
+    // parsed up to
+    size_t pos_{0};
+    bool finished_{false};
+    int result_{-1};
+};
+
+
+template <typename Message>
+class StreamReader : public BaseStreamReader {
+  public:
+    int Read(Message *message) { return BaseStreamReader::Read(message); }
+};
+
+
+}  // namespace phxrpc
+
@@ -0,0 +1,224 @@
+/*
+Tencent is pleased to support the open source community by making
+PhxRPC available.
+Copyright (C) 2016 THL A29 Limited, a Tencent company.
+All rights reserved.
+
+Licensed under the BSD 3-Clause License (the "License"); you may
+not use this file except in compliance with the License. You may
+obtain a copy of the License at
+
+https://opensource.org/licenses/BSD-3-Clause
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" basis,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+implied. See the License for the specific language governing
+permissions and limitations under the License.
+
+See the AUTHORS file for names of contributors.
+*/
+
+#include <assert.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cache_table.h"
+
+#include "phxrpc/network.h"
+
+
+using namespace phxrpc;
+using namespace std;
+
+
+namespace {
+
+
+// as many as CacheTable has, max_entries is split among them
+const int SHARD_COUNT{16};
+
+
+void Put(CacheTable *table, const string &key, const string &value, const int ttl_ms) {
+    string found;
+    shared_ptr<CacheTable::Flight> flight;
+    int ret{-1};
+    assert(CacheSource::MISS == table->Lookup(key, 0, nullptr, 0, &found, &flight, &ret));
+    table->Fill(flight, 0, value, ttl_ms);
+}
+
+CacheSource Get(CacheTable *table, const string &key, const int max_stale_ms,
+                string *value) {
+    shared_ptr<CacheTable::Flight> flight;
+    int ret{-1};
+    const CacheSource source{table->Lookup(key, max_stale_ms, nullptr, 0, value, &flight, &ret)};
+    // not to leave a flight for the next lookup to wait for
+    if (CacheSource::MISS == source)
+        table->Fill(flight, -1, "", 0);
+
+    return source;
+}
+
+void Sleep(UThreadEpollScheduler *scheduler, const int ms) {
+    UThreadSocket_t *waiter{NewUThreadWaiter(scheduler)};
+    UThreadWait(*waiter, ms);
+    free(waiter);
+}
+
+// 2 entries a shard, the least recently used of 3 keys in one shard goes
+void Lru() {
+    CacheTable table;
+    table.set_max_entries(2 * SHARD_COUNT);
+
+    vector<string> keys;
+    const size_t shard{hash<string>()("key0") % SHARD_COUNT};
+    for (int i{0}; 3 > keys.size(); ++i) {
+        const string key("key" + to_string(i));
+        if (shard == hash<string>()(key) % SHARD_COUNT)
+            keys.push_back(key);
+    }
+
+    string value;
+    Put(&table, keys[0], "a", 10000);
+    Put(&table, keys[1], "b", 10000);
+    assert(CacheSource::HIT == Get(&table, keys[0], 0, &value) && "a" == value);
+
+    Put(&table, keys[2], "c", 10000);
+    assert(CacheSource::MISS == Get(&table, keys[1], 0, &value));
+    assert(CacheSource::HIT == Get(&table, keys[0], 0, &value) && "a" == value);
+    assert(CacheSource::HIT == Get(&table, keys[2], 0, &value) && "c" == value);
+
+    printf("lru eviction ok\n");
+}
+
+// an expired entry is still found within max_stale_ms, and a lookup waiting for a
+// stuck flight gives up after its timeout with a flight of its own
+void Stale() {
+    CacheTable table;
+    table.set_max_entries(100);
+
+    string value;
+    Put(&table, "key", "old", 20);
+    assert(CacheSource::HIT == Get(&table, "key", 0, &value) && "old" == value);
+    usleep(40 * 1000);
+    assert(CacheSource::STALE == Get(&table, "key", 1000, &value) && "old" == value);
+
+    shared_ptr<CacheTable::Flight> flight, own;
+    int ret{-1};
+    assert(CacheSource::MISS == table.Lookup("key", 0, nullptr, 0, &value, &flight, &ret));
+
+    const uint64_t begin_ms{Timer::GetSteadyClockMS()};
+    assert(CacheSource::MISS == table.Lookup("key", 0, nullptr, 50, &value, &own, &ret));
+    assert(own && own != flight && Timer::GetSteadyClockMS() - begin_ms >= 40);
+
+    table.Fill(own, 0, "own", 10000);
+    assert(CacheSource::HIT == Get(&table, "key", 0, &value) && "own" == value);
+    table.Fill(flight, 0, "new", 10000);
+    assert(CacheSource::HIT == Get(&table, "key", 0, &value) && "new" == value);
+
+    printf("stale lookups ok\n");
+}
+
+// threads looking up a key being filled get what it is filled with, errors too
+void CoalesceThreads(const int fill_ret) {
+    CacheTable table;
+    table.set_max_entries(100);
+
+    string value;
+    shared_ptr<CacheTable::Flight> flight;
+    int ret{-1};
+    assert(CacheSource::MISS == table.Lookup("key", 0, nullptr, 1000, &value, &flight, &ret));
+
+    vector<thread> threads;
+    for (int i{0}; 3 > i; ++i) {
+        threads.emplace_back([&table, fill_ret]() {
+            string value;
+            shared_ptr<CacheTable::Flight> flight;
+            int ret{-1};
+            assert(CacheSource::COALESCED ==
+                   table.Lookup("key", 0, nullptr, 2000, &value, &flight, &ret));
+            assert(!flight && fill_ret == ret && (0 != ret || "filled" == value));
+        });
+    }
+    usleep(50 * 1000);
+    table.Fill(flight, fill_ret, 0 == fill_ret ? "filled" : "", 10000);
+    for (auto &thread : threads)
+        thread.join();
+
+    // a failed fill is not kept
+    assert((0 == fill_ret ? CacheSource::HIT : CacheSource::MISS) ==
+           Get(&table, "key", 0, &value));
+}
+
+// uthreads of the filler's scheduler and of another thread's wait for the fill too
+void CoalesceUThreads() {
+    CacheTable table;
+    table.set_max_entries(100);
+
+    UThreadEpollScheduler filler_scheduler(64 * 1024, 16), other_scheduler(64 * 1024, 16);
+    atomic<bool> filling{false};
+    atomic<int> coalesced{0};
+
+    auto wait_fill = [&table, &coalesced](UThreadEpollScheduler *scheduler) {
+        string value;
+        shared_ptr<CacheTable::Flight> flight;
+        int ret{-1};
+        if (CacheSource::COALESCED ==
+            table.Lookup("key", 0, scheduler, 2000, &value, &flight, &ret) &&
+            0 == ret && "filled" == value)
+            ++coalesced;
+    };
+
+    filler_scheduler.AddTask([&](void *) {
+        string value;
+        shared_ptr<CacheTable::Flight> flight;
+        int ret{-1};
+        assert(CacheSource::MISS ==
+               table.Lookup("key", 0, &filler_scheduler, 2000, &value, &flight, &ret));
+        filling = true;
+
+        Sleep(&filler_scheduler, 100);
+        table.Fill(flight, 0, "filled", 10000);
+    }, nullptr);
+    for (int i{0}; 2 > i; ++i) {
+        filler_scheduler.AddTask([&](void *) {
+            Sleep(&filler_scheduler, 10);
+            wait_fill(&filler_scheduler);
+        }, nullptr);
+    }
+
+    thread other([&]() {
+        while (!filling)
+            usleep(1000);
+        for (int i{0}; 2 > i; ++i)
+            other_scheduler.AddTask([&](void *) { wait_fill(&other_scheduler); }, nullptr);
+        other_scheduler.Run();
+    });
+    filler_scheduler.Run();
+    other.join();
+
+    assert(4 == coalesced);
+}
+
+
+}  // namespace
+
+
+int main(int argc, char **argv) {
+    Lru();
+    Stale();
+
+    CoalesceThreads(0);
+    CoalesceThreads(-1);
+    CoalesceUThreads();
+    printf("coalesced lookups ok\n");
+
+    return 0;
+}
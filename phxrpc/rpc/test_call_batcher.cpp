@@ -0,0 +1,128 @@
+/*
+Tencent is pleased to support the open source community by making
+PhxRPC available.
+Copyright (C) 2016 THL A29 Limited, a Tencent company.
+All rights reserved.
+
+Licensed under the BSD 3-Clause License (the "License"); you may
+not use this file except in compliance with the License. You may
+obtain a copy of the License at
+
+https://opensource.org/licenses/BSD-3-Clause
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" basis,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+implied. See the License for the specific language governing
+permissions and limitations under the License.
+
+See the AUTHORS file for names of contributors.
+*/
+
+#include <assert.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <google/protobuf/wrappers.pb.h>
+
+#include "call_batcher.h"
+#include "phxrpc.pb.h"
+
+
+using namespace phxrpc;
+using namespace std;
+
+
+namespace {
+
+
+// answers the request at each index with its own result and response
+int Echo(const BatchRequest &req, BatchResponse *resp) {
+    for (int i{0}; req.requests_size() > i; ++i) {
+        google::protobuf::StringValue value;
+        assert(value.ParseFromString(req.requests(i)));
+
+        resp->add_results(1000 + stoi(value.value()));
+        value.set_value("echo " + value.value());
+        assert(value.SerializeToString(resp->add_responses()));
+    }
+
+    return 0;
+}
+
+// 10 calls with a max_size of 4 go out as 4, 4 and 2, each caller getting its own back
+void Split() {
+    BatchPolicy policy;
+    policy.window_ms = 500;
+    policy.max_size = 4;
+
+    mutex mutex;
+    vector<int> sizes;
+    CallBatcher batcher("/test/Echo", policy,
+            [&](const BatchRequest &req, BatchResponse *resp) {
+        {
+            lock_guard<std::mutex> lock(mutex);
+            sizes.push_back(req.requests_size());
+        }
+        assert("/test/Echo" == req.uri());
+
+        return Echo(req, resp);
+    });
+
+    vector<thread> threads;
+    for (int i{0}; 10 > i; ++i) {
+        threads.emplace_back([&batcher, i]() {
+            google::protobuf::StringValue req, resp;
+            req.set_value(to_string(i));
+
+            assert(1000 + i == batcher.Call(req, &resp));
+            assert("echo " + to_string(i) == resp.value());
+        });
+    }
+    for (auto &thread : threads)
+        thread.join();
+
+    sort(sizes.begin(), sizes.end());
+    assert((vector<int>{2, 4, 4}) == sizes);
+
+    printf("batches split at max_size ok\n");
+}
+
+// an err of the batch goes to every caller, and so does an answer short of responses
+void Errors() {
+    BatchPolicy policy;
+    policy.window_ms = 1;
+
+    google::protobuf::StringValue req, resp;
+    req.set_value("1");
+
+    CallBatcher failed("/test/Echo", policy,
+            [](const BatchRequest &req, BatchResponse *resp) { return -202; });
+    assert(-202 == failed.Call(req, &resp));
+
+    CallBatcher short_resp("/test/Echo", policy,
+            [](const BatchRequest &req, BatchResponse *resp) {
+        resp->add_results(0);
+
+        return 0;
+    });
+    assert(-1 == short_resp.Call(req, &resp));
+
+    printf("batch errors ok\n");
+}
+
+
+}  // namespace
+
+
+int main(int argc, char **argv) {
+    Split();
+    Errors();
+
+    return 0;
+}
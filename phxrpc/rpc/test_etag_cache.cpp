@@ -0,0 +1,141 @@
+/*
+Tencent is pleased to support the open source community by making
+PhxRPC available.
+Copyright (C) 2016 THL A29 Limited, a Tencent company.
+All rights reserved.
+
+Licensed under the BSD 3-Clause License (the "License"); you may
+not use this file except in compliance with the License. You may
+obtain a copy of the License at
+
+https://opensource.org/licenses/BSD-3-Clause
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" basis,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+implied. See the License for the specific language governing
+permissions and limitations under the License.
+
+See the AUTHORS file for names of contributors.
+*/
+
+#include <assert.h>
+
+#include <cstdio>
+#include <string>
+
+#include <google/protobuf/wrappers.pb.h>
+
+#include "etag.h"
+
+#include "phxrpc/http.h"
+#include "phxrpc/http/http_protocol.h"
+
+
+using namespace phxrpc;
+using namespace std;
+
+
+namespace {
+
+
+// a call of a client with cache to a server answering with body, resp is what came back
+int Call(ETagCache *cache, const string &query, const string &body, HttpResponse *resp,
+         string *etag_sent, google::protobuf::StringValue *resp_pb) {
+    google::protobuf::StringValue req_pb;
+    req_pb.set_value(query);
+
+    HttpRequest req;
+    req.set_uri("/test/Get");
+    assert(0 == req.FromPb(req_pb));
+    string key;
+    cache->Prepare(&req, &key);
+    const char *if_none_match{req.GetHeaderValue("If-None-Match")};
+    etag_sent->assign(nullptr == if_none_match ? "" : if_none_match);
+
+    google::protobuf::StringValue server_pb;
+    server_pb.set_value(body);
+    assert(0 == resp->FromPb(server_pb));
+    resp->set_result(0);
+    assert(0 == ETagUtils::Respond(req, resp, 0));
+
+    return cache->ToPb(key, resp, resp_pb);
+}
+
+// a 304 is answered from the copy kept, a changed body replaces it
+void Revalidate() {
+    ETagCache cache;
+    string etag;
+    google::protobuf::StringValue resp_pb;
+
+    HttpResponse first;
+    assert(0 == Call(&cache, "q", "answer", &first, &etag, &resp_pb));
+    assert(etag.empty() && 200 == first.status_code() && "answer" == resp_pb.value());
+    const string first_etag(first.GetHeaderValue("ETag"));
+
+    HttpResponse not_modified;
+    resp_pb.Clear();
+    assert(0 == Call(&cache, "q", "answer", &not_modified, &etag, &resp_pb));
+    assert(first_etag == etag);
+    assert(HttpProtocol::SC_NOT_MODIFIED == not_modified.status_code());
+    assert(not_modified.content().empty() && "answer" == resp_pb.value());
+
+    HttpResponse changed;
+    assert(0 == Call(&cache, "q", "changed", &changed, &etag, &resp_pb));
+    assert(200 == changed.status_code() && "changed" == resp_pb.value());
+    const string changed_etag(changed.GetHeaderValue("ETag"));
+    assert(first_etag != changed_etag);
+
+    HttpResponse again;
+    resp_pb.Clear();
+    assert(0 == Call(&cache, "q", "changed", &again, &etag, &resp_pb));
+    assert(changed_etag == etag && "changed" == resp_pb.value());
+    assert(HttpProtocol::SC_NOT_MODIFIED == again.status_code());
+
+    // another request has its own
+    HttpResponse other;
+    assert(0 == Call(&cache, "p", "changed", &other, &etag, &resp_pb));
+    assert(etag.empty() && 200 == other.status_code());
+
+    printf("304 answered from the copy ok\n");
+}
+
+// a 304 for a response no longer kept fails rather than come back empty
+void Evicted() {
+    ETagCache cache(1);
+    string etag;
+    google::protobuf::StringValue resp_pb;
+
+    HttpResponse first;
+    assert(0 == Call(&cache, "q", "answer", &first, &etag, &resp_pb));
+
+    google::protobuf::StringValue req_pb;
+    req_pb.set_value("q");
+    HttpRequest req;
+    req.set_uri("/test/Get");
+    assert(0 == req.FromPb(req_pb));
+    string key;
+    cache.Prepare(&req, &key);
+    assert(nullptr != req.GetHeaderValue("If-None-Match"));
+
+    HttpResponse second;
+    assert(0 == Call(&cache, "p", "answer", &second, &etag, &resp_pb));
+
+    HttpResponse not_modified;
+    not_modified.set_status_code(HttpProtocol::SC_NOT_MODIFIED);
+    not_modified.set_result(0);
+    assert(-1 == cache.ToPb(key, &not_modified, &resp_pb));
+
+    printf("304 of an evicted response ok\n");
+}
+
+
+}  // namespace
+
+
+int main(int argc, char **argv) {
+    Revalidate();
+    Evicted();
+
+    return 0;
+}
@@ -0,0 +1,203 @@
+/*
+Tencent is pleased to support the open source community by making
+PhxRPC available.
+Copyright (C) 2016 THL A29 Limited, a Tencent company.
+All rights reserved.
+
+Licensed under the BSD 3-Clause License (the "License"); you may
+not use this file except in compliance with the License. You may
+obtain a copy of the License at
+
+https://opensource.org/licenses/BSD-3-Clause
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" basis,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+implied. See the License for the specific language governing
+permissions and limitations under the License.
+
+See the AUTHORS file for names of contributors.
+*/
+
+#include <assert.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "client_config.h"
+#include "client_monitor.h"
+#include "load_balancer.h"
+
+#include "phxrpc/network.h"
+
+
+using namespace phxrpc;
+using namespace std;
+
+
+namespace {
+
+
+class EjectMonitor : public ClientMonitor {
+  public:
+    virtual void EndpointEject(const char *ip, const int port, const int eject_ms) override {
+        ++ejects;
+        last_eject_ms = eject_ms;
+    }
+
+    virtual void EndpointRestore(const char *ip, const int port) override {
+        ++restores;
+    }
+
+    int ejects{0};
+    int last_eject_ms{0};
+    int restores{0};
+};
+
+
+vector<Endpoint_t> MakeEndpoints(const vector<int> &weights) {
+    vector<Endpoint_t> endpoints(weights.size());
+    for (size_t i{0}; weights.size() > i; ++i) {
+        snprintf(endpoints[i].ip, sizeof(endpoints[i].ip), "127.0.0.%zu", i + 1);
+        endpoints[i].port = 16161;
+        endpoints[i].index = static_cast<int>(i);
+        endpoints[i].weight = weights[i];
+    }
+
+    return endpoints;
+}
+
+// 5:1:1 goes a,a,b,a,c,a,a, and each endpoint gets its weight in every round
+void RoundRobin() {
+    vector<Endpoint_t> endpoints(MakeEndpoints({5, 1, 1}));
+    RoundRobinBalancer balancer;
+    balancer.Reset(endpoints);
+
+    string order;
+    for (int i{0}; 7 > i; ++i)
+        order.push_back('a' + balancer.Select(endpoints)->index);
+    assert("aabacaa" == order);
+
+    endpoints = MakeEndpoints({3, 2, 0});
+    balancer.Reset(endpoints);
+    vector<int> counts(endpoints.size(), 0);
+    for (int i{0}; 6 * 100 > i; ++i)
+        ++counts[balancer.Select(endpoints)->index];
+    // weight 0 counts as 1
+    assert(300 == counts[0] && 200 == counts[1] && 100 == counts[2]);
+
+    printf("round-robin schedule ok\n");
+}
+
+// the slow one of three is never the better of two, and a busy one rarely
+void P2C() {
+    vector<Endpoint_t> endpoints(MakeEndpoints({1, 1, 1}));
+    vector<EndpointStat> stats(endpoints.size());
+    EjectMonitor monitor;
+    for (size_t i{0}; endpoints.size() > i; ++i)
+        endpoints[i].stat = &stats[i];
+
+    const uint64_t now_us{Timer::GetSteadyClockUS()};
+    stats[0].CallEnd(stats[0].CallBegin() - 100 * 1000, false, monitor);
+    assert(stats[0].latency_us(now_us) > 50 * 1000.0);
+
+    P2CBalancer balancer;
+    vector<int> counts(endpoints.size(), 0);
+    for (int i{0}; 1000 > i; ++i)
+        ++counts[balancer.Select(endpoints)->index];
+    assert(0 == counts[0] && 0 < counts[1] && 0 < counts[2]);
+
+    // calls in flight weigh on it too
+    for (int i{0}; 10 > i; ++i)
+        stats[1].CallBegin();
+    counts.assign(endpoints.size(), 0);
+    for (int i{0}; 1000 > i; ++i)
+        ++counts[balancer.Select(endpoints)->index];
+    // the busy one still beats the slow one, so it gets the pairs with it only
+    assert(0 == counts[0] && counts[2] > counts[1] * 3 / 2);
+
+    printf("p2c ok\n");
+}
+
+// closed, open after consecutive_failures, half-open with one probe per interval, open
+// again for twice as long on a failed probe, closed on one that succeeds
+void Ejection() {
+    vector<Endpoint_t> endpoints(MakeEndpoints({1, 1}));
+    vector<EndpointStat> stats(endpoints.size());
+    OutlierPolicy policy;
+    policy.consecutive_failures = 3;
+    policy.base_ejection_ms = 50;
+    policy.max_ejection_ms = 1000;
+    policy.max_ejection_percent = 50;
+    policy.probe_interval_ms = 20;
+    policy.endpoint_count = static_cast<int>(endpoints.size());
+    for (size_t i{0}; endpoints.size() > i; ++i)
+        stats[i].Init(&endpoints[i], &policy);
+
+    EjectMonitor monitor;
+    EndpointStat &stat = stats[0];
+
+    stat.ConnectFail(monitor);
+    stat.ConnectFail(monitor);
+    // a success in between starts the count over
+    stat.CallEnd(stat.CallBegin(), false, monitor);
+    stat.ConnectFail(monitor);
+    stat.ConnectFail(monitor);
+    assert(EndpointStat::State::CLOSED == stat.state(Timer::GetSteadyClockUS()));
+
+    stat.ConnectFail(monitor);
+    uint64_t now_us{Timer::GetSteadyClockUS()};
+    assert(EndpointStat::State::OPEN == stat.state(now_us));
+    assert(!stat.Allow(now_us));
+    assert(1 == monitor.ejects && 50 == monitor.last_eject_ms && 1 == policy.ejected);
+
+    // the other one stays in, or half of them would be out
+    for (int i{0}; policy.consecutive_failures > i; ++i)
+        stats[1].ConnectFail(monitor);
+    assert(EndpointStat::State::CLOSED == stats[1].state(Timer::GetSteadyClockUS()));
+    assert(1 == monitor.ejects && 1 == policy.ejected);
+
+    // a call made before the ejection ended says nothing about the endpoint
+    const uint64_t early_us{stat.CallBegin()};
+    usleep(60 * 1000);
+    stat.CallEnd(early_us, false, monitor);
+    now_us = Timer::GetSteadyClockUS();
+    assert(EndpointStat::State::HALF_OPEN == stat.state(now_us));
+    assert(0 == monitor.restores);
+
+    // one probe per interval
+    assert(stat.Allow(now_us));
+    assert(!stat.Allow(now_us));
+    assert(stat.Allow(now_us + policy.probe_interval_ms * 1000));
+
+    stat.CallEnd(stat.CallBegin(), true, monitor);
+    assert(EndpointStat::State::OPEN == stat.state(Timer::GetSteadyClockUS()));
+    assert(2 == monitor.ejects && 100 == monitor.last_eject_ms && 1 == policy.ejected);
+
+    usleep(110 * 1000);
+    assert(EndpointStat::State::HALF_OPEN == stat.state(Timer::GetSteadyClockUS()));
+    stat.CallEnd(stat.CallBegin(), false, monitor);
+    assert(EndpointStat::State::CLOSED == stat.state(Timer::GetSteadyClockUS()));
+    assert(1 == monitor.restores && 0 == policy.ejected);
+
+    // back to the base ejection time
+    for (int i{0}; policy.consecutive_failures > i; ++i)
+        stat.ConnectFail(monitor);
+    assert(3 == monitor.ejects && 50 == monitor.last_eject_ms);
+
+    printf("ejection and restore ok\n");
+}
+
+
+}  // namespace
+
+
+int main(int argc, char **argv) {
+    RoundRobin();
+    P2C();
+    Ejection();
+
+    return 0;
+}
@@ -20,9 +20,14 @@ See the AUTHORS file for names of contributors.
 */
 
 #include <cassert>
+#include <cstdlib>
+#include <cstring>
 
 #include "caller.h"
 #include "client_monitor.h"
+#include "connection_pool.h"
+#include "hedged_caller.h"
+#include "hsha_server.h"
 #include "uthread_caller.h"
 
 #include "phxrpc/network.h"
@@ -53,8 +58,13 @@ UThreadCaller::UThreadCaller(UThreadEpollScheduler *uthread_scheduler,
           mconnect_timeout_ms(connect_timeout_ms),
           msocket_timeout_ms(socket_timeout_ms),
           call_ret_(-1),
+          status_(UThreadCallStatus::PENDING),
           callback_(callback),
-          args_(args) {
+          args_(args),
+          pool_(nullptr),
+          hedge_config_(nullptr),
+          hedge_latency_(nullptr),
+          multi_caller_(nullptr) {
 }
 
 UThreadCaller::~UThreadCaller() {
@@ -92,6 +102,27 @@ void UThreadCaller::SetRet(const int ret) {
     call_ret_ = ret;
 }
 
+UThreadCallStatus UThreadCaller::GetStatus() const {
+    return status_;
+}
+
+void UThreadCaller::SetStatus(const UThreadCallStatus status) {
+    status_ = status;
+}
+
+void UThreadCaller::SetPool(UThreadConnectionPool *pool) {
+    pool_ = pool;
+}
+
+void UThreadCaller::SetHedge(ClientConfig *config, LatencyHistogram *latency) {
+    hedge_config_ = config;
+    hedge_latency_ = latency;
+}
+
+void UThreadCaller::SetMultiCaller(UThreadMultiCaller *multi_caller) {
+    multi_caller_ = multi_caller;
+}
+
 void UThreadCaller::Callback() {
     if (nullptr != callback_) {
         callback_(this, args_);
@@ -101,24 +132,99 @@ void UThreadCaller::Callback() {
 void UThreadCaller::Call(void *args) {
     UThreadCaller *uthread_caller = (UThreadCaller *)args;
 
-    UThreadTcpStream socket;
     Endpoint_t *ep = uthread_caller->GetEP();
-    bool open_ret = phxrpc::UThreadTcpUtils::Open(
-            uthread_caller->Getuthread_scheduler(), &socket, ep->ip, ep->port,
-            uthread_caller->mconnect_timeout_ms);
-    if (open_ret) {
-        socket.SetTimeout(uthread_caller->msocket_timeout_ms);
-        phxrpc::Caller caller(socket, uthread_caller->client_monitor_,
-                              uthread_caller->msg_handler_factory_);
-        caller.GetRequest()->set_uri(uthread_caller->uri().c_str());
-        uthread_caller->SetRet(caller.Call(uthread_caller->GetRequest(),
-                                           uthread_caller->GetResponse()));
+    if (ep->local) {
+        // an HshaServer of this process, there is no connection to it, kept up till
+        // the call is done
+        shared_ptr<HshaServer> local_server{HshaServer::FindLocal(strchr(ep->ip, ':') + 1)};
+        int ret{-1};
+        if (nullptr != local_server) {
+            BlockTcpStream socket;
+            phxrpc::Caller caller(socket, uthread_caller->client_monitor_,
+                                  uthread_caller->msg_handler_factory_);
+            caller.set_uri(uthread_caller->uri().c_str(), uthread_caller->GetCmdID());
+            caller.set_endpoint_stat(ep->stat);
+            caller.set_local(local_server.get(), uthread_caller->Getuthread_scheduler());
+            ret = caller.Call(uthread_caller->GetRequest(), uthread_caller->GetResponse());
+        }
+        uthread_caller->SetRet(ret);
+    } else if (nullptr != uthread_caller->hedge_config_ && nullptr != uthread_caller->hedge_latency_) {
+        // the backup may outlive this call, what it needs is copied
+        const string uri(uthread_caller->uri());
+        const int cmd_id(uthread_caller->GetCmdID());
+        const bool keep_alive(nullptr != uthread_caller->pool_ &&
+                              uthread_caller->pool_->keep_alive());
+        ClientMonitor &client_monitor(uthread_caller->client_monitor_);
+        BaseMessageHandlerFactory &msg_handler_factory(uthread_caller->msg_handler_factory_);
+        UThreadHedgedCaller hedged_caller(uthread_caller->Getuthread_scheduler(),
+                *uthread_caller->hedge_config_, uthread_caller->pool_, client_monitor,
+                *uthread_caller->hedge_latency_,
+                [uri, cmd_id, keep_alive, &client_monitor, &msg_handler_factory](
+                        BaseTcpStream &socket, EndpointStat *endpoint_stat,
+                        const google::protobuf::Message &req, google::protobuf::Message *resp) {
+                    phxrpc::Caller caller(socket, client_monitor, msg_handler_factory);
+                    caller.set_uri(uri.c_str(), cmd_id);
+                    caller.set_keep_alive(keep_alive);
+                    caller.set_endpoint_stat(endpoint_stat);
+                    return caller.Call(req, resp);
+                });
+        uthread_caller->SetRet(hedged_caller.Call(*ep, uthread_caller->GetRequest(),
+                                                  uthread_caller->GetResponse()));
+    } else if (nullptr != uthread_caller->pool_) {
+        auto socket(uthread_caller->pool_->Get(uthread_caller->Getuthread_scheduler(), *ep,
+                                               uthread_caller->client_monitor_));
+        if (socket) {
+            phxrpc::Caller caller(*socket, uthread_caller->client_monitor_,
+                                  uthread_caller->msg_handler_factory_);
+            caller.set_uri(uthread_caller->uri().c_str(), uthread_caller->GetCmdID());
+            caller.set_keep_alive(uthread_caller->pool_->keep_alive());
+            caller.set_endpoint_stat(ep->stat);
+            uthread_caller->SetRet(caller.Call(uthread_caller->GetRequest(),
+                                               uthread_caller->GetResponse()));
+        } else {
+            uthread_caller->SetRet(-1);
+        }
     } else {
-        uthread_caller->SetRet(-1);
+        UThreadTcpStream socket;
+        // resolved by ClientConfig, or filled in by hand with ip only
+        bool open_ret = 0 != ep->addr.ss_family ?
+                phxrpc::UThreadTcpUtils::Open(
+                        uthread_caller->Getuthread_scheduler(), &socket,
+                        (const struct sockaddr *)&ep->addr, ep->addrlen,
+                        uthread_caller->mconnect_timeout_ms) :
+                phxrpc::UThreadTcpUtils::Open(
+                        uthread_caller->Getuthread_scheduler(), &socket, ep->ip, ep->port,
+                        uthread_caller->mconnect_timeout_ms);
+        if (open_ret) {
+            socket.SetTimeout(uthread_caller->msocket_timeout_ms);
+            phxrpc::Caller caller(socket, uthread_caller->client_monitor_,
+                                  uthread_caller->msg_handler_factory_);
+            caller.set_uri(uthread_caller->uri().c_str(), uthread_caller->GetCmdID());
+            caller.set_endpoint_stat(ep->stat);
+            uthread_caller->SetRet(caller.Call(uthread_caller->GetRequest(),
+                                               uthread_caller->GetResponse()));
+        } else {
+            uthread_caller->SetRet(-1);
+            if (nullptr != ep->stat) {
+                ep->stat->ConnectFail(uthread_caller->client_monitor_);
+            }
+        }
+        uthread_caller->client_monitor_.ClientConnect(open_ret);
     }
-    uthread_caller->client_monitor_.ClientConnect(open_ret);
+
+    // cancelled or timed out while it ran, its response is not to be looked at
+    if (UThreadCallStatus::PENDING != uthread_caller->GetStatus()) {
+        return;
+    }
+
+    uthread_caller->SetStatus(0 <= uthread_caller->GetRet() ?
+                              UThreadCallStatus::OK : UThreadCallStatus::FAILED);
 
     uthread_caller->Callback();
+
+    if (nullptr != uthread_caller->multi_caller_) {
+        uthread_caller->multi_caller_->CallDone(uthread_caller);
+    }
 }
 
 void UThreadCaller::Close() {
@@ -130,7 +236,10 @@ void UThreadCaller::Close() {
 UThreadMultiCaller::UThreadMultiCaller(ClientMonitor &client_monitor,
                                        BaseMessageHandlerFactory &msg_handler_factory)
         : uthread_scheduler_(64 * 1024, 300), client_monitor_(client_monitor),
-          msg_handler_factory_(msg_handler_factory) {
+          msg_handler_factory_(msg_handler_factory), policy_(MultiCallPolicy::ALL),
+          count_(0), deadline_ms_(0), pool_(nullptr), hedge_config_(nullptr),
+          hedge_latency_(nullptr), success_count_(0),
+          finished_count_(0), over_(false), watcher_(nullptr) {
 }
 
 UThreadMultiCaller::~UThreadMultiCaller() {
@@ -141,6 +250,30 @@ UThreadMultiCaller::~UThreadMultiCaller() {
     }
 
     uthread_caller_list_.clear();
+
+    // the connections wait on uthread_scheduler_, no other caller can use them
+    if (nullptr != pool_)
+        pool_->Forget(&uthread_scheduler_);
+
+    free(watcher_);
+}
+
+void UThreadMultiCaller::set_policy(const MultiCallPolicy policy, const int count) {
+    policy_ = policy;
+    count_ = count;
+}
+
+void UThreadMultiCaller::set_deadline_ms(const int deadline_ms) {
+    deadline_ms_ = deadline_ms;
+}
+
+void UThreadMultiCaller::set_pool(UThreadConnectionPool *pool) {
+    pool_ = pool;
+}
+
+void UThreadMultiCaller::set_hedge(ClientConfig *config, LatencyHistogram *latency) {
+    hedge_config_ = config;
+    hedge_latency_ = latency;
 }
 
 const int UThreadMultiCaller::GetRet(size_t index) {
@@ -150,6 +283,17 @@ const int UThreadMultiCaller::GetRet(size_t index) {
     return uthread_caller_list_[index]->GetRet();
 }
 
+UThreadCallStatus UThreadMultiCaller::GetStatus(size_t index) {
+    if (index >= uthread_caller_list_.size()) {
+        return UThreadCallStatus::FAILED;
+    }
+    return uthread_caller_list_[index]->GetStatus();
+}
+
+size_t UThreadMultiCaller::GetSuccessCount() const {
+    return success_count_;
+}
+
 void UThreadMultiCaller::AddCaller(google::protobuf::Message &request,
                                    google::protobuf::Message *response,
                                    const string &uri, const int cmd_id, const Endpoint_t &ep,
@@ -159,13 +303,104 @@ void UThreadMultiCaller::AddCaller(google::protobuf::Message &request,
             request, response, client_monitor_, msg_handler_factory_, uri, cmd_id, ep,
             connect_timeout_ms, socket_timeout_ms, callback, args);
     assert(nullptr != caller);
+    caller->SetPool(pool_);
+    caller->SetHedge(hedge_config_, hedge_latency_);
+    caller->SetMultiCaller(this);
     uthread_caller_list_.push_back(caller);
 
     uthread_scheduler_.AddTask(UThreadCaller::Call, (void *)caller);
 }
 
-void UThreadMultiCaller::MultiCall() {
+bool UThreadMultiCaller::MultiCall() {
+    if (0 < deadline_ms_ && !IsOver()) {
+        watcher_ = NewUThreadWaiter(&uthread_scheduler_);
+        uthread_scheduler_.AddTask(UThreadMultiCaller::Watch, (void *)this);
+    } else if (IsOver()) {
+        return IsMet();
+    }
+
     uthread_scheduler_.Run();
+
+    return IsMet();
+}
+
+void UThreadMultiCaller::CallDone(UThreadCaller *caller) {
+    ++finished_count_;
+    if (UThreadCallStatus::OK == caller->GetStatus()) {
+        ++success_count_;
+    }
+
+    if (over_ || !IsOver()) {
+        return;
+    }
+
+    over_ = true;
+    if (finished_count_ < uthread_caller_list_.size()) {
+        // the slowest ones are not waited for
+        Cancel(UThreadCallStatus::CANCELLED);
+    } else if (nullptr != hedge_config_) {
+        // the losing hedge calls are not waited for either
+        uthread_scheduler_.Close();
+    } else if (nullptr != watcher_) {
+        UThreadWakeUp(*watcher_);
+    }
+}
+
+void UThreadMultiCaller::Watch(void *args) {
+    UThreadMultiCaller *multi_caller = (UThreadMultiCaller *)args;
+
+    UThreadWait(*multi_caller->watcher_, multi_caller->deadline_ms_);
+
+    if (!multi_caller->over_) {
+        multi_caller->over_ = true;
+        multi_caller->Cancel(UThreadCallStatus::TIMEOUT);
+    }
+}
+
+int UThreadMultiCaller::GetNeed() const {
+    const int total = static_cast<int>(uthread_caller_list_.size());
+
+    switch (policy_) {
+        case MultiCallPolicy::FIRST_SUCCESS:
+            return 1;
+        case MultiCallPolicy::FIRST_N:
+            return count_;
+        case MultiCallPolicy::QUORUM:
+            return 0 < count_ ? count_ : total / 2 + 1;
+        default:
+            return total;
+    }
+}
+
+bool UThreadMultiCaller::IsMet() const {
+    if (MultiCallPolicy::ALL == policy_) {
+        return finished_count_ == uthread_caller_list_.size();
+    }
+
+    return static_cast<int>(success_count_) >= GetNeed();
+}
+
+bool UThreadMultiCaller::IsOver() const {
+    if (finished_count_ == uthread_caller_list_.size() || IsMet()) {
+        return true;
+    }
+
+    // the rest succeeding would not be enough
+    const size_t left = uthread_caller_list_.size() - finished_count_;
+
+    return MultiCallPolicy::ALL != policy_ &&
+           static_cast<int>(success_count_ + left) < GetNeed();
+}
+
+void UThreadMultiCaller::Cancel(const UThreadCallStatus status) {
+    for (auto &caller : uthread_caller_list_) {
+        if (UThreadCallStatus::PENDING == caller->GetStatus()) {
+            caller->SetStatus(status);
+        }
+    }
+
+    // resumes the uthreads still waiting, their sockets fail, then MultiCall returns
+    uthread_scheduler_.Close();
 }
 
 
@@ -47,11 +47,26 @@ namespace phxrpc {
 
 class BaseMessageHandlerFactory;
 class ClientMonitor;
+class LatencyHistogram;
 class UThreadCaller;
+class UThreadConnectionPool;
 class UThreadEpollScheduler;
+class UThreadMultiCaller;
 
 typedef void (*UThreadCallback)(UThreadCaller *caller, void *args);
 
+enum class UThreadCallStatus {
+    // not finished yet
+    PENDING,
+    // returned a result not less than 0
+    OK,
+    FAILED,
+    // still running once the MultiCallPolicy was met or could no longer be
+    CANCELLED,
+    // still running at the deadline of MultiCall
+    TIMEOUT,
+};
+
 class UThreadCaller {
   public:
     UThreadCaller(UThreadEpollScheduler *uthread_scheduler,
@@ -76,8 +91,18 @@ class UThreadCaller {
     const int GetRet();
     void SetRet(const int ret);
 
+    UThreadCallStatus GetStatus() const;
+    void SetStatus(const UThreadCallStatus status);
+
     void Callback();
 
+    // connections come from pool instead of one per call, ep must be of its ClientConfig
+    void SetPool(UThreadConnectionPool *pool);
+    // still running after the [Hedge] delay of config, the call gets a backup to another
+    // of its endpoints, ep must be of config, see UThreadHedgedCaller
+    void SetHedge(ClientConfig *config, LatencyHistogram *latency);
+    void SetMultiCaller(UThreadMultiCaller *multi_caller);
+
     static void Call(void *args);
 
     int mconnect_timeout_ms;
@@ -94,33 +119,93 @@ class UThreadCaller {
     Endpoint_t ep_;
 
     int call_ret_;
+    UThreadCallStatus status_;
     UThreadCallback callback_;
     void *args_;
+
+    UThreadConnectionPool *pool_;
+    ClientConfig *hedge_config_;
+    LatencyHistogram *hedge_latency_;
+    UThreadMultiCaller *multi_caller_;
 };
 
 ///////////////////////////////////////////////////////
 
+// when MultiCall returns, the calls still running then are cancelled
+enum class MultiCallPolicy {
+    ALL,
+    FIRST_SUCCESS,
+    // count calls succeeded
+    FIRST_N,
+    // count calls succeeded, more than half of them if count is 0
+    QUORUM,
+};
+
 class UThreadMultiCaller {
   public:
     UThreadMultiCaller(ClientMonitor &client_monitor,
                        BaseMessageHandlerFactory &msg_handler_factory);
     virtual ~UThreadMultiCaller();
 
+    // ALL by default
+    void set_policy(const MultiCallPolicy policy, const int count = 0);
+
+    // for MultiCall as a whole, 0 for none, by default
+    void set_deadline_ms(const int deadline_ms);
+
+    // for the callers added after, see UThreadCaller::SetPool
+    void set_pool(UThreadConnectionPool *pool);
+
+    // for the callers added after, see UThreadCaller::SetHedge, latency is of the method
+    // they call, nullptr config for none, by default
+    void set_hedge(ClientConfig *config, LatencyHistogram *latency);
+
     void AddCaller(google::protobuf::Message &request,
                    google::protobuf::Message *response,
                    const std::string &uri, const int cmd_id, const Endpoint_t &ep,
                    const int connect_timeout_ms, const int socket_timeout_ms,
                    UThreadCallback callback = nullptr, void *args = nullptr);
 
-    void MultiCall();
+    // once per UThreadMultiCaller, returns whether the policy is met, the callback
+    // of a call runs only if it finished by then
+    bool MultiCall();
 
     const int GetRet(size_t index);
 
+    UThreadCallStatus GetStatus(size_t index);
+
+    size_t GetSuccessCount() const;
+
+    // by UThreadCaller::Call
+    void CallDone(UThreadCaller *caller);
+
   private:
+    static void Watch(void *args);
+
+    // count of OK calls needed
+    int GetNeed() const;
+    bool IsMet() const;
+    // met, or too many failed for it to be met
+    bool IsOver() const;
+    // marks the calls still running status, and ends the scheduler
+    void Cancel(const UThreadCallStatus status);
+
     UThreadEpollScheduler uthread_scheduler_;
     std::vector<UThreadCaller *> uthread_caller_list_;
     ClientMonitor &client_monitor_;
     BaseMessageHandlerFactory &msg_handler_factory_;
+
+    MultiCallPolicy policy_;
+    int count_;
+    int deadline_ms_;
+    UThreadConnectionPool *pool_;
+    ClientConfig *hedge_config_;
+    LatencyHistogram *hedge_latency_;
+
+    size_t success_count_;
+    size_t finished_count_;
+    bool over_;
+    UThreadSocket_t *watcher_;
 };
 
 